@@ -213,6 +213,44 @@ static inline block_t *block_Duplicate( block_t *p_block )
     return p_dup;
 }
 
+/**
+ * Shares a block.
+ *
+ * Turns a block into a reference to its payload, so that further references
+ * can be obtained with block_Hold() without copying the data. The payload
+ * is released along with the last reference.
+ *
+ * The payload of a shared block is read-only: it must be made writable with
+ * block_Writable() before being modified in place. block_Realloc() and
+ * block_TryRealloc() take care of that by themselves.
+ *
+ * @param block block to share (consumed; can already be shared)
+ * @return the shared block, or NULL on memory error (the block is released).
+ */
+VLC_API block_t *block_Share(block_t *block) VLC_USED;
+
+/**
+ * Holds a block.
+ *
+ * Creates a new reference to the payload of a shared block, with a copy of
+ * its properties. If the block is not shared, it is duplicated instead.
+ *
+ * @return the new reference, or NULL on memory error.
+ */
+VLC_API block_t *block_Hold(block_t *block) VLC_USED;
+
+/**
+ * Makes a block writable.
+ *
+ * If the payload of the block is referenced by other blocks, it is copied
+ * to a new block, and the reference is released. Otherwise, the block is
+ * returned as is.
+ *
+ * @param block block to make writable (consumed)
+ * @return a writable block, or NULL on memory error (the block is released).
+ */
+VLC_API block_t *block_Writable(block_t *block) VLC_USED;
+
 /**
  * Wraps heap in a block.
  *
@@ -430,6 +468,23 @@ static inline block_t *block_ChainGather( block_t *p_list )
  */
 VLC_API block_fifo_t *block_FifoNew(void) VLC_USED VLC_MALLOC;
 
+/**
+ * Creates a single producer, single consumer FIFO queue of blocks.
+ *
+ * This is the same as block_FifoNew(), but block_FifoPut() and
+ * block_FifoGet() use a lock-free ring and only take the FIFO lock to wake
+ * up a sleeping consumer or when the ring is full.
+ *
+ * @warning Only one thread may queue blocks, and only one thread may dequeue
+ * blocks, at any given time. The locked vlc_fifo_*() functions remain
+ * available to these two threads. Queueing to the ring only signals the FIFO
+ * with vlc_fifo_Signal(): consumers must wait with vlc_fifo_Wait(), not
+ * vlc_fifo_WaitCond() or vlc_fifo_TimedWaitCond().
+ *
+ * @return the FIFO or NULL on memory error
+ */
+VLC_API block_fifo_t *block_FifoNewSPSC(void) VLC_USED VLC_MALLOC;
+
 /**
  * Destroys a FIFO created by block_FifoNew().
  *
@@ -278,6 +278,94 @@ VLC_API int filter_Blend( filter_t *, picture_t *p_dst, int i_dst_x, int i_dst_y
  */
 VLC_API void filter_DeleteBlend( filter_t * );
 
+/**
+ * \defgroup filter_slices Slice threading
+ * Runs a video filter on horizontal bands of its pictures in parallel.
+ *
+ * The threads are shared by all the filters of the process, and their
+ * number is set by the "filter-threads" option.
+ * @{
+ */
+typedef struct filter_slices_t filter_slices_t;
+
+#define FILTER_SLICES_MIN_LINES 32
+
+/**
+ * Processes one band of a picture.
+ *
+ * \param opaque data passed to filter_slices_Run()
+ * \param i_slice index of the band
+ * \param i_slices number of bands
+ */
+typedef void (*filter_slice_cb)( void *opaque, unsigned i_slice,
+                                 unsigned i_slices );
+
+/**
+ * Band of lines processed by a slice, see filter_slices_GetBand().
+ */
+typedef struct
+{
+    int i_first;    /**< first line to write */
+    int i_end;      /**< line following the last line to write */
+    int i_above;    /**< first line to process, including overlap lines */
+    int i_below;    /**< line following the last line to process */
+} filter_band_t;
+
+/**
+ * Creates the slice context of a filter.
+ *
+ * Bands are kept at least FILTER_SLICES_MIN_LINES lines high, so that the
+ * synchronization and the overlap lines do not outweigh the gain.
+ *
+ * \param i_lines height of the filtered pictures
+ * \param i_max_slices maximum number of bands of the filter, 0 for no limit
+ * \return the context, or NULL on error
+ */
+VLC_API filter_slices_t *filter_slices_New( filter_t *, unsigned i_lines,
+                                            unsigned i_max_slices ) VLC_USED;
+
+/**
+ * Destroys the slice context of a filter, and prints its statistics.
+ */
+VLC_API void filter_slices_Delete( filter_slices_t * );
+
+/**
+ * Returns the number of bands the pictures are split into, so that the
+ * filter can allocate per slice buffers.
+ */
+VLC_API unsigned filter_slices_Count( const filter_slices_t * ) VLC_USED;
+
+/**
+ * Calls pf_slice once for every band, from the shared threads and the
+ * calling thread, and waits for all the calls to return.
+ *
+ * The statistics count one picture per call.
+ */
+VLC_API void filter_slices_Run( filter_slices_t *, filter_slice_cb pf_slice,
+                                void *opaque );
+
+/**
+ * Computes the band of lines of a plane processed by a slice.
+ *
+ * Bands start on multiples of i_align lines. Filters whose output depends on
+ * the previous lines process i_overlap more lines above the band, and
+ * filters looking ahead as many lines below, without writing them.
+ */
+static inline void filter_slices_GetBand( filter_band_t *p_band, int i_lines,
+                                          unsigned i_slice, unsigned i_slices,
+                                          int i_align, int i_overlap )
+{
+    const int i_step = ( i_lines / i_align + i_slices - 1 ) / i_slices * i_align;
+
+    p_band->i_first = __MIN( (int)i_slice * i_step, i_lines );
+    p_band->i_end = i_slice + 1 < i_slices ?
+                    __MIN( p_band->i_first + i_step, i_lines ) : i_lines;
+    p_band->i_above = __MAX( p_band->i_first - i_overlap, 0 );
+    p_band->i_below = __MIN( p_band->i_end + i_overlap, i_lines );
+}
+
+/** @} */
+
 /**
  * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
  * using a void (*)( filter_t *, picture_t *, picture_t * ) function
@@ -424,6 +512,38 @@ VLC_API picture_t *filter_chain_VideoFilter(filter_chain_t *chain,
  */
 VLC_API void filter_chain_VideoFlush( filter_chain_t * );
 
+/**
+ * Drain a video filter chain.
+ *
+ * Returns the next picture still pending in the chain, waiting for the
+ * pipelined filters to output it if needed.
+ *
+ * \param chain pointer to filter chain
+ * \return a filtered picture, or NULL once the chain is empty
+ */
+VLC_API picture_t *filter_chain_VideoDrain(filter_chain_t *chain);
+
+/**
+ * Run each video filter of the chain on its own thread.
+ *
+ * Once enabled, filter_chain_VideoFilter() only queues the input picture
+ * and returns the next picture output by the last filter, if any. The
+ * pictures keep their order. The delay of the chain grows with the number
+ * of filters, so the last pictures must be fetched with
+ * filter_chain_VideoDrain().
+ *
+ * The filters run concurrently with the owner. Apart from the picture
+ * functions, the chain must not be used while pictures are in flight.
+ * The owner picture allocator must not wait for the chain output either.
+ *
+ * Adding or removing filters stops the threads and discards the pictures
+ * in flight. The threads start again with the next picture.
+ *
+ * \param chain pointer to a video filter chain
+ * \param depth pictures queued before each filter, or 0 to disable
+ */
+VLC_API void filter_chain_SetPipeline(filter_chain_t *chain, unsigned depth);
+
 /**
  * Generate subpictures from a chain of subpicture source "filters".
  *
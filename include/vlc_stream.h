@@ -154,6 +154,7 @@ enum stream_query_e
     STREAM_GET_CONTENT_TYPE,    /**< arg1= char **         res=can fail */
     STREAM_GET_SIGNAL,      /**< arg1=double *pf_quality, arg2=double *pf_strength   res=can fail */
     STREAM_GET_TAGS,        /**< arg1=const block_t ** res=can fail */
+    STREAM_GET_CACHE_STATS, /**< arg1=stream_cache_stats_t * res=can fail */
 
     STREAM_SET_PAUSE_STATE = 0x200, /**< arg1= bool        res=can fail */
     STREAM_SET_TITLE,       /**< arg1= int          res=can fail */
@@ -167,6 +168,20 @@ enum stream_query_e
     STREAM_GET_PRIVATE_ID_STATE,          /* arg1=int i_private_data arg2=bool *          res=can fail */
 };
 
+/**
+ * Read-ahead statistics of a caching stream filter (STREAM_GET_CACHE_STATS)
+ */
+typedef struct
+{
+    uint64_t i_read_hits;     /**< reads served without waiting */
+    uint64_t i_read_stalls;   /**< reads which had to wait for data */
+    mtime_t  i_stall_time;    /**< total time spent waiting for data */
+    uint64_t i_seek_hits;     /**< seeks served from the buffer */
+    uint64_t i_seek_misses;   /**< seeks requiring an upstream seek */
+    uint64_t i_fetched;       /**< bytes read from the source */
+    size_t   i_window;        /**< current read-ahead window (bytes) */
+} stream_cache_stats_t;
+
 /**
  * Reads data from a byte stream.
  *
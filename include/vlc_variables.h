@@ -146,6 +146,26 @@ VLC_API int var_Inherit( vlc_object_t *, const char *, int, vlc_value_t * );
 
 VLC_API void var_FreeList( vlc_value_t *, vlc_value_t * );
 
+/*****************************************************************************
+ * Variable handles
+ *****************************************************************************
+ * A handle is looked up by name once and then reads the current value of a
+ * boolean, integer or float variable without locking, e.g. once per frame.
+ * It keeps the variable alive, like var_Create() does, until var_Release().
+ * Handles must be released before the object holding the variable is.
+ *****************************************************************************/
+typedef struct variable_t vlc_var_handle_t;
+
+VLC_API vlc_var_handle_t *var_Hold( vlc_object_t *, const char * ) VLC_USED;
+#define var_Hold(a,b) var_Hold( VLC_OBJECT(a), b )
+
+VLC_API void var_Release( vlc_object_t *, vlc_var_handle_t * );
+#define var_Release(a,b) var_Release( VLC_OBJECT(a), b )
+
+VLC_API bool var_HandleGetBool( const vlc_var_handle_t * ) VLC_USED;
+VLC_API int64_t var_HandleGetInteger( const vlc_var_handle_t * ) VLC_USED;
+VLC_API float var_HandleGetFloat( const vlc_var_handle_t * ) VLC_USED;
+
 
 /*****************************************************************************
  * Variable callbacks
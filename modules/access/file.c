@@ -51,6 +51,9 @@
 #else
 #   include <unistd.h>
 #endif
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 #include <dirent.h>
 
 #include <vlc_common.h>
@@ -70,8 +73,18 @@ struct access_sys_t
     int fd;
 
     bool b_pace_control;
+#ifdef HAVE_MMAP
+    /* Memory-mapped mode */
+    uint64_t offset; /* current position */
+    size_t   page_mask;
+#endif
 };
 
+#ifdef HAVE_MMAP
+/** Size of the file windows returned by the memory-mapped mode */
+# define FILE_MMAP_WINDOW (1 << 20)
+#endif
+
 #if !defined (_WIN32) && !defined (__OS2__)
 static bool IsRemote (int fd)
 {
@@ -127,9 +140,16 @@ static bool IsRemote (const char *path)
 #ifndef HAVE_POSIX_FADVISE
 # define posix_fadvise(fd, off, len, adv)
 #endif
+#ifndef HAVE_POSIX_MADVISE
+# define posix_madvise(addr, len, adv)
+#endif
 
 static ssize_t Read (stream_t *, void *, size_t);
 static int FileSeek (stream_t *, uint64_t);
+#ifdef HAVE_MMAP
+static block_t *MmapBlock (stream_t *, bool *);
+static int MmapSeek (stream_t *, uint64_t);
+#endif
 static int NoSeek (stream_t *, uint64_t);
 static int FileControl (stream_t *, int, va_list);
 
@@ -237,6 +257,21 @@ int FileOpen( vlc_object_t *p_this )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        /* Local regular files can be mapped instead of read. Remote files are
+         * not, as a network error would fault the mapping (SIGBUS). */
+        if (S_ISREG (st.st_mode) && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote(fd, p_access->psz_filepath))
+        {
+            msg_Dbg (p_access, "using memory-mapped file access");
+            p_access->pf_read = NULL;
+            p_access->pf_block = MmapBlock;
+            p_access->pf_seek = MmapSeek;
+            p_sys->offset = 0;
+            p_sys->page_mask = sysconf (_SC_PAGESIZE) - 1;
+            posix_fadvise (fd, 0, FILE_MMAP_WINDOW, POSIX_FADV_WILLNEED);
+        }
 #endif
     }
     else
@@ -259,7 +294,7 @@ void FileClose (vlc_object_t * p_this)
 {
     stream_t     *p_access = (stream_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_read == NULL && p_access->pf_block == NULL)
     {
         DirClose (p_this);
         return;
@@ -308,6 +343,102 @@ static int FileSeek (stream_t *p_access, uint64_t i_pos)
     return VLC_SUCCESS;
 }
 
+#ifdef HAVE_MMAP
+/*****************************************************************************
+ * MmapReadBlock: read the next window of the file, if it cannot be mapped
+ *****************************************************************************/
+static block_t *MmapReadBlock (stream_t *p_access, size_t length,
+                               bool *restrict eof)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    block_t *block = block_Alloc (length);
+    if (unlikely(block == NULL))
+    {
+        *eof = true;
+        return NULL;
+    }
+
+    ssize_t val = pread (p_sys->fd, block->p_buffer, length, p_sys->offset);
+    if (val <= 0)
+    {
+        if (val < 0)
+            msg_Err (p_access, "read error: %s", vlc_strerror_c(errno));
+        block_Release (block);
+        *eof = true;
+        return NULL;
+    }
+
+    block->i_buffer = val;
+    p_sys->offset += val;
+    return block;
+}
+
+/*****************************************************************************
+ * MmapBlock: map the next window of the file
+ *****************************************************************************/
+static block_t *MmapBlock (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    struct stat st;
+
+    /* The file may be growing, check its size every time. */
+    if (fstat (p_sys->fd, &st))
+    {
+        msg_Err (p_access, "read error: %s", vlc_strerror_c(errno));
+        *eof = true;
+        return NULL;
+    }
+
+    if (p_sys->offset >= (uint64_t)st.st_size)
+    {
+        *eof = true;
+        return NULL;
+    }
+
+    /* Mappings start on a page boundary */
+    size_t inner = p_sys->offset & p_sys->page_mask;
+    off_t outer = p_sys->offset - inner;
+    size_t length = FILE_MMAP_WINDOW;
+
+    if ((uint64_t)st.st_size - p_sys->offset < length - inner)
+        length = st.st_size - p_sys->offset + inner;
+
+    void *addr = mmap (NULL, length, PROT_READ, MAP_SHARED, p_sys->fd, outer);
+    if (addr == MAP_FAILED)
+    {
+        msg_Warn (p_access, "memory mapping failed: %s",
+                  vlc_strerror_c(errno));
+        return MmapReadBlock (p_access, length - inner, eof);
+    }
+    posix_madvise (addr, length, POSIX_MADV_SEQUENTIAL);
+
+    /* The mapping is released on failure */
+    block_t *block = block_mmap_Alloc (addr, length);
+    if (unlikely(block == NULL))
+        return MmapReadBlock (p_access, length - inner, eof);
+
+    block->p_buffer += inner;
+    block->i_buffer -= inner;
+    p_sys->offset += block->i_buffer;
+
+    /* Ask for the next window while this one is being consumed */
+    posix_fadvise (p_sys->fd, outer + length, FILE_MMAP_WINDOW,
+                   POSIX_FADV_WILLNEED);
+    return block;
+}
+
+static int MmapSeek (stream_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    p_sys->offset = i_pos;
+    posix_fadvise (p_sys->fd, i_pos & ~(uint64_t)p_sys->page_mask,
+                   FILE_MMAP_WINDOW, POSIX_FADV_WILLNEED);
+    return VLC_SUCCESS;
+}
+#endif
+
 static int NoSeek (stream_t *p_access, uint64_t i_pos)
 {
     /* vlc_assert_unreachable(); ?? */
@@ -98,6 +98,7 @@ struct vlc_http_mgr
     vlc_tls_creds_t *creds;
     struct vlc_http_cookie_jar_t *jar;
     struct vlc_http_conn *conn;
+    vlc_mutex_t lock; /**< protects creds and conn */
 };
 
 static struct vlc_http_conn *vlc_http_mgr_find(struct vlc_http_mgr *mgr,
@@ -116,6 +117,21 @@ static void vlc_http_mgr_release(struct vlc_http_mgr *mgr,
     vlc_http_conn_release(conn);
 }
 
+/**
+ * Waits for the response headers of a stream.
+ *
+ * The manager lock is dropped meanwhile, so that other threads can open
+ * their own streams on the same (HTTP/2) connection.
+ */
+static struct vlc_http_msg *vlc_http_mgr_wait(struct vlc_http_mgr *mgr,
+                                              struct vlc_http_stream *stream)
+{
+    vlc_mutex_unlock(&mgr->lock);
+    struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
+    vlc_mutex_lock(&mgr->lock);
+    return m;
+}
+
 static
 struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr,
                                         const char *host, unsigned port,
@@ -128,7 +144,7 @@ struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr,
     struct vlc_http_stream *stream = vlc_http_stream_open(conn, req);
     if (stream != NULL)
     {
-        struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
+        struct vlc_http_msg *m = vlc_http_mgr_wait(mgr, stream);
         if (m != NULL)
             return m;
 
@@ -137,8 +153,9 @@ struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr,
          * far, and CONNECT is treated as if it were idempotent (which works
          * fine here). */
     }
-    /* Get rid of closing or reset connection */
-    vlc_http_mgr_release(mgr, conn);
+    /* Get rid of closing or reset connection, unless another thread did */
+    if (mgr->conn == conn)
+        vlc_http_mgr_release(mgr, conn);
     return NULL;
 }
 
@@ -164,20 +181,22 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
     if (resp != NULL)
         return resp; /* existing connection reused */
 
+    /* The credentials are never released before the manager: connecting
+     * can take a while, so do it unlocked as vlc_http_mgr_wait() does */
+    vlc_tls_creds_t *creds = mgr->creds;
+    vlc_mutex_unlock(&mgr->lock);
+
     char *proxy = vlc_http_proxy_find(host, port, true);
     if (proxy != NULL)
     {
-        tls = vlc_https_connect_proxy(mgr->creds, mgr->creds,
+        tls = vlc_https_connect_proxy(creds, creds,
                                       host, port, &http2, proxy);
         free(proxy);
     }
     else
-        tls = vlc_https_connect(mgr->creds, host, port, &http2);
-
-    if (tls == NULL)
-        return NULL;
+        tls = vlc_https_connect(creds, host, port, &http2);
 
-    struct vlc_http_conn *conn;
+    struct vlc_http_conn *conn = NULL;
 
     /* For HTTPS, TLS-ALPN determines whether HTTP version 2.0 ("h2") or 1.1
      * ("http/1.1") is used.
@@ -186,17 +205,35 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
      * supported by the server.
      * NOTE: We do not enforce TLS version 1.2 for HTTP 2.0 explicitly.
      */
-    if (http2)
-        conn = vlc_h2_conn_create(mgr->obj, tls);
-    else
-        conn = vlc_h1_conn_create(mgr->obj, tls, false);
-
-    if (unlikely(conn == NULL))
+    if (tls != NULL)
     {
-        vlc_tls_Close(tls);
-        return NULL;
+        if (http2)
+            conn = vlc_h2_conn_create(mgr->obj, tls);
+        else
+            conn = vlc_h1_conn_create(mgr->obj, tls, false);
+
+        if (unlikely(conn == NULL))
+            vlc_tls_Close(tls);
+    }
+
+    vlc_mutex_lock(&mgr->lock);
+
+    if (mgr->conn != NULL)
+    {   /* Another thread connected meanwhile: use its connection if free */
+        resp = vlc_http_mgr_reuse(mgr, host, port, req);
+        if (resp != NULL)
+        {
+            if (conn != NULL)
+                vlc_http_conn_release(conn);
+            return resp;
+        }
     }
 
+    if (conn == NULL)
+        return NULL;
+
+    if (mgr->conn != NULL) /* busy HTTP/1 connection */
+        vlc_http_mgr_release(mgr, mgr->conn);
     mgr->conn = conn;
 
     return vlc_http_mgr_reuse(mgr, host, port, req);
@@ -240,13 +277,15 @@ static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
     if (stream == NULL)
         return NULL;
 
-    resp = vlc_http_msg_get_initial(stream);
+    resp = vlc_http_mgr_wait(mgr, stream);
     if (resp == NULL)
     {
         vlc_http_conn_release(conn);
         return NULL;
     }
 
+    if (mgr->conn != NULL) /* replaced by another thread meanwhile */
+        vlc_http_mgr_release(mgr, mgr->conn);
     mgr->conn = conn;
     return resp;
 }
@@ -255,7 +294,11 @@ struct vlc_http_msg *vlc_http_mgr_request(struct vlc_http_mgr *mgr, bool https,
                                           const char *host, unsigned port,
                                           const struct vlc_http_msg *m)
 {
-    return (https ? vlc_https_request : vlc_http_request)(mgr, host, port, m);
+    vlc_mutex_lock(&mgr->lock);
+    struct vlc_http_msg *resp =
+        (https ? vlc_https_request : vlc_http_request)(mgr, host, port, m);
+    vlc_mutex_unlock(&mgr->lock);
+    return resp;
 }
 
 struct vlc_http_cookie_jar_t *vlc_http_mgr_get_jar(struct vlc_http_mgr *mgr)
@@ -274,6 +317,7 @@ struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
     mgr->creds = NULL;
     mgr->jar = jar;
     mgr->conn = NULL;
+    vlc_mutex_init(&mgr->lock);
     return mgr;
 }
 
@@ -283,5 +327,6 @@ void vlc_http_mgr_destroy(struct vlc_http_mgr *mgr)
         vlc_http_mgr_release(mgr, mgr->conn);
     if (mgr->creds != NULL)
         vlc_tls_Delete(mgr->creds);
+    vlc_mutex_destroy(&mgr->lock);
     free(mgr);
 }
@@ -117,6 +117,7 @@ struct vlc_h1_conn
     bool released;
     bool proxy;
     void *opaque;
+    vlc_mutex_t lock; /**< protects active and released */
 };
 
 #define CO(conn) ((conn)->opaque)
@@ -147,7 +148,11 @@ static struct vlc_http_stream *vlc_h1_stream_open(struct vlc_http_conn *c,
     size_t len;
     ssize_t val;
 
-    if (conn->active || conn->conn.tls == NULL)
+    vlc_mutex_lock(&conn->lock);
+    bool busy = conn->active;
+    vlc_mutex_unlock(&conn->lock);
+
+    if (busy || conn->conn.tls == NULL)
         return NULL;
 
     char *payload = vlc_http_msg_format(req, &len, conn->proxy);
@@ -174,7 +179,9 @@ static struct vlc_http_stream *vlc_h1_stream_open(struct vlc_http_conn *c,
         block = vlc_http_msg_read( req );
     }
 
+    vlc_mutex_lock(&conn->lock);
     conn->active = true;
+    vlc_mutex_unlock(&conn->lock);
     conn->content_length = body_streamed_size;
     conn->connection_close = false;
     return &conn->stream;
@@ -290,9 +297,13 @@ static void vlc_h1_stream_close(struct vlc_http_stream *stream, bool abort)
     if (abort)
         vlc_h1_stream_fatal(conn);
 
+    /* The owner may release the connection from another thread */
+    vlc_mutex_lock(&conn->lock);
     conn->active = false;
+    bool destroy = conn->released;
+    vlc_mutex_unlock(&conn->lock);
 
-    if (conn->released)
+    if (destroy)
         vlc_h1_conn_destroy(conn);
 }
 
@@ -313,6 +324,7 @@ static void vlc_h1_conn_destroy(struct vlc_h1_conn *conn)
         vlc_tls_Shutdown(conn->conn.tls, true);
         vlc_tls_Close(conn->conn.tls);
     }
+    vlc_mutex_destroy(&conn->lock);
     free(conn);
 }
 
@@ -320,10 +332,13 @@ static void vlc_h1_conn_release(struct vlc_http_conn *c)
 {
     struct vlc_h1_conn *conn = container_of(c, struct vlc_h1_conn, conn);
 
+    vlc_mutex_lock(&conn->lock);
     assert(!conn->released);
     conn->released = true;
+    bool destroy = !conn->active;
+    vlc_mutex_unlock(&conn->lock);
 
-    if (!conn->active)
+    if (destroy)
         vlc_h1_conn_destroy(conn);
 }
 
@@ -346,6 +361,7 @@ struct vlc_http_conn *vlc_h1_conn_create(void *ctx, vlc_tls_t *tls, bool proxy)
     conn->released = false;
     conn->proxy = proxy;
     conn->opaque = ctx;
+    vlc_mutex_init(&conn->lock);
 
     return &conn->conn;
 }
@@ -100,6 +100,181 @@ static int rtp_timeout (mtime_t deadline)
     return t;
 }
 
+#ifdef HAVE_RECVMMSG
+/** Maximum number of datagrams received per system call */
+# define RTP_BATCH 32
+
+# ifdef SO_TIMESTAMPNS
+/**
+ * Converts the kernel reception time-stamp of a datagram, if any, to the
+ * VLC clock. This excludes the scheduling latency of the thread from the
+ * jitter estimation.
+ */
+static mtime_t rtp_rx_time (struct msghdr *msg, const struct timespec *rt,
+                            mtime_t now)
+{
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR (msg);
+         cmsg != NULL;
+         cmsg = CMSG_NXTHDR (msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET
+         || cmsg->cmsg_type != SCM_TIMESTAMPNS)
+            continue;
+
+        struct timespec ts;
+        memcpy (&ts, CMSG_DATA (cmsg), sizeof (ts));
+
+        mtime_t age = (rt->tv_sec - ts.tv_sec) * CLOCK_FREQ
+                    + (rt->tv_nsec - ts.tv_nsec) / (1000000000 / CLOCK_FREQ);
+        if (age >= 0 && age < CLOCK_FREQ)
+            return now - age;
+        break; /* wall clock was changed */
+    }
+    return now;
+}
+# endif
+
+/**
+ * RTP/RTCP session thread for datagram sockets
+ *
+ * Pending datagrams are received in batches, with a single system call.
+ */
+void *rtp_dgram_thread (void *opaque)
+{
+    demux_t *demux = opaque;
+    demux_sys_t *sys = demux->p_sys;
+    mtime_t deadline = VLC_TS_INVALID;
+    int rtp_fd = sys->fd;
+    size_t mru = DEFAULT_MRU;
+    struct mmsghdr msgv[RTP_BATCH];
+    struct iovec iov[RTP_BATCH];
+    block_t *blockv[RTP_BATCH];
+# ifdef SO_TIMESTAMPNS
+    union
+    {
+        char buf[CMSG_SPACE (sizeof (struct timespec))];
+        struct cmsghdr align;
+    } cmsgv[RTP_BATCH];
+
+    if (setsockopt (rtp_fd, SOL_SOCKET, SO_TIMESTAMPNS, &(int){ 1 },
+                    sizeof (int)))
+        msg_Dbg (demux, "no kernel reception time-stamps");
+# endif
+
+    for (unsigned i = 0; i < RTP_BATCH; i++)
+        blockv[i] = NULL;
+
+    struct pollfd ufd[1];
+    ufd[0].fd = rtp_fd;
+    ufd[0].events = POLLIN;
+
+    for (;;)
+    {
+        int n = poll (ufd, 1, rtp_timeout (deadline));
+        if (n == -1)
+            continue;
+
+        int canc = vlc_savecancel ();
+        if (n == 0)
+            goto dequeue;
+
+        if (ufd[0].revents)
+        {
+            if (unlikely(ufd[0].revents & POLLHUP))
+                break; /* RTP socket dead (DCCP only) */
+
+            unsigned count;
+
+            for (count = 0; count < RTP_BATCH; count++)
+            {
+                block_t *block = blockv[count];
+
+                if (block != NULL && block->i_buffer < mru)
+                {   /* MRU was raised after a truncated packet */
+                    block_Release (block);
+                    block = NULL;
+                }
+                if (block == NULL)
+                {
+                    block = block_Alloc (mru);
+                    if (unlikely(block == NULL))
+                        break;
+                }
+                blockv[count] = block;
+
+                iov[count].iov_base = block->p_buffer;
+                iov[count].iov_len = block->i_buffer;
+                memset (&msgv[count], 0, sizeof (msgv[count]));
+                msgv[count].msg_hdr.msg_iov = &iov[count];
+                msgv[count].msg_hdr.msg_iovlen = 1;
+# ifdef SO_TIMESTAMPNS
+                msgv[count].msg_hdr.msg_control = cmsgv[count].buf;
+                msgv[count].msg_hdr.msg_controllen = sizeof (cmsgv[count].buf);
+# endif
+            }
+
+            if (unlikely(count == 0))
+            {
+                if (mru == DEFAULT_MRU)
+                    break; /* we are totallly screwed */
+                mru = DEFAULT_MRU;
+                vlc_restorecancel (canc);
+                continue; /* retry with shrunk MRU */
+            }
+
+            int flags = MSG_DONTWAIT;
+# ifdef __linux__
+            flags |= MSG_TRUNC; /* report the real length of truncated packets */
+# endif
+            int val = recvmmsg (rtp_fd, msgv, count, flags, NULL);
+            if (val == -1)
+                msg_Warn (demux, "RTP network error: %s",
+                          vlc_strerror_c(errno));
+
+            mtime_t now = mdate ();
+# ifdef SO_TIMESTAMPNS
+            struct timespec rt;
+            clock_gettime (CLOCK_REALTIME, &rt);
+# endif
+
+            for (int i = 0; i < val; i++)
+            {
+                block_t *block = blockv[i];
+                size_t len = msgv[i].msg_len;
+
+                blockv[i] = NULL;
+                if (msgv[i].msg_hdr.msg_flags & MSG_TRUNC)
+                {
+                    msg_Err(demux, "%zu bytes packet truncated (MRU was %zu)",
+                            len, mru);
+                    block->i_flags |= BLOCK_FLAG_CORRUPTED;
+                    if (len > mru)
+                        mru = len;
+                }
+                else
+                    block->i_buffer = len;
+
+# ifdef SO_TIMESTAMPNS
+                block->i_pts = rtp_rx_time (&msgv[i].msg_hdr, &rt, now);
+# else
+                block->i_pts = now;
+# endif
+                rtp_process (demux, block);
+            }
+        }
+
+    dequeue:
+        if (!rtp_dequeue (demux, sys->session, &deadline))
+            deadline = VLC_TS_INVALID;
+        vlc_restorecancel (canc);
+    }
+
+    for (unsigned i = 0; i < RTP_BATCH; i++)
+        if (blockv[i] != NULL)
+            block_Release (blockv[i]);
+    return NULL;
+}
+#else
 /**
  * RTP/RTCP session thread for datagram sockets
  */
@@ -187,6 +362,7 @@ void *rtp_dgram_thread (void *opaque)
     }
     return NULL;
 }
+#endif
 
 /**
  * RTP/RTCP session thread for stream sockets (framed RTP)
@@ -233,7 +233,8 @@ rtp_find_ptype (const rtp_session_t *session, rtp_source_t *source,
  *
  * @param demux VLC demux object
  * @param session RTP session receiving the packet
- * @param block RTP packet including the RTP header
+ * @param block RTP packet including the RTP header, with its reception time
+ * as PTS if known (VLC_TS_INVALID otherwise)
  */
 void
 rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
@@ -256,7 +257,9 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
         block->i_buffer -= padding;
     }
 
-    mtime_t        now = mdate ();
+    /* Reception time, if the receiving thread knows it */
+    mtime_t        now = (block->i_pts > VLC_TS_INVALID) ? block->i_pts
+                                                         : mdate ();
     rtp_source_t  *src  = NULL;
     const uint16_t seq  = rtp_seq (block);
     const uint32_t ssrc = GetDWBE (block->p_buffer + 8);
@@ -76,11 +76,23 @@ vlc_module_begin ()
     set_callbacks( Open, Close )
 vlc_module_end ()
 
+#ifdef HAVE_RECVMMSG
+/** Maximum number of datagrams received per system call */
+# define UDP_BATCH 32
+#endif
+
 struct access_sys_t
 {
     int fd;
     int timeout;
     size_t mtu;
+#ifdef HAVE_RECVMMSG
+    /* Datagram buffers: slots[next..count) were received and not yet
+     * returned, the others are empty buffers kept for the next batch. */
+    block_t *slots[UDP_BATCH];
+    unsigned next;
+    unsigned count;
+#endif
 };
 
 /*****************************************************************************
@@ -169,6 +181,11 @@ static int Open( vlc_object_t *p_this )
     }
 
     sys->mtu = 7 * 188;
+#ifdef HAVE_RECVMMSG
+    for( unsigned i = 0; i < UDP_BATCH; i++ )
+        sys->slots[i] = NULL;
+    sys->next = sys->count = 0;
+#endif
 
     sys->timeout = var_InheritInteger( p_access, "udp-timeout");
     if( sys->timeout > 0)
@@ -185,6 +202,11 @@ static void Close( vlc_object_t *p_this )
     stream_t     *p_access = (stream_t*)p_this;
     access_sys_t *sys = p_access->p_sys;
 
+#ifdef HAVE_RECVMMSG
+    for( unsigned i = 0; i < UDP_BATCH; i++ )
+        if( sys->slots[i] != NULL )
+            block_Release( sys->slots[i] );
+#endif
     net_Close( sys->fd );
 }
 
@@ -221,6 +243,114 @@ static int Control( stream_t *p_access, int i_query, va_list args )
 /*****************************************************************************
  * BlockUDP:
  *****************************************************************************/
+static int PollUDP(stream_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+    struct pollfd ufd[1];
+
+    ufd[0].fd = sys->fd;
+    ufd[0].events = POLLIN;
+
+    switch (vlc_poll_i11e(ufd, 1, sys->timeout))
+    {
+        case 0:
+            msg_Err(access, "receive time-out");
+            *eof = true;
+            /* fall through */
+        case -1:
+            return -1;
+    }
+    return 0;
+}
+
+#ifdef HAVE_RECVMMSG
+/**
+ * Receives as many pending datagrams as possible with a single system call,
+ * then returns them one at a time.
+ */
+static block_t *BlockUDP(stream_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+
+    if (sys->next < sys->count)
+    {
+        block_t *pkt = sys->slots[sys->next];
+
+        sys->slots[sys->next++] = NULL;
+        return pkt;
+    }
+
+    struct mmsghdr msgv[UDP_BATCH];
+    struct iovec iov[UDP_BATCH];
+    unsigned n;
+
+    for (n = 0; n < UDP_BATCH; n++)
+    {
+        block_t *pkt = sys->slots[n];
+
+        if (pkt != NULL && pkt->i_buffer < sys->mtu)
+        {   /* MTU was raised after a truncated packet */
+            block_Release(pkt);
+            pkt = NULL;
+        }
+        if (pkt == NULL)
+        {
+            pkt = block_Alloc(sys->mtu);
+            if (unlikely(pkt == NULL))
+                break;
+        }
+        sys->slots[n] = pkt;
+
+        iov[n].iov_base = pkt->p_buffer;
+        iov[n].iov_len = pkt->i_buffer;
+        memset(&msgv[n], 0, sizeof (msgv[n]));
+        msgv[n].msg_hdr.msg_iov = &iov[n];
+        msgv[n].msg_hdr.msg_iovlen = 1;
+    }
+
+    if (unlikely(n == 0))
+    {   /* OOM - dequeue and discard one packet */
+        char dummy;
+        recv(sys->fd, &dummy, 1, 0);
+        return NULL;
+    }
+
+    if (PollUDP(access, eof))
+        return NULL;
+
+    int flags = MSG_DONTWAIT;
+#ifdef __linux__
+    flags |= MSG_TRUNC; /* report the real length of truncated packets */
+#endif
+    int val = recvmmsg(sys->fd, msgv, n, flags, NULL);
+    if (val <= 0)
+        return NULL;
+
+    for (int i = 0; i < val; i++)
+    {
+        block_t *pkt = sys->slots[i];
+        size_t len = msgv[i].msg_len;
+
+        if (msgv[i].msg_hdr.msg_flags & MSG_TRUNC)
+        {
+            msg_Err(access, "%zu bytes packet truncated (MTU was %zu)",
+                    len, sys->mtu);
+            pkt->i_flags |= BLOCK_FLAG_CORRUPTED;
+            if (len > sys->mtu)
+                sys->mtu = len;
+        }
+        else
+            pkt->i_buffer = len;
+    }
+
+    sys->count = val;
+    sys->next = 1;
+
+    block_t *pkt = sys->slots[0];
+    sys->slots[0] = NULL;
+    return pkt;
+}
+#else
 static block_t *BlockUDP(stream_t *access, bool *restrict eof)
 {
     access_sys_t *sys = access->p_sys;
@@ -245,20 +375,8 @@ static block_t *BlockUDP(stream_t *access, bool *restrict eof)
 #endif
     };
 
-    struct pollfd ufd[1];
-
-    ufd[0].fd = sys->fd;
-    ufd[0].events = POLLIN;
-
-    switch (vlc_poll_i11e(ufd, 1, sys->timeout))
-    {
-        case 0:
-            msg_Err(access, "receive time-out");
-            *eof = true;
-            /* fall through */
-        case -1:
-            goto skip;
-     }
+    if (PollUDP(access, eof))
+        goto skip;
 
     ssize_t len = recvmsg(sys->fd, &msg, 0);
     if (len < 0)
@@ -282,3 +400,4 @@ skip:
 
     return pkt;
 }
+#endif
@@ -48,8 +48,14 @@
 #endif
 
 #include <vlc_network.h>
+#ifdef HAVE_SENDMMSG
+#   include <netinet/in.h>
+#   include <netinet/udp.h>
+#endif
 
 #define MAX_EMPTY_BLOCKS 200
+/* Maximum number of packets sent at once */
+#define MAX_BATCH_PACKETS 64
 
 /*****************************************************************************
  * Module descriptor
@@ -71,6 +77,15 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define WINDOW_TEXT N_("Send window (ms)")
+#define WINDOW_LONGTEXT N_("Packets due within this time of the first " \
+                           "pending packet are sent together, with a " \
+                           "single system call where supported.")
+
+#define GSO_TEXT N_("UDP segmentation offload")
+#define GSO_LONGTEXT N_("Pass batches of equally-sized packets to the " \
+                        "kernel as a single segmented datagram.")
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -79,6 +94,9 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_integer( SOUT_CFG_PREFIX "window", 0, WINDOW_TEXT, WINDOW_LONGTEXT,
+                                 true )
+    add_bool( SOUT_CFG_PREFIX "gso", false, GSO_TEXT, GSO_LONGTEXT, true )
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +110,8 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "window",
+    "gso",
     NULL
 };
 
@@ -209,8 +229,8 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
-    p_sys->p_empty_blocks = block_FifoNew();
+    p_sys->p_fifo = block_FifoNewSPSC();
+    p_sys->p_empty_blocks = block_FifoNewSPSC();
     p_sys->p_buffer = NULL;
 
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
@@ -380,6 +400,126 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+/* Packets dequeued by the sender thread and not sent yet */
+struct udp_batch
+{
+    block_t *pkts[MAX_BATCH_PACKETS];
+    unsigned count;
+    block_t *pending; /* next packet, not due within the window */
+    mtime_t date_last; /* date of the last dated packet */
+};
+
+static void ReleaseBatch( void *data )
+{
+    struct udp_batch *batch = data;
+
+    for( unsigned i = 0; i < batch->count; i++ )
+        block_Release( batch->pkts[i] );
+    if( batch->pending != NULL )
+        block_Release( batch->pending );
+}
+
+/*****************************************************************************
+ * SendBatch: send packets with as few system calls as possible
+ *****************************************************************************/
+static void SendBatch( sout_access_out_t *p_access, block_t **pkts,
+                       unsigned count, bool *pb_gso, unsigned *pi_calls )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    int fd = p_sys->i_handle;
+
+#ifdef HAVE_SENDMMSG
+    struct iovec iov[MAX_BATCH_PACKETS];
+
+    for( unsigned i = 0; i < count; i++ )
+    {
+        iov[i].iov_base = pkts[i]->p_buffer;
+        iov[i].iov_len = pkts[i]->i_buffer;
+    }
+
+# ifdef UDP_SEGMENT
+    /* With segmentation offload, all packets but the last must have the same
+     * size, and the kernel splits the concatenated payload accordingly. */
+    bool b_same = *pb_gso && count > 1;
+    size_t i_total = pkts[0]->i_buffer;
+    for( unsigned i = 1; b_same && i < count; i++ )
+    {
+        b_same = (i + 1 < count) ? pkts[i]->i_buffer == pkts[0]->i_buffer
+                                 : pkts[i]->i_buffer <= pkts[0]->i_buffer;
+        i_total += pkts[i]->i_buffer;
+    }
+    if( b_same && i_total <= 65000 /* IP datagram size limit */ )
+    {
+        union
+        {
+            char buf[CMSG_SPACE(sizeof (uint16_t))];
+            struct cmsghdr align;
+        } control;
+        struct msghdr msg = {
+            .msg_iov = iov,
+            .msg_iovlen = count,
+            .msg_control = control.buf,
+            .msg_controllen = sizeof (control.buf),
+        };
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+        uint16_t segsize = pkts[0]->i_buffer;
+
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof (segsize));
+        memcpy( CMSG_DATA(cmsg), &segsize, sizeof (segsize) );
+
+        (*pi_calls)++;
+        if( sendmsg( fd, &msg, 0 ) >= 0 )
+            return;
+        if( errno == EINVAL || errno == EIO || errno == ENOPROTOOPT )
+        {
+            msg_Warn( p_access, "UDP segmentation offload not supported" );
+            *pb_gso = false;
+        }
+        else
+        {
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            return;
+        }
+    }
+# else
+    (void) pb_gso;
+# endif
+
+    struct mmsghdr msgv[MAX_BATCH_PACKETS];
+
+    memset( msgv, 0, count * sizeof (*msgv) );
+    for( unsigned i = 0; i < count; i++ )
+    {
+        msgv[i].msg_hdr.msg_iov = &iov[i];
+        msgv[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for( unsigned i = 0; i < count; )
+    {
+        (*pi_calls)++;
+        int val = sendmmsg( fd, msgv + i, count - i, 0 );
+        if( val <= 0 )
+        {
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            i++; /* skip the failing packet */
+        }
+        else
+            i += val;
+    }
+#else
+    (void) pb_gso;
+
+    for( unsigned i = 0; i < count; i++ )
+    {
+        (*pi_calls)++;
+        if( send( fd, pkts[i]->p_buffer, pkts[i]->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+    }
+#endif
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -387,50 +527,115 @@ static void* ThreadWrite( void *data )
 {
     sout_access_out_t *p_access = data;
     sout_access_out_sys_t *p_sys = p_access->p_sys;
-    mtime_t i_date_last = -1;
     const unsigned i_group = var_GetInteger( p_access,
                                              SOUT_CFG_PREFIX "group" );
+    const mtime_t i_window = INT64_C(1000)
+                           * var_GetInteger( p_access, SOUT_CFG_PREFIX "window" );
+    bool b_gso = var_GetBool( p_access, SOUT_CFG_PREFIX "gso" );
     mtime_t i_to_send = i_group;
     unsigned i_dropped_packets = 0;
+    /* The state modified in the loop lives in the batch, as the cleanup
+     * handler may be registered with setjmp() */
+    struct udp_batch batch = { .count = 0, .pending = NULL, .date_last = -1 };
+
+    /* Send jitter statistics */
+    struct
+    {
+        mtime_t i_next; /* next report date */
+        mtime_t i_sum;
+        mtime_t i_max;
+        unsigned i_packets;
+        unsigned i_calls;
+    } stats = { .i_next = mdate() + 10 * CLOCK_FREQ };
+
+    vlc_cleanup_push( ReleaseBatch, &batch );
 
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
-        mtime_t       i_date, i_sent;
+        mtime_t i_deadline = VLC_TS_INVALID;
 
-        i_date = p_sys->i_caching + p_pk->i_dts;
-        if( i_date_last > 0 )
+        /* Collect the packets due within the send window */
+        while( batch.count < MAX_BATCH_PACKETS )
         {
-            if( i_date - i_date_last > 2000000 )
+            block_t *p_pk = batch.pending;
+            batch.pending = NULL;
+
+            if( p_pk == NULL )
             {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
-                             i_date - i_date_last );
+                if( batch.count == 0 )
+                    p_pk = block_FifoGet( p_sys->p_fifo );
+                else
+                {   /* Do not wait for more packets */
+                    vlc_fifo_Lock( p_sys->p_fifo );
+                    p_pk = vlc_fifo_DequeueUnlocked( p_sys->p_fifo );
+                    vlc_fifo_Unlock( p_sys->p_fifo );
+                    if( p_pk == NULL )
+                        break;
+                }
 
-                block_FifoPut( p_sys->p_empty_blocks, p_pk );
+                if( p_pk->i_dts <= VLC_TS_INVALID )
+                {   /* Undated packet: nothing to wait for */
+                    p_pk->i_pts = VLC_TS_INVALID;
+                    batch.pkts[batch.count++] = p_pk;
+                    break;
+                }
+
+                mtime_t i_date = p_sys->i_caching + p_pk->i_dts;
+                if( batch.date_last > 0 )
+                {
+                    if( i_date - batch.date_last > 2000000 )
+                    {
+                        if( !i_dropped_packets )
+                            msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
+                                     i_date - batch.date_last );
+
+                        block_FifoPut( p_sys->p_empty_blocks, p_pk );
+
+                        batch.date_last = i_date;
+                        i_dropped_packets++;
+                        continue;
+                    }
+                    else if( i_date - batch.date_last < -1000 )
+                    {
+                        if( !i_dropped_packets )
+                            msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
+                                     batch.date_last - i_date );
+                    }
+                }
+                batch.date_last = i_date;
 
-                i_date_last = i_date;
-                i_dropped_packets++;
-                continue;
+                /* Only the last packet of a group, or a packet with a PCR,
+                 * has to wait for its date. Others are sent right away. */
+                i_to_send--;
+                if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
+                {
+                    i_to_send = i_group;
+                    p_pk->i_pts = i_date;
+                }
+                else
+                    p_pk->i_pts = VLC_TS_INVALID;
             }
-            else if( i_date - i_date_last < -1000 )
+
+            if( p_pk->i_pts > VLC_TS_INVALID )
             {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
-                             i_date_last - i_date );
+                if( i_deadline == VLC_TS_INVALID )
+                    i_deadline = p_pk->i_pts;
+                else if( p_pk->i_pts > __MAX(i_deadline, mdate()) + i_window )
+                {   /* Not due yet: keep it for the next batch */
+                    batch.pending = p_pk;
+                    break;
+                }
             }
+            batch.pkts[batch.count++] = p_pk;
         }
 
-        block_cleanup_push( p_pk );
-        i_to_send--;
-        if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
-        {
-            mwait( i_date );
-            i_to_send = i_group;
-        }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
-        vlc_cleanup_pop();
+        if( batch.count == 0 )
+            continue;
+
+        if( i_deadline > VLC_TS_INVALID )
+            mwait( i_deadline );
+
+        SendBatch( p_access, batch.pkts, batch.count, &b_gso, &stats.i_calls );
 
         if( i_dropped_packets )
         {
@@ -438,18 +643,42 @@ static void* ThreadWrite( void *data )
             i_dropped_packets = 0;
         }
 
-#if 1
-        i_sent = mdate();
-        if ( i_sent > i_date + 20000 )
+        mtime_t i_sent = mdate();
+        for( unsigned i = 0; i < batch.count; i++ )
         {
-            msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
-                     i_sent - i_date );
-        }
-#endif
+            block_t *p_pk = batch.pkts[i];
 
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
+            if( p_pk->i_pts > VLC_TS_INVALID )
+            {
+                mtime_t i_late = i_sent - p_pk->i_pts;
+#if 1
+                if ( i_late > 20000 )
+                    msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
+                             i_late );
+#endif
+                if( i_late < 0 )
+                    i_late = -i_late; /* sent early, within the window */
+                stats.i_sum += i_late;
+                if( i_late > stats.i_max )
+                    stats.i_max = i_late;
+                stats.i_packets++;
+            }
+            block_FifoPut( p_sys->p_empty_blocks, p_pk );
+        }
+        batch.count = 0;
 
-        i_date_last = i_date;
+        if( i_sent >= stats.i_next )
+        {
+            if( stats.i_packets > 0 )
+                msg_Dbg( p_access, "send jitter: average %"PRId64" us, "
+                         "maximum %"PRId64" us over %u packets, "
+                         "%u system calls", stats.i_sum / stats.i_packets,
+                         stats.i_max, stats.i_packets, stats.i_calls );
+            stats.i_sum = stats.i_max = 0;
+            stats.i_packets = stats.i_calls = 0;
+            stats.i_next = i_sent + 10 * CLOCK_FREQ;
+        }
     }
+    vlc_cleanup_pop();
     return NULL;
 }
@@ -36,6 +36,7 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
 #include <math.h>
 
 #include <vlc_common.h>
@@ -57,6 +58,7 @@ struct filter_sys_t
     int i_nb;
     float *p_last;
     float f_max;
+    vlc_var_handle_t *max_level;
 };
 
 /*****************************************************************************
@@ -106,6 +108,9 @@ static int Open( vlc_object_t *p_this )
                                         "norm-buff-size" );
     p_sys->f_max = var_CreateGetFloat( p_filter->obj.parent,
                                        "norm-max-level" );
+    /* read for every buffer */
+    p_sys->max_level = var_Hold( p_filter->obj.parent, "norm-max-level" );
+    assert( p_sys->max_level != NULL );
 
     if( p_sys->f_max <= 0 ) p_sys->f_max = 0.01;
 
@@ -113,6 +118,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->p_last = calloc( i_channels * (p_filter->p_sys->i_nb + 2), sizeof(float) );
     if( !p_sys->p_last )
     {
+        var_Release( p_filter->obj.parent, p_sys->max_level );
         free( p_sys );
         return VLC_ENOMEM;
     }
@@ -187,8 +193,7 @@ static block_t *DoWork( filter_t *p_filter, block_t *p_in_buf )
         f_average = f_average / p_sys->i_nb;
 
         /* Seuil arbitraire */
-        p_sys->f_max = var_GetFloat( p_filter->obj.parent,
-                                     "norm-max-level" );
+        p_sys->f_max = var_HandleGetFloat( p_sys->max_level );
 
         //fprintf(stderr,"Average %f, max %f\n", f_average, p_sys->f_max );
         if( f_average > p_sys->f_max )
@@ -228,6 +233,7 @@ static void Close( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t*)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
+    var_Release( p_filter->obj.parent, p_sys->max_level );
     free( p_sys->p_last );
     free( p_sys );
 }
@@ -152,6 +152,7 @@ bool PlaylistManager::start()
 {
     if(!conManager && !(conManager = new (std::nothrow) HTTPConnectionManager(VLC_OBJECT(p_demux->s))))
         return false;
+    playlist->setConnectionManager(conManager);
 
     if(!setupPeriod())
         return false;
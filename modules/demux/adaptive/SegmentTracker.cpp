@@ -29,6 +29,7 @@
 #include "playlist/Segment.h"
 #include "playlist/SegmentChunk.hpp"
 #include "logic/AbstractAdaptationLogic.h"
+#include "http/HTTPConnectionManager.h"
 
 using namespace adaptive;
 using namespace adaptive::logic;
@@ -274,11 +275,31 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     {
         curNumber = next;
         next++;
+        prefetch(rep, connManager);
     }
 
     return chunk;
 }
 
+void SegmentTracker::prefetch(BaseRepresentation *rep, AbstractConnectionManager *connManager) const
+{
+    /* Segments past the live edge might not exist yet */
+    if(rep->getPlaylist()->isLive())
+        return;
+
+    uint64_t number = next;
+    for(unsigned i = 0; i < connManager->getPrefetchDepth(); i++)
+    {
+        bool b_gap;
+        ISegment *segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                number, &number, &b_gap);
+        if(!segment)
+            break;
+        segment->prefetch(number, rep, connManager);
+        number++;
+    }
+}
+
 bool SegmentTracker::setPositionByTime(mtime_t time, bool restarted, bool tryonly)
 {
     uint64_t segnumber;
@@ -130,6 +130,7 @@ namespace adaptive
 
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
+            void prefetch(BaseRepresentation *, AbstractConnectionManager *) const;
             void notify(const SegmentTrackerEvent &) const;
             bool first;
             bool initializing;
@@ -74,6 +74,16 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using http access instead of custom http code")
 
+#define ADAPT_DOWNLOADS_TEXT N_("Concurrent downloads")
+#define ADAPT_DOWNLOADS_LONGTEXT N_("Maximum number of segments downloaded at the same time")
+
+#define ADAPT_PREFETCH_TEXT N_("Segments prefetched")
+#define ADAPT_PREFETCH_LONGTEXT N_("Number of segments downloaded ahead of each stream")
+
+#define ADAPT_CACHE_TEXT N_("Segments cache size (MiB)")
+#define ADAPT_CACHE_LONGTEXT N_("Memory used to keep downloaded segments for seeking back " \
+                                "and switching representations")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
@@ -120,6 +130,12 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, false )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_integer_with_range( "adaptive-downloads", 4, 1, 16,
+                     ADAPT_DOWNLOADS_TEXT, ADAPT_DOWNLOADS_LONGTEXT, true )
+        add_integer_with_range( "adaptive-prefetch", 2, 0, 16,
+                     ADAPT_PREFETCH_TEXT, ADAPT_PREFETCH_LONGTEXT, true )
+        add_integer( "adaptive-cachesize", 32,
+                     ADAPT_CACHE_TEXT, ADAPT_CACHE_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -243,7 +243,11 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     HTTPChunkSource(url, manager, sourceid),
     p_head     (NULL),
     pp_tail    (&p_head),
-    buffered     (0)
+    buffered     (0),
+    keepmax      (0),
+    p_kept       (NULL),
+    pp_kepttail  (&p_kept),
+    kept         (0)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&avail);
@@ -270,6 +274,8 @@ HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
         pp_tail = &p_head;
     }
     buffered = 0;
+    if(p_kept)
+        block_ChainRelease(p_kept);
     vlc_mutex_unlock(&lock);
 
     vlc_cond_destroy(&avail);
@@ -300,6 +306,39 @@ void HTTPChunkBufferedSource::release()
     vlc_mutex_unlock(&lock);
 }
 
+void HTTPChunkBufferedSource::setCacheKey(const std::string &key, size_t max)
+{
+    vlc_mutex_lock(&lock);
+    cachekey = key;
+    keepmax = max;
+    vlc_mutex_unlock(&lock);
+}
+
+/* Keeps a copy of the downloaded data to hand it over to the
+   connection manager's cache once complete */
+void HTTPChunkBufferedSource::keep(const block_t *p_block)
+{
+    if(cachekey.empty())
+        return;
+
+    block_t *p_copy = NULL;
+    if(kept + p_block->i_buffer <= keepmax)
+        p_copy = block_Duplicate(const_cast<block_t *>(p_block));
+    if(!p_copy)
+    {
+        /* too large, or out of memory, give up */
+        cachekey.clear();
+        if(p_kept)
+            block_ChainRelease(p_kept);
+        p_kept = NULL;
+        pp_kepttail = &p_kept;
+        kept = 0;
+        return;
+    }
+    kept += p_copy->i_buffer;
+    block_ChainLastAppend(&pp_kepttail, p_copy);
+}
+
 void HTTPChunkBufferedSource::bufferize(size_t readsize)
 {
     vlc_mutex_lock(&lock);
@@ -333,6 +372,9 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         mtime_t time;
     } rate = {0,0};
 
+    block_t *p_complete = NULL;
+    std::string key;
+
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
     if(ret <= 0)
     {
@@ -343,13 +385,13 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         rate.size = buffered + consumed;
         rate.time = mdate() - downloadstart;
         downloadstart = 0;
-        vlc_mutex_unlock(&lock);
     }
     else
     {
         p_block->i_buffer = (size_t) ret;
         vlc_mutex_lock(&lock);
         buffered += p_block->i_buffer;
+        keep(p_block);
         block_ChainLastAppend(&pp_tail, p_block);
         if((size_t) ret < readsize)
         {
@@ -358,14 +400,30 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
             rate.time = mdate() - downloadstart;
             downloadstart = 0;
         }
-        vlc_mutex_unlock(&lock);
     }
 
+    if(done && p_kept && ret >= 0 &&
+       (!contentLength || kept == contentLength))
+    {
+        p_complete = p_kept;
+        key = cachekey;
+        p_kept = NULL;
+        pp_kepttail = &p_kept;
+    }
+    vlc_mutex_unlock(&lock);
+
     if(rate.size)
     {
         connManager->updateDownloadRate(sourceid, rate.size, rate.time);
     }
 
+    if(p_complete)
+    {
+        p_complete = block_ChainGather(p_complete);
+        if(p_complete)
+            connManager->cacheResource(key, p_complete);
+    }
+
     vlc_cond_signal(&avail);
 }
 
@@ -472,6 +530,56 @@ block_t * HTTPChunkBufferedSource::read(size_t readsize)
     return p_block;
 }
 
+MemoryChunkSource::MemoryChunkSource(block_t *block)
+{
+    data = block;
+    i_read = 0;
+    contentLength = data->i_buffer;
+}
+
+MemoryChunkSource::~MemoryChunkSource()
+{
+    if(data)
+        block_Release(data);
+}
+
+bool MemoryChunkSource::hasMoreData() const
+{
+    return data && i_read < contentLength;
+}
+
+block_t * MemoryChunkSource::readBlock()
+{
+    block_t *p_block = NULL;
+    if(data)
+    {
+        p_block = data;
+        data = NULL;
+    }
+    return p_block;
+}
+
+block_t * MemoryChunkSource::read(size_t toread)
+{
+    if(!data)
+        return NULL;
+
+    block_t * p_block = NULL;
+
+    toread = __MIN(data->i_buffer - i_read, toread);
+    if(toread > 0)
+    {
+        if((p_block = block_Alloc(toread)))
+        {
+            memcpy(p_block->p_buffer, &data->p_buffer[i_read], toread);
+            p_block->i_buffer = toread;
+            i_read += toread;
+        }
+    }
+
+    return p_block;
+}
+
 HTTPChunk::HTTPChunk(const std::string &url, AbstractConnectionManager *manager,
                      const adaptive::ID &id):
     AbstractChunk(new HTTPChunkSource(url, manager, id))
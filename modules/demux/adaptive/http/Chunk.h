@@ -120,6 +120,7 @@ namespace adaptive
                 virtual bool       hasMoreData     () const; /* impl */
                 void               hold();
                 void               release();
+                void               setCacheKey(const std::string &, size_t);
 
             protected:
                 virtual bool       prepare(); /* reimpl */
@@ -127,9 +128,15 @@ namespace adaptive
                 bool               isDone() const;
 
             private:
+                void               keep(const block_t *);
                 block_t            *p_head; /* read cache buffer */
                 block_t           **pp_tail;
                 size_t              buffered; /* read cache size */
+                std::string         cachekey; /* empty if not to be cached */
+                size_t              keepmax;
+                block_t            *p_kept; /* copy of the whole resource */
+                block_t           **pp_kepttail;
+                size_t              kept;
                 bool                done;
                 bool                eof;
                 mtime_t             downloadstart;
@@ -138,6 +145,21 @@ namespace adaptive
                 bool                held;
         };
 
+        class MemoryChunkSource : public AbstractChunkSource
+        {
+            public:
+                MemoryChunkSource(block_t *);
+                virtual ~MemoryChunkSource();
+
+                virtual block_t *   readBlock       (); /* impl */
+                virtual block_t *   read            (size_t); /* impl */
+                virtual bool        hasMoreData     () const; /* impl */
+
+            private:
+                block_t            *data;
+                size_t              i_read;
+        };
+
         class HTTPChunk : public AbstractChunk
         {
             public:
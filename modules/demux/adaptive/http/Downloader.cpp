@@ -26,54 +26,81 @@
 #include <vlc_threads.h>
 #include <vlc_atomic.h>
 
+#include <algorithm>
+
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::Downloader(unsigned maxthreads_)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&updatedcond);
     killed = false;
-    thread_handle_valid = false;
+    maxthreads = maxthreads_ ? maxthreads_ : 1;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(threads.size() < maxthreads)
     {
-        return false;
+        vlc_thread_t thread_handle;
+        if(vlc_clone(&thread_handle, downloaderThread,
+                     static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        threads.push_back(thread_handle);
     }
-    thread_handle_valid = true;
-    return true;
+    return !threads.empty();
 }
 
 Downloader::~Downloader()
 {
     vlc_mutex_lock( &lock );
     killed = true;
-    vlc_cond_signal(&waitcond);
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock( &lock );
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    std::vector<vlc_thread_t>::const_iterator it;
+    for(it = threads.begin(); it != threads.end(); ++it)
+        vlc_join(*it, NULL);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&updatedcond);
 }
-void Downloader::schedule(HTTPChunkBufferedSource *source)
+
+void Downloader::schedule(HTTPChunkBufferedSource *source, bool prefetch)
 {
     vlc_mutex_lock(&lock);
     source->hold();
-    chunks.push_back(source);
+    if(prefetch)
+        prefetches.push_back(source);
+    else
+        chunks.push_back(source);
     vlc_cond_signal(&waitcond);
     vlc_mutex_unlock(&lock);
 }
 
+void Downloader::promote(HTTPChunkBufferedSource *source)
+{
+    vlc_mutex_lock(&lock);
+    std::list<HTTPChunkBufferedSource *>::iterator it =
+            std::find(prefetches.begin(), prefetches.end(), source);
+    if(it != prefetches.end())
+    {
+        prefetches.erase(it);
+        chunks.push_back(source);
+    }
+    vlc_mutex_unlock(&lock);
+}
+
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
+    /* can't interrupt a read, wait for it to complete */
+    while(isDownloading(source))
+        vlc_cond_wait(&updatedcond, &lock);
     source->release();
     chunks.remove(source);
+    prefetches.remove(source);
     vlc_mutex_unlock(&lock);
 }
 
@@ -92,27 +119,54 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
+bool Downloader::isDownloading(const HTTPChunkBufferedSource *source) const
+{
+    return std::find(current.begin(), current.end(), source) != current.end();
+}
+
+HTTPChunkBufferedSource * Downloader::getNextSource() const
+{
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
+        if(!isDownloading(*it))
+            return *it;
+    for(it = prefetches.begin(); it != prefetches.end(); ++it)
+        if(!isDownloading(*it))
+            return *it;
+    return NULL;
+}
+
 void Downloader::Run()
 {
     vlc_mutex_lock(&lock);
     while(1)
     {
-        while(chunks.empty() && !killed)
+        HTTPChunkBufferedSource *source;
+
+        while(!killed && (source = getNextSource()) == NULL)
             vlc_cond_wait(&waitcond, &lock);
 
         if(killed)
             break;
 
-        if(!chunks.empty())
+        /* Each thread services its own source, which is only read
+         * from one thread at a time */
+        current.push_back(source);
+        vlc_mutex_unlock(&lock);
+
+        DownloadSource(source);
+
+        vlc_mutex_lock(&lock);
+        current.remove(source);
+        if(source->isDone())
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-            {
-                chunks.pop_front();
-                source->release();
-            }
+            chunks.remove(source);
+            prefetches.remove(source);
+            source->release();
         }
+        else
+            vlc_cond_signal(&waitcond);
+        vlc_cond_broadcast(&updatedcond);
     }
     vlc_mutex_unlock(&lock);
 }
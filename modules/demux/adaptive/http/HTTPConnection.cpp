@@ -27,8 +27,19 @@
 #include "../adaptive/tools/Helper.h"
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #include <sstream>
 #include <vlc_stream.h>
+#include <vlc_block.h>
+
+extern "C"
+{
+    #include "../../../access/http/resource.h"
+    #include "../../../access/http/connmgr.h"
+    #include "../../../access/http/message.h"
+}
 
 using namespace adaptive::http;
 
@@ -487,6 +498,230 @@ void StreamUrlConnection::setUsed( bool b )
        reset();
 }
 
+struct LibVLCHTTPConnection::restuple
+{
+    struct vlc_http_resource resource;
+    LibVLCHTTPConnection *connection; /* callbacks opaque, right after */
+};
+
+LibVLCHTTPConnection::LibVLCHTTPConnection(vlc_object_t *p_object_,
+                                           LibVLCHTTPConnectionFactory *factory_)
+    : AbstractConnection(p_object_)
+{
+    factory = factory_;
+    source = NULL;
+    p_pending = NULL;
+    psz_useragent = var_InheritString(p_object_, "http-user-agent");
+}
+
+LibVLCHTTPConnection::~LibVLCHTTPConnection()
+{
+    reset();
+    free(psz_useragent);
+}
+
+void LibVLCHTTPConnection::reset()
+{
+    if(p_pending)
+        block_Release(p_pending);
+    p_pending = NULL;
+    if(source)
+        vlc_http_res_destroy(&source->resource);
+    source = NULL;
+    bytesRead = 0;
+    contentLength = 0;
+    bytesRange = BytesRange();
+}
+
+int LibVLCHTTPConnection::formatRequest(const struct vlc_http_resource *,
+                                        struct vlc_http_msg *req, void *opaque)
+{
+    const LibVLCHTTPConnection *conn =
+            *static_cast<LibVLCHTTPConnection **>(opaque);
+    const BytesRange &range = conn->bytesRange;
+
+    if(range.isValid())
+    {
+        if(range.getEndByte())
+            return vlc_http_msg_add_header(req, "Range", "bytes=%zu-%zu",
+                                           range.getStartByte(), range.getEndByte());
+        return vlc_http_msg_add_header(req, "Range", "bytes=%zu-",
+                                       range.getStartByte());
+    }
+    return 0;
+}
+
+int LibVLCHTTPConnection::validateResponse(const struct vlc_http_resource *,
+                                           const struct vlc_http_msg *resp, void *opaque)
+{
+    const LibVLCHTTPConnection *conn =
+            *static_cast<LibVLCHTTPConnection **>(opaque);
+    const int status = vlc_http_msg_get_status(resp);
+
+    if(status >= 400)
+    {
+        msg_Err(conn->p_object, "Failed reading %s: %d",
+                conn->params.getUrl().c_str(), status);
+        return -1;
+    }
+    return 0;
+}
+
+bool LibVLCHTTPConnection::canReuse(const ConnectionParams &params_) const
+{
+    /* request() only updates the path: the origin must match */
+    return ( available &&
+             params.getHostname() == params_.getHostname() &&
+             params.getScheme() == params_.getScheme() &&
+             params.getPort() == params_.getPort() );
+}
+
+int LibVLCHTTPConnection::request(const std::string &path, const BytesRange &range)
+{
+    static const struct vlc_http_resource_cbs callbacks =
+    {
+        formatRequest,
+        validateResponse,
+    };
+
+    reset();
+
+    /* Set new path for this query */
+    params.setPath(path);
+
+    msg_Dbg(p_object, "Retrieving %s @%zu", params.getUrl().c_str(),
+                       range.isValid() ? range.getStartByte() : 0);
+
+    bytesRange = range;
+
+    for(int redirects = 0; ; redirects++)
+    {
+        struct vlc_http_mgr *mgr = factory->getManager(p_object, params);
+        if(!mgr)
+            return VLC_EGENERIC;
+
+        /* vlc_http_res_destroy() frees the resource, hence the tuple */
+        source = static_cast<restuple *>(malloc(sizeof(*source)));
+        if(!source)
+            return VLC_ENOMEM;
+        source->connection = this;
+        if(vlc_http_res_init(&source->resource, &callbacks, mgr,
+                             params.getUrl().c_str(), psz_useragent, NULL, "GET"))
+        {
+            free(source);
+            source = NULL;
+            return VLC_EGENERIC;
+        }
+
+        const int status = vlc_http_res_get_status(&source->resource);
+        if(status < 0)
+        {
+            reset();
+            return VLC_EGENERIC;
+        }
+
+        char *psz_redirect = vlc_http_res_get_redirect(&source->resource);
+        if(!psz_redirect)
+            break;
+
+        msg_Info(p_object, "%d redirection to %s", status, psz_redirect);
+        params = ConnectionParams(psz_redirect);
+        free(psz_redirect);
+        reset();
+        bytesRange = range;
+        if(redirects == maxRedirects)
+            return VLC_EGENERIC;
+    }
+
+    if(vlc_http_res_get_status(&source->resource) >= 300)
+    {
+        reset();
+        return VLC_ENOOBJ;
+    }
+
+    if(range.isValid() && range.getEndByte() > 0)
+    {
+        contentLength = range.getEndByte() - range.getStartByte() + 1;
+    }
+    else
+    {
+        uintmax_t i_size = vlc_http_msg_get_size(source->resource.response);
+        if(i_size != (uintmax_t) -1)
+            contentLength = i_size;
+    }
+
+    return VLC_SUCCESS;
+}
+
+ssize_t LibVLCHTTPConnection::read(void *p_buffer, size_t len)
+{
+    if(!source)
+        return VLC_EGENERIC;
+
+    if(len == 0)
+        return VLC_SUCCESS;
+
+    const size_t toRead = (contentLength) ? contentLength - bytesRead : len;
+    if (toRead == 0)
+        return VLC_SUCCESS;
+
+    if(len > toRead)
+        len = toRead;
+
+    size_t copied = 0;
+    bool error = false;
+    while(copied < len)
+    {
+        if(!p_pending)
+        {
+            block_t *p_block = vlc_http_res_read(&source->resource);
+            if(p_block == NULL || (void *) p_block == vlc_http_error)
+            {
+                error = (p_block != NULL);
+                break;
+            }
+            p_pending = p_block;
+        }
+
+        size_t i_copy = std::min(len - copied, p_pending->i_buffer);
+        memcpy(&((uint8_t *)p_buffer)[copied], p_pending->p_buffer, i_copy);
+        copied += i_copy;
+        p_pending->p_buffer += i_copy;
+        p_pending->i_buffer -= i_copy;
+        if(p_pending->i_buffer == 0)
+        {
+            block_Release(p_pending);
+            p_pending = NULL;
+        }
+    }
+
+    bytesRead += copied;
+
+    if(contentLength == bytesRead && !p_pending && !error)
+    {
+        /* consume the end of stream, so that it is not reset */
+        block_t *p_block = vlc_http_res_read(&source->resource);
+        if(p_block != NULL && (void *) p_block != vlc_http_error)
+            block_Release(p_block);
+    }
+
+    if(copied < len || contentLength == bytesRead) /* set EOF */
+    {
+        reset();
+        if(error && copied == 0)
+            return VLC_EGENERIC;
+    }
+
+    return copied;
+}
+
+void LibVLCHTTPConnection::setUsed( bool b )
+{
+    available = !b;
+    if(available)
+        reset();
+}
+
 ConnectionFactory::ConnectionFactory()
 {
 }
@@ -524,3 +759,53 @@ AbstractConnection * StreamUrlConnectionFactory::createConnection(vlc_object_t *
 {
     return new (std::nothrow) StreamUrlConnection(p_object);
 }
+
+LibVLCHTTPConnectionFactory::LibVLCHTTPConnectionFactory()
+    : ConnectionFactory()
+{
+    vlc_mutex_init(&lock);
+}
+
+LibVLCHTTPConnectionFactory::~LibVLCHTTPConnectionFactory()
+{
+    std::map<std::string, struct vlc_http_mgr *>::const_iterator it;
+    for(it = managers.begin(); it != managers.end(); ++it)
+        vlc_http_mgr_destroy((*it).second);
+    vlc_mutex_destroy(&lock);
+}
+
+AbstractConnection * LibVLCHTTPConnectionFactory::createConnection(vlc_object_t *p_object,
+                                                                   const ConnectionParams &params)
+{
+    /* Plain HTTP can't be multiplexed (no h2c): keep persistent connections */
+    if(params.getScheme() != "https" || params.getHostname().empty())
+        return ConnectionFactory::createConnection(p_object, params);
+
+    return new (std::nothrow) LibVLCHTTPConnection(p_object, this);
+}
+
+struct vlc_http_mgr * LibVLCHTTPConnectionFactory::getManager(vlc_object_t *p_object,
+                                                              const ConnectionParams &params)
+{
+    std::ostringstream os;
+    os.imbue(std::locale("C"));
+    os << params.getScheme() << "://" << params.getHostname() << ":" << params.getPort();
+    const std::string origin = os.str();
+
+    vlc_mutex_lock(&lock);
+    struct vlc_http_mgr *mgr = NULL;
+    std::map<std::string, struct vlc_http_mgr *>::const_iterator it = managers.find(origin);
+    if(it != managers.end())
+    {
+        mgr = (*it).second;
+    }
+    else
+    {
+        mgr = vlc_http_mgr_create(p_object, static_cast<struct vlc_http_cookie_jar_t *>
+                                            (var_InheritAddress(p_object, "http-cookies")));
+        if(mgr)
+            managers.insert(std::pair<std::string, struct vlc_http_mgr *>(origin, mgr));
+    }
+    vlc_mutex_unlock(&lock);
+    return mgr;
+}
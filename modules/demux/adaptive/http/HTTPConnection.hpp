@@ -29,6 +29,11 @@
 #include "BytesRange.hpp"
 #include <vlc_common.h>
 #include <string>
+#include <map>
+
+struct vlc_http_mgr;
+struct vlc_http_msg;
+struct vlc_http_resource;
 
 namespace adaptive
 {
@@ -120,6 +125,38 @@ namespace adaptive
                 stream_t *p_streamurl;
        };
 
+       class LibVLCHTTPConnectionFactory;
+
+       /* Requests through the HTTP/1.1 and HTTP/2 stack of the https access
+          module. Streams to the same origin share its connection, and are
+          multiplexed when the server negotiates HTTP/2. */
+       class LibVLCHTTPConnection : public AbstractConnection
+       {
+            public:
+                LibVLCHTTPConnection(vlc_object_t *, LibVLCHTTPConnectionFactory *);
+                virtual ~LibVLCHTTPConnection();
+
+                virtual bool    canReuse     (const ConnectionParams &) const;
+
+                virtual int     request     (const std::string& path, const BytesRange & = BytesRange());
+                virtual ssize_t read        (void *p_buffer, size_t len);
+
+                virtual void    setUsed( bool );
+
+            private:
+                void reset();
+                static int formatRequest(const struct vlc_http_resource *,
+                                         struct vlc_http_msg *, void *);
+                static int validateResponse(const struct vlc_http_resource *,
+                                            const struct vlc_http_msg *, void *);
+                struct restuple;
+                LibVLCHTTPConnectionFactory *factory;
+                struct restuple *source;
+                block_t *p_pending;
+                char *psz_useragent;
+                static const int maxRedirects = 3;
+       };
+
        class ConnectionFactory
        {
            public:
@@ -128,6 +165,20 @@ namespace adaptive
                virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
        };
 
+       class LibVLCHTTPConnectionFactory : public ConnectionFactory
+       {
+           public:
+               LibVLCHTTPConnectionFactory();
+               virtual ~LibVLCHTTPConnectionFactory();
+               virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
+               struct vlc_http_mgr * getManager(vlc_object_t *, const ConnectionParams &);
+
+           private:
+               vlc_mutex_t lock;
+               /* one per origin, as a manager only keeps a single connection */
+               std::map<std::string, struct vlc_http_mgr *> managers;
+       };
+
        class StreamUrlConnectionFactory : public ConnectionFactory
        {
            public:
@@ -30,7 +30,11 @@
 #include "ConnectionParams.hpp"
 #include "Sockets.hpp"
 #include "Downloader.hpp"
+#include "Chunk.h"
 #include <vlc_url.h>
+#include <vlc_block.h>
+
+#include <sstream>
 
 using namespace adaptive::http;
 
@@ -61,23 +65,37 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, Connec
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
+    vlc_mutex_init(&cachelock);
+    cachesize = 0;
+    cachemax = var_InheritInteger(p_object, "adaptive-cachesize") * 1024 * 1024;
+    prefetchmax = var_InheritInteger(p_object, "adaptive-prefetch");
+    downloader = new (std::nothrow) Downloader(var_InheritInteger(p_object, "adaptive-downloads"));
     downloader->start();
     if(!factory_)
     {
         if(var_InheritBool(p_object, "adaptive-use-access"))
             factory = new (std::nothrow) StreamUrlConnectionFactory();
         else
-            factory = new (std::nothrow) ConnectionFactory();
+            factory = new (std::nothrow) LibVLCHTTPConnectionFactory();
     }
     else
         factory = factory_;
 }
 HTTPConnectionManager::~HTTPConnectionManager   ()
 {
+    /* sources cancel themselves from the downloader */
+    std::list<std::pair<std::string, HTTPChunkBufferedSource *> >::const_iterator it;
+    for(it = prefetched.begin(); it != prefetched.end(); ++it)
+        delete (*it).second;
+    prefetched.clear();
     delete downloader;
-    delete factory;
     this->closeAllConnections();
+    delete factory;
+
+    std::list<std::pair<std::string, block_t *> >::const_iterator cit;
+    for(cit = cache.begin(); cit != cache.end(); ++cit)
+        block_Release((*cit).second);
+    vlc_mutex_destroy(&cachelock);
     vlc_mutex_destroy(&lock);
 }
 
@@ -151,3 +169,168 @@ void HTTPConnectionManager::cancel(AbstractChunkSource *source)
     if(src)
         downloader->cancel(src);
 }
+
+std::string HTTPConnectionManager::makeKey(const std::string &url, const BytesRange &range)
+{
+    if(!range.isValid())
+        return url;
+    std::stringstream ss;
+    ss << url << "@" << range.getStartByte() << "-" << range.getEndByte();
+    return ss.str();
+}
+
+HTTPChunkBufferedSource * HTTPConnectionManager::newSource(const std::string &url,
+                                                           const std::string &key,
+                                                           const adaptive::ID &id,
+                                                           const BytesRange &range)
+{
+    HTTPChunkBufferedSource *source = new (std::nothrow) HTTPChunkBufferedSource(url, this, id);
+    if(source)
+    {
+        if(range.isValid())
+            source->setBytesRange(range);
+        /* don't let a single segment flush most of the cache */
+        if(cachemax)
+            source->setCacheKey(key, cachemax / 4);
+    }
+    return source;
+}
+
+block_t * HTTPConnectionManager::getCached(const std::string &key)
+{
+    block_t *p_block = NULL;
+    vlc_mutex_lock(&cachelock);
+    std::list<std::pair<std::string, block_t *> >::iterator it;
+    for(it = cache.begin(); it != cache.end(); ++it)
+    {
+        if((*it).first == key)
+        {
+            p_block = block_Duplicate((*it).second);
+            cache.splice(cache.begin(), cache, it);
+            break;
+        }
+    }
+    vlc_mutex_unlock(&cachelock);
+    return p_block;
+}
+
+AbstractChunkSource * HTTPConnectionManager::makeSource(const std::string &url,
+                                                        const adaptive::ID &id,
+                                                        const BytesRange &range)
+{
+    if(unlikely(!downloader))
+        return NULL;
+
+    const std::string key = makeKey(url, range);
+
+    /* Already downloading or downloaded ahead */
+    vlc_mutex_lock(&cachelock);
+    std::list<std::pair<std::string, HTTPChunkBufferedSource *> >::iterator it;
+    for(it = prefetched.begin(); it != prefetched.end(); ++it)
+    {
+        if((*it).first == key)
+        {
+            HTTPChunkBufferedSource *source = (*it).second;
+            prefetched.erase(it);
+            vlc_mutex_unlock(&cachelock);
+            downloader->promote(source);
+            return source;
+        }
+    }
+    vlc_mutex_unlock(&cachelock);
+
+    /* Downloaded earlier (backward seek, representation switch back) */
+    block_t *p_block = getCached(key);
+    if(p_block)
+    {
+        MemoryChunkSource *source = new (std::nothrow) MemoryChunkSource(p_block);
+        if(!source)
+            block_Release(p_block);
+        return source;
+    }
+
+    HTTPChunkBufferedSource *source = newSource(url, key, id, range);
+    if(source)
+        downloader->schedule(source);
+    return source;
+}
+
+void HTTPConnectionManager::prefetch(const std::string &url, const adaptive::ID &id,
+                                     const BytesRange &range)
+{
+    if(unlikely(!downloader) || prefetchmax == 0)
+        return;
+
+    const std::string key = makeKey(url, range);
+
+    vlc_mutex_lock(&cachelock);
+    std::list<std::pair<std::string, HTTPChunkBufferedSource *> >::const_iterator it;
+    for(it = prefetched.begin(); it != prefetched.end(); ++it)
+    {
+        if((*it).first == key)
+        {
+            vlc_mutex_unlock(&cachelock);
+            return;
+        }
+    }
+    std::list<std::pair<std::string, block_t *> >::const_iterator cit;
+    for(cit = cache.begin(); cit != cache.end(); ++cit)
+    {
+        if((*cit).first == key)
+        {
+            vlc_mutex_unlock(&cachelock);
+            return;
+        }
+    }
+    vlc_mutex_unlock(&cachelock);
+
+    HTTPChunkBufferedSource *source = newSource(url, key, id, range);
+    if(!source)
+        return;
+    downloader->schedule(source, true);
+
+    /* Unclaimed prefetches (seek, switch) are dropped oldest first.
+       Allow for the audio, video and subtitles streams. */
+    HTTPChunkBufferedSource *expired = NULL;
+    vlc_mutex_lock(&cachelock);
+    prefetched.push_back(std::pair<std::string, HTTPChunkBufferedSource *>(key, source));
+    if(prefetched.size() > prefetchmax * 3)
+    {
+        expired = prefetched.front().second;
+        prefetched.pop_front();
+    }
+    vlc_mutex_unlock(&cachelock);
+
+    delete expired;
+}
+
+unsigned HTTPConnectionManager::getPrefetchDepth() const
+{
+    return prefetchmax;
+}
+
+void HTTPConnectionManager::cacheResource(const std::string &key, block_t *p_block)
+{
+    vlc_mutex_lock(&cachelock);
+    std::list<std::pair<std::string, block_t *> >::iterator it;
+    for(it = cache.begin(); it != cache.end(); ++it)
+    {
+        if((*it).first == key)
+        {
+            cachesize -= (*it).second->i_buffer;
+            block_Release((*it).second);
+            cache.erase(it);
+            break;
+        }
+    }
+
+    cache.push_front(std::pair<std::string, block_t *>(key, p_block));
+    cachesize += p_block->i_buffer;
+    while(cachesize > cachemax && !cache.empty())
+    {
+        cachesize -= cache.back().second->i_buffer;
+        block_Release(cache.back().second);
+        cache.pop_back();
+    }
+    vlc_mutex_unlock(&cachelock);
+}
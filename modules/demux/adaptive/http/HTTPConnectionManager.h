@@ -29,6 +29,7 @@
 
 #include <vlc_common.h>
 #include <vector>
+#include <list>
 #include <string>
 
 namespace adaptive
@@ -40,6 +41,8 @@ namespace adaptive
         class AbstractConnection;
         class Downloader;
         class AbstractChunkSource;
+        class HTTPChunkBufferedSource;
+        class BytesRange;
 
         class AbstractConnectionManager : public IDownloadRateObserver
         {
@@ -51,6 +54,17 @@ namespace adaptive
                 virtual void start(AbstractChunkSource *) = 0;
                 virtual void cancel(AbstractChunkSource *) = 0;
 
+                /* Returns a started source for the resource, from the cache or
+                   the prefetched downloads if possible */
+                virtual AbstractChunkSource * makeSource(const std::string &, const ID &,
+                                                         const BytesRange &) = 0;
+                /* Starts downloading a resource that will likely be needed soon */
+                virtual void prefetch(const std::string &, const ID &, const BytesRange &) = 0;
+                /* Takes ownership of a complete resource */
+                virtual void cacheResource(const std::string &, block_t *) = 0;
+                /* Count of segments to prefetch ahead of each stream */
+                virtual unsigned getPrefetchDepth() const = 0;
+
                 virtual void updateDownloadRate(const ID &, size_t, mtime_t); /* impl */
                 void setDownloadRateObserver(IDownloadRateObserver *);
 
@@ -73,6 +87,12 @@ namespace adaptive
                 virtual void start(AbstractChunkSource *) /* impl */;
                 virtual void cancel(AbstractChunkSource *) /* impl */;
 
+                virtual AbstractChunkSource * makeSource(const std::string &, const ID &,
+                                                         const BytesRange &); /* impl */
+                virtual void prefetch(const std::string &, const ID &, const BytesRange &); /* impl */
+                virtual void cacheResource(const std::string &, block_t *); /* impl */
+                virtual unsigned getPrefetchDepth() const; /* impl */
+
             private:
                 void    releaseAllConnections ();
                 Downloader                                         *downloader;
@@ -80,6 +100,19 @@ namespace adaptive
                 std::vector<AbstractConnection *>                   connectionPool;
                 ConnectionFactory                                  *factory;
                 AbstractConnection * reuseConnection(ConnectionParams &);
+
+                HTTPChunkBufferedSource * newSource(const std::string &, const std::string &,
+                                                    const ID &, const BytesRange &);
+                block_t * getCached(const std::string &);
+                static std::string makeKey(const std::string &, const BytesRange &);
+
+                /* shared by all streams, most recently used first */
+                vlc_mutex_t                                         cachelock;
+                std::list<std::pair<std::string, block_t *> >       cache;
+                size_t                                              cachesize;
+                size_t                                              cachemax;
+                std::list<std::pair<std::string, HTTPChunkBufferedSource *> > prefetched;
+                unsigned                                            prefetchmax;
         };
     }
 }
@@ -35,7 +35,8 @@ using namespace adaptive::playlist;
 
 AbstractPlaylist::AbstractPlaylist (vlc_object_t *p_object_) :
     ICanonicalUrl(),
-    p_object(p_object_)
+    p_object(p_object_),
+    connManager(NULL)
 {
     playbackStart.Set(0);
     availabilityStartTime.Set( 0 );
@@ -113,6 +114,16 @@ vlc_object_t * AbstractPlaylist::getVLCObject() const
     return p_object;
 }
 
+void AbstractPlaylist::setConnectionManager(http::AbstractConnectionManager *manager)
+{
+    connManager = manager;
+}
+
+adaptive::http::AbstractConnectionManager * AbstractPlaylist::getConnectionManager() const
+{
+    return connManager;
+}
+
 BasePeriod* AbstractPlaylist::getFirstPeriod()
 {
     std::vector<BasePeriod *> periods = getPeriods();
@@ -29,6 +29,10 @@
 
 namespace adaptive
 {
+    namespace http
+    {
+        class AbstractConnectionManager;
+    }
 
     namespace playlist
     {
@@ -53,6 +57,9 @@ namespace adaptive
 
                 virtual Url         getUrlSegment() const; /* impl */
                 vlc_object_t *      getVLCObject()  const;
+                /* Shared with the segments once playback started */
+                void                setConnectionManager(http::AbstractConnectionManager *);
+                http::AbstractConnectionManager * getConnectionManager() const;
 
                 virtual const std::vector<BasePeriod *>& getPeriods();
                 virtual BasePeriod*                      getFirstPeriod();
@@ -72,6 +79,7 @@ namespace adaptive
 
             protected:
                 vlc_object_t                       *p_object;
+                http::AbstractConnectionManager    *connManager;
                 std::vector<BasePeriod *>           periods;
                 std::vector<std::string>            baseUrls;
                 std::string                         playlistUrl;
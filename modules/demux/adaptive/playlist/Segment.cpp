@@ -70,27 +70,32 @@ void ISegment::onChunkDownload(block_t **, SegmentChunk *, BaseRepresentation *)
 SegmentChunk* ISegment::toChunk(size_t index, BaseRepresentation *rep, AbstractConnectionManager *connManager)
 {
     const std::string url = getUrlSegment().toString(index, rep);
-    HTTPChunkBufferedSource *source = new (std::nothrow) HTTPChunkBufferedSource(url, connManager,
-                                                                                 rep->getAdaptationSet()->getID());
+    AbstractChunkSource *source = connManager->makeSource(url, rep->getAdaptationSet()->getID(),
+                                                          getBytesRange());
     if( source )
     {
-        if(startByte != endByte)
-            source->setBytesRange(BytesRange(startByte, endByte));
-
         SegmentChunk *chunk = new (std::nothrow) SegmentChunk(this, source, rep);
         if( chunk )
-        {
-            connManager->start(source);
             return chunk;
-        }
         else
-        {
             delete source;
-        }
     }
     return NULL;
 }
 
+void ISegment::prefetch(size_t index, BaseRepresentation *rep, AbstractConnectionManager *connManager)
+{
+    const std::string url = getUrlSegment().toString(index, rep);
+    connManager->prefetch(url, rep->getAdaptationSet()->getID(), getBytesRange());
+}
+
+BytesRange ISegment::getBytesRange() const
+{
+    if(startByte != endByte)
+        return BytesRange(startByte, endByte);
+    return BytesRange();
+}
+
 bool ISegment::isTemplate() const
 {
     return templated;
@@ -31,13 +31,12 @@
 using namespace adaptive;
 using namespace adaptive::http;
 
-block_t * Retrieve::HTTP(vlc_object_t *obj, const std::string &uri)
+static block_t * Fetch(AbstractConnectionManager *connManager, const std::string &uri)
 {
-    HTTPConnectionManager connManager(obj);
     HTTPChunk *datachunk;
     try
     {
-        datachunk = new HTTPChunk(uri, &connManager, ID());
+        datachunk = new HTTPChunk(uri, connManager, ID());
     } catch (int) {
         return NULL;
     }
@@ -46,3 +45,13 @@ block_t * Retrieve::HTTP(vlc_object_t *obj, const std::string &uri)
     delete datachunk;
     return block;
 }
+
+block_t * Retrieve::HTTP(vlc_object_t *obj, const std::string &uri,
+                         AbstractConnectionManager *sharedManager)
+{
+    if(sharedManager)
+        return Fetch(sharedManager, uri);
+
+    HTTPConnectionManager connManager(obj);
+    return Fetch(&connManager, uri);
+}
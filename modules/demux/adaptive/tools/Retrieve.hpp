@@ -25,10 +25,18 @@
 
 namespace adaptive
 {
+    namespace http
+    {
+        class AbstractConnectionManager;
+    }
+
     class Retrieve
     {
         public:
-            static block_t * HTTP(vlc_object_t *, const std::string &uri);
+            /* Uses the given connection manager (and its persistent
+               connections), or a temporary one */
+            static block_t * HTTP(vlc_object_t *, const std::string &uri,
+                                  http::AbstractConnectionManager * = NULL);
     };
 }
 
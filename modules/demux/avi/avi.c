@@ -46,6 +46,7 @@
 
 #include "libavi.h"
 #include "../rawdv.h"
+#include "../seekindex.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -2619,6 +2620,64 @@ static void AVI_IndexLoad( demux_t *p_demux )
     }
 }
 
+/* The rebuilt index is cached with one entry per chunk, the time being the
+ * chunk number in its stream */
+static bool AVI_IndexLoadCache( demux_t *p_demux, const seekindex_t *p_cache )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !seekindex_IsComplete( p_cache ) )
+        return false;
+
+    for( size_t i = 0; i < seekindex_Count( p_cache ); i++ )
+    {
+        const seekindex_entry_t *p_entry = seekindex_Get( p_cache, i );
+
+        if( p_entry->i_track >= p_sys->i_track )
+            break;
+
+        avi_track_t *tk = p_sys->track[p_entry->i_track];
+        avi_entry_t index;
+
+        index.i_id      = 0; /* unused once indexed */
+        index.i_flags   = p_entry->i_flags;
+        index.i_pos     = p_entry->i_offset;
+        index.i_length  = p_entry->i_size;
+        index.i_lengthtotal = p_entry->i_size;
+        avi_index_Append( &tk->idx, &p_sys->i_movi_lastchunk_pos, &index );
+    }
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        msg_Dbg( p_demux, "stream[%u] loaded %u cached index entries",
+                 i, p_sys->track[i]->idx.i_size );
+    return true;
+}
+
+static void AVI_IndexSaveCache( demux_t *p_demux, seekindex_t *p_cache )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        const avi_index_t *p_index = &p_sys->track[i]->idx;
+
+        for( unsigned j = 0; j < p_index->i_size; j++ )
+        {
+            const seekindex_entry_t entry = {
+                .i_time = j,
+                .i_offset = p_index->p_entry[j].i_pos,
+                .i_size = p_index->p_entry[j].i_length,
+                .i_flags = p_index->p_entry[j].i_flags,
+                .i_track = i,
+            };
+
+            if( seekindex_Add( p_cache, &entry ) )
+                return;
+        }
+    }
+    seekindex_SetComplete( p_cache );
+}
+
 static void AVI_IndexCreate( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2631,6 +2690,8 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
     mtime_t i_dialog_update;
     vlc_dialog_id *p_dialog_id = NULL;
+    seekindex_t *p_cache;
+    bool b_cancelled = false;
 
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
@@ -2644,6 +2705,13 @@ static void AVI_IndexCreate( demux_t *p_demux )
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
         avi_index_Init( &p_sys->track[i_stream]->idx );
 
+    p_cache = seekindex_Open( p_demux, p_demux->s, "avi" );
+    if( p_cache != NULL && AVI_IndexLoadCache( p_demux, p_cache ) )
+    {
+        seekindex_Close( p_cache );
+        return;
+    }
+
     i_movi_end = __MIN( (off_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
                         stream_Size( p_demux->s ) );
 
@@ -2669,7 +2737,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
         if( p_dialog_id != NULL && mdate() - i_dialog_update > 100000 )
         {
             if( vlc_dialog_is_cancelled( p_demux, p_dialog_id ) )
+            {
+                b_cancelled = true;
                 break;
+            }
 
             double f_current = vlc_stream_Tell( p_demux->s );
             double f_size    = stream_Size( p_demux->s );
@@ -2748,6 +2819,14 @@ print_stat:
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
                 i_stream, p_sys->track[i_stream]->idx.i_size );
     }
+
+    if( p_cache != NULL )
+    {
+        /* the scan gives the same result every time unless interrupted */
+        if( !b_cancelled )
+            AVI_IndexSaveCache( p_demux, p_cache );
+        seekindex_Close( p_cache );
+    }
 }
 
 /* */
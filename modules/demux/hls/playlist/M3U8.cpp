@@ -54,7 +54,7 @@ std::vector<std::uint8_t> M3U8::getEncryptionKey(const std::string &uri)
     if(it == keystore.end())
     {
         /* Pretty bad inside the lock */
-        block_t *p_block = Retrieve::HTTP(p_object, uri);
+        block_t *p_block = Retrieve::HTTP(p_object, uri, connManager);
         if(p_block)
         {
             if(p_block->i_buffer == 16)
@@ -28,6 +28,7 @@
 #include "util.hpp"
 #include "Ebml_parser.hpp"
 #include "Ebml_dispatcher.hpp"
+#include "stream_io_callback.hpp"
 
 #include <new>
 #include <iterator>
@@ -61,11 +62,18 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,ep(NULL)
     ,b_preloaded(false)
     ,b_ref_external_segments(false)
+    ,p_seekindex(NULL)
 {
 }
 
 matroska_segment_c::~matroska_segment_c()
 {
+    if( p_seekindex )
+    {
+        _seeker.save( p_seekindex );
+        seekindex_Close( p_seekindex );
+    }
+
     free( psz_writing_application );
     free( psz_muxing_application );
     free( psz_segment_filename );
@@ -681,6 +689,18 @@ bool matroska_segment_c::Preload( )
 
     ComputeTrackPriority();
 
+    /* reuse what previous sessions learnt seeking in this segment */
+    {
+        char psz_format[32];
+        snprintf( psz_format, sizeof(psz_format), "mkv:%" PRIu64,
+                  static_cast<uint64_t>( segment->GetElementPosition() ) );
+        stream_t *s = static_cast<vlc_stream_io_callback&>( es.I_O() ).stream();
+
+        p_seekindex = seekindex_Open( &sys.demuxer, s, psz_format );
+        if( p_seekindex )
+            _seeker.load( p_seekindex );
+    }
+
     b_preloaded = true;
 
     if( cluster )
@@ -172,6 +172,7 @@ private:
     void EnsureDuration();
 
     SegmentSeeker _seeker;
+    seekindex_t  *p_seekindex;
 
     friend SegmentSeeker;
 };
@@ -47,6 +47,22 @@ namespace {
 
     template<class It> It prev_( It it ) { return --it; }
     template<class It> It next_( It it ) { return ++it; }
+
+    // pseudo-tracks of the cached index, Matroska track numbers start at 1
+
+    uint32_t const SEEKINDEX_CLUSTERS = 0;
+    uint32_t const SEEKINDEX_RANGES   = UINT32_MAX;
+
+    seekindex_entry_t seekindex_entry( uint32_t track, int64_t time, uint64_t fpos, uint32_t flags = 0 )
+    {
+        seekindex_entry_t entry = seekindex_entry_t();
+
+        entry.i_track  = track;
+        entry.i_time   = time;
+        entry.i_offset = fpos;
+        entry.i_flags  = flags;
+        return entry;
+    }
 }
 
 SegmentSeeker::cluster_positions_t::iterator
@@ -486,3 +502,63 @@ SegmentSeeker::mkv_jump_to( matroska_segment_c& ms, fptr_t fpos )
     ms.es.I_O().setFilePointer( fpos );
 }
 
+void
+SegmentSeeker::load( seekindex_t const * p_index )
+{
+    for( size_t i = 0; i < seekindex_Count( p_index ); ++i )
+    {
+        seekindex_entry_t const * entry = seekindex_Get( p_index, i );
+
+        switch( entry->i_track )
+        {
+            case SEEKINDEX_CLUSTERS:
+                add_cluster_position( entry->i_offset );
+                break;
+
+            case SEEKINDEX_RANGES:
+                mark_range_as_searched( Range( entry->i_time, entry->i_offset ) );
+                break;
+
+            default:
+                add_seekpoint( entry->i_track, Seekpoint( entry->i_offset, entry->i_time,
+                  static_cast<Seekpoint::TrustLevel>( entry->i_flags ) ) );
+        }
+    }
+}
+
+void
+SegmentSeeker::save( seekindex_t * p_index ) const
+{
+    for( cluster_positions_t::const_iterator it = _cluster_positions.begin(); it != _cluster_positions.end(); ++it )
+    {
+        seekindex_entry_t const entry = seekindex_entry( SEEKINDEX_CLUSTERS, *it, *it );
+
+        if( seekindex_Add( p_index, &entry ) )
+            return;
+    }
+
+    for( tracks_seekpoints_t::const_iterator it = _tracks_seekpoints.begin(); it != _tracks_seekpoints.end(); ++it )
+    {
+        if( it->first == SEEKINDEX_CLUSTERS || it->first == SEEKINDEX_RANGES )
+            continue;
+
+        for( seekpoints_t::const_iterator sp = it->second.begin(); sp != it->second.end(); ++sp )
+        {
+            if( sp->trust_level <= Seekpoint::DISABLED )
+                continue;
+
+            seekindex_entry_t const entry = seekindex_entry( it->first, sp->pts, sp->fpos, sp->trust_level );
+
+            if( seekindex_Add( p_index, &entry ) )
+                return;
+        }
+    }
+
+    for( ranges_t::const_iterator it = _ranges_searched.begin(); it != _ranges_searched.end(); ++it )
+    {
+        seekindex_entry_t const entry = seekindex_entry( SEEKINDEX_RANGES, it->start, it->end );
+
+        if( seekindex_Add( p_index, &entry ) )
+            return;
+    }
+}
@@ -25,6 +25,7 @@
 #define MKV_MATROSKA_SEGMENT_SEEKER_HPP_
 
 #include "mkv.hpp"
+#include "../seekindex.h"
 
 #include <algorithm>
 #include <vector>
@@ -118,6 +119,9 @@ class SegmentSeeker
         void mark_range_as_searched( Range );
         ranges_t get_search_areas( fptr_t start, fptr_t end ) const;
 
+        void load( seekindex_t const * );
+        void save( seekindex_t * ) const;
+
     public:
         ranges_t            _ranges_searched;
         tracks_seekpoints_t _tracks_seekpoints;
@@ -47,17 +47,12 @@ typedef struct
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_duration;    /* total duration of all samples */
 
-    uint32_t     i_entries_dts;
-    uint32_t     *p_sample_count_dts;
-    uint32_t     *p_sample_delta_dts;   /* dts delta */
-
-    uint32_t     i_entries_pts;
-    uint32_t     *p_sample_count_pts;
-    int32_t      *p_sample_offset_pts;  /* pts-dts */
-
-    uint32_t     *p_sample_size;
-    /* TODO if needed add pts
-        but quickly *add* support for edts and seeking */
+    /* position of the first sample in the stts and ctts run tables:
+     * entry index, and count of the entry samples in previous chunks */
+    uint32_t     i_stts_index;
+    uint32_t     i_stts_skip;
+    uint32_t     i_ctts_index;
+    uint32_t     i_ctts_skip;
 
 } mp4_chunk_t;
 
@@ -120,8 +115,7 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-//                                    too much time to do sumations each time*/
+    const uint32_t   *p_sample_size; /* points into the stsz box */
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
@@ -130,6 +124,9 @@ typedef struct
 
     const MP4_Box_t *p_track;
     const MP4_Box_t *p_stbl;  /* will contain all timing information */
+    const MP4_Box_t *p_stts;  /* sample to dts runs, walked from the chunks */
+    const MP4_Box_t *p_ctts;  /* sample to pts offset runs (could be NULL) */
+    int64_t          i_cts_shift;
     const MP4_Box_t *p_stsd;  /* will contain all data to initialize decoder */
     const MP4_Box_t *p_sample;/* point on actual sdsd */
 
@@ -39,6 +39,7 @@
 #include "ts_pid.h"
 #include "ts_streams.h"
 #include "ts_streams_private.h"
+#include "ts_workers.h"
 #include "ts_psi.h"
 #include "ts_si.h"
 #include "ts_psip.h"
@@ -54,6 +55,7 @@
 
 #include "../../codec/scte18.h"
 #include "../opus.h"
+#include "../seekindex.h"
 #include "../../mux/mpeg/csa.h"
 
 #ifdef HAVE_ARIBB24
@@ -61,6 +63,7 @@
 #endif
 
 #include <assert.h>
+#include <stdatomic.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -111,6 +114,12 @@ static void Close ( vlc_object_t * );
     "Seek and position based on a percent byte position, not a PCR generated " \
     "time position. If seeking doesn't work property, turn on this option." )
 
+#define WORKERS_TEXT N_("Output threads")
+#define WORKERS_LONGTEXT N_( \
+    "Number of threads converting and sending the elementary streams " \
+    "data, programs being spread across them. 0 sends from the demuxer " \
+    "thread. Useful when demuxing many programs at once." )
+
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
@@ -148,6 +157,8 @@ vlc_module_begin ()
 
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
+    add_integer( "ts-workers", 0, WORKERS_TEXT, WORKERS_LONGTEXT, true )
+        change_integer_range( 0, 32 )
 
     add_obsolete_bool( "ts-silent" );
 
@@ -169,28 +180,83 @@ static bool PIDReferencedByProgram( const ts_pmt_t *, uint16_t );
 void UpdatePESFilters( demux_t *p_demux, bool b_all );
 static inline void FlushESBuffer( ts_stream_t *p_pes );
 static void UpdatePIDScrambledState( demux_t *p_demux, ts_pid_t *p_pid, bool );
-static inline int PIDGet( block_t *p )
+static inline int PIDGet( const uint8_t *p )
 {
-    return ( (p->p_buffer[1]&0x1f)<<8 )|p->p_buffer[2];
+    return ( (p[1]&0x1f)<<8 )|p[2];
 }
-static mtime_t GetPCR( const block_t * );
+static mtime_t GetPCR( const uint8_t *, size_t );
 
-static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, int * );
+static bool ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, uint8_t *p, uint32_t *, int * );
 static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk, size_t );
 static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *, block_t *, size_t );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, mtime_t i_pcr );
 
-static block_t* ReadTSPacket( demux_t *p_demux );
+static uint8_t * ReadTSPacketData( demux_t *p_demux );
+static void DescrambleTSPackets( demux_t *, const uint8_t * );
+static uint64_t StreamTell( demux_sys_t * );
+static void ReadBufReset( demux_sys_t * );
+static int StreamSeek( demux_sys_t *, uint64_t );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, int64_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, mtime_t );
 static void PCRFixHandle( demux_t *, ts_pmt_t *, block_t * );
+static void RunOutputJob( demux_t *, ts_worker_job_t * );
 
 #define TS_PACKET_SIZE_188 188
 #define TS_PACKET_SIZE_192 192
 #define TS_PACKET_SIZE_204 204
 #define TS_PACKET_SIZE_MAX 204
 #define TS_HEADER_SIZE 4
+#define TS_READ_BATCH_PACKETS 64
+
+/* Set on the blocks of a PES chain which continue the payload of the
+ * previous block, and are only gathered when needed */
+#define TS_BLOCK_FLAG_FRAGMENT (1 << BLOCK_FLAG_PRIVATE_SHIFT)
+
+/* Period of the copy statistics debug report */
+#define TS_STATS_PERIOD (CLOCK_FREQ * 10)
+
+/* Storage of the read buffer, referenced by the PES payload blocks. It is
+ * only written to while nothing else references it. */
+struct ts_readbuf_chunk_t
+{
+    atomic_uint refs;
+    uint8_t     p_data[];
+};
+
+static void ReadBufChunkRelease( ts_readbuf_chunk_t *p_chunk )
+{
+    if( atomic_fetch_sub_explicit( &p_chunk->refs, 1,
+                                   memory_order_acq_rel ) == 1 )
+        free( p_chunk );
+}
+
+typedef struct
+{
+    block_t             self;
+    ts_readbuf_chunk_t *p_chunk;
+} ts_packet_block_t;
+
+static void PacketBlockRelease( block_t *p_block )
+{
+    ts_packet_block_t *p_pkt = container_of( p_block, ts_packet_block_t, self );
+    ReadBufChunkRelease( p_pkt->p_chunk );
+    free( p_pkt );
+}
+
+/* Returns a block referencing, not copying, a packet of the read buffer */
+static block_t * PacketBlockNew( demux_sys_t *p_sys, uint8_t *p_data )
+{
+    ts_packet_block_t *p_pkt = malloc( sizeof(*p_pkt) );
+    if( unlikely(p_pkt == NULL) )
+        return NULL;
+
+    block_Init( &p_pkt->self, p_data, TS_PACKET_SIZE_188 );
+    p_pkt->self.pf_release = PacketBlockRelease;
+    p_pkt->p_chunk = p_sys->readbuf.p_chunk;
+    atomic_fetch_add_explicit( &p_pkt->p_chunk->refs, 1, memory_order_relaxed );
+    return &p_pkt->self;
+}
 
 static int DetectPacketSize( demux_t *p_demux, unsigned *pi_header_size, int i_offset )
 {
@@ -479,6 +545,10 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->b_split_es = var_InheritBool( p_demux, "ts-split-es" );
 
+    int i_workers = var_InheritInteger( p_demux, "ts-workers" );
+    if( i_workers > 0 )
+        p_sys->workers = ts_workers_New( p_demux, i_workers, RunOutputJob );
+
     p_sys->b_canseek = false;
     p_sys->b_canfastseek = false;
     p_sys->b_ignore_time_for_positions = var_InheritBool( p_demux, "ts-seek-percent" );
@@ -510,6 +580,9 @@ static int Open( vlc_object_t *p_this )
     vlc_stream_Control( p_sys->stream, STREAM_CAN_FASTSEEK,
                         &p_sys->b_canfastseek );
 
+    if( p_sys->b_canfastseek )
+        p_sys->seekindex = seekindex_Open( p_demux, p_demux->s, "ts" );
+
     /* Preparse time */
     if( p_sys->b_canseek )
     {
@@ -539,6 +612,21 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    if( p_sys->workers )
+    {
+        ts_workers_Delete( p_sys->workers );
+        p_sys->workers = NULL;
+    }
+
+    if( p_sys->stats.i_time > 0 )
+        msg_Dbg( p_demux, "demuxed %"PRIu64" packets in %"PRId64" ms "
+                 "(%"PRIu64" KiB/s)", p_sys->stats.i_packets,
+                 p_sys->stats.i_time / 1000, p_sys->stats.i_packets *
+                 p_sys->i_packet_size * CLOCK_FREQ / 1024 / p_sys->stats.i_time );
+    msg_Dbg( p_demux, "copied %"PRIu64" KiB of %"PRIu64" KiB demuxed",
+             p_sys->stats.i_copied / 1024,
+             p_sys->stats.i_packets * p_sys->i_packet_size / 1024 );
+
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
     vlc_mutex_lock( &p_sys->csa_lock );
@@ -565,6 +653,12 @@ static void Close( vlc_object_t *p_this )
 
     vlc_mutex_destroy( &p_sys->csa_lock );
 
+    if( p_sys->seekindex )
+        seekindex_Close( p_sys->seekindex );
+
+    if( p_sys->readbuf.p_chunk )
+        ReadBufChunkRelease( p_sys->readbuf.p_chunk );
+
     /* Release all non default pids */
     ts_pid_list_Release( p_demux, &p_sys->pids );
 
@@ -603,6 +697,7 @@ static int Demux( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
     bool b_wait_es = p_sys->i_pmt_es <= 0;
+    mtime_t i_start = mdate();
 
     /* If we had no PAT within MIN_PAT_INTERVAL, create PAT/PMT from probed streams */
     if( p_sys->i_pmt_es == 0 && !SEEN(GetPID(p_sys, 0)) && p_sys->patfix.status == PAT_MISSING )
@@ -616,11 +711,14 @@ static int Demux( demux_t *p_demux )
     {
         bool         b_frame = false;
         int          i_header = 0;
-        block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
+        uint32_t     i_flags = 0;
+        uint8_t     *p_pkt;
+        if( !(p_pkt = ReadTSPacketData( p_demux )) )
         {
+            p_sys->stats.i_time += mdate() - i_start;
             return VLC_DEMUXER_EOF;
         }
+        p_sys->stats.i_packets++;
 
         if( p_sys->b_start_record )
         {
@@ -630,22 +728,17 @@ static int Demux( demux_t *p_demux )
             p_sys->b_start_record = false;
         }
 
-        /* Early reject truncated packets from hw devices */
-        if( unlikely(p_pkt->i_buffer < TS_PACKET_SIZE_188) )
-        {
-            block_Release( p_pkt );
-            continue;
-        }
-
         /* Reject any fully uncorrected packet. Even PID can be incorrect */
-        if( p_pkt->p_buffer[1]&0x80 )
+        if( p_pkt[1]&0x80 )
         {
             msg_Dbg( p_demux, "transport_error_indicator set (pid=%d)",
                      PIDGet( p_pkt ) );
-            block_Release( p_pkt );
             continue;
         }
 
+        if( p_sys->csa )
+            DescrambleTSPackets( p_demux, p_pkt );
+
         /* Parse the TS packet */
         ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt ) );
         if( !SEEN(p_pid) )
@@ -658,38 +751,42 @@ static int Demux( demux_t *p_demux )
         }
 
         /* Drop duplicates and invalid (DOES NOT drop corrupted) */
-        p_pkt = ProcessTSPacket( p_demux, p_pid, p_pkt, &i_header );
-        if( !p_pkt )
+        if( !ProcessTSPacket( p_demux, p_pid, p_pkt, &i_flags, &i_header ) )
             continue;
 
-        if( !SCRAMBLED(*p_pid) != !(p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED) )
+        if( !SCRAMBLED(*p_pid) != !(i_flags & BLOCK_FLAG_SCRAMBLED) )
         {
-            UpdatePIDScrambledState( p_demux, p_pid, p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED );
+            UpdatePIDScrambledState( p_demux, p_pid, i_flags & BLOCK_FLAG_SCRAMBLED );
         }
 
         /* Adaptation field cannot be scrambled */
-        mtime_t i_pcr = GetPCR( p_pkt );
+        mtime_t i_pcr = GetPCR( p_pkt, TS_PACKET_SIZE_188 );
         if( i_pcr > VLC_TS_INVALID )
             PCRHandle( p_demux, p_pid, i_pcr );
 
         /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
         if( !SEEN( GetPID( p_sys, 0 ) ) &&
             (p_pid->probed.i_fourcc == 0 || p_pid->i_pid == p_sys->patfix.i_timesourcepid) &&
-            (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
-            (p_pkt->p_buffer[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
+            (p_pkt[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
+            (p_pkt[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
         {
-            ProbePES( p_demux, p_pid, p_pkt->p_buffer + TS_HEADER_SIZE,
-                      p_pkt->i_buffer - TS_HEADER_SIZE, p_pkt->p_buffer[3] & 0x20 /* Adaptation field */);
+            ProbePES( p_demux, p_pid, p_pkt + TS_HEADER_SIZE,
+                      TS_PACKET_SIZE_188 - TS_HEADER_SIZE, p_pkt[3] & 0x20 /* Adaptation field */);
         }
 
         switch( p_pid->type )
         {
         case TYPE_PAT:
         case TYPE_PMT:
-            /* PAT and PMT are not allowed to be scrambled */
-            ts_psi_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
+        {
+            /* PAT and PMT are not allowed to be scrambled.
+             * PMT callbacks can probe the stream and overwrite the read
+             * buffer, so work on a copy */
+            uint8_t pkt[TS_PACKET_SIZE_188];
+            memcpy( pkt, p_pkt, TS_PACKET_SIZE_188 );
+            ts_psi_Packet_Push( p_pid, pkt );
             break;
+        }
 
         case TYPE_STREAM:
             p_sys->b_end_preparse = true;
@@ -705,41 +802,54 @@ static int Demux( demux_t *p_demux )
             if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
             {
                 /* That packet is for an unselected ES, don't waste time/memory gathering its data */
-                block_Release( p_pkt );
                 continue;
             }
 
-            if( p_pid->u.p_stream->transport == TS_TRANSPORT_PES )
-            {
-                b_frame = GatherPESData( p_demux, p_pid, p_pkt, i_header );
-            }
-            else if( p_pid->u.p_stream->transport == TS_TRANSPORT_SECTIONS )
+            if( p_pid->u.p_stream->transport == TS_TRANSPORT_PES ||
+                p_pid->u.p_stream->transport == TS_TRANSPORT_SECTIONS )
             {
-                b_frame = GatherSectionsData( p_demux, p_pid, p_pkt, i_header );
-            }
-            else // pid->u.p_pes->transport == TS_TRANSPORT_IGNORE
-            {
-                block_Release( p_pkt );
+                /* Only now does the packet need its own block. PES payloads
+                 * stay in the read buffer until gathered. */
+                block_t *p_block;
+                if( p_pid->u.p_stream->transport == TS_TRANSPORT_PES )
+                {
+                    p_block = PacketBlockNew( p_sys, p_pkt );
+                }
+                else
+                {
+                    p_block = block_Alloc( TS_PACKET_SIZE_188 );
+                    if( likely(p_block) )
+                    {
+                        memcpy( p_block->p_buffer, p_pkt, TS_PACKET_SIZE_188 );
+                        p_sys->stats.i_copied += TS_PACKET_SIZE_188;
+                    }
+                }
+                if( unlikely(p_block == NULL) )
+                    continue;
+                p_block->i_flags = i_flags;
+
+                if( p_pid->u.p_stream->transport == TS_TRANSPORT_PES )
+                    b_frame = GatherPESData( p_demux, p_pid, p_block, i_header );
+                else
+                    b_frame = GatherSectionsData( p_demux, p_pid, p_block, i_header );
             }
+            /* else pid->u.p_pes->transport == TS_TRANSPORT_IGNORE */
 
             break;
 
         case TYPE_SI:
-            if( (p_pkt->i_flags & (BLOCK_FLAG_SCRAMBLED|BLOCK_FLAG_CORRUPTED)) == 0 )
-                ts_si_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
+            if( (i_flags & (BLOCK_FLAG_SCRAMBLED|BLOCK_FLAG_CORRUPTED)) == 0 )
+                ts_si_Packet_Push( p_pid, p_pkt );
             break;
 
         case TYPE_PSIP:
-            if( (p_pkt->i_flags & (BLOCK_FLAG_SCRAMBLED|BLOCK_FLAG_CORRUPTED)) == 0 )
-                ts_psip_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
+            if( (i_flags & (BLOCK_FLAG_SCRAMBLED|BLOCK_FLAG_CORRUPTED)) == 0 )
+                ts_psip_Packet_Push( p_pid, p_pkt );
             break;
 
         case TYPE_CAT:
         default:
             /* We have to handle PCR if present */
-            block_Release( p_pkt );
             break;
         }
 
@@ -748,6 +858,22 @@ static int Demux( demux_t *p_demux )
     }
 
     demux_UpdateTitleFromStream( p_demux );
+    p_sys->stats.i_time += mdate() - i_start;
+
+    if( p_sys->stats.i_report_date == 0 )
+        p_sys->stats.i_report_date = i_start;
+    else if( i_start - p_sys->stats.i_report_date >= TS_STATS_PERIOD )
+    {
+        const mtime_t i_period = i_start - p_sys->stats.i_report_date;
+        msg_Dbg( p_demux, "copied %"PRIu64" KiB/s of %"PRIu64" KiB/s demuxed",
+                 ( p_sys->stats.i_copied - p_sys->stats.i_report_copied )
+                    * CLOCK_FREQ / 1024 / i_period,
+                 ( p_sys->stats.i_packets - p_sys->stats.i_report_packets )
+                    * p_sys->i_packet_size * CLOCK_FREQ / 1024 / i_period );
+        p_sys->stats.i_report_date = i_start;
+        p_sys->stats.i_report_packets = p_sys->stats.i_packets;
+        p_sys->stats.i_report_copied = p_sys->stats.i_copied;
+    }
     return VLC_DEMUXER_SUCCESS;
 }
 
@@ -886,6 +1012,22 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
     }
 
+    /* Seeking and selection change the ES the workers are sending to */
+    if( p_sys->workers )
+    {
+        switch( i_query )
+        {
+            case DEMUX_SET_POSITION:
+            case DEMUX_SET_TIME:
+            case DEMUX_SET_GROUP:
+            case DEMUX_SET_ES:
+                ts_workers_Drain( p_sys->workers );
+                break;
+            default:
+                break;
+        }
+    }
+
     switch( i_query )
     {
     case DEMUX_CAN_SEEK:
@@ -925,7 +1067,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            uint64_t offset = vlc_stream_Tell( p_sys->stream );
+            uint64_t offset = StreamTell( p_sys );
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -972,7 +1114,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         i64 = stream_Size( p_sys->stream );
         if( i64 > 0 &&
-            vlc_stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
+            StreamSeek( p_sys, (int64_t)(i64 * f) ) == VLC_SUCCESS )
         {
             ReadyQueuesPostSeek( p_demux );
             return VLC_SUCCESS;
@@ -1104,11 +1246,14 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 
     case DEMUX_SET_TITLE:
-        return vlc_stream_vaControl( p_sys->stream, STREAM_SET_TITLE, args );
-
     case DEMUX_SET_SEEKPOINT:
-        return vlc_stream_vaControl( p_sys->stream, STREAM_SET_SEEKPOINT,
-                                     args );
+        if( vlc_stream_vaControl( p_sys->stream, i_query == DEMUX_SET_TITLE ?
+                                  STREAM_SET_TITLE : STREAM_SET_SEEKPOINT,
+                                  args ) )
+            return VLC_EGENERIC;
+        /* Packets read ahead belong to the previous title or chapter */
+        ReadBufReset( p_sys );
+        return VLC_SUCCESS;
 
     case DEMUX_GET_META:
         return vlc_stream_vaControl( p_sys->stream, STREAM_GET_META, args );
@@ -1294,7 +1439,7 @@ invalid:
 
 static block_t * ConvertPESBlock( demux_t *p_demux, ts_es_t *p_es,
                                   size_t i_pes_size, uint8_t i_stream_id,
-                                  block_t *p_block )
+                                  mtime_t i_pcr, block_t *p_block )
 {
     if(!p_block)
         return NULL;
@@ -1316,7 +1461,6 @@ static block_t * ConvertPESBlock( demux_t *p_demux, ts_es_t *p_es,
         {
             /* Teletext may have missing PTS (ETSI EN 300 472 Annexe A)
              * In this case use the last PCR + 40ms */
-            mtime_t i_pcr = p_es->p_program->pcr.i_current;
             if( i_pcr > VLC_TS_INVALID )
                 p_block->i_pts = FROM_SCALE(i_pcr) + 40000;
         }
@@ -1368,12 +1512,6 @@ static void SendDataChain( demux_t *p_demux, ts_es_t *p_es, block_t *p_chain )
         p_block->p_next = NULL;
 
         ts_es_t *p_es_send = p_es;
-        if( p_es_send->i_next_block_flags )
-        {
-            p_block->i_flags |= p_es_send->i_next_block_flags;
-            p_es_send->i_next_block_flags = 0;
-        }
-
         while( p_es_send )
         {
             if( p_es_send->p_program->b_selected )
@@ -1417,6 +1555,129 @@ static void SendDataChain( demux_t *p_demux, ts_es_t *p_es, block_t *p_chain )
     }
 }
 
+/****************************************************************************
+ * output, on the worker threads if any
+ ****************************************************************************/
+static bool PESChainIsFragmented( const block_t *p_pes )
+{
+    return p_pes->p_next && (p_pes->p_next->i_flags & TS_BLOCK_FLAG_FRAGMENT);
+}
+
+/* Detaches the first PES of the chain, with its payload fragments */
+static block_t * PESChainExtract( block_t **pp_chain )
+{
+    block_t *p_pes = *pp_chain;
+    block_t *p_last = p_pes;
+
+    while( PESChainIsFragmented( p_last ) )
+        p_last = p_last->p_next;
+    *pp_chain = p_last->p_next;
+    p_last->p_next = NULL;
+    return p_pes;
+}
+
+/* Makes the PES payload contiguous, for the consumers which need it */
+static block_t * PESChainGather( block_t *p_pes )
+{
+    if( !PESChainIsFragmented( p_pes ) )
+        return p_pes;
+
+    block_t *p_block = block_ChainGather( p_pes );
+    if( unlikely(p_block == NULL) )
+        block_ChainRelease( p_pes );
+    return p_block;
+}
+
+static void RunOutputJob( demux_t *p_demux, ts_worker_job_t *p_job )
+{
+    if( p_job->p_es == NULL )
+    {
+        es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_job->i_program,
+                        FROM_SCALE(p_job->i_pcr) );
+        return;
+    }
+
+    if( p_job->b_direct )
+    {
+        if( p_job->p_es->id )
+            es_out_Send( p_demux->out, p_job->p_es->id, p_job->p_block );
+        else
+            block_Release( p_job->p_block );
+        return;
+    }
+
+    block_t *p_block = PESChainGather( p_job->p_block );
+    /* Some codecs might need xform or AU splitting */
+    if( p_block && p_job->b_convert )
+        p_block = ConvertPESBlock( p_demux, p_job->p_es, p_job->i_pes_size,
+                                   p_job->i_stream_id, p_job->i_pcr, p_block );
+    if( p_block )
+        p_block->i_flags |= p_job->i_flags;
+
+    SendDataChain( p_demux, p_job->p_es, p_block );
+}
+
+static void OutputJob( demux_t *p_demux, ts_worker_job_t *p_job )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    /* Data of PID shared by several programs is sent to all of them, which
+     * can be bound to different workers: send it synchronously instead. */
+    if( p_sys->workers && (p_job->p_es == NULL || p_job->b_direct ||
+                           p_job->p_es->p_next == NULL) )
+    {
+        ts_worker_job_t *p_copy = malloc( sizeof(*p_copy) );
+        if( likely(p_copy) )
+        {
+            *p_copy = *p_job;
+            ts_workers_Push( p_sys->workers, p_copy );
+            return;
+        }
+    }
+
+    if( p_sys->workers )
+        ts_workers_Drain( p_sys->workers );
+    RunOutputJob( p_demux, p_job );
+}
+
+static void OutputPESBlock( demux_t *p_demux, ts_es_t *p_es, bool b_convert,
+                            size_t i_pes_size, uint8_t i_stream_id,
+                            block_t *p_block )
+{
+    ts_worker_job_t job = {
+        .i_program = p_es->p_program->i_number,
+        .p_es = p_es,
+        .p_block = p_block,
+        .i_pcr = p_es->p_program->pcr.i_current,
+        .i_pes_size = i_pes_size,
+        .i_flags = p_es->i_next_block_flags,
+        .i_stream_id = i_stream_id,
+        .b_convert = b_convert,
+    };
+    p_es->i_next_block_flags = 0;
+    OutputJob( p_demux, &job );
+}
+
+void OutputESBlock( demux_t *p_demux, ts_es_t *p_es, block_t *p_block )
+{
+    ts_worker_job_t job = {
+        .i_program = p_es->p_program->i_number,
+        .p_es = p_es,
+        .p_block = p_block,
+        .b_direct = true,
+    };
+    OutputJob( p_demux, &job );
+}
+
+static void OutputPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
+{
+    ts_worker_job_t job = {
+        .i_program = p_pmt->i_number,
+        .i_pcr = i_pcr,
+    };
+    OutputJob( p_demux, &job );
+}
+
 /****************************************************************************
  * gathering stuff
  ****************************************************************************/
@@ -1547,12 +1808,14 @@ static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
 
         p_pes->i_length = FROM_SCALE_NZ(i_length);
 
+        /* The payload is only gathered on output, as a single copy */
+        for( block_t *p_frag = p_pes->p_next; p_frag; p_frag = p_frag->p_next )
+            p_frag->i_flags = TS_BLOCK_FLAG_FRAGMENT;
+
         /* Can become a chain on next call due to prepcr */
-        block_t *p_chain = block_ChainGather( p_pes );
+        block_t *p_chain = p_pes;
         while ( p_chain ) {
-            block_t *p_block = p_chain;
-            p_chain = p_chain->p_next;
-            p_block->p_next = NULL;
+            block_t *p_block = PESChainExtract( &p_chain );
 
             if( !p_pmt->pcr.b_fix_done ) /* Not seen yet */
                 PCRFixHandle( p_demux, p_pmt, p_block );
@@ -1606,19 +1869,27 @@ static void ParsePESDataChain( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
 
                 /*** From here, block can become a chain again though conversion below ***/
 
+                if( PESChainIsFragmented( p_block ) )
+                {
+                    size_t i_copied;
+                    block_ChainProperties( p_block, NULL, &i_copied, NULL );
+                    p_demux->p_sys->stats.i_copied += i_copied;
+                }
+
                 if( pid->u.p_stream->p_proc )
                 {
                     if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
                         ts_stream_processor_Reset( pid->u.p_stream->p_proc );
-                    p_block = ts_stream_processor_Push( pid->u.p_stream->p_proc, i_stream_id, p_block );
+                    p_block = PESChainGather( p_block );
+                    if( p_block )
+                        p_block = ts_stream_processor_Push( pid->u.p_stream->p_proc, i_stream_id, p_block );
+                    if( p_block )
+                        OutputPESBlock( p_demux, p_es, false, i_pes_size, i_stream_id, p_block );
                 }
                 else
-                /* Some codecs might need xform or AU splitting */
                 {
-                    p_block = ConvertPESBlock( p_demux, p_es, i_pes_size, i_stream_id, p_block );
+                    OutputPESBlock( p_demux, p_es, true, i_pes_size, i_stream_id, p_block );
                 }
-
-                SendDataChain( p_demux, p_es, p_block );
             }
             else
             {
@@ -1684,14 +1955,128 @@ static bool PushPESBlock( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, bool
     return b_ret;
 }
 
-static block_t* ReadTSPacket( demux_t *p_demux )
+static uint64_t StreamTell( demux_sys_t *p_sys )
+{
+    /* Account for what was read ahead but not consumed yet */
+    return vlc_stream_Tell( p_sys->stream )
+           - ( p_sys->readbuf.i_fill - p_sys->readbuf.i_offset );
+}
+
+/* Drops what was read ahead, when the stream position changes */
+static void ReadBufReset( demux_sys_t *p_sys )
+{
+    p_sys->readbuf.i_fill = 0;
+    p_sys->readbuf.i_offset = 0;
+    p_sys->readbuf.i_descrambled = 0;
+}
+
+static int StreamSeek( demux_sys_t *p_sys, uint64_t i_pos )
+{
+    ReadBufReset( p_sys );
+    return vlc_stream_Seek( p_sys->stream, i_pos );
+}
+
+/* Makes sure at least i_size bytes are buffered from the current offset */
+static bool ReadTSBuffer( demux_t *p_demux, size_t i_size )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
-    block_t     *p_pkt;
+    if( p_sys->readbuf.i_fill - p_sys->readbuf.i_offset >= i_size )
+        return true;
+
+    const size_t i_tail = p_sys->readbuf.i_fill - p_sys->readbuf.i_offset;
+
+    if( p_sys->readbuf.p_chunk == NULL ||
+        atomic_load( &p_sys->readbuf.p_chunk->refs ) > 1 )
+    {
+        /* PES payloads still reference the buffer: read into a new one */
+        const size_t i_size = p_sys->i_packet_size * TS_READ_BATCH_PACKETS;
+        ts_readbuf_chunk_t *p_chunk = malloc( sizeof(*p_chunk) + i_size );
+        if( unlikely(p_chunk == NULL) )
+            return false;
+        atomic_init( &p_chunk->refs, 1 );
+
+        if( p_sys->readbuf.p_chunk )
+        {
+            memcpy( p_chunk->p_data,
+                    &p_sys->readbuf.p_buffer[p_sys->readbuf.i_offset], i_tail );
+            p_sys->stats.i_copied += i_tail;
+            ReadBufChunkRelease( p_sys->readbuf.p_chunk );
+        }
+        p_sys->readbuf.p_chunk = p_chunk;
+        p_sys->readbuf.p_buffer = p_chunk->p_data;
+        p_sys->readbuf.i_size = i_size;
+    }
+    else
+    {
+        /* Move the incomplete tail to the front */
+        memmove( p_sys->readbuf.p_buffer,
+                 &p_sys->readbuf.p_buffer[p_sys->readbuf.i_offset], i_tail );
+    }
+    p_sys->readbuf.i_fill = i_tail;
+    if( p_sys->readbuf.i_descrambled > p_sys->readbuf.i_offset )
+        p_sys->readbuf.i_descrambled -= p_sys->readbuf.i_offset;
+    else
+        p_sys->readbuf.i_descrambled = 0;
+    p_sys->readbuf.i_offset = 0;
+
+    /* Take whatever is available, so that live sources don't wait for
+     * a full batch */
+    while( p_sys->readbuf.i_fill < i_size )
+    {
+        ssize_t i_read = vlc_stream_ReadPartial( p_sys->stream,
+                            &p_sys->readbuf.p_buffer[p_sys->readbuf.i_fill],
+                            p_sys->readbuf.i_size - p_sys->readbuf.i_fill );
+        if( i_read < 0 )
+            continue;
+        if( i_read == 0 )
+            return false;
+        p_sys->readbuf.i_fill += i_read;
+    }
+
+    return true;
+}
+
+/* Descrambles, in one batch, the packet and all the following ones that
+ * are already buffered */
+static void DescrambleTSPackets( demux_t *p_demux, const uint8_t *p_pkt )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const unsigned i_hdr = p_sys->i_packet_header_size;
+    size_t i_pos = p_pkt - i_hdr - p_sys->readbuf.p_buffer;
+
+    if( i_pos < p_sys->readbuf.i_descrambled )
+        return;
+
+    uint8_t *pp_pkts[TS_READ_BATCH_PACKETS];
+    int i_pkts = 0;
 
-    /* Get a new TS packet */
-    if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
+    for( ; i_pos + p_sys->i_packet_size <= p_sys->readbuf.i_fill &&
+           i_pkts < TS_READ_BATCH_PACKETS; i_pos += p_sys->i_packet_size )
+    {
+        uint8_t *p = &p_sys->readbuf.p_buffer[i_pos + i_hdr];
+        if( p[0] != 0x47 )
+            break; /* let the resync logic handle it */
+        if( (p[1]&0x80) || PIDGet( p ) == 0x1FFF )
+            continue; /* will be dropped anyway */
+        if( p[3]&0x80 )
+            pp_pkts[i_pkts++] = p;
+    }
+    p_sys->readbuf.i_descrambled = i_pos;
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    csa_DecryptBatch( p_sys->csa, pp_pkts, i_pkts, p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
+/* Returns the next packet (after the optional BluRay header) in place.
+ * It is only valid until the next read, and must be copied to be kept. */
+static uint8_t * ReadTSPacketData( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const unsigned i_hdr = p_sys->i_packet_header_size;
+
+    if( !ReadTSBuffer( p_demux, p_sys->i_packet_size ) )
     {
         int64_t size = stream_Size( p_sys->stream );
         if( size >= 0 && (uint64_t)size == vlc_stream_Tell( p_sys->stream ) )
@@ -1701,72 +2086,61 @@ static block_t* ReadTSPacket( demux_t *p_demux )
         return NULL;
     }
 
-    if( p_pkt->i_buffer < TS_HEADER_SIZE + p_sys->i_packet_header_size )
-    {
-        block_Release( p_pkt );
-        return NULL;
-    }
-
     /* Skip header (BluRay streams).
      * re-sync logic would do this (by adjusting packet start), but this would result in losing first and last ts packets.
      * First packet is usually PAT, and losing it means losing whole first GOP. This is fatal with still-image based menus.
      */
-    p_pkt->p_buffer += p_sys->i_packet_header_size;
-    p_pkt->i_buffer -= p_sys->i_packet_header_size;
+    uint8_t *p = &p_sys->readbuf.p_buffer[p_sys->readbuf.i_offset];
 
     /* Check sync byte and re-sync if needed */
-    if( p_pkt->p_buffer[0] != 0x47 )
+    if( p[i_hdr] != 0x47 )
     {
         msg_Warn( p_demux, "lost synchro" );
-        block_Release( p_pkt );
+        p_sys->readbuf.i_offset += p_sys->i_packet_size;
         for( ;; )
         {
-            const uint8_t *p_peek;
-            int i_peek = 0;
             unsigned i_skip = 0;
 
-            i_peek = vlc_stream_Peek( p_sys->stream, &p_peek,
-                    p_sys->i_packet_size * 10 );
-            if( i_peek < 0 || (unsigned)i_peek < p_sys->i_packet_size + 1 )
+            if( !ReadTSBuffer( p_demux, p_sys->i_packet_size + i_hdr + 1 ) )
             {
                 msg_Dbg( p_demux, "eof ?" );
                 return NULL;
             }
 
-            while( i_skip < i_peek - p_sys->i_packet_size )
+            p = &p_sys->readbuf.p_buffer[p_sys->readbuf.i_offset];
+            const size_t i_avail = p_sys->readbuf.i_fill - p_sys->readbuf.i_offset;
+            while( i_skip + p_sys->i_packet_size + i_hdr < i_avail )
             {
-                if( p_peek[i_skip + p_sys->i_packet_header_size] == 0x47 &&
-                        p_peek[i_skip + p_sys->i_packet_header_size + p_sys->i_packet_size] == 0x47 )
+                if( p[i_skip + i_hdr] == 0x47 &&
+                    p[i_skip + i_hdr + p_sys->i_packet_size] == 0x47 )
                 {
                     break;
                 }
                 i_skip++;
             }
             msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
-            if (vlc_stream_Read( p_sys->stream, NULL, i_skip ) != i_skip)
-                return NULL;
+            p_sys->readbuf.i_offset += i_skip;
 
-            if( i_skip < i_peek - p_sys->i_packet_size )
-            {
+            if( i_skip + p_sys->i_packet_size + i_hdr < i_avail )
                 break;
-            }
         }
-        if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
+        if( !ReadTSBuffer( p_demux, p_sys->i_packet_size ) )
         {
             msg_Dbg( p_demux, "eof ?" );
             return NULL;
         }
+        p = &p_sys->readbuf.p_buffer[p_sys->readbuf.i_offset];
     }
-    return p_pkt;
+
+    p_sys->readbuf.i_offset += p_sys->i_packet_size;
+    return p + i_hdr;
 }
 
-static mtime_t GetPCR( const block_t *p_pkt )
+static mtime_t GetPCR( const uint8_t *p, size_t i_buffer )
 {
-    const uint8_t *p = p_pkt->p_buffer;
-
     mtime_t i_pcr = -1;
 
-    if( likely(p_pkt->i_buffer > 11) &&
+    if( likely(i_buffer > 11) &&
         ( p[3]&0x20 ) && /* adaptation */
         ( p[5]&0x10 ) &&
         ( p[4] >= 7 ) )
@@ -1860,19 +2234,24 @@ static void ReadyQueuesPostSeek( demux_t *p_demux )
     }
 }
 
+/* Seeking stops at a PCR at most this much before the requested time
+ * (90kHz units) */
+#define SEEK_TOLERANCE TO_SCALE_NZ(CLOCK_FREQ / 2)
+
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaledtime )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
     /* Deal with common but worst binary search case */
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
-        return vlc_stream_Seek( p_sys->stream, 0 );
+        return StreamSeek( p_sys, 0 );
 
     const int64_t i_stream_size = stream_Size( p_sys->stream );
     if( !p_sys->b_canfastseek || i_stream_size < p_sys->i_packet_size )
         return VLC_EGENERIC;
 
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = StreamTell( p_sys );
+    const size_t i_pkt_size = p_sys->i_packet_size - p_sys->i_packet_header_size;
 
     /* Find the time position by using binary search algorithm. */
     uint64_t i_head_pos = 0;
@@ -1880,6 +2259,23 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
     if( i_head_pos >= i_tail_pos )
         return VLC_EGENERIC;
 
+    /* Narrow down the search using the PCR positions seen before */
+    const seekindex_entry_t *p_before, *p_after;
+    const int64_t i_indextime = i_scaledtime - p_pmt->pcr.i_first;
+    if( p_sys->seekindex &&
+        seekindex_Lookup( p_sys->seekindex, p_pmt->i_number, i_indextime,
+                          &p_before, &p_after ) == VLC_SUCCESS )
+    {
+        if( p_before && p_before->i_offset < i_tail_pos )
+        {
+            if( i_indextime - p_before->i_time < SEEK_TOLERANCE )
+                return StreamSeek( p_sys, p_before->i_offset );
+            i_head_pos = p_before->i_offset;
+        }
+        if( p_after && p_after->i_offset > i_head_pos )
+            i_tail_pos = __MIN( i_tail_pos, p_after->i_offset );
+    }
+
     bool b_found = false;
     while( (i_head_pos + p_sys->i_packet_size) <= i_tail_pos && !b_found )
     {
@@ -1888,37 +2284,37 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
         uint64_t i_div = i_splitpos % p_sys->i_packet_size;
         i_splitpos -= i_div;
 
-        if ( vlc_stream_Seek( p_sys->stream, i_splitpos ) != VLC_SUCCESS )
+        if ( StreamSeek( p_sys, i_splitpos ) != VLC_SUCCESS )
             break;
 
         uint64_t i_pos = i_splitpos;
         while( i_pos < i_tail_pos )
         {
             int64_t i_pcr = -1;
-            block_t *p_pkt = ReadTSPacket( p_demux );
+            const uint8_t *p_pkt = ReadTSPacketData( p_demux );
             if( !p_pkt )
             {
                 i_head_pos = i_tail_pos;
                 break;
             }
             else
-                i_pos = vlc_stream_Tell( p_sys->stream );
+                i_pos = StreamTell( p_sys );
 
             int i_pid = PIDGet( p_pkt );
             ts_pid_t *p_pid = GetPID(p_sys, i_pid);
             if( i_pid != 0x1FFF && p_pid->type == TYPE_STREAM &&
                 ts_stream_Find_es( p_pid->u.p_stream, p_pmt ) &&
-               (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
-               (p_pkt->p_buffer[3] & 0xD0) == 0x10    /* Has payload but is not encrypted */
+               (p_pkt[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
+               (p_pkt[3] & 0xD0) == 0x10    /* Has payload but is not encrypted */
             )
             {
                 unsigned i_skip = 4;
-                if ( p_pkt->p_buffer[3] & 0x20 ) // adaptation field
+                if ( p_pkt[3] & 0x20 ) // adaptation field
                 {
-                    if( p_pkt->i_buffer >= 4 + 2 + 5 )
+                    if( i_pkt_size >= 4 + 2 + 5 )
                     {
-                        i_pcr = GetPCR( p_pkt );
-                        i_skip += 1 + p_pkt->p_buffer[4];
+                        i_pcr = GetPCR( p_pkt, i_pkt_size );
+                        i_skip += 1 + p_pkt[4];
                     }
                 }
                 else
@@ -1926,8 +2322,8 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
                     mtime_t i_dts = -1;
                     mtime_t i_pts = -1;
                     uint8_t i_stream_id;
-                    if ( VLC_SUCCESS == ParsePESHeader( VLC_OBJECT(p_demux), &p_pkt->p_buffer[i_skip],
-                                                        p_pkt->i_buffer - i_skip, &i_skip,
+                    if ( VLC_SUCCESS == ParsePESHeader( VLC_OBJECT(p_demux), &p_pkt[i_skip],
+                                                        i_pkt_size - i_skip, &i_skip,
                                                         &i_dts, &i_pts, &i_stream_id, NULL ) )
                     {
                         if( i_dts > -1 )
@@ -1935,14 +2331,13 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
                     }
                 }
             }
-            block_Release( p_pkt );
 
             if( i_pcr != -1 )
             {
                 int64_t i_diff = i_scaledtime - TimeStampWrapAround( p_pmt->pcr.i_first, i_pcr );
                 if ( i_diff < 0 )
                     i_tail_pos = (i_splitpos >= p_sys->i_packet_size) ? i_splitpos - p_sys->i_packet_size : 0;
-                else if( i_diff < TO_SCALE(VLC_TS_0 + CLOCK_FREQ / 2) ) // 500ms
+                else if( i_diff < SEEK_TOLERANCE )
                     b_found = true;
                 else
                     i_head_pos = i_pos;
@@ -1957,7 +2352,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
     if( !b_found )
     {
         msg_Dbg( p_demux, "Seek():cannot find a time position." );
-        vlc_stream_Seek( p_sys->stream, i_initial_pos );
+        StreamSeek( p_sys, i_initial_pos );
         return VLC_EGENERIC;
     }
     return VLC_SUCCESS;
@@ -1969,21 +2364,21 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
 {
     demux_sys_t *p_sys = p_demux->p_sys;
     int i_count = 0;
-    block_t *p_pkt = NULL;
+    const uint8_t *p_pkt = NULL;
+    const size_t i_pkt_size = p_sys->i_packet_size - p_sys->i_packet_header_size;
 
     for( ;; )
     {
         *pi_pcr = -1;
 
-        if( i_count++ > PROBE_CHUNK_COUNT || !( p_pkt = ReadTSPacket( p_demux ) ) )
+        if( i_count++ > PROBE_CHUNK_COUNT || !( p_pkt = ReadTSPacketData( p_demux ) ) )
         {
             break;
         }
 
-        if( p_pkt->i_size < TS_PACKET_SIZE_188 &&
-           ( p_pkt->p_buffer[1]&0x80 ) /* transport error */ )
+        if( i_pkt_size < TS_PACKET_SIZE_188 &&
+           ( p_pkt[1]&0x80 ) /* transport error */ )
         {
-            block_Release( p_pkt );
             continue;
         }
 
@@ -1992,17 +2387,17 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
 
         p_pid->i_flags |= FLAG_SEEN;
 
-        if( i_pid != 0x1FFF && (p_pkt->p_buffer[1] & 0x80) == 0 ) /* not corrupt */
+        if( i_pid != 0x1FFF && (p_pkt[1] & 0x80) == 0 ) /* not corrupt */
         {
             bool b_pcrresult = true;
-            bool b_adaptfield = p_pkt->p_buffer[3] & 0x20;
+            bool b_adaptfield = p_pkt[3] & 0x20;
 
-            if( b_adaptfield && p_pkt->i_buffer >= 4 + 2 + 5 )
-                *pi_pcr = GetPCR( p_pkt );
+            if( b_adaptfield && i_pkt_size >= 4 + 2 + 5 )
+                *pi_pcr = GetPCR( p_pkt, i_pkt_size );
 
             if( *pi_pcr == -1 &&
-                (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* payload start */
-                (p_pkt->p_buffer[3] & 0xD0) == 0x10 && /* Has payload but is not encrypted */
+                (p_pkt[1] & 0xC0) == 0x40 && /* payload start */
+                (p_pkt[3] & 0xD0) == 0x10 && /* Has payload but is not encrypted */
                 p_pid->type == TYPE_STREAM &&
                 p_pid->u.p_stream->p_es->fmt.i_cat != UNKNOWN_ES
               )
@@ -2013,10 +2408,10 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
                 uint8_t i_stream_id;
                 unsigned i_skip = 4;
                 if ( b_adaptfield ) // adaptation field
-                    i_skip += 1 + p_pkt->p_buffer[4];
+                    i_skip += 1 + p_pkt[4];
 
-                if ( VLC_SUCCESS == ParsePESHeader( VLC_OBJECT(p_demux), &p_pkt->p_buffer[i_skip],
-                                                    p_pkt->i_buffer - i_skip, &i_skip,
+                if ( VLC_SUCCESS == ParsePESHeader( VLC_OBJECT(p_demux), &p_pkt[i_skip],
+                                                    i_pkt_size - i_skip, &i_skip,
                                                     &i_dts, &i_pts, &i_stream_id, NULL ) )
                 {
                     if( i_dts != -1 )
@@ -2040,7 +2435,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
                         if( b_end )
                         {
                             p_pmt->i_last_dts = *pi_pcr;
-                            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                            p_pmt->i_last_dts_byte = StreamTell( p_sys );
                         }
                         /* Start, only keep first */
                         else if( b_pcrresult && p_pmt->pcr.i_first == -1 )
@@ -2058,8 +2453,6 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
                 }
             }
         }
-
-        block_Release( p_pkt );
     }
 
     return i_count;
@@ -2068,7 +2461,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
 int ProbeStart( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = StreamTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = 0;
@@ -2081,7 +2474,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_pos = p_sys->i_packet_size * i_probe_count;
         i_pos = __MIN( i_pos, i_stream_size );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( StreamSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, false, &i_pcr, &b_found );
@@ -2090,7 +2483,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_probe_count += PROBE_CHUNK_COUNT;
     } while( i_pos > 0 && (i_pcr == -1 || !b_found) && i_probe_count < (2 * PROBE_CHUNK_COUNT) );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( StreamSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2099,7 +2492,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
 int ProbeEnd( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = StreamTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = PROBE_CHUNK_COUNT;
@@ -2112,7 +2505,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_pos = i_stream_size - (p_sys->i_packet_size * i_probe_count);
         i_pos = __MAX( i_pos, 0 );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( StreamSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, true, &i_pcr, &b_found );
@@ -2121,7 +2514,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_probe_count += PROBE_CHUNK_COUNT;
     } while( i_pos > 0 && (i_pcr == -1 || !b_found) && i_probe_count < (6 * PROBE_CHUNK_COUNT) );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( StreamSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2169,13 +2562,13 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
 
     if ( p_sys->i_pmt_es )
     {
-        es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
+        OutputPCR( p_demux, p_pmt, i_pcr );
         /* growing files/named fifo handling */
         if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+            StreamTell( p_sys ) > p_pmt->i_last_dts_byte )
         {
             p_pmt->i_last_dts = i_pcr;
-            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+            p_pmt->i_last_dts_byte = StreamTell( p_sys );
         }
     }
 }
@@ -2265,6 +2658,29 @@ static void PCRCheckDTS( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr)
     }
 }
 
+/* Remembers where PCR are found, about every second */
+static void PCRIndex( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint64_t i_pos = StreamTell( p_sys );
+
+    if( p_pmt->pcr.i_first == -1 || i_pos < p_sys->i_packet_size )
+        return;
+
+    seekindex_entry_t entry = {
+        .i_time = i_pcr - p_pmt->pcr.i_first,
+        .i_offset = i_pos - p_sys->i_packet_size,
+        .i_track = p_pmt->i_number,
+    };
+
+    if( p_pmt->pcr.i_indexed != -1 &&
+        llabs( entry.i_time - p_pmt->pcr.i_indexed ) < TO_SCALE_NZ(CLOCK_FREQ) )
+        return;
+
+    if( seekindex_Add( p_sys->seekindex, &entry ) == VLC_SUCCESS )
+        p_pmt->pcr.i_indexed = entry.i_time;
+}
+
 static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, mtime_t i_pcr )
 {
     demux_sys_t   *p_sys = p_demux->p_sys;
@@ -2302,6 +2718,8 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, mtime_t i_pcr )
                 /* We've found a target group for update */
                 PCRCheckDTS( p_demux, p_pmt, i_pcr );
                 ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
+                if( p_sys->seekindex )
+                    PCRIndex( p_demux, p_pmt, i_program_pcr );
             }
         }
 
@@ -2375,9 +2793,9 @@ static void PCRFixHandle( demux_t *p_demux, ts_pmt_t *p_pmt, block_t *p_block )
     }
 }
 
-static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, int *pi_skip )
+static bool ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, uint8_t *p,
+                             uint32_t *pi_flags, int *pi_skip )
 {
-    const uint8_t *p = p_pkt->p_buffer;
     const bool b_adaptation = p[3]&0x20;
     const bool b_payload    = p[3]&0x10;
     const bool b_scrambled  = p[3]&0xc0;
@@ -2396,24 +2814,22 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
     /* Drop null packets */
     if( unlikely(pid->i_pid == 0x1FFF) )
     {
-        block_Release( p_pkt );
-        return NULL;
+        return false;
     }
 
     /* For now, ignore additional error correction
      * TODO: handle Reed-Solomon 204,188 error correction */
-    p_pkt->i_buffer = TS_PACKET_SIZE_188;
 
     if( b_scrambled )
     {
         if( p_demux->p_sys->csa )
         {
             vlc_mutex_lock( &p_demux->p_sys->csa_lock );
-            csa_Decrypt( p_demux->p_sys->csa, p_pkt->p_buffer, p_demux->p_sys->i_csa_pkt_size );
+            csa_Decrypt( p_demux->p_sys->csa, p, p_demux->p_sys->i_csa_pkt_size );
             vlc_mutex_unlock( &p_demux->p_sys->csa_lock );
         }
         else
-            p_pkt->i_flags |= BLOCK_FLAG_SCRAMBLED;
+            *pi_flags |= BLOCK_FLAG_SCRAMBLED;
     }
 
     /* We don't have any adaptation_field, so payload starts
@@ -2425,8 +2841,7 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
         if( p[4] + 5 > 188 /* adaptation field only == 188 */ )
         {
             /* Broken is broken */
-            block_Release( p_pkt );
-            return NULL;
+            return false;
         }
         else if( p[4] > 0 )
         {
@@ -2436,7 +2851,7 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
             {
                 msg_Warn( p_demux, "discontinuity indicator (pid=%d) ",
                             pid->i_pid );
-                p_pkt->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+                *pi_flags |= BLOCK_FLAG_DISCONTINUITY;
             }
 #if 0
             if( p[5]&0x40 )
@@ -2472,8 +2887,7 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
             {
                 /* Discard duplicated payload 2.4.3.3 */
                 pid->i_dup++;
-                block_Release( p_pkt );
-                return NULL;
+                return false;
             }
             else if( i_diff != 0 && !b_discontinuity )
             {
@@ -2482,7 +2896,7 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
 
                 pid->i_cc = i_cc;
                 pid->i_dup = 0;
-                p_pkt->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+                *pi_flags |= BLOCK_FLAG_DISCONTINUITY;
             }
             else pid->i_cc = i_cc;
         }
@@ -2498,11 +2912,10 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
 
     if( unlikely(!(b_payload || b_adaptation)) ) /* Invalid, ignore */
     {
-        block_Release( p_pkt );
-        return NULL;
+        return false;
     }
 
-    return p_pkt;
+    return true;
 }
 
 /* Avoids largest memcpy */
@@ -2792,6 +3205,9 @@ void AddAndCreateES( demux_t *p_demux, ts_pid_t *pid, bool b_create_delayed )
     if( b_create_delayed )
         p_sys->es_creation = CREATE_ES;
 
+    if( p_sys->workers )
+        ts_workers_Drain( p_sys->workers );
+
     if( pid && p_sys->es_creation == CREATE_ES )
     {
         DoCreateES( p_demux, pid->u.p_stream->p_es, NULL );
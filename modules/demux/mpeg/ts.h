@@ -24,6 +24,9 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct seekindex_t seekindex_t;
+typedef struct ts_workers_t ts_workers_t;
+typedef struct ts_readbuf_chunk_t ts_readbuf_chunk_t;
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -60,8 +63,37 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* Batched stream reads: packets are walked in place. PES payloads are
+     * referenced from the buffer, sections are copied out. */
+    struct
+    {
+        ts_readbuf_chunk_t *p_chunk; /* refcounted storage of p_buffer */
+        uint8_t *p_buffer;
+        size_t   i_size;   /* allocated */
+        size_t   i_fill;   /* bytes read from the stream */
+        size_t   i_offset; /* start of the next unread packet */
+        size_t   i_descrambled; /* end of the already descrambled packets */
+    } readbuf;
+
     bool        b_ignore_time_for_positions;
 
+    /* PCR positions, cached across sessions */
+    seekindex_t *seekindex;
+
+    /* PES conversion and output threads, if any */
+    ts_workers_t *workers;
+
+    struct
+    {
+        uint64_t i_packets;
+        mtime_t  i_time; /* spent in the demux function */
+        uint64_t i_copied; /* payload bytes copied on the demux path */
+        /* totals at the last periodic report */
+        mtime_t  i_report_date;
+        uint64_t i_report_packets;
+        uint64_t i_report_copied;
+    } stats;
+
     ts_standards_e standard;
 
     struct
@@ -137,6 +169,10 @@ int ProbeStart( demux_t *p_demux, int i_program );
 int ProbeEnd( demux_t *p_demux, int i_program );
 
 void AddAndCreateES( demux_t *p_demux, ts_pid_t *pid, bool b_create_delayed );
+
+/* Sends a block to an ES, after the data already queued for its program */
+void OutputESBlock( demux_t *p_demux, ts_es_t *p_es, block_t *p_block );
+
 int FindPCRCandidate( ts_pmt_t *p_pmt );
 
 #endif
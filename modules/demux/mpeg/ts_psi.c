@@ -53,6 +53,7 @@
 #include "ts_psip.h"
 #include "ts_si.h"
 #include "ts_metadata.h"
+#include "ts_workers.h"
 
 #include "../access/dtv/en50221_capmt.h"
 
@@ -111,6 +112,10 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_dvbpsipat )
     msg_Dbg( p_demux, "new PAT ts_id=%d version=%d current_next=%d",
              p_dvbpsipat->i_ts_id, p_dvbpsipat->i_version, p_dvbpsipat->b_current_next );
 
+    /* Programs and their ES are about to change */
+    if( p_sys->workers )
+        ts_workers_Drain( p_sys->workers );
+
     /* Save old programs array */
     DECL_ARRAY(ts_pid_t *) old_pmt_rm;
     old_pmt_rm.i_alloc = p_pat->programs.i_alloc;
@@ -1628,6 +1633,10 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
         return;
     }
 
+    /* The program ES are about to change */
+    if( p_sys->workers )
+        ts_workers_Drain( p_sys->workers );
+
     /* Save old es array */
     DECL_ARRAY(ts_pid_t *) pid_to_decref;
     pid_to_decref.i_alloc = p_pmt->e_streams.i_alloc;
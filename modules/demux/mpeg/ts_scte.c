@@ -30,6 +30,7 @@
 #include <dvbpsi/psi.h>
 
 #include "ts_pid.h"
+#include "ts.h"
 #include "ts_scte.h"
 #include "ts_streams_private.h"
 #include "timestamps.h"
@@ -67,7 +68,7 @@ void SCTE18_Section_Callback( dvbpsi_t *p_handle, const dvbpsi_psi_section_t* p_
             p_block->i_dts = p_block->i_pts = FROM_SCALE( i_date );
 
             es_out_Control( p_demux->out, ES_OUT_SET_ES_STATE, p_es->id, true );
-            es_out_Send( p_demux->out, p_es->id, p_block );
+            OutputESBlock( p_demux, p_es, p_block );
         }
     }
 }
@@ -114,8 +115,5 @@ void SCTE27_Section_Callback( demux_t *p_demux,
     p_content->i_dts = p_content->i_pts = VLC_TS_0 + i_date * 100 / 9;
     //PCRFixHandle( p_demux, p_pmt, p_content );
 
-    if( p_pes->p_es->id )
-        es_out_Send( p_demux->out, p_pes->p_es->id, p_content );
-    else
-        block_Release( p_content );
+    OutputESBlock( p_demux, p_pes->p_es, p_content );
 }
@@ -27,6 +27,7 @@
 #include "ts_pid.h"
 #include "ts_streams_private.h"
 #include "ts.h"
+#include "ts_workers.h"
 
 #include "ts_sl.h"
 
@@ -170,6 +171,9 @@ void SLPackets_Section_Handler( demux_t *p_demux,
                      SetupISO14496LogicalStream( p_demux, &p_mpeg4desc->dec_descr, &fmt ) &&
                      !es_format_IsSimilar( &fmt, &p_es->fmt ) )
                 {
+                    if( p_demux->p_sys->workers )
+                        ts_workers_Drain( p_demux->p_sys->workers );
+
                     fmt.i_id = p_es->fmt.i_id;
                     fmt.i_group = p_es->fmt.i_group;
                     es_format_Clean( &p_es->fmt );
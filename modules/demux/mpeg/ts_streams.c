@@ -45,6 +45,7 @@
 #include "sections.h"
 #include "ts_pid.h"
 #include "ts.h"
+#include "ts_workers.h"
 
 #include "ts_psip.h"
 
@@ -134,6 +135,7 @@ ts_pmt_t *ts_pmt_New( demux_t *p_demux )
     pmt->pcr.i_pcroffset = -1;
 
     pmt->pcr.b_fix_done = false;
+    pmt->pcr.i_indexed = -1;
 
     pmt->eit.i_event_length = 0;
     pmt->eit.i_event_start = 0;
@@ -146,6 +148,9 @@ ts_pmt_t *ts_pmt_New( demux_t *p_demux )
 
 void ts_pmt_Del( demux_t *p_demux, ts_pmt_t *pmt )
 {
+    if( p_demux->p_sys->workers )
+        ts_workers_Drain( p_demux->p_sys->workers );
+
     if( dvbpsi_decoder_present( pmt->handle ) )
         dvbpsi_pmt_detach( pmt->handle );
     dvbpsi_delete( pmt->handle );
@@ -189,6 +194,9 @@ ts_es_t * ts_es_New( ts_pmt_t *p_program )
 
 static void ts_pes_es_Clean( demux_t *p_demux, ts_es_t *p_es )
 {
+    if( p_demux->p_sys->workers )
+        ts_workers_Drain( p_demux->p_sys->workers );
+
     if( p_es && p_es->id )
     {
         /* Ensure we don't wait for overlap hacks #14257 */
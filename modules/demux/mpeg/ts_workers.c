@@ -0,0 +1,219 @@
+/*****************************************************************************
+ * ts_workers.c: TS Demux per program output threads
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_block.h>
+
+#include "ts_streams.h"
+#include "ts_workers.h"
+
+#include <assert.h>
+
+/* Maximum number of queued jobs per worker, before the input thread waits */
+#define TS_WORKER_MAX_JOBS 512
+
+typedef struct
+{
+    ts_workers_t    *p_workers;
+    vlc_thread_t     thread;
+    vlc_cond_t       wait_job;
+
+    ts_worker_job_t *p_first;
+    ts_worker_job_t **pp_last;
+    unsigned         i_queued;
+    bool             b_busy;
+
+    /* statistics */
+    uint64_t         i_jobs;
+    uint64_t         i_bytes;
+    mtime_t          i_time;
+} ts_worker_t;
+
+struct ts_workers_t
+{
+    demux_t             *p_demux;
+    ts_worker_callback_t pf_run;
+
+    vlc_mutex_t          lock;
+    vlc_cond_t           wait_space;
+    vlc_cond_t           wait_idle;
+    bool                 b_exit;
+
+    unsigned             i_count;
+    ts_worker_t          workers[];
+};
+
+static void *Run( void *data )
+{
+    ts_worker_t *p_worker = data;
+    ts_workers_t *p_workers = p_worker->p_workers;
+
+    vlc_mutex_lock( &p_workers->lock );
+    for( ;; )
+    {
+        while( p_worker->p_first == NULL && !p_workers->b_exit )
+            vlc_cond_wait( &p_worker->wait_job, &p_workers->lock );
+
+        ts_worker_job_t *p_job = p_worker->p_first;
+        if( p_job == NULL )
+            break;
+
+        p_worker->p_first = p_job->p_next;
+        if( p_worker->p_first == NULL )
+            p_worker->pp_last = &p_worker->p_first;
+        if( p_worker->i_queued-- == TS_WORKER_MAX_JOBS )
+            vlc_cond_signal( &p_workers->wait_space );
+        p_worker->b_busy = true;
+        vlc_mutex_unlock( &p_workers->lock );
+
+        size_t i_bytes = 0;
+        if( p_job->p_block )
+            block_ChainProperties( p_job->p_block, NULL, &i_bytes, NULL );
+        mtime_t i_start = mdate();
+        p_workers->pf_run( p_workers->p_demux, p_job );
+        mtime_t i_time = mdate() - i_start;
+        free( p_job );
+
+        vlc_mutex_lock( &p_workers->lock );
+        p_worker->b_busy = false;
+        p_worker->i_jobs++;
+        p_worker->i_bytes += i_bytes;
+        p_worker->i_time += i_time;
+        if( p_worker->p_first == NULL )
+            vlc_cond_broadcast( &p_workers->wait_idle );
+    }
+    vlc_mutex_unlock( &p_workers->lock );
+    return NULL;
+}
+
+ts_workers_t * ts_workers_New( demux_t *p_demux, unsigned i_count,
+                               ts_worker_callback_t pf_run )
+{
+    assert( i_count > 0 );
+
+    ts_workers_t *p_workers = malloc( sizeof(*p_workers) +
+                                      i_count * sizeof(ts_worker_t) );
+    if( unlikely(p_workers == NULL) )
+        return NULL;
+
+    p_workers->p_demux = p_demux;
+    p_workers->pf_run = pf_run;
+    p_workers->b_exit = false;
+    p_workers->i_count = 0;
+    vlc_mutex_init( &p_workers->lock );
+    vlc_cond_init( &p_workers->wait_space );
+    vlc_cond_init( &p_workers->wait_idle );
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_workers->workers[i];
+        p_worker->p_workers = p_workers;
+        p_worker->p_first = NULL;
+        p_worker->pp_last = &p_worker->p_first;
+        p_worker->i_queued = 0;
+        p_worker->b_busy = false;
+        p_worker->i_jobs = 0;
+        p_worker->i_bytes = 0;
+        p_worker->i_time = 0;
+        vlc_cond_init( &p_worker->wait_job );
+
+        if( vlc_clone( &p_worker->thread, Run, p_worker,
+                       VLC_THREAD_PRIORITY_INPUT ) )
+        {
+            vlc_cond_destroy( &p_worker->wait_job );
+            break;
+        }
+        p_workers->i_count++;
+    }
+
+    if( p_workers->i_count == 0 )
+    {
+        ts_workers_Delete( p_workers );
+        return NULL;
+    }
+
+    msg_Dbg( p_demux, "using %u output threads", p_workers->i_count );
+    return p_workers;
+}
+
+void ts_workers_Delete( ts_workers_t *p_workers )
+{
+    vlc_mutex_lock( &p_workers->lock );
+    p_workers->b_exit = true;
+    for( unsigned i = 0; i < p_workers->i_count; i++ )
+        vlc_cond_signal( &p_workers->workers[i].wait_job );
+    vlc_mutex_unlock( &p_workers->lock );
+
+    for( unsigned i = 0; i < p_workers->i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_workers->workers[i];
+
+        /* Queued jobs are completed before exiting */
+        vlc_join( p_worker->thread, NULL );
+        vlc_cond_destroy( &p_worker->wait_job );
+        assert( p_worker->p_first == NULL );
+
+        if( p_worker->i_time > 0 )
+            msg_Dbg( p_workers->p_demux, "output thread %u: %"PRIu64" PES, "
+                     "%"PRIu64" KiB in %"PRId64" ms (%"PRIu64" KiB/s)", i,
+                     p_worker->i_jobs, p_worker->i_bytes / 1024,
+                     p_worker->i_time / 1000,
+                     p_worker->i_bytes * CLOCK_FREQ / 1024 / p_worker->i_time );
+    }
+
+    vlc_cond_destroy( &p_workers->wait_idle );
+    vlc_cond_destroy( &p_workers->wait_space );
+    vlc_mutex_destroy( &p_workers->lock );
+    free( p_workers );
+}
+
+void ts_workers_Push( ts_workers_t *p_workers, ts_worker_job_t *p_job )
+{
+    ts_worker_t *p_worker =
+            &p_workers->workers[(unsigned) p_job->i_program % p_workers->i_count];
+
+    p_job->p_next = NULL;
+
+    vlc_mutex_lock( &p_workers->lock );
+    /* Do not let the input thread run away from a slow worker */
+    while( p_worker->i_queued >= TS_WORKER_MAX_JOBS )
+        vlc_cond_wait( &p_workers->wait_space, &p_workers->lock );
+    *p_worker->pp_last = p_job;
+    p_worker->pp_last = &p_job->p_next;
+    p_worker->i_queued++;
+    vlc_cond_signal( &p_worker->wait_job );
+    vlc_mutex_unlock( &p_workers->lock );
+}
+
+void ts_workers_Drain( ts_workers_t *p_workers )
+{
+    vlc_mutex_lock( &p_workers->lock );
+    for( unsigned i = 0; i < p_workers->i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_workers->workers[i];
+        while( p_worker->p_first != NULL || p_worker->b_busy )
+            vlc_cond_wait( &p_workers->wait_idle, &p_workers->lock );
+    }
+    vlc_mutex_unlock( &p_workers->lock );
+}
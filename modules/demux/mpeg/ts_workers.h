@@ -0,0 +1,64 @@
+/*****************************************************************************
+ * ts_workers.h: TS Demux per program output threads
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_TS_WORKERS_H
+#define VLC_TS_WORKERS_H
+
+/*
+ * Reassembled PES are converted and sent to the es_out by worker threads.
+ * Each program is bound to a single worker, which also sends the program
+ * clock references, so that a program's data and PCR keep their order.
+ *
+ * Jobs reference the demuxer ES: the input thread must drain the workers
+ * before changing or deleting any of them.
+ */
+
+typedef struct ts_workers_t ts_workers_t;
+
+typedef struct ts_worker_job_t ts_worker_job_t;
+struct ts_worker_job_t
+{
+    ts_worker_job_t *p_next;
+    int          i_program;
+    ts_es_t     *p_es;      /* NULL for a PCR job */
+    block_t     *p_block;
+    mtime_t      i_pcr;     /* program clock at the time of queueing */
+    size_t       i_pes_size;
+    int          i_flags;   /* added to the first output block */
+    uint8_t      i_stream_id;
+    bool         b_convert;
+    bool         b_direct;  /* sent as is to p_es only */
+};
+
+/* Runs a job on a worker thread, releasing its block. The job itself is
+ * freed by the caller. */
+typedef void (* ts_worker_callback_t)( demux_t *, ts_worker_job_t * );
+
+ts_workers_t * ts_workers_New( demux_t *, unsigned i_count,
+                               ts_worker_callback_t pf_run );
+void ts_workers_Delete( ts_workers_t * );
+
+/* Queues an allocated job to the worker of its program, taking ownership of
+ * it. Waits if too many jobs are already queued. */
+void ts_workers_Push( ts_workers_t *, ts_worker_job_t * );
+
+/* Waits for all the queued jobs to be completed */
+void ts_workers_Drain( ts_workers_t * );
+
+#endif
@@ -44,6 +44,7 @@
 #include "xiph_metadata.h"
 #include "ogg.h"
 #include "oggseek.h"
+#include "seekindex.h"
 #include "opus.h"
 
 /*****************************************************************************
@@ -130,6 +131,8 @@ static void Ogg_CreateES( demux_t *p_demux );
 static int Ogg_BeginningOfStream( demux_t *p_demux );
 static int Ogg_FindLogicalStreams( demux_t *p_demux );
 static void Ogg_EndOfStream( demux_t *p_demux );
+static void Ogg_LoadIndex( const seekindex_t *, logical_stream_t * );
+static void Ogg_SaveIndex( seekindex_t *, const logical_stream_t * );
 
 /* */
 static void Ogg_LogicalStreamDelete( demux_t *p_demux, logical_stream_t *p_stream );
@@ -245,6 +248,10 @@ static int Open( vlc_object_t * p_this )
     /* */
     TAB_INIT( p_sys->i_seekpoints, p_sys->pp_seekpoints );
 
+    bool b_canfastseek;
+    if( vlc_stream_Control( p_demux->s, STREAM_CAN_FASTSEEK, &b_canfastseek )
+     == VLC_SUCCESS && b_canfastseek )
+        p_sys->p_seekindex = seekindex_Open( p_demux, p_demux->s, "ogg" );
 
     while ( !p_sys->b_preparsing_done && p_demux->pf_demux( p_demux ) > 0 )
     {}
@@ -270,6 +277,9 @@ static void Close( vlc_object_t *p_this )
     if( p_sys->p_old_stream )
         Ogg_LogicalStreamDelete( p_demux, p_sys->p_old_stream );
 
+    if( p_sys->p_seekindex )
+        seekindex_Close( p_sys->p_seekindex );
+
     free( p_sys );
 }
 
@@ -2193,6 +2203,8 @@ static int Ogg_BeginningOfStream( demux_t *p_demux )
 
         /* initialise kframe index */
         p_stream->idx=NULL;
+        if( p_ogg->p_seekindex )
+            Ogg_LoadIndex( p_ogg->p_seekindex, p_stream );
 
         if ( p_stream->fmt.i_bitrate == 0  &&
              ( p_stream->fmt.i_cat == VIDEO_ES ||
@@ -2268,6 +2280,37 @@ static void Ogg_CleanSpecificData( logical_stream_t *p_stream )
 #endif
 }
 
+/* The keyframe indexes are cached per serial number */
+static void Ogg_LoadIndex( const seekindex_t *p_index, logical_stream_t *p_stream )
+{
+    const seekindex_entry_t *p_entry;
+
+    if( seekindex_Lookup( p_index, p_stream->i_serial_no, INT64_MIN,
+                          NULL, &p_entry ) )
+        return;
+
+    for( const seekindex_entry_t *p_end = seekindex_Get( p_index, 0 )
+                                        + seekindex_Count( p_index );
+         p_entry < p_end && p_entry->i_track == (uint32_t)p_stream->i_serial_no;
+         p_entry++ )
+        OggSeek_IndexAdd( p_stream, p_entry->i_time, p_entry->i_offset );
+}
+
+static void Ogg_SaveIndex( seekindex_t *p_index, const logical_stream_t *p_stream )
+{
+    for( const demux_index_entry_t *idx = p_stream->idx; idx; idx = idx->p_next )
+    {
+        const seekindex_entry_t entry = {
+            .i_time = idx->i_value,
+            .i_offset = idx->i_pagepos,
+            .i_track = p_stream->i_serial_no,
+        };
+
+        if( seekindex_Add( p_index, &entry ) )
+            break;
+    }
+}
+
 /**
  * This function delete and release all data associated to a logical_stream_t
  */
@@ -2286,6 +2329,8 @@ static void Ogg_LogicalStreamDelete( demux_t *p_demux, logical_stream_t *p_strea
 
     if ( p_stream->idx != NULL)
     {
+        if( p_demux->p_sys->p_seekindex )
+            Ogg_SaveIndex( p_demux->p_sys->p_seekindex, p_stream );
         oggseek_index_entries_free( p_stream->idx );
     }
 
@@ -49,6 +49,7 @@
 #define PACKET_IS_SYNCPOINT  0x08
 
 typedef struct oggseek_index_entry demux_index_entry_t;
+typedef struct seekindex_t seekindex_t;
 typedef struct ogg_skeleton_t ogg_skeleton_t;
 
 typedef struct backup_queue
@@ -225,6 +226,9 @@ struct demux_sys_t
     int                 i_attachments;
     input_attachment_t  **attachments;
 
+    /* keyframe indexes of the logical streams, cached across sessions */
+    seekindex_t *p_seekindex;
+
     /* preparsing info */
     bool b_preparsing_done;
     bool b_es_created;
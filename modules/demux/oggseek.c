@@ -929,6 +929,8 @@ int Oggseek_BlindSeektoAbsoluteTime( demux_t *p_demux, logical_stream_t *p_strea
         i_lowerpos = OggBisectSearchByTime( p_demux, p_stream, i_time,
                                             p_stream->i_data_start, p_sys->i_total_length );
         b_found = ( i_lowerpos != -1 );
+        if ( b_found )
+            OggSeek_IndexAdd( p_stream, i_time, i_lowerpos );
     }
 
     if ( !b_found ) return -1;
@@ -0,0 +1,524 @@
+/*****************************************************************************
+ * seekindex.c: persistent seek index cache for demuxers
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <sys/stat.h>
+#include <errno.h>
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_url.h>
+
+#include "seekindex.h"
+
+#define SEEKINDEX_MAGIC    "VLCSIDX"
+#define SEEKINDEX_VERSION  1
+#define SEEKINDEX_COMPLETE 0x1
+
+#define SEEKINDEX_HEADER_SIZE (8 + 4 + 4 + 8 + 8 + 4)
+#define SEEKINDEX_ENTRY_SIZE  32
+#define SEEKINDEX_MAX_ENTRIES (1 << 21) /* 64 MiB on disk */
+
+/* Bounds of the cache directory, the least recently written files being
+ * removed first */
+#define SEEKINDEX_CACHE_SIZE  (128 << 20)
+#define SEEKINDEX_CACHE_FILES 1000
+
+struct seekindex_t
+{
+    vlc_object_t *obj;
+    char *psz_key;   /* demuxer format and file path */
+    char *psz_cache; /* cache file path */
+    uint64_t i_file_size;
+    int64_t  i_file_mtime;
+
+    seekindex_entry_t *p_entries;
+    size_t i_count;
+    size_t i_max;
+    uint32_t i_flags;
+    bool b_dirty;
+};
+
+static int EntryCompare( const seekindex_entry_t *a, uint32_t i_track,
+                         int64_t i_time )
+{
+    if( a->i_track != i_track )
+        return a->i_track < i_track ? -1 : 1;
+    if( a->i_time != i_time )
+        return a->i_time < i_time ? -1 : 1;
+    return 0;
+}
+
+/* index of the first entry not before (or after) (track, time) */
+static size_t EntryFind( const seekindex_t *p_idx, uint32_t i_track,
+                         int64_t i_time, bool b_after )
+{
+    size_t lo = 0, hi = p_idx->i_count;
+
+    while( lo < hi )
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        int i_cmp = EntryCompare( &p_idx->p_entries[mid], i_track, i_time );
+
+        if( i_cmp < 0 || (b_after && i_cmp == 0) )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static char *CacheDir( void )
+{
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    char *psz_dir;
+
+    if( psz_cachedir == NULL )
+        return NULL;
+    if( asprintf( &psz_dir, "%s"DIR_SEP"seekindex", psz_cachedir ) == -1 )
+        psz_dir = NULL;
+    free( psz_cachedir );
+    return psz_dir;
+}
+
+typedef struct
+{
+    char    *psz_path;
+    uint64_t i_size;
+    time_t   i_mtime;
+} cache_file_t;
+
+static int CacheFileCompare( const void *a, const void *b )
+{
+    const cache_file_t *p_a = a, *p_b = b;
+
+    if( p_a->i_mtime != p_b->i_mtime )
+        return p_a->i_mtime < p_b->i_mtime ? -1 : 1;
+    return 0;
+}
+
+/* Removes the oldest files of the cache directory beyond its bounds */
+static void Trim( seekindex_t *p_idx, const char *psz_dir )
+{
+    DIR *dir = vlc_opendir( psz_dir );
+    if( dir == NULL )
+        return;
+
+    cache_file_t *p_files = NULL;
+    size_t i_files = 0, i_max = 0;
+    uint64_t i_total = 0;
+    const char *psz_name;
+
+    while( (psz_name = vlc_readdir( dir )) != NULL )
+    {
+        cache_file_t file;
+        struct stat st;
+
+        if( psz_name[0] == '.' )
+            continue;
+        if( asprintf( &file.psz_path, "%s"DIR_SEP"%s", psz_dir,
+                      psz_name ) == -1 )
+            break;
+        if( vlc_stat( file.psz_path, &st ) || !S_ISREG(st.st_mode) )
+        {
+            free( file.psz_path );
+            continue;
+        }
+        i_total += st.st_size;
+
+        /* The file just written is accounted for, but never removed */
+        if( !strcmp( file.psz_path, p_idx->psz_cache ) )
+        {
+            free( file.psz_path );
+            continue;
+        }
+
+        if( i_files == i_max )
+        {
+            size_t i_new = i_max ? i_max * 2 : 64;
+            cache_file_t *p_new = realloc( p_files,
+                                           i_new * sizeof(*p_files) );
+            if( unlikely(p_new == NULL) )
+            {
+                free( file.psz_path );
+                break;
+            }
+            p_files = p_new;
+            i_max = i_new;
+        }
+        file.i_size = st.st_size;
+        file.i_mtime = st.st_mtime;
+        p_files[i_files++] = file;
+    }
+    closedir( dir );
+
+    if( i_files > 0 )
+        qsort( p_files, i_files, sizeof(*p_files), CacheFileCompare );
+
+    size_t i_kept = i_files + 1;
+    for( size_t i = 0; i < i_files; i++ )
+    {
+        if( i_total > SEEKINDEX_CACHE_SIZE || i_kept > SEEKINDEX_CACHE_FILES )
+        {
+            if( vlc_unlink( p_files[i].psz_path ) == 0 )
+            {
+                msg_Dbg( p_idx->obj, "removed %s", p_files[i].psz_path );
+                i_total -= p_files[i].i_size;
+                i_kept--;
+            }
+        }
+        free( p_files[i].psz_path );
+    }
+    free( p_files );
+}
+
+static void Load( seekindex_t *p_idx )
+{
+    FILE *file = vlc_fopen( p_idx->psz_cache, "rb" );
+    if( file == NULL )
+        return;
+
+    const size_t i_keylen = strlen( p_idx->psz_key );
+    uint8_t header[SEEKINDEX_HEADER_SIZE];
+    char *psz_key = malloc( i_keylen );
+
+    if( unlikely(psz_key == NULL)
+     || fread( header, sizeof(header), 1, file ) != 1
+     || memcmp( header, SEEKINDEX_MAGIC, 8 )
+     || GetDWBE( &header[8] ) != SEEKINDEX_VERSION
+     || GetQWBE( &header[16] ) != p_idx->i_file_size
+     || (int64_t)GetQWBE( &header[24] ) != p_idx->i_file_mtime
+     || GetDWBE( &header[32] ) != i_keylen
+     || fread( psz_key, i_keylen, 1, file ) != 1
+     || memcmp( psz_key, p_idx->psz_key, i_keylen ) )
+        goto out;
+
+    uint8_t count[4];
+    if( fread( count, sizeof(count), 1, file ) != 1 )
+        goto out;
+
+    const size_t i_count = GetDWBE( count );
+    if( i_count == 0 || i_count > SEEKINDEX_MAX_ENTRIES )
+        goto out;
+
+    seekindex_entry_t *p_entries = malloc( i_count * sizeof(*p_entries) );
+    if( unlikely(p_entries == NULL) )
+        goto out;
+
+    for( size_t i = 0; i < i_count; i++ )
+    {
+        uint8_t buf[SEEKINDEX_ENTRY_SIZE];
+        seekindex_entry_t *p_entry = &p_entries[i];
+
+        if( fread( buf, sizeof(buf), 1, file ) != 1 )
+        {
+            free( p_entries );
+            goto out;
+        }
+        p_entry->i_time = GetQWBE( &buf[0] );
+        p_entry->i_offset = GetQWBE( &buf[8] );
+        p_entry->i_size = GetDWBE( &buf[16] );
+        p_entry->i_flags = GetDWBE( &buf[20] );
+        p_entry->i_track = GetDWBE( &buf[24] );
+
+        if( i > 0 && EntryCompare( &p_entries[i - 1], p_entry->i_track,
+                                   p_entry->i_time ) >= 0 )
+        {   /* not sorted: corrupt */
+            free( p_entries );
+            goto out;
+        }
+    }
+
+    p_idx->p_entries = p_entries;
+    p_idx->i_count = p_idx->i_max = i_count;
+    p_idx->i_flags = GetDWBE( &header[12] );
+    msg_Dbg( p_idx->obj, "loaded %zu seek index entries from %s",
+             i_count, p_idx->psz_cache );
+out:
+    free( psz_key );
+    fclose( file );
+}
+
+static int Save( seekindex_t *p_idx )
+{
+    char *psz_dir = CacheDir();
+    char *psz_tmp;
+
+    if( psz_dir == NULL )
+        return VLC_ENOMEM;
+
+    /* create the cache directory and its parents if missing */
+    for( char *p = strchr( psz_dir + 1, DIR_SEP_CHAR ); p != NULL;
+         p = strchr( p + 1, DIR_SEP_CHAR ) )
+    {
+        *p = '\0';
+        vlc_mkdir( psz_dir, 0700 );
+        *p = DIR_SEP_CHAR;
+    }
+    vlc_mkdir( psz_dir, 0700 );
+
+    if( asprintf( &psz_tmp, "%s.XXXXXX", p_idx->psz_cache ) == -1 )
+    {
+        free( psz_dir );
+        return VLC_ENOMEM;
+    }
+
+    int fd = vlc_mkstemp( psz_tmp );
+    if( fd == -1 )
+    {
+        msg_Warn( p_idx->obj, "cannot create %s: %s", psz_tmp,
+                  vlc_strerror_c(errno) );
+        free( psz_tmp );
+        free( psz_dir );
+        return VLC_EGENERIC;
+    }
+
+    const size_t i_keylen = strlen( p_idx->psz_key );
+    uint8_t header[SEEKINDEX_HEADER_SIZE];
+    uint8_t count[4];
+    bool b_error;
+
+    memcpy( header, SEEKINDEX_MAGIC, 8 );
+    SetDWBE( &header[8], SEEKINDEX_VERSION );
+    SetDWBE( &header[12], p_idx->i_flags );
+    SetQWBE( &header[16], p_idx->i_file_size );
+    SetQWBE( &header[24], p_idx->i_file_mtime );
+    SetDWBE( &header[32], i_keylen );
+    SetDWBE( count, p_idx->i_count );
+
+    b_error = vlc_write( fd, header, sizeof(header) ) != sizeof(header)
+           || vlc_write( fd, p_idx->psz_key, i_keylen ) != (ssize_t)i_keylen
+           || vlc_write( fd, count, sizeof(count) ) != sizeof(count);
+
+    for( size_t i = 0; i < p_idx->i_count && !b_error; )
+    {
+        uint8_t buf[256 * SEEKINDEX_ENTRY_SIZE];
+        size_t i_buf = 0;
+
+        for( ; i < p_idx->i_count && i_buf < sizeof(buf); i++ )
+        {
+            const seekindex_entry_t *p_entry = &p_idx->p_entries[i];
+            uint8_t *p = &buf[i_buf];
+
+            SetQWBE( &p[0], p_entry->i_time );
+            SetQWBE( &p[8], p_entry->i_offset );
+            SetDWBE( &p[16], p_entry->i_size );
+            SetDWBE( &p[20], p_entry->i_flags );
+            SetDWBE( &p[24], p_entry->i_track );
+            SetDWBE( &p[28], 0 );
+            i_buf += SEEKINDEX_ENTRY_SIZE;
+        }
+        b_error = vlc_write( fd, buf, i_buf ) != (ssize_t)i_buf;
+    }
+
+    vlc_close( fd );
+    if( b_error || vlc_rename( psz_tmp, p_idx->psz_cache ) )
+    {
+        msg_Warn( p_idx->obj, "cannot write %s", p_idx->psz_cache );
+        vlc_unlink( psz_tmp );
+        free( psz_tmp );
+        free( psz_dir );
+        return VLC_EGENERIC;
+    }
+    free( psz_tmp );
+
+    msg_Dbg( p_idx->obj, "saved %zu seek index entries to %s",
+             p_idx->i_count, p_idx->psz_cache );
+    Trim( p_idx, psz_dir );
+    free( psz_dir );
+    return VLC_SUCCESS;
+}
+
+#undef seekindex_Open
+seekindex_t *seekindex_Open( vlc_object_t *obj, stream_t *s,
+                             const char *psz_format )
+{
+    if( !var_InheritBool( obj, "seek-index-cache" )
+     || s->psz_url == NULL || strncmp( s->psz_url, "file:", 5 ) )
+        return NULL;
+
+    char *psz_path = vlc_uri2path( s->psz_url );
+    struct stat st;
+
+    if( psz_path == NULL )
+        return NULL;
+    if( vlc_stat( psz_path, &st ) || !S_ISREG(st.st_mode) )
+    {
+        free( psz_path );
+        return NULL;
+    }
+
+    seekindex_t *p_idx = malloc( sizeof(*p_idx) );
+    if( unlikely(p_idx == NULL) )
+    {
+        free( psz_path );
+        return NULL;
+    }
+
+    p_idx->obj = obj;
+    p_idx->i_file_size = st.st_size;
+    p_idx->i_file_mtime = st.st_mtime;
+    p_idx->p_entries = NULL;
+    p_idx->i_count = p_idx->i_max = 0;
+    p_idx->i_flags = 0;
+    p_idx->b_dirty = false;
+    p_idx->psz_cache = NULL;
+
+    int i_ret = asprintf( &p_idx->psz_key, "%s\n%s", psz_format, psz_path );
+    free( psz_path );
+    if( i_ret == -1 )
+    {
+        free( p_idx );
+        return NULL;
+    }
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, p_idx->psz_key, strlen( p_idx->psz_key ) );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    char *psz_dir = CacheDir();
+    if( psz_hash == NULL || psz_dir == NULL
+     || asprintf( &p_idx->psz_cache, "%s"DIR_SEP"%s", psz_dir, psz_hash ) == -1 )
+        p_idx->psz_cache = NULL;
+    free( psz_dir );
+    free( psz_hash );
+
+    if( p_idx->psz_cache == NULL )
+    {
+        free( p_idx->psz_key );
+        free( p_idx );
+        return NULL;
+    }
+
+    Load( p_idx );
+    return p_idx;
+}
+
+void seekindex_Close( seekindex_t *p_idx )
+{
+    if( p_idx->b_dirty && p_idx->i_count > 0 )
+        Save( p_idx );
+
+    free( p_idx->p_entries );
+    free( p_idx->psz_cache );
+    free( p_idx->psz_key );
+    free( p_idx );
+}
+
+size_t seekindex_Count( const seekindex_t *p_idx )
+{
+    return p_idx->i_count;
+}
+
+const seekindex_entry_t *seekindex_Get( const seekindex_t *p_idx, size_t i )
+{
+    return i < p_idx->i_count ? &p_idx->p_entries[i] : NULL;
+}
+
+int seekindex_Add( seekindex_t *p_idx, const seekindex_entry_t *p_entry )
+{
+    size_t i;
+
+    /* entries are usually appended in order */
+    if( p_idx->i_count == 0 ||
+        EntryCompare( &p_idx->p_entries[p_idx->i_count - 1],
+                      p_entry->i_track, p_entry->i_time ) < 0 )
+        i = p_idx->i_count;
+    else
+        i = EntryFind( p_idx, p_entry->i_track, p_entry->i_time, false );
+
+    if( i < p_idx->i_count &&
+        EntryCompare( &p_idx->p_entries[i], p_entry->i_track,
+                      p_entry->i_time ) == 0 )
+    {
+        const seekindex_entry_t *p_old = &p_idx->p_entries[i];
+
+        if( p_old->i_offset != p_entry->i_offset
+         || p_old->i_size != p_entry->i_size
+         || p_old->i_flags != p_entry->i_flags )
+        {
+            p_idx->p_entries[i] = *p_entry;
+            p_idx->b_dirty = true;
+        }
+        return VLC_SUCCESS;
+    }
+
+    if( p_idx->i_count >= SEEKINDEX_MAX_ENTRIES )
+        return VLC_ENOMEM;
+
+    if( p_idx->i_count == p_idx->i_max )
+    {
+        size_t i_max = p_idx->i_max ? p_idx->i_max * 2 : 256;
+        seekindex_entry_t *p_entries =
+            realloc( p_idx->p_entries, i_max * sizeof(*p_entries) );
+
+        if( unlikely(p_entries == NULL) )
+            return VLC_ENOMEM;
+        p_idx->p_entries = p_entries;
+        p_idx->i_max = i_max;
+    }
+
+    memmove( &p_idx->p_entries[i + 1], &p_idx->p_entries[i],
+             (p_idx->i_count - i) * sizeof(*p_entry) );
+    p_idx->p_entries[i] = *p_entry;
+    p_idx->i_count++;
+    p_idx->b_dirty = true;
+    return VLC_SUCCESS;
+}
+
+int seekindex_Lookup( const seekindex_t *p_idx, uint32_t i_track, int64_t i_time,
+                      const seekindex_entry_t **pp_before,
+                      const seekindex_entry_t **pp_after )
+{
+    size_t i = EntryFind( p_idx, i_track, i_time, true );
+    const seekindex_entry_t *p_before = NULL, *p_after = NULL;
+
+    if( i > 0 && p_idx->p_entries[i - 1].i_track == i_track )
+        p_before = &p_idx->p_entries[i - 1];
+    if( i < p_idx->i_count && p_idx->p_entries[i].i_track == i_track )
+        p_after = &p_idx->p_entries[i];
+
+    if( pp_before != NULL )
+        *pp_before = p_before;
+    if( pp_after != NULL )
+        *pp_after = p_after;
+    return (p_before != NULL || p_after != NULL) ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+bool seekindex_IsComplete( const seekindex_t *p_idx )
+{
+    return p_idx->i_flags & SEEKINDEX_COMPLETE;
+}
+
+void seekindex_SetComplete( seekindex_t *p_idx )
+{
+    if( !(p_idx->i_flags & SEEKINDEX_COMPLETE) )
+    {
+        p_idx->i_flags |= SEEKINDEX_COMPLETE;
+        p_idx->b_dirty = true;
+    }
+}
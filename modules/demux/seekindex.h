@@ -0,0 +1,92 @@
+/*****************************************************************************
+ * seekindex.h: persistent seek index cache for demuxers
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_DEMUX_SEEKINDEX_H
+#define VLC_DEMUX_SEEKINDEX_H
+
+/*
+ * Demuxers which have to scan a file to seek in it (missing or partial index)
+ * can store what they learnt in an on-disk cache, and reload it the next time
+ * the same file is opened. Caches live in the user cache directory and are
+ * keyed by the file path, size and modification time, so that a modified
+ * file is never matched with a stale index.
+ *
+ * Entries are kept sorted by (track, time). The meaning of each field is up
+ * to the demuxer, which must bump its format string whenever it changes it.
+ */
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+typedef struct seekindex_t seekindex_t;
+
+typedef struct
+{
+    int64_t  i_time;   /* timestamp, or any value ordering the track entries */
+    uint64_t i_offset; /* byte offset in the stream */
+    uint32_t i_size;
+    uint32_t i_flags;
+    uint32_t i_track;
+} seekindex_entry_t;
+
+/**
+ * Opens the seek index cache of a stream.
+ *
+ * \param psz_format demuxer specific name (and version) of the index
+ * \return NULL if the stream is not a local file, or if the cache is disabled
+ */
+seekindex_t *seekindex_Open( vlc_object_t *, stream_t *, const char *psz_format );
+#define seekindex_Open(o, s, f) seekindex_Open(VLC_OBJECT(o), s, f)
+
+/**
+ * Writes the index back to the cache if it was modified, and frees it.
+ */
+void seekindex_Close( seekindex_t * );
+
+size_t seekindex_Count( const seekindex_t * );
+const seekindex_entry_t *seekindex_Get( const seekindex_t *, size_t );
+
+/**
+ * Adds or replaces the entry with the same track and time.
+ */
+int seekindex_Add( seekindex_t *, const seekindex_entry_t * );
+
+/**
+ * Finds the entries of a track surrounding a time.
+ *
+ * \param pp_before last entry at or before the time (or NULL)
+ * \param pp_after first entry after the time (or NULL)
+ * \return VLC_SUCCESS if any of both was found
+ */
+int seekindex_Lookup( const seekindex_t *, uint32_t i_track, int64_t i_time,
+                      const seekindex_entry_t **pp_before,
+                      const seekindex_entry_t **pp_after );
+
+/**
+ * Whether the index was marked as covering the whole stream.
+ */
+bool seekindex_IsComplete( const seekindex_t * );
+void seekindex_SetComplete( seekindex_t * );
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif
@@ -56,7 +56,7 @@ Manifest * SmoothManager::fetchManifest()
     playlisturl.append("://");
     playlisturl.append(p_demux->psz_location);
 
-    block_t *p_block = Retrieve::HTTP(VLC_OBJECT(p_demux), playlisturl);
+    block_t *p_block = Retrieve::HTTP(VLC_OBJECT(p_demux), playlisturl, conManager);
     if(!p_block)
         return NULL;
 
@@ -22,7 +22,7 @@
 #endif
 
 #include "ForgedInitSegment.hpp"
-#include "MemoryChunk.hpp"
+#include "../adaptive/http/Chunk.h"
 #include "../adaptive/playlist/SegmentChunk.hpp"
 
 #include <vlc_common.h>
@@ -37,7 +37,7 @@ extern "C"
 
 using namespace adaptive::playlist;
 using namespace smooth::playlist;
-using namespace smooth::http;
+using namespace adaptive::http;
 
 ForgedInitSegment::ForgedInitSegment(ICanonicalUrl *parent,
                                      const std::string &type_,
@@ -27,6 +27,7 @@
 #endif
 
 #include <vlc_common.h>
+#include <assert.h>
 
 #include "csa.h"
 
@@ -56,6 +57,17 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 static void csa_BlockDecypher( uint8_t kk[57], uint8_t ib[8], uint8_t bd[8] );
 static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] );
 
+/* A packet of a batch */
+typedef struct
+{
+    uint8_t *pkt;
+    int      i_hdr;
+    int      n; /* number of complete 8 bytes blocks */
+} csa_lane_t;
+
+static void csa_StreamCypherBatch( const uint8_t ck[8], csa_lane_t *lanes,
+                                   int i_lanes, int i_pkt_size );
+
 /*****************************************************************************
  * csa_New:
  *****************************************************************************/
@@ -307,6 +319,143 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     }
 }
 
+/*****************************************************************************
+ * csa_DecryptBatch:
+ *****************************************************************************
+ * Same result as csa_Decrypt() on each packet, but the stream cypher runs on
+ * up to CSA_BATCH_MAX packets at once.
+ *****************************************************************************/
+static void csa_DecryptLanes( csa_lane_t *lanes, int i_lanes, uint8_t *ck,
+                              uint8_t *kk, int i_pkt_size )
+{
+    if( i_lanes == 0 )
+        return;
+
+    /* xor the stream into every block but the first one */
+    csa_StreamCypherBatch( ck, lanes, i_lanes, i_pkt_size );
+
+    for( int l = 0; l < i_lanes; l++ )
+    {
+        uint8_t *p = &lanes[l].pkt[lanes[l].i_hdr];
+        const int n = lanes[l].n;
+        uint8_t ib[8], block[8];
+
+        memcpy( ib, p, 8 );
+        for( int i = 1; i < n + 1; i++ )
+        {
+            csa_BlockDecypher( kk, ib, block );
+            if( i != n )
+                memcpy( ib, &p[8*i], 8 );
+            else
+                memset( ib, 0, 8 );
+            for( int j = 0; j < 8; j++ )
+                p[8*(i-1)+j] = ib[j] ^ block[j];
+        }
+    }
+}
+
+void csa_DecryptBatch( csa_t *c, uint8_t **pp_pkts, int i_count, int i_pkt_size )
+{
+    csa_lane_t odd[CSA_BATCH_MAX], even[CSA_BATCH_MAX];
+    int i_odd = 0, i_even = 0;
+
+    for( int i = 0; i < i_count; i++ )
+    {
+        uint8_t *pkt = pp_pkts[i];
+
+        /* transport scrambling control */
+        if( (pkt[3]&0x80) == 0 )
+            continue;
+
+        int i_hdr = 4;
+        if( pkt[3]&0x20 )
+            i_hdr += pkt[4] + 1;
+
+        if( 188 - i_hdr < 8 || i_pkt_size - i_hdr < 8 )
+        {
+            /* nothing to batch, let the packet be handled alone */
+            csa_Decrypt( c, pkt, i_pkt_size );
+            continue;
+        }
+
+        csa_lane_t *lane = (pkt[3]&0x40) ? &odd[i_odd++] : &even[i_even++];
+        lane->pkt = pkt;
+        lane->i_hdr = i_hdr;
+        lane->n = (i_pkt_size - i_hdr) / 8;
+
+        /* clear transport scrambling control */
+        pkt[3] &= 0x3f;
+
+        if( i_odd == CSA_BATCH_MAX )
+        {
+            csa_DecryptLanes( odd, i_odd, c->o_ck, c->o_kk, i_pkt_size );
+            i_odd = 0;
+        }
+        if( i_even == CSA_BATCH_MAX )
+        {
+            csa_DecryptLanes( even, i_even, c->e_ck, c->e_kk, i_pkt_size );
+            i_even = 0;
+        }
+    }
+
+    csa_DecryptLanes( odd, i_odd, c->o_ck, c->o_kk, i_pkt_size );
+    csa_DecryptLanes( even, i_even, c->e_ck, c->e_kk, i_pkt_size );
+}
+
+/*****************************************************************************
+ * csa_EncryptBatch:
+ *****************************************************************************/
+void csa_EncryptBatch( csa_t *c, uint8_t **pp_pkts, int i_count, int i_pkt_size )
+{
+    uint8_t *ck = c->use_odd ? c->o_ck : c->e_ck;
+    uint8_t *kk = c->use_odd ? c->o_kk : c->e_kk;
+    csa_lane_t lanes[CSA_BATCH_MAX];
+    int i_lanes = 0;
+
+    for( int i = 0; i < i_count; i++ )
+    {
+        uint8_t *pkt = pp_pkts[i];
+
+        int i_hdr = 4;
+        if( pkt[3]&0x20 )
+            i_hdr += pkt[4] + 1;
+
+        const int n = (i_pkt_size - i_hdr) / 8;
+        if( n <= 0 )
+        {
+            /* not enough data to scramble */
+            pkt[3] &= 0x3f;
+            continue;
+        }
+
+        /* set transport scrambling control */
+        pkt[3] |= c->use_odd ? 0xc0 : 0x80;
+
+        /* block cypher, from the last block to the first one */
+        uint8_t *p = &pkt[i_hdr];
+        uint8_t ib[8] = { 0 }, block[8];
+        for( int k = n; k > 0; k-- )
+        {
+            for( int j = 0; j < 8; j++ )
+                block[j] = p[8*(k-1)+j] ^ ib[j];
+            csa_BlockCypher( kk, block, ib );
+            memcpy( &p[8*(k-1)], ib, 8 );
+        }
+
+        lanes[i_lanes].pkt = pkt;
+        lanes[i_lanes].i_hdr = i_hdr;
+        lanes[i_lanes].n = n;
+        if( ++i_lanes == CSA_BATCH_MAX )
+        {
+            csa_StreamCypherBatch( ck, lanes, i_lanes, i_pkt_size );
+            i_lanes = 0;
+        }
+    }
+
+    if( i_lanes > 0 )
+        csa_StreamCypherBatch( ck, lanes, i_lanes, i_pkt_size );
+}
+
 /*****************************************************************************
  * Divers
  *****************************************************************************/
@@ -494,6 +643,209 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 }
 
 
+/*
+ * Bitsliced stream cypher
+ *
+ * Each bit of the csa_StreamCypher() registers is held in a word, one
+ * packet per bit of the word, so that every logical operation advances
+ * the cypher of all packets at once. S-boxes are evaluated as multiplexer
+ * trees over their truth tables, and the T4 adder as a ripple carry.
+ */
+typedef uint64_t csa_slice_t;
+
+static_assert( CSA_BATCH_MAX <= sizeof(csa_slice_t) * 8,
+               "CSA batch does not fit in a slice" );
+
+typedef struct
+{
+    csa_slice_t A[11][4];
+    csa_slice_t B[11][4];
+    csa_slice_t X[4], Y[4], Z[4];
+    csa_slice_t D[4], E[4], F[4];
+    csa_slice_t p, q, r;
+} csa_slices_t;
+
+/* Truth tables of the 7 s-boxes, one mask per input value and output bit */
+typedef csa_slice_t csa_sbox_leaves_t[7][2][0x20];
+
+static void csa_SliceSboxInit( csa_sbox_leaves_t leaves )
+{
+    const int *sboxes[7] = { sbox1, sbox2, sbox3, sbox4, sbox5, sbox6, sbox7 };
+
+    for( int i = 0; i < 7; i++ )
+        for( int o = 0; o < 2; o++ )
+            for( int k = 0; k < 0x20; k++ )
+                leaves[i][o][k] = ((sboxes[i][k] >> o)&1) ? ~(csa_slice_t)0 : 0;
+}
+
+static inline csa_slice_t csa_SliceMux( csa_slice_t a, csa_slice_t b,
+                                        csa_slice_t sel )
+{
+    return a ^ ((a ^ b) & sel);
+}
+
+static inline void csa_SliceSbox( const csa_slice_t leaves[2][0x20],
+                                  csa_slice_t i4, csa_slice_t i3,
+                                  csa_slice_t i2, csa_slice_t i1,
+                                  csa_slice_t i0, csa_slice_t out[2] )
+{
+    for( int o = 0; o < 2; o++ )
+    {
+        const csa_slice_t *l = leaves[o];
+        csa_slice_t v[0x10];
+
+        for( int k = 0; k < 0x10; k++ )
+            v[k] = csa_SliceMux( l[2*k], l[2*k+1], i0 );
+        for( int k = 0; k < 0x08; k++ )
+            v[k] = csa_SliceMux( v[2*k], v[2*k+1], i1 );
+        for( int k = 0; k < 0x04; k++ )
+            v[k] = csa_SliceMux( v[2*k], v[2*k+1], i2 );
+        for( int k = 0; k < 0x02; k++ )
+            v[k] = csa_SliceMux( v[2*k], v[2*k+1], i3 );
+
+        out[o] = csa_SliceMux( v[0], v[1], i4 );
+    }
+}
+
+/* One cypher round, the sliced equivalent of the csa_StreamCypher() inner
+ * loop body. in_a/in_b are only used during initialisation. */
+static void csa_SliceRound( csa_slices_t *s, const csa_sbox_leaves_t leaves,
+                            const csa_slice_t *in_a, const csa_slice_t *in_b )
+{
+    csa_slice_t (*A)[4] = s->A;
+    csa_slice_t (*B)[4] = s->B;
+    csa_slice_t s1[2], s2[2], s3[2], s4[2], s5[2], s6[2], s7[2];
+    csa_slice_t extra_B[4], next_A1[4], next_B1[4], next_E[4];
+
+    csa_SliceSbox( leaves[0], A[4][0], A[1][2], A[6][1], A[7][3], A[9][0], s1 );
+    csa_SliceSbox( leaves[1], A[2][1], A[3][2], A[6][3], A[7][0], A[9][1], s2 );
+    csa_SliceSbox( leaves[2], A[1][3], A[2][0], A[5][1], A[5][3], A[6][2], s3 );
+    csa_SliceSbox( leaves[3], A[3][3], A[1][1], A[2][3], A[4][2], A[8][0], s4 );
+    csa_SliceSbox( leaves[4], A[5][2], A[4][3], A[6][0], A[8][1], A[9][2], s5 );
+    csa_SliceSbox( leaves[5], A[3][1], A[4][1], A[5][0], A[7][2], A[9][3], s6 );
+    csa_SliceSbox( leaves[6], A[2][2], A[3][0], A[7][1], A[8][2], A[8][3], s7 );
+
+    extra_B[3] = B[3][0] ^ B[6][1] ^ B[7][2] ^ B[9][3];
+    extra_B[2] = B[6][0] ^ B[8][1] ^ B[3][3] ^ B[4][2];
+    extra_B[1] = B[5][3] ^ B[8][2] ^ B[4][0] ^ B[5][1];
+    extra_B[0] = B[9][2] ^ B[6][3] ^ B[3][1] ^ B[8][0];
+
+    for( int b = 0; b < 4; b++ )
+    {
+        next_A1[b] = A[10][b] ^ s->X[b];
+        next_B1[b] = B[7][b] ^ B[10][b] ^ s->Y[b];
+        if( in_a )
+        {
+            next_A1[b] ^= s->D[b] ^ in_a[b];
+            next_B1[b] ^= in_b[b];
+        }
+    }
+
+    /* if p=1, rotate left */
+    const csa_slice_t rot[4] = { next_B1[3], next_B1[0], next_B1[1], next_B1[2] };
+    for( int b = 0; b < 4; b++ )
+        next_B1[b] ^= (next_B1[b] ^ rot[b]) & s->p;
+
+    /* T3 and T4 */
+    csa_slice_t carry = s->r;
+    for( int b = 0; b < 4; b++ )
+    {
+        const csa_slice_t t = s->Z[b] ^ s->E[b];
+        const csa_slice_t sum = t ^ carry;
+        carry = (s->Z[b] & s->E[b]) | (carry & t);
+
+        s->D[b] = s->E[b] ^ s->Z[b] ^ extra_B[b];
+        next_E[b] = s->F[b];
+        s->F[b] = s->E[b] ^ ((s->E[b] ^ sum) & s->q);
+        s->E[b] = next_E[b];
+    }
+    s->r ^= (s->r ^ carry) & s->q;
+
+    memmove( &A[2], &A[1], sizeof(A[0]) * 9 );
+    memmove( &B[2], &B[1], sizeof(B[0]) * 9 );
+    memcpy( A[1], next_A1, sizeof(A[1]) );
+    memcpy( B[1], next_B1, sizeof(B[1]) );
+
+    s->X[3] = s4[0]; s->X[2] = s3[0]; s->X[1] = s2[1]; s->X[0] = s1[1];
+    s->Y[3] = s6[0]; s->Y[2] = s5[0]; s->Y[1] = s4[1]; s->Y[0] = s3[1];
+    s->Z[3] = s2[0]; s->Z[2] = s1[0]; s->Z[1] = s6[1]; s->Z[0] = s5[1];
+    s->p = s7[1];
+    s->q = s7[0];
+}
+
+/* Initialises the cypher of each lane with its first block, then xors the
+ * following stream bytes into the packet, starting at the second block */
+static void csa_StreamCypherBatch( const uint8_t ck[8], csa_lane_t *lanes,
+                                   int i_lanes, int i_pkt_size )
+{
+    csa_slices_t s;
+    csa_sbox_leaves_t leaves;
+    memset( &s, 0, sizeof(s) );
+    csa_SliceSboxInit( leaves );
+
+    for( int i = 0; i < 4; i++ )
+    {
+        for( int b = 0; b < 4; b++ )
+        {
+            s.A[1+2*i+0][b] = ((ck[i]   >> (4+b))&1) ? ~(csa_slice_t)0 : 0;
+            s.A[1+2*i+1][b] = ((ck[i]   >> b)&1)     ? ~(csa_slice_t)0 : 0;
+            s.B[1+2*i+0][b] = ((ck[4+i] >> (4+b))&1) ? ~(csa_slice_t)0 : 0;
+            s.B[1+2*i+1][b] = ((ck[4+i] >> b)&1)     ? ~(csa_slice_t)0 : 0;
+        }
+    }
+
+    /* init, 2 rounds per nibble of the first block */
+    int i_chunks = 0;
+    for( int i = 0; i < 8; i++ )
+    {
+        csa_slice_t in[8] = { 0 };
+        for( int l = 0; l < i_lanes; l++ )
+        {
+            const uint8_t sb = lanes[l].pkt[lanes[l].i_hdr + i];
+            for( int b = 0; b < 8; b++ )
+                in[b] |= (csa_slice_t)((sb >> b)&1) << l;
+        }
+        /* in1 is the high nibble, in2 the low one */
+        for( int j = 0; j < 4; j++ )
+            csa_SliceRound( &s, leaves, (j % 2) ? &in[0] : &in[4],
+                                        (j % 2) ? &in[4] : &in[0] );
+    }
+
+    for( int l = 0; l < i_lanes; l++ )
+    {
+        const int i_end = (i_pkt_size - lanes[l].i_hdr + 7) / 8;
+        if( i_end > i_chunks )
+            i_chunks = i_end;
+    }
+
+    /* generation: chunk m goes to offset 8*m of the payload */
+    for( int m = 1; m < i_chunks; m++ )
+    {
+        csa_slice_t out[8][8];
+        for( int i = 0; i < 8; i++ )
+        {
+            for( int j = 0; j < 4; j++ )
+            {
+                csa_SliceRound( &s, leaves, NULL, NULL );
+                out[i][7-2*j] = s.D[2] ^ s.D[3];
+                out[i][6-2*j] = s.D[0] ^ s.D[1];
+            }
+        }
+
+        for( int l = 0; l < i_lanes; l++ )
+        {
+            const int i_off = lanes[l].i_hdr + 8*m;
+            for( int i = 0; i < 8 && i_off + i < i_pkt_size; i++ )
+            {
+                uint8_t byte = 0;
+                for( int b = 0; b < 8; b++ )
+                    byte |= ((out[i][b] >> l)&1) << b;
+                lanes[l].pkt[i_off + i] ^= byte;
+            }
+        }
+    }
+}
+
 // block - sbox
 static const uint8_t block_sbox[256] =
 {
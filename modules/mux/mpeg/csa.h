@@ -31,6 +31,11 @@ typedef struct csa_t csa_t;
 #define csa_UseKey  __csa_UseKey
 #define csa_Decrypt __csa_decrypt
 #define csa_Encrypt __csa_encrypt
+#define csa_DecryptBatch __csa_decrypt_batch
+#define csa_EncryptBatch __csa_encrypt_batch
+
+/* Number of packets (de)scrambled together by the batch functions */
+#define CSA_BATCH_MAX 64
 
 csa_t *csa_New( void );
 void   csa_Delete( csa_t * );
@@ -41,4 +46,8 @@ int    csa_UseKey( vlc_object_t *p_caller, csa_t *, bool use_odd );
 void   csa_Decrypt( csa_t *, uint8_t *pkt, int i_pkt_size );
 void   csa_Encrypt( csa_t *, uint8_t *pkt, int i_pkt_size );
 
+/* Same as csa_Decrypt()/csa_Encrypt() on each packet, but faster */
+void   csa_DecryptBatch( csa_t *, uint8_t **pp_pkts, int i_count, int i_pkt_size );
+void   csa_EncryptBatch( csa_t *, uint8_t **pp_pkts, int i_count, int i_pkt_size );
+
 #endif /* _CSA_H */
@@ -1772,10 +1772,14 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    /* Date the packets and scramble them in batches */
+    uint8_t *pp_crypt[CSA_BATCH_MAX];
+    int i_crypt = 0;
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
-    for (int i = 0; i < i_packet_count; i++ )
+    block_t *p_ts = p_chain_ts->p_first;
+    for (int i = 0; i < i_packet_count; i++, p_ts = p_ts->p_next )
     {
-        block_t *p_ts = BufferChainGet( p_chain_ts );
         mtime_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
 
         p_ts->i_dts    = i_new_dts;
@@ -1788,10 +1792,27 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         }
         if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
         {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
+            pp_crypt[i_crypt++] = p_ts->p_buffer;
+            if( i_crypt == CSA_BATCH_MAX )
+            {
+                vlc_mutex_lock( &p_sys->csa_lock );
+                csa_EncryptBatch( p_sys->csa, pp_crypt, i_crypt,
+                                  p_sys->i_csa_pkt_size );
+                vlc_mutex_unlock( &p_sys->csa_lock );
+                i_crypt = 0;
+            }
         }
+    }
+    if( i_crypt > 0 )
+    {
+        vlc_mutex_lock( &p_sys->csa_lock );
+        csa_EncryptBatch( p_sys->csa, pp_crypt, i_crypt, p_sys->i_csa_pkt_size );
+        vlc_mutex_unlock( &p_sys->csa_lock );
+    }
+
+    for (int i = 0; i < i_packet_count; i++ )
+    {
+        p_ts = BufferChainGet( p_chain_ts );
 
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
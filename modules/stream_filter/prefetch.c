@@ -61,8 +61,67 @@ struct stream_sys_t
     char        *buffer;
     size_t       read_size;
     size_t       seek_threshold;
+    size_t       history_size;
+
+    /* Rate estimations (bytes per second) for the read-ahead window */
+    uint64_t     consume_rate;
+    uint64_t     consume_bytes;
+    mtime_t      consume_start;
+    uint64_t     link_rate;
+    uint64_t     link_bytes;
+    mtime_t      link_time;
+
+    stream_cache_stats_t stats;
 };
 
+/* Time span over which the rates are averaged */
+#define CONSUME_PERIOD (CLOCK_FREQ)
+#define LINK_PERIOD    (CLOCK_FREQ / 4)
+/* Duration of playback to keep ahead of the reader */
+#define WINDOW_LEAD    (4 * CLOCK_FREQ)
+
+static uint64_t RateUpdate(uint64_t rate, uint64_t bytes, mtime_t period)
+{
+    uint64_t sample = bytes * CLOCK_FREQ / period;
+
+    /* Exponential moving average, to ride over bursts */
+    return rate ? (3 * rate + sample) / 4 : sample;
+}
+
+/**
+ * Computes how much unread data should be fetched in advance.
+ *
+ * The reader should never wait for data as long as the link is faster than
+ * the consumption. The slower the link relatively to the consumption, the
+ * larger the window, so that throughput variations can be absorbed.
+ * Until the consumption rate is known, the whole buffer is used, minus the
+ * history reserved to serve backward seeks.
+ */
+static size_t Window(const stream_sys_t *sys)
+{
+    size_t max = sys->buffer_size - sys->history_size;
+    size_t min = 2 * sys->read_size;
+
+    if (sys->consume_rate == 0)
+        return max;
+
+    uint64_t window = sys->consume_rate * WINDOW_LEAD / CLOCK_FREQ;
+    if (sys->link_rate > 0)
+    {
+        uint64_t consume = sys->consume_rate;
+
+        if (consume > 3 * sys->link_rate)
+            consume = 3 * sys->link_rate;
+        window += window * consume / sys->link_rate;
+    }
+
+    if (window < min)
+        window = min;
+    if (window > max)
+        window = max;
+    return window;
+}
+
 static ssize_t ThreadRead(stream_t *stream, void *buf, size_t length)
 {
     stream_sys_t *sys = stream->p_sys;
@@ -71,10 +130,27 @@ static ssize_t ThreadRead(stream_t *stream, void *buf, size_t length)
     vlc_mutex_unlock(&sys->lock);
     assert(length > 0);
 
+    mtime_t start = mdate();
     ssize_t val = vlc_stream_ReadPartial(stream->p_source, buf, length);
+    mtime_t duration = mdate() - start;
 
     vlc_mutex_lock(&sys->lock);
     vlc_restorecancel(canc);
+
+    if (val > 0)
+    {   /* Only the time spent reading is accounted, so that this measures
+         * what the link can achieve, not what the reader consumes. */
+        sys->stats.i_fetched += val;
+        sys->link_bytes += val;
+        sys->link_time += duration;
+        if (sys->link_time >= LINK_PERIOD)
+        {
+            sys->link_rate = RateUpdate(sys->link_rate, sys->link_bytes,
+                                        sys->link_time);
+            sys->link_bytes = 0;
+            sys->link_time = 0;
+        }
+    }
     return val;
 }
 
@@ -204,17 +280,27 @@ static void *Thread(void *data)
 
         assert(sys->buffer_size >= sys->buffer_length);
 
+        uint64_t ahead = 0;
+        if (history < sys->buffer_length)
+            ahead = sys->buffer_length - history;
+        if (ahead >= Window(sys))
+        {   /* Far enough ahead of the reader, wait for data to be read */
+            vlc_cond_wait(&sys->wait_space, &sys->lock);
+            continue;
+        }
+
         size_t len = sys->buffer_size - sys->buffer_length;
         if (len == 0)
         {   /* Buffer is full */
-            if (history == 0)
+            if (history <= sys->history_size)
             {   /* Wait for data to be read */
                 vlc_cond_wait(&sys->wait_space, &sys->lock);
                 continue;
             }
 
-            /* Discard some historical data to make room. */
-            len = history;
+            /* Discard some historical data to make room, but keep the most
+             * recent part of it for backward seeks. */
+            len = history - sys->history_size;
             if (len > sys->read_size)
                 len = sys->read_size;
 
@@ -264,6 +350,11 @@ static int Seek(stream_t *stream, uint64_t offset)
     stream_sys_t *sys = stream->p_sys;
 
     vlc_mutex_lock(&sys->lock);
+    if (offset >= sys->buffer_offset
+     && offset <= sys->buffer_offset + sys->buffer_length)
+        sys->stats.i_seek_hits++;
+    else
+        sys->stats.i_seek_misses++;
     sys->stream_offset = offset;
     sys->error = false;
     vlc_cond_signal(&sys->wait_space);
@@ -291,6 +382,7 @@ static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
 {
     stream_sys_t *sys = stream->p_sys;
     size_t copy, offset;
+    mtime_t stall = 0;
     bool eof;
 
     if (buflen == 0)
@@ -314,11 +406,22 @@ static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
             return 0;
         }
 
+        if (stall == 0)
+            stall = mdate();
         vlc_interrupt_forward_start(sys->interrupt, data);
         vlc_cond_wait(&sys->wait_data, &sys->lock);
         vlc_interrupt_forward_stop(data);
     }
 
+    mtime_t now = mdate();
+    if (stall != 0)
+    {
+        sys->stats.i_read_stalls++;
+        sys->stats.i_stall_time += now - stall;
+    }
+    else
+        sys->stats.i_read_hits++;
+
     offset = sys->stream_offset % sys->buffer_size;
     if (copy > buflen)
         copy = buflen;
@@ -328,6 +431,15 @@ static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
 
     memcpy(buf, sys->buffer + offset, copy);
     sys->stream_offset += copy;
+
+    sys->consume_bytes += copy;
+    if (now - sys->consume_start >= CONSUME_PERIOD)
+    {
+        sys->consume_rate = RateUpdate(sys->consume_rate, sys->consume_bytes,
+                                       now - sys->consume_start);
+        sys->consume_bytes = 0;
+        sys->consume_start = now;
+    }
     vlc_cond_signal(&sys->wait_space);
     vlc_mutex_unlock(&sys->lock);
     return copy;
@@ -379,11 +491,26 @@ static int Control(stream_t *stream, int query, va_list args)
             return VLC_SUCCESS;
         case STREAM_GET_SIGNAL:
             return VLC_EGENERIC;
+        case STREAM_GET_CACHE_STATS:
+        {
+            stream_cache_stats_t *stats = va_arg(args, stream_cache_stats_t *);
+
+            vlc_mutex_lock(&sys->lock);
+            *stats = sys->stats;
+            stats->i_window = Window(sys);
+            vlc_mutex_unlock(&sys->lock);
+            break;
+        }
         case STREAM_SET_PAUSE_STATE:
         {
             bool paused = va_arg(args, unsigned);
 
             vlc_mutex_lock(&sys->lock);
+            if (sys->paused && !paused)
+            {   /* Do not account the pause in the consumption rate */
+                sys->consume_bytes = 0;
+                sys->consume_start = mdate();
+            }
             sys->paused = paused;
             vlc_cond_signal(&sys->wait_space);
             vlc_mutex_unlock (&sys->lock);
@@ -452,6 +579,7 @@ static int Open(vlc_object_t *obj)
     sys->buffer_size = var_InheritInteger(obj, "prefetch-buffer-size") << 10u;
     sys->read_size = var_InheritInteger(obj, "prefetch-read-size");
     sys->seek_threshold = var_InheritInteger(obj, "prefetch-seek-threshold");
+    sys->history_size = var_InheritInteger(obj, "prefetch-seek-back") << 10u;
 
     uint64_t size = stream_Size(stream->p_source);
     if (size > 0)
@@ -463,6 +591,17 @@ static int Open(vlc_object_t *obj)
     }
     if (sys->buffer_size < sys->read_size)
         sys->buffer_size = sys->read_size;
+    /* The history must never starve the read-ahead */
+    if (sys->history_size > sys->buffer_size / 2)
+        sys->history_size = sys->buffer_size / 2;
+
+    sys->consume_rate = 0;
+    sys->consume_bytes = 0;
+    sys->consume_start = mdate();
+    sys->link_rate = 0;
+    sys->link_bytes = 0;
+    sys->link_time = 0;
+    memset(&sys->stats, 0, sizeof (sys->stats));
 
     sys->buffer = malloc(sys->buffer_size);
     if (sys->buffer == NULL)
@@ -487,8 +626,9 @@ static int Open(vlc_object_t *obj)
         goto error;
     }
 
-    msg_Dbg(stream, "using %zu bytes buffer, %zu bytes read",
-            sys->buffer_size, sys->read_size);
+    msg_Dbg(stream, "using %zu bytes buffer, %zu bytes read, "
+            "%zu bytes history", sys->buffer_size, sys->read_size,
+            sys->history_size);
     stream->pf_read = Read;
     stream->pf_readdir = ReadDir;
     stream->pf_control = Control;
@@ -514,6 +654,15 @@ static void Close (vlc_object_t *obj)
     vlc_interrupt_kill(sys->interrupt);
     vlc_join(sys->thread, NULL);
     vlc_interrupt_destroy(sys->interrupt);
+
+    const stream_cache_stats_t *stats = &sys->stats;
+    msg_Dbg(stream, "reads: %"PRIu64" hits, %"PRIu64" stalls (%"PRId64" ms), "
+            "seeks: %"PRIu64" hits, %"PRIu64" misses, %"PRIu64" bytes fetched",
+            stats->i_read_hits, stats->i_read_stalls,
+            stats->i_stall_time / 1000, stats->i_seek_hits,
+            stats->i_seek_misses, stats->i_fetched);
+    msg_Dbg(stream, "rates: consumption %"PRIu64" B/s, link %"PRIu64" B/s",
+            sys->consume_rate, sys->link_rate);
     vlc_cond_destroy(&sys->wait_space);
     vlc_cond_destroy(&sys->wait_data);
     vlc_mutex_destroy(&sys->lock);
@@ -540,4 +689,8 @@ vlc_module_begin()
     add_integer("prefetch-seek-threshold", 1 << 14, N_("Seek threshold"),
                 N_("Prefetch forward seek threshold (bytes)"), true)
         change_integer_range(0, UINT64_C(1) << 60)
+    add_integer("prefetch-seek-back", 1 << 10, N_("Seek-back history"),
+                N_("Already read data kept to serve backward seeks (KiB)"),
+                true)
+        change_integer_range(0, 1 << 20)
 vlc_module_end()
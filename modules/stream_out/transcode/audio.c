@@ -322,7 +322,7 @@ int transcode_audio_process( sout_stream_t *p_stream,
                 if( likely(p_audio_buf->i_pts != VLC_TS_INVALID ) )
                     i_drift = p_audio_buf->i_pts - i_pts;
             }
-            p_sys->i_master_drift = i_drift;
+            atomic_store( &p_sys->i_master_drift, i_drift );
             date_Increment( &id->next_input_pts, p_audio_buf->i_nb_samples );
         }
 
@@ -397,7 +397,7 @@ bool transcode_audio_add( sout_stream_t *p_stream, const es_format_t *p_fmt,
     }
 
     /* Open output stream */
-    id->id = sout_StreamIdAdd( p_stream->p_next, &id->p_encoder->fmt_out );
+    id->id = transcode_output_add( p_stream, &id->p_encoder->fmt_out );
     id->b_transcode = true;
 
     if( !id->id )
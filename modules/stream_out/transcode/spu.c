@@ -111,8 +111,10 @@ static int transcode_spu_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id
         }
     }
 
+    vlc_mutex_lock( &p_sys->lock_spu );
     if( !p_sys->p_spu )
         p_sys->p_spu = spu_Create( p_stream, NULL );
+    vlc_mutex_unlock( &p_sys->lock_spu );
 
     return VLC_SUCCESS;
 }
@@ -130,11 +132,13 @@ void transcode_spu_close( sout_stream_t *p_stream, sout_stream_id_sys_t *id)
     if( id->p_encoder->p_module )
         module_unneed( id->p_encoder, id->p_encoder->p_module );
 
+    vlc_mutex_lock( &p_sys->lock_spu );
     if( p_sys->p_spu )
     {
         spu_Destroy( p_sys->p_spu );
         p_sys->p_spu = NULL;
     }
+    vlc_mutex_unlock( &p_sys->lock_spu );
 }
 
 int transcode_spu_process( sout_stream_t *p_stream,
@@ -164,14 +168,22 @@ int transcode_spu_process( sout_stream_t *p_stream,
             continue;
         }
 
-        if( p_sys->b_master_sync && p_sys->i_master_drift )
+        mtime_t i_master_drift = atomic_load( &p_sys->i_master_drift );
+        if( p_sys->b_master_sync && i_master_drift )
         {
-            p_subpic->i_start -= p_sys->i_master_drift;
-            if( p_subpic->i_stop ) p_subpic->i_stop -= p_sys->i_master_drift;
+            p_subpic->i_start -= i_master_drift;
+            if( p_subpic->i_stop ) p_subpic->i_stop -= i_master_drift;
         }
 
         if( p_sys->b_soverlay )
-            spu_PutSubpicture( p_sys->p_spu, p_subpic );
+        {
+            vlc_mutex_lock( &p_sys->lock_spu );
+            if( p_sys->p_spu )
+                spu_PutSubpicture( p_sys->p_spu, p_subpic );
+            else
+                subpicture_Delete( p_subpic );
+            vlc_mutex_unlock( &p_sys->lock_spu );
+        }
         else
         {
             block_t *p_block;
@@ -213,7 +225,7 @@ bool transcode_spu_add( sout_stream_t *p_stream, const es_format_t *p_fmt,
         }
 
         /* open output stream */
-        id->id = sout_StreamIdAdd( p_stream->p_next, &id->p_encoder->fmt_out );
+        id->id = transcode_output_add( p_stream, &id->p_encoder->fmt_out );
         id->b_transcode = true;
 
         if( !id->id )
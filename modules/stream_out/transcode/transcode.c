@@ -130,6 +130,13 @@
 #define POOL_TEXT N_("Picture pool size")
 #define POOL_LONGTEXT N_( "Defines how many pictures we allow to be in pool "\
     "between decoder/encoder threads when threads > 0" )
+#define ES_THREADS_TEXT N_("Per stream threads")
+#define ES_THREADS_LONGTEXT N_( \
+    "Decodes, filters and encodes each transcoded stream on its own thread." )
+#define PIPELINE_TEXT N_("Pipelined video filters")
+#define PIPELINE_LONGTEXT N_( \
+    "Runs each video filter on its own thread, with up to this many " \
+    "pictures queued before it (0 to disable)." )
 
 
 static const char *const ppsz_deinterlace_type[] =
@@ -215,6 +222,11 @@ vlc_module_begin ()
         change_integer_range( 1, 1000 )
     add_bool( SOUT_CFG_PREFIX "high-priority", false, HP_TEXT, HP_LONGTEXT,
               true )
+    add_bool( SOUT_CFG_PREFIX "es-threads", false, ES_THREADS_TEXT,
+              ES_THREADS_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "filter-pipeline", 0, PIPELINE_TEXT,
+                 PIPELINE_LONGTEXT, true )
+        change_integer_range( 0, 64 )
 
 vlc_module_end ()
 
@@ -224,7 +236,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "high-priority", "maxwidth", "maxheight", "pool-size",
-    NULL
+    "es-threads", "filter-pipeline", NULL
 };
 
 /*****************************************************************************
@@ -233,6 +245,7 @@ static const char *const ppsz_sout_options[] = {
 static sout_stream_id_sys_t *Add( sout_stream_t *, const es_format_t * );
 static void              Del ( sout_stream_t *, sout_stream_id_sys_t * );
 static int               Send( sout_stream_t *, sout_stream_id_sys_t *, block_t* );
+static void              Flush( sout_stream_t *, sout_stream_id_sys_t * );
 
 /*****************************************************************************
  * Open:
@@ -249,7 +262,11 @@ static int Open( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
     p_sys = calloc( 1, sizeof( *p_sys ) );
-    p_sys->i_master_drift = 0;
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+    atomic_init( &p_sys->i_master_drift, 0 );
+    vlc_mutex_init( &p_sys->lock_spu );
+    vlc_mutex_init( &p_sys->lock_next );
 
     config_ChainParse( p_stream, SOUT_CFG_PREFIX, ppsz_sout_options,
                    p_stream->p_cfg );
@@ -368,6 +385,9 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_threads = var_GetInteger( p_stream, SOUT_CFG_PREFIX "threads" );
     p_sys->pool_size = var_GetInteger( p_stream, SOUT_CFG_PREFIX "pool-size" );
     p_sys->b_high_priority = var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" );
+    p_sys->b_es_threads = var_GetBool( p_stream, SOUT_CFG_PREFIX "es-threads" );
+    p_sys->i_filter_pipeline = var_GetInteger( p_stream,
+                                               SOUT_CFG_PREFIX "filter-pipeline" );
 
     if( p_sys->i_vcodec )
     {
@@ -422,6 +442,7 @@ static int Open( vlc_object_t *p_this )
     p_stream->pf_add    = Add;
     p_stream->pf_del    = Del;
     p_stream->pf_send   = Send;
+    p_stream->pf_flush  = Flush;
     p_stream->p_sys     = p_sys;
 
     return VLC_SUCCESS;
@@ -455,9 +476,241 @@ static void Close( vlc_object_t * p_this )
     if( p_sys->p_spu ) spu_Destroy( p_sys->p_spu );
     if( p_sys->p_spu_blend ) filter_DeleteBlend( p_sys->p_spu_blend );
 
+    vlc_mutex_destroy( &p_sys->lock_next );
+    vlc_mutex_destroy( &p_sys->lock_spu );
     free( p_sys );
 }
 
+/*****************************************************************************
+ * Output, serialized as the ES threads share the next stream
+ *****************************************************************************/
+void *transcode_output_add( sout_stream_t *p_stream, const es_format_t *p_fmt )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock_next );
+    void *id = sout_StreamIdAdd( p_stream->p_next, p_fmt );
+    vlc_mutex_unlock( &p_sys->lock_next );
+    return id;
+}
+
+static void OutputDel( sout_stream_t *p_stream, void *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock_next );
+    sout_StreamIdDel( p_stream->p_next, id );
+    vlc_mutex_unlock( &p_sys->lock_next );
+}
+
+static int OutputSend( sout_stream_t *p_stream, void *id, block_t *p_block )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock_next );
+    int i_ret = sout_StreamIdSend( p_stream->p_next, id, p_block );
+    vlc_mutex_unlock( &p_sys->lock_next );
+    return i_ret;
+}
+
+/*****************************************************************************
+ * Process: runs a block through the ES chain, from the input or ES thread
+ *****************************************************************************/
+static int Process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                    block_t *p_buffer, uint64_t *pi_out )
+{
+    block_t *p_out = NULL;
+
+    if( !id->b_transcode )
+    {
+        if( p_buffer == NULL )
+            return VLC_SUCCESS;
+        if( id->id )
+            return OutputSend( p_stream, id->id, p_buffer );
+
+        block_Release( p_buffer );
+        return VLC_EGENERIC;
+    }
+
+    switch( id->p_decoder->fmt_in.i_cat )
+    {
+    case AUDIO_ES:
+        if( transcode_audio_process( p_stream, id, p_buffer, &p_out )
+            != VLC_SUCCESS )
+        {
+            return VLC_EGENERIC;
+        }
+        break;
+
+    case VIDEO_ES:
+        if( transcode_video_process( p_stream, id, p_buffer, &p_out )
+            != VLC_SUCCESS )
+        {
+            return VLC_EGENERIC;
+        }
+        break;
+
+    case SPU_ES:
+        if ( transcode_spu_process( p_stream, id, p_buffer, &p_out ) !=
+            VLC_SUCCESS )
+        {
+            return VLC_EGENERIC;
+        }
+        break;
+
+    default:
+        p_out = NULL;
+        if( p_buffer )
+            block_Release( p_buffer );
+        break;
+    }
+
+    if( p_out )
+    {
+        if( pi_out )
+            for( block_t *p_block = p_out; p_block; p_block = p_block->p_next )
+                (*pi_out)++;
+        return OutputSend( p_stream, id->id, p_out );
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * ES threads: each transcoded ES chain can run on its own thread, fed
+ * through a bounded queue
+ *****************************************************************************/
+static void *EsThread( void *data )
+{
+    sout_stream_id_sys_t *id = data;
+    sout_stream_t *p_stream = id->thread.p_stream;
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &id->thread.lock );
+    for( ;; )
+    {
+        while( id->thread.i_queued == 0 && !id->thread.b_exit )
+            vlc_cond_wait( &id->thread.wait_in, &id->thread.lock );
+
+        /* Queued blocks are processed before exiting */
+        if( id->thread.i_queued == 0 )
+            break;
+
+        block_t *p_block = id->thread.queue[id->thread.i_first].p_block;
+        mtime_t i_date = id->thread.queue[id->thread.i_first].i_date;
+        id->thread.i_first = (id->thread.i_first + 1) % ES_THREAD_QUEUE_SIZE;
+        id->thread.i_queued--;
+        id->thread.b_busy = true;
+        vlc_cond_signal( &id->thread.wait_space );
+        vlc_mutex_unlock( &id->thread.lock );
+
+        uint64_t i_out = 0;
+        Process( p_stream, id, p_block, &i_out );
+        mtime_t i_latency = mdate() - i_date;
+
+        vlc_mutex_lock( &id->thread.lock );
+        id->thread.b_busy = false;
+        id->thread.i_in++;
+        id->thread.i_out += i_out;
+        id->thread.i_latency += i_latency;
+        if( i_latency > id->thread.i_latency_max )
+            id->thread.i_latency_max = i_latency;
+        if( id->thread.i_queued == 0 )
+            vlc_cond_broadcast( &id->thread.wait_space );
+    }
+    vlc_mutex_unlock( &id->thread.lock );
+
+    vlc_restorecancel( canc );
+    return NULL;
+}
+
+static int EsThreadStart( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    int i_priority = id->p_decoder->fmt_in.i_cat == AUDIO_ES ?
+                     VLC_THREAD_PRIORITY_AUDIO : VLC_THREAD_PRIORITY_VIDEO;
+
+    id->thread.p_stream = p_stream;
+    id->thread.b_busy = false;
+    id->thread.b_exit = false;
+    id->thread.i_first = 0;
+    id->thread.i_queued = 0;
+    id->thread.i_start = mdate();
+    id->thread.i_in = 0;
+    id->thread.i_out = 0;
+    id->thread.i_latency = 0;
+    id->thread.i_latency_max = 0;
+    vlc_mutex_init( &id->thread.lock );
+    vlc_cond_init( &id->thread.wait_in );
+    vlc_cond_init( &id->thread.wait_space );
+
+    if( vlc_clone( &id->thread.thread, EsThread, id, i_priority ) )
+    {
+        vlc_cond_destroy( &id->thread.wait_space );
+        vlc_cond_destroy( &id->thread.wait_in );
+        vlc_mutex_destroy( &id->thread.lock );
+        return VLC_EGENERIC;
+    }
+    id->thread.b_running = true;
+    return VLC_SUCCESS;
+}
+
+static void EsThreadStop( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    vlc_mutex_lock( &id->thread.lock );
+    id->thread.b_exit = true;
+    vlc_cond_signal( &id->thread.wait_in );
+    vlc_mutex_unlock( &id->thread.lock );
+
+    vlc_join( id->thread.thread, NULL );
+    vlc_cond_destroy( &id->thread.wait_space );
+    vlc_cond_destroy( &id->thread.wait_in );
+    vlc_mutex_destroy( &id->thread.lock );
+    id->thread.b_running = false;
+
+    mtime_t i_duration = mdate() - id->thread.i_start;
+    if( id->thread.i_in > 0 && i_duration > 0 )
+        msg_Dbg( p_stream, "%4.4s thread: %"PRIu64" blocks in, %"PRIu64
+                 " out (%.2f/s), latency %"PRId64" ms average, %"PRId64
+                 " ms max", (char *)&id->p_decoder->fmt_in.i_codec,
+                 id->thread.i_in, id->thread.i_out,
+                 (double)id->thread.i_out * CLOCK_FREQ / i_duration,
+                 id->thread.i_latency / id->thread.i_in / 1000,
+                 id->thread.i_latency_max / 1000 );
+}
+
+static int EsThreadQueue( sout_stream_id_sys_t *id, block_t *p_block )
+{
+    vlc_mutex_lock( &id->thread.lock );
+    /* Do not let the input run away from a slow chain */
+    while( id->thread.i_queued == ES_THREAD_QUEUE_SIZE )
+        vlc_cond_wait( &id->thread.wait_space, &id->thread.lock );
+
+    unsigned i_last = (id->thread.i_first + id->thread.i_queued)
+                      % ES_THREAD_QUEUE_SIZE;
+    id->thread.queue[i_last].p_block = p_block;
+    id->thread.queue[i_last].i_date = mdate();
+    id->thread.i_queued++;
+    vlc_cond_signal( &id->thread.wait_in );
+    vlc_mutex_unlock( &id->thread.lock );
+    return VLC_SUCCESS;
+}
+
+/* Drops the queued blocks and waits for the one being processed */
+static void EsThreadFlush( sout_stream_id_sys_t *id )
+{
+    vlc_mutex_lock( &id->thread.lock );
+    while( id->thread.i_queued > 0 )
+    {
+        block_t *p_block = id->thread.queue[id->thread.i_first].p_block;
+        if( p_block )
+            block_Release( p_block );
+        id->thread.i_first = (id->thread.i_first + 1) % ES_THREAD_QUEUE_SIZE;
+        id->thread.i_queued--;
+    }
+    while( id->thread.b_busy )
+        vlc_cond_wait( &id->thread.wait_space, &id->thread.lock );
+    vlc_mutex_unlock( &id->thread.lock );
+}
+
 static void DeleteSoutStreamID( sout_stream_id_sys_t *id )
 {
     if( id )
@@ -535,7 +788,7 @@ static sout_stream_id_sys_t *Add( sout_stream_t *p_stream,
     {
         msg_Dbg( p_stream, "not transcoding a stream (fcc=`%4.4s')",
                  (char*)&p_fmt->i_codec );
-        id->id = sout_StreamIdAdd( p_stream->p_next, p_fmt );
+        id->id = transcode_output_add( p_stream, p_fmt );
         id->b_transcode = false;
 
         success = id->id;
@@ -544,6 +797,11 @@ static sout_stream_id_sys_t *Add( sout_stream_t *p_stream,
     if(!success)
         goto error;
 
+    if( id->b_transcode && p_sys->b_es_threads &&
+        EsThreadStart( p_stream, id ) != VLC_SUCCESS )
+        msg_Warn( p_stream, "cannot spawn thread, transcoding on the input "
+                  "thread (fcc=`%4.4s')", (char*)&p_fmt->i_codec );
+
     return id;
 
 error:
@@ -553,16 +811,30 @@ error:
 
 static void Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 {
+    bool b_drained = false;
+
+    if( id->thread.b_running )
+    {
+        /* Drain the chain on its thread */
+        if( id->p_decoder->fmt_in.i_cat == AUDIO_ES ||
+            id->p_decoder->fmt_in.i_cat == VIDEO_ES )
+            EsThreadQueue( id, NULL );
+        EsThreadStop( p_stream, id );
+        b_drained = true;
+    }
+
     if( id->b_transcode )
     {
         switch( id->p_decoder->fmt_in.i_cat )
         {
         case AUDIO_ES:
-            Send( p_stream, id, NULL );
+            if( !b_drained )
+                Send( p_stream, id, NULL );
             transcode_audio_close( id );
             break;
         case VIDEO_ES:
-            Send( p_stream, id, NULL );
+            if( !b_drained )
+                Send( p_stream, id, NULL );
             transcode_video_close( p_stream, id );
             break;
         case SPU_ES:
@@ -574,7 +846,7 @@ static void Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
         }
     }
 
-    if( id->id ) sout_StreamIdDel( p_stream->p_next, id->id );
+    if( id->id ) OutputDel( p_stream, id->id );
 
     DeleteSoutStreamID( id );
 }
@@ -582,50 +854,27 @@ static void Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                  block_t *p_buffer )
 {
-    block_t *p_out = NULL;
+    if( id->thread.b_running )
+        return EsThreadQueue( id, p_buffer );
 
-    if( !id->b_transcode )
-    {
-        if( id->id )
-            return sout_StreamIdSend( p_stream->p_next, id->id, p_buffer );
-
-        block_Release( p_buffer );
-        return VLC_EGENERIC;
-    }
+    return Process( p_stream, id, p_buffer, NULL );
+}
 
-    switch( id->p_decoder->fmt_in.i_cat )
-    {
-    case AUDIO_ES:
-        if( transcode_audio_process( p_stream, id, p_buffer, &p_out )
-            != VLC_SUCCESS )
-        {
-            return VLC_EGENERIC;
-        }
-        break;
+static void Flush( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
 
-    case VIDEO_ES:
-        if( transcode_video_process( p_stream, id, p_buffer, &p_out )
-            != VLC_SUCCESS )
-        {
-            return VLC_EGENERIC;
-        }
-        break;
+    if( id->thread.b_running )
+        EsThreadFlush( id );
 
-    case SPU_ES:
-        if ( transcode_spu_process( p_stream, id, p_buffer, &p_out ) !=
-            VLC_SUCCESS )
-        {
-            return VLC_EGENERIC;
-        }
-        break;
+    if( id->b_transcode && id->p_decoder->p_module &&
+        id->p_decoder->pf_flush )
+        id->p_decoder->pf_flush( id->p_decoder );
 
-    default:
-        p_out = NULL;
-        block_Release( p_buffer );
-        break;
+    if( id->id )
+    {
+        vlc_mutex_lock( &p_sys->lock_next );
+        sout_StreamFlush( p_stream->p_next, id->id );
+        vlc_mutex_unlock( &p_sys->lock_next );
     }
-
-    if( p_out )
-        return sout_StreamIdSend( p_stream->p_next, id->id, p_out );
-    return VLC_SUCCESS;
 }
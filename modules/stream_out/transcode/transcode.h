@@ -10,10 +10,14 @@
 #include <vlc_codec.h>
 
 #include <vlc_picture_fifo.h>
+#include <vlc_atomic.h>
 
 /*100ms is around the limit where people are noticing lipsync issues*/
 #define MASTER_SYNC_MAX_DRIFT 100000
 
+/* Maximum number of input blocks queued to an ES thread */
+#define ES_THREAD_QUEUE_SIZE 64
+
 struct sout_stream_sys_t
 {
     sout_stream_id_sys_t *id_video;
@@ -53,6 +57,7 @@ struct sout_stream_sys_t
     unsigned int    fps_num,fps_den;
 
     char            *psz_vf2;
+    unsigned int    i_filter_pipeline; /* pictures queued per filter */
 
     /* SPU */
     vlc_fourcc_t    i_scodec;   /* codec spu (0 if not transcode) */
@@ -61,11 +66,16 @@ struct sout_stream_sys_t
     config_chain_t  *p_spu_cfg;
     spu_t           *p_spu;
     filter_t        *p_spu_blend;
+    vlc_mutex_t     lock_spu; /* p_spu and p_spu_blend are used by several ES */
 
     /* Sync */
     bool            b_master_sync;
     /* i_master drift is how much audio buffer is ahead of calculated pts */
-    mtime_t         i_master_drift;
+    atomic_int_least64_t i_master_drift;
+
+    /* ES threads */
+    bool            b_es_threads;
+    vlc_mutex_t     lock_next; /* serializes the calls to the next stream */
 };
 
 struct aout_filters;
@@ -123,8 +133,39 @@ struct sout_stream_id_sys_t
     date_t          next_input_pts; /**< Incoming calculated PTS */
     date_t          next_output_pts; /**< output calculated PTS */
 
+    /* Thread running the decoder -> filters -> encoder chain, if any */
+    struct
+    {
+        bool         b_running;
+        vlc_thread_t thread;
+        sout_stream_t *p_stream;
+        vlc_mutex_t  lock;
+        vlc_cond_t   wait_in;    /* for input blocks or exit */
+        vlc_cond_t   wait_space; /* for room in the queue or idleness */
+        bool         b_busy;
+        bool         b_exit;
+
+        /* input blocks (NULL to drain) and their queuing date */
+        struct
+        {
+            block_t *p_block;
+            mtime_t  i_date;
+        } queue[ES_THREAD_QUEUE_SIZE];
+        unsigned     i_first;
+        unsigned     i_queued;
+
+        /* statistics */
+        mtime_t      i_start;
+        uint64_t     i_in;
+        uint64_t     i_out;
+        mtime_t      i_latency;  /* total, from queuing to output */
+        mtime_t      i_latency_max;
+    } thread;
 };
 
+/* Adds the output stream, serialized with the ES threads */
+void *transcode_output_add( sout_stream_t *, const es_format_t * );
+
 /* SPU */
 
 void transcode_spu_close  ( sout_stream_t *, sout_stream_id_sys_t * );
@@ -312,6 +312,7 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
     id->p_encoder->fmt_in.video.i_chroma = id->p_encoder->fmt_in.i_codec;
     id->p_f_chain = filter_chain_NewVideo( p_stream, false, &owner );
     filter_chain_Reset( id->p_f_chain, p_fmt_out, p_fmt_out );
+    filter_chain_SetPipeline( id->p_f_chain, p_stream->p_sys->i_filter_pipeline );
 
     /* Check that we have visible_width/height*/
     if( !id->p_decoder->fmt_out.video.i_visible_height )
@@ -346,6 +347,8 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
         id->p_uf_chain = filter_chain_NewVideo( p_stream, true, &owner );
         filter_chain_Reset( id->p_uf_chain, p_fmt_out,
                             &id->p_encoder->fmt_in );
+        filter_chain_SetPipeline( id->p_uf_chain,
+                                  p_stream->p_sys->i_filter_pipeline );
         if( p_fmt_out->video.i_chroma != id->p_encoder->fmt_in.video.i_chroma )
         {
             filter_chain_AppendConverter( id->p_uf_chain, p_fmt_out,
@@ -635,7 +638,7 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
     id->p_encoder->fmt_out.i_codec =
         vlc_fourcc_GetCodec( VIDEO_ES, id->p_encoder->fmt_out.i_codec );
 
-    id->id = sout_StreamIdAdd( p_stream->p_next, &id->p_encoder->fmt_out );
+    id->id = transcode_output_add( p_stream, &id->p_encoder->fmt_out );
     if( !id->id )
     {
         msg_Err( p_stream, "cannot add this stream" );
@@ -692,6 +695,7 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
      * Encoding
      */
     /* Check if we have a subpicture to overlay */
+    vlc_mutex_lock( &p_sys->lock_spu );
     if( p_sys->p_spu )
     {
         video_format_t fmt = id->p_encoder->fmt_in.video;
@@ -729,6 +733,7 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
             subpicture_Delete( p_subpic );
         }
     }
+    vlc_mutex_unlock( &p_sys->lock_spu );
 
     if( p_sys->i_threads == 0 )
     {
@@ -751,6 +756,30 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
         picture_Release( p_pic );
 }
 
+/* Outputs the pictures still in the filter chains */
+static void DrainFilters( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                          block_t **out )
+{
+    picture_t *p_pic;
+
+    if( id->p_f_chain )
+        while( (p_pic = filter_chain_VideoDrain( id->p_f_chain )) != NULL )
+        {
+            if( id->p_uf_chain )
+                p_pic = filter_chain_VideoFilter( id->p_uf_chain, p_pic );
+            while( p_pic )
+            {
+                OutputFrame( p_stream, p_pic, id, out );
+                p_pic = id->p_uf_chain ?
+                        filter_chain_VideoFilter( id->p_uf_chain, NULL ) : NULL;
+            }
+        }
+
+    if( id->p_uf_chain )
+        while( (p_pic = filter_chain_VideoDrain( id->p_uf_chain )) != NULL )
+            OutputFrame( p_stream, p_pic, id, out );
+}
+
 int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                     block_t *in, block_t **out )
 {
@@ -789,6 +818,7 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                         id->fmt_input_video.i_sar_den, id->p_decoder->fmt_out.video.i_sar_den
                     );
             /* Close filters */
+            DrainFilters( p_stream, id, out );
             if( id->p_f_chain )
                 filter_chain_Delete( id->p_f_chain );
             id->p_f_chain = NULL;
@@ -874,6 +904,9 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 end:
     if( unlikely( in == NULL ) )
     {
+        if( id->p_encoder->p_module )
+            DrainFilters( p_stream, id, out );
+
         if( p_sys->i_threads == 0 )
         {
             if( id->p_encoder->p_module )
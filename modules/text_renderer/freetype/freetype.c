@@ -70,6 +70,7 @@
 #include "platform_fonts.h"
 #include "freetype.h"
 #include "text_layout.h"
+#include "glyph_cache.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -122,6 +123,9 @@ static void Destroy( vlc_object_t * );
 static const int pi_sizes[] = { 20, 18, 16, 12, 6 };
 static const char *const ppsz_sizes_text[] = {
     N_("Smaller"), N_("Small"), N_("Normal"), N_("Large"), N_("Larger") };
+#define CACHE_SIZE_TEXT N_("Glyph cache size (KiB)")
+#define CACHE_SIZE_LONGTEXT N_("Memory used to keep rendered glyphs and " \
+  "shaped text between subtitles. 0 disables the cache." )
 #define YUVP_TEXT N_("Use YUVP renderer")
 #define YUVP_LONGTEXT N_("This renders the font using \"paletized YUV\". " \
   "This option is only needed if you want to encode into DVB subtitles" )
@@ -232,6 +236,8 @@ vlc_module_begin ()
 
     add_bool( "freetype-yuvp", false, YUVP_TEXT,
               YUVP_LONGTEXT, true )
+    add_integer_with_range( "freetype-cache-size", 8192, 0, 1048576,
+                            CACHE_SIZE_TEXT, CACHE_SIZE_LONGTEXT, true )
 
 #ifdef HAVE_FRIBIDI
     add_integer_with_range( "freetype-text-direction", 0, 0, 2, TEXT_DIRECTION_TEXT,
@@ -1203,6 +1209,9 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
 
     FreeLines( p_lines );
 
+    if( p_sys->p_glyph_cache )
+        glyph_cache_Trim( p_sys->p_glyph_cache );
+
     free( psz_text );
     FreeStylesArray( pp_styles, i_styles );
     free( pi_k_durations );
@@ -1253,6 +1262,10 @@ static int Create( vlc_object_t *p_this )
 
     p_sys->i_scale = 100;
 
+    int64_t i_cache_size = var_InheritInteger( p_filter, "freetype-cache-size" );
+    if( i_cache_size > 0 )
+        p_sys->p_glyph_cache = glyph_cache_New( i_cache_size * 1024 );
+
     /* default style to apply to uncomplete segmeents styles */
     p_sys->p_default_style = text_style_Create( STYLE_FULLY_SET );
     if(unlikely(!p_sys->p_default_style))
@@ -1370,6 +1383,9 @@ static void Destroy( vlc_object_t *p_this )
     DumpDictionary( p_filter, &p_sys->fallback_map, true, -1 );
 #endif
 
+    if( p_sys->p_glyph_cache )
+        glyph_cache_Delete( p_this, p_sys->p_glyph_cache );
+
     /* Text styles */
     text_style_Delete( p_sys->p_default_style );
     text_style_Delete( p_sys->p_forced_style );
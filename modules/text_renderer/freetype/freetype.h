@@ -111,6 +111,9 @@ struct filter_sys_t
     /** Font face cache */
     vlc_dictionary_t  face_map;
 
+    /** Glyph and shaped run cache, NULL if disabled */
+    struct glyph_cache_t *p_glyph_cache;
+
     int               i_fallback_counter;
 
     /* Current scaling of the text, default is 100 (%) */
@@ -0,0 +1,418 @@
+/*****************************************************************************
+ * glyph_cache.c : Glyph and shaped run cache
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Glyph and shaped run cache
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "glyph_cache.h"
+
+#define GLYPH_CACHE_BUCKETS 4096
+
+enum
+{
+    ENTRY_OUTLINE,  /* loaded or stroked glyph */
+    ENTRY_BITMAP,   /* rendered glyph */
+    ENTRY_RUN,      /* shaped run */
+    ENTRY_TYPES
+};
+
+static const char *const ppsz_entry_types[ENTRY_TYPES] = {
+    "outlines", "bitmaps", "shaped runs",
+};
+
+typedef struct glyph_cache_entry_t glyph_cache_entry_t;
+struct glyph_cache_entry_t
+{
+    glyph_cache_entry_t *p_hash_next;
+    glyph_cache_entry_t *p_prev;    /* more recently used */
+    glyph_cache_entry_t *p_next;    /* less recently used */
+    uint32_t             i_hash;
+    int                  i_type;
+    size_t               i_size;
+
+    union
+    {
+        struct
+        {
+            glyph_cache_key_t key;
+            FT_Glyph          p_glyph;
+            FT_Vector         advance;
+        } glyph;
+#ifdef HAVE_HARFBUZZ
+        struct
+        {
+            FT_Face              p_face;
+            hb_script_t          script;
+            hb_direction_t       direction;
+            uni_char_t          *p_text;
+            unsigned             i_length;
+            hb_glyph_info_t     *p_infos;
+            hb_glyph_position_t *p_positions;
+            unsigned             i_count;
+        } run;
+#endif
+    } u;
+};
+
+struct glyph_cache_t
+{
+    glyph_cache_entry_t *pp_buckets[GLYPH_CACHE_BUCKETS];
+    glyph_cache_entry_t *p_first;   /* most recently used */
+    glyph_cache_entry_t *p_last;    /* least recently used */
+    size_t               i_size;
+    size_t               i_max_size;
+    unsigned             i_entries;
+
+    /* statistics */
+    uint64_t             i_hits[ENTRY_TYPES];
+    uint64_t             i_misses[ENTRY_TYPES];
+    uint64_t             i_evictions;
+};
+
+/* FNV-1a */
+static uint32_t Hash( uint32_t i_hash, const void *p_data, size_t i_size )
+{
+    const uint8_t *p = p_data;
+
+    for( size_t i = 0; i < i_size; i++ )
+        i_hash = ( i_hash ^ p[i] ) * 16777619;
+    return i_hash;
+}
+
+#define HASH_INIT 2166136261u
+#define HASH_FIELD( h, field ) Hash( h, &(field), sizeof(field) )
+
+static uint32_t HashGlyphKey( const glyph_cache_key_t *p_key )
+{
+    uint32_t i_hash = HASH_INIT;
+    i_hash = HASH_FIELD( i_hash, p_key->p_face );
+    i_hash = HASH_FIELD( i_hash, p_key->i_index );
+    i_hash = HASH_FIELD( i_hash, p_key->i_flags );
+    i_hash = HASH_FIELD( i_hash, p_key->i_radius );
+    i_hash = HASH_FIELD( i_hash, p_key->i_subpixel_x );
+    i_hash = HASH_FIELD( i_hash, p_key->i_subpixel_y );
+    return i_hash;
+}
+
+static bool GlyphKeyEquals( const glyph_cache_key_t *p_a,
+                            const glyph_cache_key_t *p_b )
+{
+    return p_a->p_face == p_b->p_face && p_a->i_index == p_b->i_index
+        && p_a->i_flags == p_b->i_flags && p_a->i_radius == p_b->i_radius
+        && p_a->i_subpixel_x == p_b->i_subpixel_x
+        && p_a->i_subpixel_y == p_b->i_subpixel_y;
+}
+
+static size_t GlyphSize( FT_Glyph p_glyph )
+{
+    if( p_glyph->format == FT_GLYPH_FORMAT_BITMAP )
+    {
+        const FT_Bitmap *p_bitmap = &((FT_BitmapGlyph)p_glyph)->bitmap;
+        return sizeof(FT_BitmapGlyphRec)
+             + (size_t)abs( p_bitmap->pitch ) * p_bitmap->rows;
+    }
+    if( p_glyph->format == FT_GLYPH_FORMAT_OUTLINE )
+    {
+        const FT_Outline *p_outline = &((FT_OutlineGlyph)p_glyph)->outline;
+        return sizeof(FT_OutlineGlyphRec)
+             + p_outline->n_points * ( sizeof(FT_Vector) + 1 )
+             + p_outline->n_contours * sizeof(short);
+    }
+    return sizeof(FT_GlyphRec);
+}
+
+static void Unlink( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    if( p_entry->p_prev )
+        p_entry->p_prev->p_next = p_entry->p_next;
+    else
+        p_cache->p_first = p_entry->p_next;
+    if( p_entry->p_next )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_cache->p_last = p_entry->p_prev;
+}
+
+static void LinkFirst( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    p_entry->p_prev = NULL;
+    p_entry->p_next = p_cache->p_first;
+    if( p_cache->p_first )
+        p_cache->p_first->p_prev = p_entry;
+    else
+        p_cache->p_last = p_entry;
+    p_cache->p_first = p_entry;
+}
+
+static void Touch( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    if( p_cache->p_first == p_entry )
+        return;
+    Unlink( p_cache, p_entry );
+    LinkFirst( p_cache, p_entry );
+}
+
+static void Insert( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    glyph_cache_entry_t **pp_bucket =
+        &p_cache->pp_buckets[p_entry->i_hash % GLYPH_CACHE_BUCKETS];
+
+    p_entry->p_hash_next = *pp_bucket;
+    *pp_bucket = p_entry;
+    LinkFirst( p_cache, p_entry );
+    p_cache->i_size += p_entry->i_size;
+    p_cache->i_entries++;
+}
+
+static void FreeEntry( glyph_cache_entry_t *p_entry )
+{
+    if( p_entry->i_type == ENTRY_RUN )
+    {
+#ifdef HAVE_HARFBUZZ
+        free( p_entry->u.run.p_text );
+        free( p_entry->u.run.p_infos );
+        free( p_entry->u.run.p_positions );
+#endif
+    }
+    else
+        FT_Done_Glyph( p_entry->u.glyph.p_glyph );
+    free( p_entry );
+}
+
+static void Remove( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    glyph_cache_entry_t **pp =
+        &p_cache->pp_buckets[p_entry->i_hash % GLYPH_CACHE_BUCKETS];
+
+    while( *pp != p_entry )
+        pp = &(*pp)->p_hash_next;
+    *pp = p_entry->p_hash_next;
+
+    Unlink( p_cache, p_entry );
+    p_cache->i_size -= p_entry->i_size;
+    p_cache->i_entries--;
+    FreeEntry( p_entry );
+}
+
+glyph_cache_t *glyph_cache_New( size_t i_max_size )
+{
+    glyph_cache_t *p_cache = calloc( 1, sizeof(*p_cache) );
+    if( unlikely(p_cache == NULL) )
+        return NULL;
+
+    p_cache->i_max_size = i_max_size;
+    return p_cache;
+}
+
+void glyph_cache_Delete( vlc_object_t *p_obj, glyph_cache_t *p_cache )
+{
+    for( int i = 0; i < ENTRY_TYPES; i++ )
+    {
+        uint64_t i_total = p_cache->i_hits[i] + p_cache->i_misses[i];
+        if( i_total > 0 )
+            msg_Dbg( p_obj, "glyph cache: %"PRIu64" %s lookups, %.1f%% hits",
+                     i_total, ppsz_entry_types[i],
+                     100. * p_cache->i_hits[i] / i_total );
+    }
+    msg_Dbg( p_obj, "glyph cache: %u entries, %zu of %zu KiB, "
+             "%"PRIu64" evictions", p_cache->i_entries,
+             p_cache->i_size / 1024, p_cache->i_max_size / 1024,
+             p_cache->i_evictions );
+
+    while( p_cache->p_first )
+    {
+        glyph_cache_entry_t *p_entry = p_cache->p_first;
+        p_cache->p_first = p_entry->p_next;
+        FreeEntry( p_entry );
+    }
+    free( p_cache );
+}
+
+void glyph_cache_Trim( glyph_cache_t *p_cache )
+{
+    while( p_cache->i_size > p_cache->i_max_size && p_cache->p_last )
+    {
+        Remove( p_cache, p_cache->p_last );
+        p_cache->i_evictions++;
+    }
+}
+
+FT_Glyph glyph_cache_GetGlyph( glyph_cache_t *p_cache,
+                               const glyph_cache_key_t *p_key,
+                               FT_Vector *p_advance )
+{
+    const int i_type = ( p_key->i_flags & GLYPH_CACHE_BITMAP ) ?
+                       ENTRY_BITMAP : ENTRY_OUTLINE;
+    const uint32_t i_hash = HashGlyphKey( p_key );
+
+    for( glyph_cache_entry_t *p_entry =
+             p_cache->pp_buckets[i_hash % GLYPH_CACHE_BUCKETS];
+         p_entry != NULL; p_entry = p_entry->p_hash_next )
+    {
+        if( p_entry->i_hash != i_hash || p_entry->i_type != i_type
+         || !GlyphKeyEquals( &p_entry->u.glyph.key, p_key ) )
+            continue;
+
+        FT_Glyph p_glyph;
+        if( FT_Glyph_Copy( p_entry->u.glyph.p_glyph, &p_glyph ) )
+            return NULL;
+
+        Touch( p_cache, p_entry );
+        p_cache->i_hits[i_type]++;
+        if( p_advance )
+            *p_advance = p_entry->u.glyph.advance;
+        return p_glyph;
+    }
+
+    p_cache->i_misses[i_type]++;
+    return NULL;
+}
+
+void glyph_cache_PutGlyph( glyph_cache_t *p_cache,
+                           const glyph_cache_key_t *p_key, FT_Glyph p_glyph,
+                           const FT_Vector *p_advance )
+{
+    glyph_cache_entry_t *p_entry = malloc( sizeof(*p_entry) );
+    if( unlikely(p_entry == NULL) )
+        return;
+
+    if( FT_Glyph_Copy( p_glyph, &p_entry->u.glyph.p_glyph ) )
+    {
+        free( p_entry );
+        return;
+    }
+
+    p_entry->i_hash = HashGlyphKey( p_key );
+    p_entry->i_type = ( p_key->i_flags & GLYPH_CACHE_BITMAP ) ?
+                      ENTRY_BITMAP : ENTRY_OUTLINE;
+    p_entry->i_size = sizeof(*p_entry) + GlyphSize( p_glyph );
+    p_entry->u.glyph.key = *p_key;
+    if( p_advance )
+        p_entry->u.glyph.advance = *p_advance;
+    else
+        p_entry->u.glyph.advance = (FT_Vector) { 0, 0 };
+    Insert( p_cache, p_entry );
+}
+
+#ifdef HAVE_HARFBUZZ
+static uint32_t HashRun( FT_Face p_face, hb_script_t script,
+                         hb_direction_t direction,
+                         const uni_char_t *p_text, unsigned i_length )
+{
+    uint32_t i_hash = HASH_INIT;
+    i_hash = HASH_FIELD( i_hash, p_face );
+    i_hash = HASH_FIELD( i_hash, script );
+    i_hash = HASH_FIELD( i_hash, direction );
+    return Hash( i_hash, p_text, i_length * sizeof(*p_text) );
+}
+
+bool glyph_cache_GetRun( glyph_cache_t *p_cache, FT_Face p_face,
+                         hb_script_t script, hb_direction_t direction,
+                         const uni_char_t *p_text, unsigned i_length,
+                         hb_glyph_info_t **pp_infos,
+                         hb_glyph_position_t **pp_positions,
+                         unsigned *pi_count )
+{
+    const uint32_t i_hash = HashRun( p_face, script, direction,
+                                     p_text, i_length );
+
+    for( glyph_cache_entry_t *p_entry =
+             p_cache->pp_buckets[i_hash % GLYPH_CACHE_BUCKETS];
+         p_entry != NULL; p_entry = p_entry->p_hash_next )
+    {
+        if( p_entry->i_hash != i_hash || p_entry->i_type != ENTRY_RUN
+         || p_entry->u.run.p_face != p_face
+         || p_entry->u.run.script != script
+         || p_entry->u.run.direction != direction
+         || p_entry->u.run.i_length != i_length
+         || memcmp( p_entry->u.run.p_text, p_text,
+                    i_length * sizeof(*p_text) ) )
+            continue;
+
+        Touch( p_cache, p_entry );
+        p_cache->i_hits[ENTRY_RUN]++;
+        *pp_infos = p_entry->u.run.p_infos;
+        *pp_positions = p_entry->u.run.p_positions;
+        *pi_count = p_entry->u.run.i_count;
+        return true;
+    }
+
+    p_cache->i_misses[ENTRY_RUN]++;
+    return false;
+}
+
+void glyph_cache_PutRun( glyph_cache_t *p_cache, FT_Face p_face,
+                         hb_script_t script, hb_direction_t direction,
+                         const uni_char_t *p_text, unsigned i_length,
+                         const hb_glyph_info_t *p_infos,
+                         const hb_glyph_position_t *p_positions,
+                         unsigned i_count )
+{
+#if ( UINT_MAX > SIZE_MAX / 64 )
+    if( unlikely(i_length > SIZE_MAX / sizeof(*p_text)
+              || i_count > SIZE_MAX / ( sizeof(*p_infos)
+                                      + sizeof(*p_positions) )) )
+        return;
+#endif
+
+    glyph_cache_entry_t *p_entry = malloc( sizeof(*p_entry) );
+    if( unlikely(p_entry == NULL) )
+        return;
+
+    p_entry->u.run.p_text = malloc( i_length * sizeof(*p_text) );
+    p_entry->u.run.p_infos = malloc( i_count * sizeof(*p_infos) );
+    p_entry->u.run.p_positions = malloc( i_count * sizeof(*p_positions) );
+    if( unlikely(p_entry->u.run.p_text == NULL
+              || p_entry->u.run.p_infos == NULL
+              || p_entry->u.run.p_positions == NULL) )
+    {
+        p_entry->i_type = ENTRY_RUN;
+        FreeEntry( p_entry );
+        return;
+    }
+
+    memcpy( p_entry->u.run.p_text, p_text, i_length * sizeof(*p_text) );
+    memcpy( p_entry->u.run.p_infos, p_infos, i_count * sizeof(*p_infos) );
+    memcpy( p_entry->u.run.p_positions, p_positions,
+            i_count * sizeof(*p_positions) );
+    p_entry->u.run.p_face = p_face;
+    p_entry->u.run.script = script;
+    p_entry->u.run.direction = direction;
+    p_entry->u.run.i_length = i_length;
+    p_entry->u.run.i_count = i_count;
+
+    p_entry->i_hash = HashRun( p_face, script, direction, p_text, i_length );
+    p_entry->i_type = ENTRY_RUN;
+    p_entry->i_size = sizeof(*p_entry) + i_length * sizeof(*p_text)
+                    + i_count * ( sizeof(*p_infos) + sizeof(*p_positions) );
+    Insert( p_cache, p_entry );
+}
+#endif
+
+/** @} */
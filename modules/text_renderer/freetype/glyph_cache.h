@@ -0,0 +1,105 @@
+/*****************************************************************************
+ * glyph_cache.h : Glyph and shaped run cache
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FREETYPE_GLYPH_CACHE_H
+#define VLC_FREETYPE_GLYPH_CACHE_H
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Glyph and shaped run cache
+ *
+ * Subtitles are usually rendered many times with the same text and styles
+ * (karaoke, animations, several outputs). This keeps the glyph images,
+ * before and after rasterization, and the shaped runs of the last renders,
+ * within a memory budget. Least recently used entries are discarded by
+ * glyph_cache_Trim(), which must not be called while entries returned by
+ * glyph_cache_GetRun() are in use.
+ *
+ * Faces are loaded once per size and kept until the module is closed, so
+ * a face identifies both a font and its size.
+ */
+
+#include "freetype.h"
+
+#ifdef HAVE_HARFBUZZ
+# include <hb.h>
+#endif
+
+#define GLYPH_CACHE_EMBOLDEN    0x1 /**< emboldened by FreeType */
+#define GLYPH_CACHE_OBLIQUE     0x2 /**< slanted by FreeType */
+#define GLYPH_CACHE_STROKED     0x4 /**< outline border, see i_radius */
+#define GLYPH_CACHE_BITMAP      0x8 /**< rendered, see i_subpixel_x/y */
+
+typedef struct
+{
+    FT_Face     p_face;
+    FT_UInt     i_index;        /**< glyph index within the face */
+    int         i_flags;        /**< GLYPH_CACHE_* */
+    int         i_radius;       /**< stroker radius (26.6) */
+    int         i_subpixel_x;   /**< rendering origin (26.6, 0 to 63) */
+    int         i_subpixel_y;
+} glyph_cache_key_t;
+
+typedef struct glyph_cache_t glyph_cache_t;
+
+glyph_cache_t *glyph_cache_New( size_t i_max_size );
+void glyph_cache_Delete( vlc_object_t *, glyph_cache_t * );
+
+/**
+ * Discards the least recently used entries beyond the memory budget.
+ */
+void glyph_cache_Trim( glyph_cache_t * );
+
+/**
+ * Returns a copy of a cached glyph image, to be freed with FT_Done_Glyph(),
+ * or NULL if it is not cached.
+ */
+FT_Glyph glyph_cache_GetGlyph( glyph_cache_t *, const glyph_cache_key_t *,
+                               FT_Vector *p_advance );
+/**
+ * Stores a copy of a glyph image.
+ */
+void glyph_cache_PutGlyph( glyph_cache_t *, const glyph_cache_key_t *,
+                           FT_Glyph, const FT_Vector *p_advance );
+
+#ifdef HAVE_HARFBUZZ
+/**
+ * Looks up the HarfBuzz output for a run of text. The returned arrays stay
+ * valid until the next glyph_cache_Trim().
+ */
+bool glyph_cache_GetRun( glyph_cache_t *, FT_Face, hb_script_t, hb_direction_t,
+                         const uni_char_t *p_text, unsigned i_length,
+                         hb_glyph_info_t **pp_infos,
+                         hb_glyph_position_t **pp_positions,
+                         unsigned *pi_count );
+/**
+ * Stores a copy of the HarfBuzz output for a run of text.
+ */
+void glyph_cache_PutRun( glyph_cache_t *, FT_Face, hb_script_t, hb_direction_t,
+                         const uni_char_t *p_text, unsigned i_length,
+                         const hb_glyph_info_t *p_infos,
+                         const hb_glyph_position_t *p_positions,
+                         unsigned i_count );
+#endif
+
+/** @} */
+
+#endif
@@ -65,6 +65,7 @@
 #include "freetype.h"
 #include "text_layout.h"
 #include "platform_fonts.h"
+#include "glyph_cache.h"
 
 /* Win32 */
 #ifdef _WIN32
@@ -130,6 +131,8 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+    glyph_cache_key_t key;      /**< identifies p_glyph in the glyph cache */
+    int      i_outline_radius;  /**< stroker radius of p_outline */
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -695,6 +698,21 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         else
             p_face = p_run->p_face;
 
+        const uni_char_t *p_text =
+            p_paragraph->p_code_points + p_run->i_start_offset;
+        const unsigned i_length = p_run->i_end_offset - p_run->i_start_offset;
+
+        if( p_sys->p_glyph_cache
+         && glyph_cache_GetRun( p_sys->p_glyph_cache, p_face,
+                                p_run->script, p_run->direction,
+                                p_text, i_length, &p_run->p_glyph_infos,
+                                &p_run->p_glyph_positions,
+                                &p_run->i_glyph_count ) )
+        {
+            i_total_glyphs += p_run->i_glyph_count;
+            continue;
+        }
+
         p_run->p_hb_font = hb_ft_font_create( p_face, 0 );
         if( !p_run->p_hb_font )
         {
@@ -714,15 +732,9 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         hb_buffer_set_direction( p_run->p_buffer, p_run->direction );
         hb_buffer_set_script( p_run->p_buffer, p_run->script );
 #ifdef __OS2__
-        hb_buffer_add_utf16( p_run->p_buffer,
-                             p_paragraph->p_code_points + p_run->i_start_offset,
-                             p_run->i_end_offset - p_run->i_start_offset, 0,
-                             p_run->i_end_offset - p_run->i_start_offset );
+        hb_buffer_add_utf16( p_run->p_buffer, p_text, i_length, 0, i_length );
 #else
-        hb_buffer_add_utf32( p_run->p_buffer,
-                             p_paragraph->p_code_points + p_run->i_start_offset,
-                             p_run->i_end_offset - p_run->i_start_offset, 0,
-                             p_run->i_end_offset - p_run->i_start_offset );
+        hb_buffer_add_utf32( p_run->p_buffer, p_text, i_length, 0, i_length );
 #endif
         hb_shape( p_run->p_hb_font, p_run->p_buffer, 0, 0 );
         p_run->p_glyph_infos =
@@ -737,6 +749,13 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             goto error;
         }
 
+        if( p_sys->p_glyph_cache )
+            glyph_cache_PutRun( p_sys->p_glyph_cache, p_face,
+                                p_run->script, p_run->direction,
+                                p_text, i_length, p_run->p_glyph_infos,
+                                p_run->p_glyph_positions,
+                                p_run->i_glyph_count );
+
         i_total_glyphs += p_run->i_glyph_count;
     }
 
@@ -800,8 +819,10 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
 
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
-        hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
-        hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        if( p_paragraph->p_runs[ i ].p_hb_font )
+            hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
+        if( p_paragraph->p_runs[ i ].p_buffer )
+            hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
     }
     FreeParagraph( *p_old_paragraph );
     *p_old_paragraph = p_new_paragraph;
@@ -955,12 +976,21 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        int i_glyph_flags = 0;
+        if( ( p_style->i_style_flags & STYLE_BOLD )
+              && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
+            i_glyph_flags |= GLYPH_CACHE_EMBOLDEN;
+        if( ( p_style->i_style_flags & STYLE_ITALIC )
+              && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
+            i_glyph_flags |= GLYPH_CACHE_OBLIQUE;
+
+        int i_radius = 0;
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
             double f_outline_thickness =
                 var_InheritInteger( p_filter, "freetype-outline-thickness" ) / 100.0;
             f_outline_thickness = VLC_CLIP( f_outline_thickness, 0.0, 0.5 );
-            int i_radius = ( i_live_size << 6 ) * f_outline_thickness;
+            i_radius = ( i_live_size << 6 ) * f_outline_thickness;
             FT_Stroker_Set( p_sys->p_stroker,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
@@ -1017,29 +1047,64 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
+            p_bitmaps->key = (glyph_cache_key_t) {
+                .p_face = p_face,
+                .i_index = i_glyph_index,
+                .i_flags = i_glyph_flags,
+            };
 
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
+            FT_Vector advance;
+            p_bitmaps->p_glyph = 0;
+            if( p_sys->p_glyph_cache )
+                p_bitmaps->p_glyph = glyph_cache_GetGlyph( p_sys->p_glyph_cache,
+                                                           &p_bitmaps->key,
+                                                           &advance );
+            if( !p_bitmaps->p_glyph )
+            {
+                if( FT_Load_Glyph( p_face, i_glyph_index,
+                                   FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+                 && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
-                SKIP_GLYPH( p_bitmaps )
+                if( i_glyph_flags & GLYPH_CACHE_EMBOLDEN )
+                    FT_GlyphSlot_Embolden( p_face->glyph );
+                if( i_glyph_flags & GLYPH_CACHE_OBLIQUE )
+                    FT_GlyphSlot_Oblique( p_face->glyph );
+
+                if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+                    SKIP_GLYPH( p_bitmaps )
+
+                advance = p_face->glyph->advance;
+                if( p_sys->p_glyph_cache )
+                    glyph_cache_PutGlyph( p_sys->p_glyph_cache, &p_bitmaps->key,
+                                          p_bitmaps->p_glyph, &advance );
+            }
 
 #undef SKIP_GLYPH
 
+            p_bitmaps->p_outline = 0;
+            p_bitmaps->p_shadow = 0;
+            p_bitmaps->i_outline_radius = i_radius;
             if( p_filter->p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
             {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
-                                           p_filter->p_sys->p_stroker, 0, 0 ) )
-                    p_bitmaps->p_outline = 0;
+                glyph_cache_key_t outline_key = p_bitmaps->key;
+                outline_key.i_flags |= GLYPH_CACHE_STROKED;
+                outline_key.i_radius = i_radius;
+
+                if( p_sys->p_glyph_cache )
+                    p_bitmaps->p_outline =
+                        glyph_cache_GetGlyph( p_sys->p_glyph_cache,
+                                              &outline_key, NULL );
+                if( !p_bitmaps->p_outline )
+                {
+                    p_bitmaps->p_outline = p_bitmaps->p_glyph;
+                    if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
+                                               p_filter->p_sys->p_stroker, 0, 0 ) )
+                        p_bitmaps->p_outline = 0;
+                    else if( p_sys->p_glyph_cache )
+                        glyph_cache_PutGlyph( p_sys->p_glyph_cache, &outline_key,
+                                              p_bitmaps->p_outline, NULL );
+                }
             }
 
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
@@ -1048,8 +1113,8 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = advance.x;
+                p_bitmaps->i_y_advance = advance.y;
             }
         }
 
@@ -1060,6 +1125,48 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
     return VLC_SUCCESS;
 }
 
+/**
+ * Same as FT_Glyph_To_Bitmap() in normal render mode. Outlines are rendered
+ * at the subpixel part of the origin, kept in the glyph cache, and moved to
+ * the integer part of the origin.
+ */
+static FT_Error GlyphToBitmap( glyph_cache_t *p_cache,
+                               const glyph_cache_key_t *p_key,
+                               FT_Glyph *pp_glyph, FT_Vector *p_origin,
+                               bool b_destroy )
+{
+    if( !p_cache || (*pp_glyph)->format != FT_GLYPH_FORMAT_OUTLINE )
+        return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                   p_origin, b_destroy );
+
+    glyph_cache_key_t key = *p_key;
+    key.i_flags |= GLYPH_CACHE_BITMAP;
+    key.i_subpixel_x = p_origin->x & 63;
+    key.i_subpixel_y = p_origin->y & 63;
+
+    FT_Glyph p_bitmap = glyph_cache_GetGlyph( p_cache, &key, NULL );
+    if( !p_bitmap )
+    {
+        FT_Vector subpixel = { .x = key.i_subpixel_x, .y = key.i_subpixel_y };
+        FT_Error error;
+
+        p_bitmap = *pp_glyph;
+        error = FT_Glyph_To_Bitmap( &p_bitmap, FT_RENDER_MODE_NORMAL,
+                                    &subpixel, 0 );
+        if( error )
+            return error;
+        glyph_cache_PutGlyph( p_cache, &key, p_bitmap, NULL );
+    }
+
+    ((FT_BitmapGlyph) p_bitmap)->left += p_origin->x >> 6;
+    ((FT_BitmapGlyph) p_bitmap)->top += p_origin->y >> 6;
+
+    if( b_destroy )
+        FT_Done_Glyph( *pp_glyph );
+    *pp_glyph = p_bitmap;
+    return 0;
+}
+
 static int LayoutLine( filter_t *p_filter,
                        paragraph_t *p_paragraph,
                        int i_first_char, int i_last_char,
@@ -1150,10 +1257,16 @@ static int LayoutLine( filter_t *p_filter,
             .y = pen_new.y + p_sys->f_shadow_vector_y * ( i_font_size << 6 )
         };
 
+        glyph_cache_key_t outline_key = p_bitmaps->key;
+        outline_key.i_flags |= GLYPH_CACHE_STROKED;
+        outline_key.i_radius = p_bitmaps->i_outline_radius;
+
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            if( GlyphToBitmap( p_sys->p_glyph_cache,
+                               p_bitmaps->p_shadow == p_bitmaps->p_outline ?
+                               &outline_key : &p_bitmaps->key,
+                               &p_bitmaps->p_shadow, &pen_shadow, false ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1161,8 +1274,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( GlyphToBitmap( p_sys->p_glyph_cache, &p_bitmaps->key,
+                               &p_bitmaps->p_glyph, &pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1178,8 +1291,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( GlyphToBitmap( p_sys->p_glyph_cache, &outline_key,
+                               &p_bitmaps->p_outline, &pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
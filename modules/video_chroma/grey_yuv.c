@@ -34,6 +34,12 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 
+#if defined(HAVE_AVX2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <immintrin.h>
+# include <vlc_cpu.h>
+# define GREY_AVX2 __attribute__((__target__("avx2")))
+#endif
+
 #define SRC_FOURCC  "GREY"
 #define DEST_FOURCC "I420,YUY2"
 
@@ -48,13 +54,25 @@ static void GREY_YUY2( filter_t *, picture_t *, picture_t * );
 static picture_t *GREY_I420_Filter( filter_t *, picture_t * );
 static picture_t *GREY_YUY2_Filter( filter_t *, picture_t * );
 
+#ifdef GREY_AVX2
+static int  ActivateAVX2 ( vlc_object_t * );
+#endif
+
 /*****************************************************************************
  * Module descriptor.
  *****************************************************************************/
 vlc_module_begin ()
     set_description( N_("Conversions from " SRC_FOURCC " to " DEST_FOURCC) )
+    add_shortcut( "grey_yuv_c" )
     set_capability( "video converter", 80 )
     set_callbacks( Activate, NULL )
+#ifdef GREY_AVX2
+    add_submodule ()
+    set_description( N_("AVX2 conversions from " SRC_FOURCC " to YUY2") )
+    add_shortcut( "grey_yuv_avx2" )
+    set_capability( "video converter", 90 )
+    set_callbacks( ActivateAVX2, NULL )
+#endif
 vlc_module_end ()
 
 /*****************************************************************************
@@ -195,3 +213,61 @@ static void GREY_YUY2( filter_t *p_filter, picture_t *p_source,
     }
 }
 
+#ifdef GREY_AVX2
+/*****************************************************************************
+ * GREY_YUY2_AVX2: 8-bit grayscale to packed YUY2, 32 pixels at a time
+ *****************************************************************************/
+GREY_AVX2
+static void GREY_YUY2_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                picture_t *p_dest )
+{
+    uint8_t *p_in = p_source->p->p_pixels;
+    uint8_t *p_out = p_dest->p->p_pixels;
+
+    const unsigned i_width = p_filter->fmt_out.video.i_width;
+    const int i_source_margin = p_source->p->i_pitch
+                                 - p_source->p->i_visible_pitch;
+    const int i_dest_margin = p_dest->p->i_pitch
+                               - p_dest->p->i_visible_pitch;
+    const __m256i chroma = _mm256_set1_epi8( 0x80 );
+
+    for( unsigned i_y = p_filter->fmt_out.video.i_height; i_y-- ; )
+    {
+        unsigned i_x = 0;
+
+        for( ; i_x + 32 <= i_width; i_x += 32 )
+        {
+            __m256i y = _mm256_loadu_si256( (const __m256i *)&p_in[i_x] );
+            /* Y0..Y7 Y16..Y23 | Y8..Y15 Y24..Y31 */
+            y = _mm256_permute4x64_epi64( y, 0xd8 );
+            _mm256_storeu_si256( (__m256i *)&p_out[2 * i_x],
+                                 _mm256_unpacklo_epi8( y, chroma ) );
+            _mm256_storeu_si256( (__m256i *)&p_out[2 * i_x + 32],
+                                 _mm256_unpackhi_epi8( y, chroma ) );
+        }
+        for( ; i_x + 1 < i_width; i_x += 2 )
+        {
+            p_out[2 * i_x]     = p_in[i_x];     p_out[2 * i_x + 1] = 0x80;
+            p_out[2 * i_x + 2] = p_in[i_x + 1]; p_out[2 * i_x + 3] = 0x80;
+        }
+
+        p_in += i_x + i_source_margin;
+        p_out += 2 * i_x + i_dest_margin;
+    }
+}
+
+VIDEO_FILTER_WRAPPER( GREY_YUY2_AVX2 )
+
+static int ActivateAVX2( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    if( !vlc_CPU_AVX2()
+     || p_filter->fmt_out.video.i_chroma != VLC_CODEC_YUYV
+     || Activate( p_this ) )
+        return VLC_EGENERIC;
+
+    p_filter->pf_video_filter = GREY_YUY2_AVX2_Filter;
+    return VLC_SUCCESS;
+}
+#endif
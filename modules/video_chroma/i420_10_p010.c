@@ -34,6 +34,12 @@
 #include <vlc_picture.h>
 #include "copy.h"
 
+#if defined(HAVE_AVX2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <immintrin.h>
+# include <vlc_cpu.h>
+# define P010_AVX2 __attribute__((__target__("avx2")))
+#endif
+
 /*****************************************************************************
  * Local and extern prototypes.
  *****************************************************************************/
@@ -98,6 +104,23 @@ static void Delete(vlc_object_t *p_this)
 /* Following functions are local */
 VIDEO_FILTER_WRAPPER( I420_10_P010 )
 
+#ifdef P010_AVX2
+static picture_t *I420_10_P010_AVX2_Filter( filter_t *, picture_t * );
+
+static int CreateAVX2( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    if( !vlc_CPU_AVX2() )
+        return VLC_EGENERIC;
+
+    int i_ret = Create( p_this );
+    if( i_ret == VLC_SUCCESS )
+        p_filter->pf_video_filter = I420_10_P010_AVX2_Filter;
+    return i_ret;
+}
+#endif
+
 /*****************************************************************************
  * planar I420 4:2:0 10-bit Y:U:V to semiplanar P010 10/16-bit 4:2:0 Y:UV
  *****************************************************************************/
@@ -124,11 +147,94 @@ static void I420_10_P010( filter_t *p_filter, picture_t *p_src,
                         &p_filter->p_sys->cache );
 }
 
+#ifdef P010_AVX2
+/*****************************************************************************
+ * Same as CopyFromI420_10ToP010(), 16 samples at a time: whole source
+ * pitches are converted
+ *****************************************************************************/
+P010_AVX2
+static void I420_10_P010_AVX2( filter_t *p_filter, picture_t *p_src,
+                                                   picture_t *p_dst )
+{
+    (void) p_filter;
+    p_dst->format.i_x_offset = p_src->format.i_x_offset;
+    p_dst->format.i_y_offset = p_src->format.i_y_offset;
+
+    const unsigned i_height = p_src->format.i_y_offset
+                            + p_src->format.i_visible_height;
+    const plane_t *p_y = &p_src->p[Y_PLANE];
+    const plane_t *p_u = &p_src->p[U_PLANE];
+    const plane_t *p_v = &p_src->p[V_PLANE];
+
+    const unsigned i_width = p_y->i_pitch / 2;
+    for( unsigned y = 0; y < i_height; y++ )
+    {
+        const uint16_t *src = (const uint16_t *)
+                              &p_y->p_pixels[y * p_y->i_pitch];
+        uint16_t *dst = (uint16_t *)
+                        &p_dst->p[0].p_pixels[y * p_dst->p[0].i_pitch];
+        unsigned x = 0;
+
+        for( ; x + 16 <= i_width; x += 16 )
+        {
+            __m256i l = _mm256_loadu_si256( (const __m256i *)&src[x] );
+            _mm256_storeu_si256( (__m256i *)&dst[x],
+                                 _mm256_slli_epi16( l, 6 ) );
+        }
+        for( ; x < i_width; x++ )
+            dst[x] = src[x] << 6;
+    }
+
+    const unsigned i_width_c = p_u->i_pitch / 2;
+    for( unsigned y = 0; y < i_height / 2; y++ )
+    {
+        const uint16_t *src_u = (const uint16_t *)
+                                &p_u->p_pixels[y * p_u->i_pitch];
+        const uint16_t *src_v = (const uint16_t *)
+                                &p_v->p_pixels[y * p_v->i_pitch];
+        uint16_t *dst = (uint16_t *)
+                        &p_dst->p[1].p_pixels[y * p_dst->p[1].i_pitch];
+        unsigned x = 0;
+
+        for( ; x + 16 <= i_width_c; x += 16 )
+        {
+            __m256i u = _mm256_slli_epi16(
+                _mm256_loadu_si256( (const __m256i *)&src_u[x] ), 6 );
+            __m256i v = _mm256_slli_epi16(
+                _mm256_loadu_si256( (const __m256i *)&src_v[x] ), 6 );
+            /* lo: UV0..UV3 | UV8..UV11, hi: UV4..UV7 | UV12..UV15 */
+            __m256i lo = _mm256_unpacklo_epi16( u, v );
+            __m256i hi = _mm256_unpackhi_epi16( u, v );
+
+            _mm256_storeu_si256( (__m256i *)&dst[2 * x],
+                                 _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+            _mm256_storeu_si256( (__m256i *)&dst[2 * x + 16],
+                                 _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+        }
+        for( ; x < i_width_c; x++ )
+        {
+            dst[2 * x]     = src_u[x] << 6;
+            dst[2 * x + 1] = src_v[x] << 6;
+        }
+    }
+}
+
+VIDEO_FILTER_WRAPPER( I420_10_P010_AVX2 )
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 vlc_module_begin ()
     set_description( N_("YUV 10-bits planar to semiplanar 10-bits conversions") )
+    add_shortcut( "i420_10_p010_c" )
     set_capability( "video converter", 160 )
     set_callbacks( Create, Delete )
+#ifdef P010_AVX2
+    add_submodule ()
+    set_description( N_("AVX2 YUV 10-bits planar to semiplanar 10-bits conversions") )
+    add_shortcut( "i420_10_p010_avx2" )
+    set_capability( "video converter", 170 )
+    set_callbacks( CreateAVX2, Delete )
+#endif
 vlc_module_end ()
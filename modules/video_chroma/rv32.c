@@ -33,19 +33,37 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 
+#if defined(HAVE_AVX2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <immintrin.h>
+# include <vlc_cpu.h>
+# define RV32_AVX2 __attribute__((__target__("avx2")))
+#endif
+
 /****************************************************************************
  * Local prototypes
  ****************************************************************************/
 static int  OpenFilter ( vlc_object_t * );
 static picture_t *Filter( filter_t *, picture_t * );
+#ifdef RV32_AVX2
+static int  OpenFilterAVX2 ( vlc_object_t * );
+static picture_t *FilterAVX2( filter_t *, picture_t * );
+#endif
 
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 vlc_module_begin ()
     set_description( N_("RV32 conversion filter") )
+    add_shortcut( "rv32_c" )
     set_capability( "video converter", 1 )
     set_callbacks( OpenFilter, NULL )
+#ifdef RV32_AVX2
+    add_submodule ()
+    set_description( N_("AVX2 RV32 conversion filter") )
+    add_shortcut( "rv32_avx2" )
+    set_capability( "video converter", 2 )
+    set_callbacks( OpenFilterAVX2, NULL )
+#endif
 vlc_module_end ()
 
 /*****************************************************************************
@@ -118,3 +136,80 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     return p_pic_dst;
 }
 
+#ifdef RV32_AVX2
+static int OpenFilterAVX2( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+
+    if( !vlc_CPU_AVX2() || OpenFilter( p_this ) )
+        return VLC_EGENERIC;
+
+    p_filter->pf_video_filter = FilterAVX2;
+    return VLC_SUCCESS;
+}
+
+/****************************************************************************
+ * RV24ToRV32Row_AVX2: converts 16 pixels per iteration, each 128-bit lane
+ * taking 4 of them from a 16 bytes load
+ ****************************************************************************/
+RV32_AVX2
+static void RV24ToRV32Row_AVX2( uint8_t *p_dst, const uint8_t *p_src,
+                                unsigned i_width )
+{
+    const __m256i shuffle = _mm256_setr_epi8(
+        2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+        2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1 );
+    const __m256i alpha = _mm256_set1_epi32( 0xff000000 );
+    unsigned j = 0;
+
+    /* The last load reads 4 bytes past the 16 pixels */
+    for( ; j + 18 <= i_width; j += 16 )
+    {
+        const uint8_t *p = &p_src[3 * j];
+        __m256i a = _mm256_inserti128_si256( _mm256_castsi128_si256(
+                        _mm_loadu_si128( (const __m128i *)&p[0] ) ),
+                        _mm_loadu_si128( (const __m128i *)&p[12] ), 1 );
+        __m256i b = _mm256_inserti128_si256( _mm256_castsi128_si256(
+                        _mm_loadu_si128( (const __m128i *)&p[24] ) ),
+                        _mm_loadu_si128( (const __m128i *)&p[36] ), 1 );
+
+        _mm256_storeu_si256( (__m256i *)&p_dst[4 * j],
+                    _mm256_or_si256( _mm256_shuffle_epi8( a, shuffle ), alpha ) );
+        _mm256_storeu_si256( (__m256i *)&p_dst[4 * j + 32],
+                    _mm256_or_si256( _mm256_shuffle_epi8( b, shuffle ), alpha ) );
+    }
+    for( ; j < i_width; j++ )
+    {
+        p_dst[4 * j]     = p_src[3 * j + 2];
+        p_dst[4 * j + 1] = p_src[3 * j + 1];
+        p_dst[4 * j + 2] = p_src[3 * j];
+        p_dst[4 * j + 3] = 0xff;  /* Alpha */
+    }
+}
+
+static picture_t *FilterAVX2( filter_t *p_filter, picture_t *p_pic )
+{
+    picture_t *p_pic_dst = filter_NewPicture( p_filter );
+    if( !p_pic_dst )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    for( int i_plane = 0; i_plane < p_pic_dst->i_planes; i_plane++ )
+    {
+        const plane_t *p_src = &p_pic->p[i_plane];
+        const plane_t *p_dst = &p_pic_dst->p[i_plane];
+
+        for( int i = 0; i < p_dst->i_lines; i++ )
+            RV24ToRV32Row_AVX2( &p_dst->p_pixels[i * p_dst->i_pitch],
+                                &p_src->p_pixels[i * p_src->i_pitch],
+                                p_filter->fmt_out.video.i_width );
+    }
+
+    picture_CopyProperties( p_pic_dst, p_pic );
+    picture_Release( p_pic );
+
+    return p_pic_dst;
+}
+#endif
@@ -0,0 +1,105 @@
+/*****************************************************************************
+ * yuy2_avx2.h : AVX2 packed YUV 4:2:2 to planar YUV rows
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Shared by yuy2_i420 and yuy2_i422. The code is compiled with a target
+ * attribute, so callers must check vlc_CPU_AVX2() first. */
+
+#if defined(HAVE_AVX2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <immintrin.h>
+# include <vlc_cpu.h>
+# define YUY2_AVX2 __attribute__((__target__("avx2")))
+
+/* Byte offsets of the first Y, U and V samples of a macropixel, and the
+ * shuffle of 8 pixels to Y0..Y7 U0..U3 V0..V3 */
+typedef struct
+{
+    vlc_fourcc_t i_chroma;
+    uint8_t      i_y, i_u, i_v;
+    int8_t       shuffle[16];
+} yuv422_order_t;
+
+static const yuv422_order_t yuv422_orders[] =
+{
+    { VLC_CODEC_YUYV, 0, 1, 3,
+      { 0, 2, 4, 6, 8, 10, 12, 14, 1, 5, 9, 13, 3, 7, 11, 15 } },
+    { VLC_CODEC_YVYU, 0, 3, 1,
+      { 0, 2, 4, 6, 8, 10, 12, 14, 3, 7, 11, 15, 1, 5, 9, 13 } },
+    { VLC_CODEC_UYVY, 1, 0, 2,
+      { 1, 3, 5, 7, 9, 11, 13, 15, 0, 4, 8, 12, 2, 6, 10, 14 } },
+};
+
+static inline const yuv422_order_t *Yuv422Order( vlc_fourcc_t i_chroma )
+{
+    for( size_t i = 0; i < ARRAY_SIZE(yuv422_orders); i++ )
+        if( yuv422_orders[i].i_chroma == i_chroma )
+            return &yuv422_orders[i];
+    return NULL;
+}
+
+/*****************************************************************************
+ * Yuv422SplitRow_AVX2: splits a row of i_width pixels, i_width being even.
+ * Chroma is skipped if p_u is NULL.
+ *****************************************************************************/
+YUY2_AVX2
+static void Yuv422SplitRow_AVX2( uint8_t *p_y, uint8_t *p_u, uint8_t *p_v,
+                                 const uint8_t *p_line, unsigned i_width,
+                                 const yuv422_order_t *p_order )
+{
+    const __m256i shuffle = _mm256_broadcastsi128_si256(
+                    _mm_loadu_si128( (const __m128i *)p_order->shuffle ) );
+    const __m256i split = _mm256_setr_epi32( 0, 2, 4, 6, 1, 3, 5, 7 );
+    unsigned i_x = 0;
+
+    for( ; i_x + 32 <= i_width; i_x += 32 )
+    {
+        __m256i a = _mm256_loadu_si256( (const __m256i *)&p_line[2 * i_x] );
+        __m256i b = _mm256_loadu_si256( (const __m256i *)&p_line[2 * i_x + 32] );
+
+        /* Y0..Y15 | U0..U3 V0..V3 U4..U7 V4..V7 */
+        a = _mm256_permute4x64_epi64( _mm256_shuffle_epi8( a, shuffle ), 0xd8 );
+        b = _mm256_permute4x64_epi64( _mm256_shuffle_epi8( b, shuffle ), 0xd8 );
+
+        _mm256_storeu_si256( (__m256i *)&p_y[i_x],
+                             _mm256_permute2x128_si256( a, b, 0x20 ) );
+        if( p_u != NULL )
+        {
+            __m256i uv = _mm256_permutevar8x32_epi32(
+                            _mm256_permute2x128_si256( a, b, 0x31 ), split );
+            _mm_storeu_si128( (__m128i *)&p_u[i_x / 2],
+                              _mm256_castsi256_si128( uv ) );
+            _mm_storeu_si128( (__m128i *)&p_v[i_x / 2],
+                              _mm256_extracti128_si256( uv, 1 ) );
+        }
+    }
+
+    for( ; i_x < i_width; i_x += 2 )
+    {
+        const uint8_t *p = &p_line[2 * i_x];
+
+        p_y[i_x]     = p[p_order->i_y];
+        p_y[i_x + 1] = p[p_order->i_y + 2];
+        if( p_u != NULL )
+        {
+            p_u[i_x / 2] = p[p_order->i_u];
+            p_v[i_x / 2] = p[p_order->i_v];
+        }
+    }
+}
+#endif
@@ -34,6 +34,8 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 
+#include "yuy2_avx2.h"
+
 #define SRC_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422"
 #define DEST_FOURCC  "I422"
 
@@ -49,13 +51,25 @@ static picture_t *YUY2_I422_Filter    ( filter_t *, picture_t * );
 static picture_t *YVYU_I422_Filter    ( filter_t *, picture_t * );
 static picture_t *UYVY_I422_Filter    ( filter_t *, picture_t * );
 
+#ifdef YUY2_AVX2
+static int  ActivateAVX2 ( vlc_object_t * );
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 vlc_module_begin ()
     set_description( N_("Conversions from " SRC_FOURCC " to " DEST_FOURCC) )
+    add_shortcut( "yuy2_i422_c" )
     set_capability( "video converter", 80 )
     set_callbacks( Activate, NULL )
+#ifdef YUY2_AVX2
+    add_submodule ()
+    set_description( N_("AVX2 conversions from " SRC_FOURCC " to " DEST_FOURCC) )
+    add_shortcut( "yuy2_i422_avx2" )
+    set_capability( "video converter", 90 )
+    set_callbacks( ActivateAVX2, NULL )
+#endif
 vlc_module_end ()
 
 /*****************************************************************************
@@ -243,3 +257,51 @@ static void UYVY_I422( filter_t *p_filter, picture_t *p_source,
         p_v += i_dest_margin_c;
     }
 }
+
+#ifdef YUY2_AVX2
+/*****************************************************************************
+ * YUV422_I422_AVX2: any packed 4:2:2 to planar YUV 4:2:2
+ *****************************************************************************/
+static void YUV422_I422_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                  picture_t *p_dest )
+{
+    const yuv422_order_t *p_order =
+        Yuv422Order( p_filter->fmt_in.video.i_chroma );
+
+    uint8_t *p_line = p_source->p->p_pixels;
+
+    uint8_t *p_y = p_dest->Y_PIXELS;
+    uint8_t *p_u = p_dest->U_PIXELS;
+    uint8_t *p_v = p_dest->V_PIXELS;
+
+    const unsigned i_width = p_filter->fmt_out.video.i_width;
+    const int i_dest_margin = p_dest->p[0].i_pitch
+                                 - p_dest->p[0].i_visible_pitch;
+    const int i_dest_margin_c = p_dest->p[1].i_pitch
+                                 - p_dest->p[1].i_visible_pitch;
+    const int i_source_margin = p_source->p->i_pitch
+                               - p_source->p->i_visible_pitch;
+
+    for( unsigned i_y = p_filter->fmt_out.video.i_height; i_y-- ; )
+    {
+        Yuv422SplitRow_AVX2( p_y, p_u, p_v, p_line, i_width, p_order );
+        p_line += 2 * i_width + i_source_margin;
+        p_y += i_width + i_dest_margin;
+        p_u += i_width / 2 + i_dest_margin_c;
+        p_v += i_width / 2 + i_dest_margin_c;
+    }
+}
+
+VIDEO_FILTER_WRAPPER( YUV422_I422_AVX2 )
+
+static int ActivateAVX2( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    if( !vlc_CPU_AVX2() || Activate( p_this ) )
+        return VLC_EGENERIC;
+
+    p_filter->pf_video_filter = YUV422_I422_AVX2_Filter;
+    return VLC_SUCCESS;
+}
+#endif
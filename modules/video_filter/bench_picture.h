@@ -0,0 +1,85 @@
+/*****************************************************************************
+ * bench_picture.h: test pictures for the benchmark filters
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_BENCH_PICTURE_H
+#define VLC_BENCH_PICTURE_H
+
+#include <vlc_picture.h>
+
+/**
+ * Allocates a picture filled with pseudo-random pixels.
+ *
+ * The same seed gives the same pixels, so that every run processes the same
+ * data. The margins are filled too, as some routines read whole pitches.
+ */
+static inline picture_t *bench_NewPicture( vlc_fourcc_t i_chroma,
+                                           unsigned i_width, unsigned i_height,
+                                           uint32_t i_seed )
+{
+    video_format_t fmt;
+
+    video_format_Init( &fmt, i_chroma );
+    video_format_Setup( &fmt, i_chroma, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    if( p_pic == NULL )
+        return NULL;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+            {
+                i_seed = i_seed * 1664525 + 1013904223;
+                p->p_pixels[y * p->i_pitch + x] = i_seed >> 24;
+            }
+    }
+    return p_pic;
+}
+
+/**
+ * Compares the visible pixels of two pictures of the same format.
+ *
+ * \param pi_plane, pi_line first differing line, if any
+ */
+static inline bool bench_ComparePictures( const picture_t *p_expected,
+                                          const picture_t *p_result,
+                                          int *pi_plane, int *pi_line )
+{
+    for( int i = 0; i < p_expected->i_planes; i++ )
+    {
+        const plane_t *p_exp = &p_expected->p[i], *p_res = &p_result->p[i];
+
+        for( int y = 0; y < p_exp->i_visible_lines; y++ )
+            if( memcmp( &p_exp->p_pixels[y * p_exp->i_pitch],
+                        &p_res->p_pixels[y * p_res->i_pitch],
+                        p_exp->i_visible_pitch ) )
+            {
+                *pi_plane = i;
+                *pi_line = y;
+                return false;
+            }
+    }
+    return true;
+}
+
+#endif
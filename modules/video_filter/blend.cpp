@@ -32,18 +32,49 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <emmintrin.h>
+# define BLEND_SSE2 __attribute__((__target__("sse2")))
+#endif
+#if defined(HAVE_AVX2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <immintrin.h>
+# define BLEND_AVX2 __attribute__((__target__("avx2")))
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 static int  Open (vlc_object_t *);
 static void Close(vlc_object_t *);
+#ifdef BLEND_SSE2
+static int  OpenSSE2(vlc_object_t *);
+#endif
+#ifdef BLEND_AVX2
+static int  OpenAVX2(vlc_object_t *);
+#endif
 
 vlc_module_begin()
     set_description(N_("Video pictures blending"))
+    add_shortcut("blend_c")
     set_capability("video blending", 100)
     set_callbacks(Open, Close)
+#ifdef BLEND_SSE2
+    add_submodule()
+    set_description(N_("SSE2 video pictures blending"))
+    add_shortcut("blend_sse2")
+    set_capability("video blending", 110)
+    set_callbacks(OpenSSE2, Close)
+#endif
+#ifdef BLEND_AVX2
+    add_submodule()
+    set_description(N_("AVX2 video pictures blending"))
+    add_shortcut("blend_avx2")
+    set_capability("video blending", 120)
+    set_callbacks(OpenAVX2, Close)
+#endif
 vlc_module_end()
 
 static inline unsigned div255(unsigned v)
@@ -79,6 +110,18 @@ public:
     {
         return fmt;
     }
+    const picture_t *getPicture() const
+    {
+        return picture;
+    }
+    unsigned getX() const
+    {
+        return x;
+    }
+    unsigned getY() const
+    {
+        return y;
+    }
     bool isFull(unsigned) const
     {
         return true;
@@ -551,6 +594,397 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
 typedef void (*blend_function_t)(const CPicture &dst_data, const CPicture &src_data,
                                  unsigned width, unsigned height, int alpha);
 
+/*
+ * Span blending
+ *
+ * The most common combinations (subtitles and logos onto the usual decoder
+ * and encoder formats) are blended a row at a time by span kernels, which
+ * give exactly the same results as the per pixel code above.
+ *
+ * Chroma spans read every other source sample: the source must hold
+ * 2 * count - 1 samples.
+ */
+struct SpanC {
+    static void luma(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                     unsigned count, unsigned alpha)
+    {
+        for (unsigned i = 0; i < count; i++)
+            ::merge(&dst[i], src[i], div255(alpha * srca[i]));
+    }
+    static void chroma(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                       unsigned count, unsigned alpha)
+    {
+        for (unsigned i = 0; i < count; i++)
+            ::merge(&dst[i], src[2 * i], div255(alpha * srca[2 * i]));
+    }
+    static void chromaInterleaved(uint8_t *dst, const uint8_t *srcu,
+                                  const uint8_t *srcv, const uint8_t *srca,
+                                  unsigned count, unsigned alpha)
+    {
+        for (unsigned i = 0; i < count; i++) {
+            unsigned a = div255(alpha * srca[2 * i]);
+            ::merge(&dst[2 * i + 0], srcu[2 * i], a);
+            ::merge(&dst[2 * i + 1], srcv[2 * i], a);
+        }
+    }
+    static void rgbx(uint8_t *dst, const uint8_t *src, unsigned count,
+                     unsigned alpha, bool swap_rb)
+    {
+        for (unsigned i = 0; i < count; i++, dst += 4, src += 4) {
+            unsigned a = div255(alpha * src[3]);
+            ::merge(&dst[swap_rb ? 2 : 0], src[0], a);
+            ::merge(&dst[1],               src[1], a);
+            ::merge(&dst[swap_rb ? 0 : 2], src[2], a);
+        }
+    }
+};
+
+#ifdef BLEND_SSE2
+struct SpanSSE2 {
+    /* All the computations fit in unsigned 16 bits lanes */
+    BLEND_SSE2 static inline __m128i div255(__m128i v)
+    {
+        v = _mm_add_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)),
+                          _mm_set1_epi16(1));
+        return _mm_srli_epi16(v, 8);
+    }
+    BLEND_SSE2 static inline __m128i merge(__m128i d, __m128i s, __m128i a)
+    {
+        __m128i na = _mm_sub_epi16(_mm_set1_epi16(255), a);
+        return div255(_mm_add_epi16(_mm_mullo_epi16(d, na),
+                                    _mm_mullo_epi16(s, a)));
+    }
+    /* Blends 16 bytes with per byte factors */
+    BLEND_SSE2 static inline __m128i merge8(__m128i d, __m128i s, __m128i a)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i lo = merge(_mm_unpacklo_epi8(d, zero),
+                           _mm_unpacklo_epi8(s, zero),
+                           _mm_unpacklo_epi8(a, zero));
+        __m128i hi = merge(_mm_unpackhi_epi8(d, zero),
+                           _mm_unpackhi_epi8(s, zero),
+                           _mm_unpackhi_epi8(a, zero));
+        return _mm_packus_epi16(lo, hi);
+    }
+    /* Loads 8 even samples into 16 bits lanes */
+    BLEND_SSE2 static inline __m128i loadEven(const uint8_t *p)
+    {
+        return _mm_and_si128(_mm_loadu_si128((const __m128i *)p),
+                             _mm_set1_epi16(0xff));
+    }
+
+    BLEND_SSE2 static void luma(uint8_t *dst, const uint8_t *src,
+                                const uint8_t *srca, unsigned count,
+                                unsigned alpha)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i va = _mm_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+            __m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+            __m128i a = _mm_loadu_si128((const __m128i *)&srca[i]);
+
+            __m128i lo = merge(_mm_unpacklo_epi8(d, zero),
+                               _mm_unpacklo_epi8(s, zero),
+                               div255(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), va)));
+            __m128i hi = merge(_mm_unpackhi_epi8(d, zero),
+                               _mm_unpackhi_epi8(s, zero),
+                               div255(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), va)));
+            _mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(lo, hi));
+        }
+        SpanC::luma(&dst[i], &src[i], &srca[i], count - i, alpha);
+    }
+    BLEND_SSE2 static void chroma(uint8_t *dst, const uint8_t *src,
+                                  const uint8_t *srca, unsigned count,
+                                  unsigned alpha)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i va = _mm_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 16 < count; i += 16) {
+            __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+
+            __m128i lo = merge(_mm_unpacklo_epi8(d, zero),
+                               loadEven(&src[2 * i]),
+                               div255(_mm_mullo_epi16(loadEven(&srca[2 * i]), va)));
+            __m128i hi = merge(_mm_unpackhi_epi8(d, zero),
+                               loadEven(&src[2 * i + 16]),
+                               div255(_mm_mullo_epi16(loadEven(&srca[2 * i + 16]), va)));
+            _mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(lo, hi));
+        }
+        SpanC::chroma(&dst[i], &src[2 * i], &srca[2 * i], count - i, alpha);
+    }
+    BLEND_SSE2 static void chromaInterleaved(uint8_t *dst, const uint8_t *srcu,
+                                             const uint8_t *srcv,
+                                             const uint8_t *srca,
+                                             unsigned count, unsigned alpha)
+    {
+        const __m128i va = _mm_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 8 < count; i += 8) {
+            __m128i s = _mm_or_si128(loadEven(&srcu[2 * i]),
+                                     _mm_slli_epi16(loadEven(&srcv[2 * i]), 8));
+            __m128i a = div255(_mm_mullo_epi16(loadEven(&srca[2 * i]), va));
+            a = _mm_or_si128(a, _mm_slli_epi16(a, 8));
+
+            __m128i d = _mm_loadu_si128((const __m128i *)&dst[2 * i]);
+            _mm_storeu_si128((__m128i *)&dst[2 * i], merge8(d, s, a));
+        }
+        SpanC::chromaInterleaved(&dst[2 * i], &srcu[2 * i], &srcv[2 * i],
+                                 &srca[2 * i], count - i, alpha);
+    }
+    BLEND_SSE2 static void rgbx(uint8_t *dst, const uint8_t *src,
+                                unsigned count, unsigned alpha, bool swap_rb)
+    {
+        const __m128i va = _mm_set1_epi16(alpha);
+        const __m128i g = _mm_set1_epi32(0xff00);
+        const __m128i rb = _mm_set1_epi32(0xff);
+        unsigned i = 0;
+
+        for (; i + 4 <= count; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i *)&src[4 * i]);
+
+            /* The 4th byte is left untouched with a null factor */
+            __m128i a = div255(_mm_mullo_epi16(_mm_srli_epi32(s, 24), va));
+            a = _mm_or_si128(a, _mm_or_si128(_mm_slli_epi32(a, 8),
+                                             _mm_slli_epi32(a, 16)));
+            if (swap_rb)
+                s = _mm_or_si128(_mm_and_si128(s, g),
+                        _mm_or_si128(_mm_and_si128(_mm_srli_epi32(s, 16), rb),
+                                     _mm_slli_epi32(_mm_and_si128(s, rb), 16)));
+
+            __m128i d = _mm_loadu_si128((const __m128i *)&dst[4 * i]);
+            _mm_storeu_si128((__m128i *)&dst[4 * i], merge8(d, s, a));
+        }
+        SpanC::rgbx(&dst[4 * i], &src[4 * i], count - i, alpha, swap_rb);
+    }
+};
+#endif
+
+#ifdef BLEND_AVX2
+struct SpanAVX2 {
+    BLEND_AVX2 static inline __m256i div255(__m256i v)
+    {
+        v = _mm256_add_epi16(_mm256_add_epi16(v, _mm256_srli_epi16(v, 8)),
+                             _mm256_set1_epi16(1));
+        return _mm256_srli_epi16(v, 8);
+    }
+    BLEND_AVX2 static inline __m256i merge(__m256i d, __m256i s, __m256i a)
+    {
+        __m256i na = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+        return div255(_mm256_add_epi16(_mm256_mullo_epi16(d, na),
+                                       _mm256_mullo_epi16(s, a)));
+    }
+    /* Unpacking and packing work within 128 bits lanes, and restore the
+     * order of the bytes */
+    BLEND_AVX2 static inline __m256i merge8(__m256i d, __m256i s, __m256i a)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i lo = merge(_mm256_unpacklo_epi8(d, zero),
+                           _mm256_unpacklo_epi8(s, zero),
+                           _mm256_unpacklo_epi8(a, zero));
+        __m256i hi = merge(_mm256_unpackhi_epi8(d, zero),
+                           _mm256_unpackhi_epi8(s, zero),
+                           _mm256_unpackhi_epi8(a, zero));
+        return _mm256_packus_epi16(lo, hi);
+    }
+    BLEND_AVX2 static inline __m256i loadEven(const uint8_t *p)
+    {
+        return _mm256_and_si256(_mm256_loadu_si256((const __m256i *)p),
+                                _mm256_set1_epi16(0xff));
+    }
+
+    BLEND_AVX2 static void luma(uint8_t *dst, const uint8_t *src,
+                                const uint8_t *srca, unsigned count,
+                                unsigned alpha)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i va = _mm256_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 32 <= count; i += 32) {
+            __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+            __m256i s = _mm256_loadu_si256((const __m256i *)&src[i]);
+            __m256i a = _mm256_loadu_si256((const __m256i *)&srca[i]);
+
+            __m256i lo = merge(_mm256_unpacklo_epi8(d, zero),
+                               _mm256_unpacklo_epi8(s, zero),
+                               div255(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), va)));
+            __m256i hi = merge(_mm256_unpackhi_epi8(d, zero),
+                               _mm256_unpackhi_epi8(s, zero),
+                               div255(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), va)));
+            _mm256_storeu_si256((__m256i *)&dst[i], _mm256_packus_epi16(lo, hi));
+        }
+        SpanC::luma(&dst[i], &src[i], &srca[i], count - i, alpha);
+    }
+    BLEND_AVX2 static void chroma(uint8_t *dst, const uint8_t *src,
+                                  const uint8_t *srca, unsigned count,
+                                  unsigned alpha)
+    {
+        const __m256i va = _mm256_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 32 < count; i += 32) {
+            __m256i lo = div255(_mm256_mullo_epi16(loadEven(&srca[2 * i]), va));
+            __m256i hi = div255(_mm256_mullo_epi16(loadEven(&srca[2 * i + 32]), va));
+            /* Packing interleaves the 128 bits lanes of both halves */
+            __m256i a = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi),
+                                                 _MM_SHUFFLE(3, 1, 2, 0));
+            __m256i s = _mm256_permute4x64_epi64(
+                            _mm256_packus_epi16(loadEven(&src[2 * i]),
+                                                loadEven(&src[2 * i + 32])),
+                            _MM_SHUFFLE(3, 1, 2, 0));
+
+            __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+            _mm256_storeu_si256((__m256i *)&dst[i], merge8(d, s, a));
+        }
+        SpanC::chroma(&dst[i], &src[2 * i], &srca[2 * i], count - i, alpha);
+    }
+    BLEND_AVX2 static void chromaInterleaved(uint8_t *dst, const uint8_t *srcu,
+                                             const uint8_t *srcv,
+                                             const uint8_t *srca,
+                                             unsigned count, unsigned alpha)
+    {
+        const __m256i va = _mm256_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 16 < count; i += 16) {
+            __m256i s = _mm256_or_si256(loadEven(&srcu[2 * i]),
+                                        _mm256_slli_epi16(loadEven(&srcv[2 * i]), 8));
+            __m256i a = div255(_mm256_mullo_epi16(loadEven(&srca[2 * i]), va));
+            a = _mm256_or_si256(a, _mm256_slli_epi16(a, 8));
+
+            __m256i d = _mm256_loadu_si256((const __m256i *)&dst[2 * i]);
+            _mm256_storeu_si256((__m256i *)&dst[2 * i], merge8(d, s, a));
+        }
+        SpanC::chromaInterleaved(&dst[2 * i], &srcu[2 * i], &srcv[2 * i],
+                                 &srca[2 * i], count - i, alpha);
+    }
+    BLEND_AVX2 static void rgbx(uint8_t *dst, const uint8_t *src,
+                                unsigned count, unsigned alpha, bool swap_rb)
+    {
+        const __m256i va = _mm256_set1_epi16(alpha);
+        const __m256i g = _mm256_set1_epi32(0xff00);
+        const __m256i rb = _mm256_set1_epi32(0xff);
+        unsigned i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+            __m256i s = _mm256_loadu_si256((const __m256i *)&src[4 * i]);
+
+            __m256i a = div255(_mm256_mullo_epi16(_mm256_srli_epi32(s, 24), va));
+            a = _mm256_or_si256(a, _mm256_or_si256(_mm256_slli_epi32(a, 8),
+                                                   _mm256_slli_epi32(a, 16)));
+            if (swap_rb)
+                s = _mm256_or_si256(_mm256_and_si256(s, g),
+                        _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(s, 16), rb),
+                                        _mm256_slli_epi32(_mm256_and_si256(s, rb), 16)));
+
+            __m256i d = _mm256_loadu_si256((const __m256i *)&dst[4 * i]);
+            _mm256_storeu_si256((__m256i *)&dst[4 * i], merge8(d, s, a));
+        }
+        SpanC::rgbx(&dst[4 * i], &src[4 * i], count - i, alpha, swap_rb);
+    }
+};
+#endif
+
+static inline const uint8_t *getPixels(const CPicture &data, unsigned plane,
+                                       unsigned x, unsigned y, unsigned bytes = 1)
+{
+    const plane_t *p = &data.getPicture()->p[plane];
+    return &p->p_pixels[y * p->i_pitch + x * bytes];
+}
+
+template <class TSpan, bool swap_uv, bool semiplanar>
+void BlendYUVAToYUV420(const CPicture &dst_data, const CPicture &src_data,
+                       unsigned width, unsigned height, int alpha)
+{
+    const unsigned dx = dst_data.getX(), dy = dst_data.getY();
+    const unsigned sx = src_data.getX(), sy = src_data.getY();
+    /* Chroma is blended from the source pixels at even destination columns */
+    const unsigned cx = dx % 2;
+    const unsigned cw = width > cx ? (width - cx + 1) / 2 : 0;
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *srcy = getPixels(src_data, Y_PLANE, sx, sy + y);
+        const uint8_t *srcu = getPixels(src_data, U_PLANE, sx + cx, sy + y);
+        const uint8_t *srcv = getPixels(src_data, V_PLANE, sx + cx, sy + y);
+        const uint8_t *srca = getPixels(src_data, A_PLANE, sx, sy + y);
+
+        TSpan::luma((uint8_t *)getPixels(dst_data, Y_PLANE, dx, dy + y),
+                    srcy, srca, width, alpha);
+
+        if (((dy + y) % 2) != 0 || cw == 0)
+            continue;
+        if (semiplanar) {
+            uint8_t *dstuv = (uint8_t *)getPixels(dst_data, 1, (dx + cx) / 2,
+                                                  (dy + y) / 2, 2);
+            TSpan::chromaInterleaved(dstuv, swap_uv ? srcv : srcu,
+                                     swap_uv ? srcu : srcv, &srca[cx],
+                                     cw, alpha);
+        } else {
+            TSpan::chroma((uint8_t *)getPixels(dst_data, swap_uv ? 2 : 1,
+                                               (dx + cx) / 2, (dy + y) / 2),
+                          srcu, &srca[cx], cw, alpha);
+            TSpan::chroma((uint8_t *)getPixels(dst_data, swap_uv ? 1 : 2,
+                                               (dx + cx) / 2, (dy + y) / 2),
+                          srcv, &srca[cx], cw, alpha);
+        }
+    }
+}
+
+template <class TSpan>
+void BlendRGBAToRGB32(const CPicture &dst_data, const CPicture &src_data,
+                      unsigned width, unsigned height, int alpha)
+{
+    const video_format_t *fmt = dst_data.getFormat();
+    bool swap_rb;
+
+#ifndef WORDS_BIGENDIAN
+    if (fmt->i_lrshift == 0 && fmt->i_lgshift == 8 && fmt->i_lbshift == 16)
+        swap_rb = false;
+    else if (fmt->i_lrshift == 16 && fmt->i_lgshift == 8 && fmt->i_lbshift == 0)
+        swap_rb = true;
+    else
+#endif
+    {
+        Blend<CPictureRGB32, CPictureRGBA, compose<convertNone, convertNone> >(
+            dst_data, src_data, width, height, alpha);
+        return;
+    }
+
+    for (unsigned y = 0; y < height; y++)
+        TSpan::rgbx((uint8_t *)getPixels(dst_data, 0, dst_data.getX(),
+                                         dst_data.getY() + y, 4),
+                    getPixels(src_data, 0, src_data.getX(),
+                              src_data.getY() + y, 4),
+                    width, alpha, swap_rb);
+}
+
+template <class TSpan>
+static blend_function_t GetSpanBlend(vlc_fourcc_t dst, vlc_fourcc_t src)
+{
+    if (src == VLC_CODEC_YUVA) {
+        switch (dst) {
+            case VLC_CODEC_I420:
+            case VLC_CODEC_J420:
+                return BlendYUVAToYUV420<TSpan, false, false>;
+            case VLC_CODEC_YV12:
+                return BlendYUVAToYUV420<TSpan, true, false>;
+            case VLC_CODEC_NV12:
+                return BlendYUVAToYUV420<TSpan, false, true>;
+            case VLC_CODEC_NV21:
+                return BlendYUVAToYUV420<TSpan, true, true>;
+        }
+    }
+    if (src == VLC_CODEC_RGBA && dst == VLC_CODEC_RGB32)
+        return BlendRGBAToRGB32<TSpan>;
+    return NULL;
+}
+
 static const struct {
     vlc_fourcc_t     dst;
     vlc_fourcc_t     src;
@@ -664,29 +1098,69 @@ static void Blend(filter_t *filter,
                width, height, alpha);
 }
 
+static int OpenBlend(filter_t *filter, blend_function_t blend)
+{
+    filter_sys_t *sys = new filter_sys_t();
+    sys->blend = blend;
+
+    filter->pf_video_blend = Blend;
+    filter->p_sys          = sys;
+    return VLC_SUCCESS;
+}
+
 static int Open(vlc_object_t *object)
 {
     filter_t *filter = (filter_t *)object;
     const vlc_fourcc_t src = filter->fmt_in.video.i_chroma;
     const vlc_fourcc_t dst = filter->fmt_out.video.i_chroma;
 
-    filter_sys_t *sys = new filter_sys_t();
+    blend_function_t blend = NULL;
     for (size_t i = 0; i < sizeof(blends) / sizeof(*blends); i++) {
         if (blends[i].src == src && blends[i].dst == dst)
-            sys->blend = blends[i].blend;
+            blend = blends[i].blend;
     }
 
-    if (!sys->blend) {
+    if (!blend) {
        msg_Err(filter, "no matching alpha blending routine (chroma: %4.4s -> %4.4s)",
                (char *)&src, (char *)&dst);
-        delete sys;
         return VLC_EGENERIC;
     }
+    return OpenBlend(filter, blend);
+}
 
-    filter->pf_video_blend = Blend;
-    filter->p_sys          = sys;
-    return VLC_SUCCESS;
+#ifdef BLEND_SSE2
+static int OpenSSE2(vlc_object_t *object)
+{
+    filter_t *filter = (filter_t *)object;
+
+    if (!vlc_CPU_SSE2())
+        return VLC_EGENERIC;
+
+    blend_function_t blend =
+        GetSpanBlend<SpanSSE2>(filter->fmt_out.video.i_chroma,
+                               filter->fmt_in.video.i_chroma);
+    if (!blend)
+        return VLC_EGENERIC;
+    return OpenBlend(filter, blend);
+}
+#endif
+
+#ifdef BLEND_AVX2
+static int OpenAVX2(vlc_object_t *object)
+{
+    filter_t *filter = (filter_t *)object;
+
+    if (!vlc_CPU_AVX2())
+        return VLC_EGENERIC;
+
+    blend_function_t blend =
+        GetSpanBlend<SpanAVX2>(filter->fmt_out.video.i_chroma,
+                               filter->fmt_in.video.i_chroma);
+    if (!blend)
+        return VLC_EGENERIC;
+    return OpenBlend(filter, blend);
 }
+#endif
 
 static void Close(vlc_object_t *object)
 {
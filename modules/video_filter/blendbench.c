@@ -38,6 +38,8 @@
 #include <vlc_picture.h>
 #include <vlc_image.h>
 
+#include "bench_picture.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -69,6 +71,16 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
                                  " in")
 
+#define BLENDER_TEXT N_("Blending module")
+#define BLENDER_LONGTEXT N_("The blending module which will be benchmarked, " \
+                            "and checked against the generic one")
+
+#define WIDTH_TEXT N_("Width of generated images")
+#define HEIGHT_TEXT N_("Height of generated images")
+#define SIZE_LONGTEXT N_("Images are generated with this size and " \
+                         "pseudo-random pixels when no file is given, " \
+                         "so that results can be reproduced")
+
 #define CFG_PREFIX "blendbench-"
 
 vlc_module_begin ()
@@ -83,6 +95,10 @@ vlc_module_begin ()
               LOOPS_LONGTEXT, false )
     add_integer_with_range( CFG_PREFIX "alpha", 128, 0, 255, ALPHA_TEXT,
               ALPHA_LONGTEXT, false )
+    add_module( CFG_PREFIX "blender", "video blending", NULL, BLENDER_TEXT,
+                BLENDER_LONGTEXT, false )
+    add_integer( CFG_PREFIX "width", 1920, WIDTH_TEXT, SIZE_LONGTEXT, false )
+    add_integer( CFG_PREFIX "height", 1080, HEIGHT_TEXT, SIZE_LONGTEXT, false )
 
     set_section( N_("Base image"), NULL )
     add_loadfile( CFG_PREFIX "base-image", NULL, BASE_IMAGE_TEXT,
@@ -100,8 +116,8 @@ vlc_module_begin ()
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "loops", "alpha", "base-image", "base-chroma", "blend-image",
-    "blend-chroma", NULL
+    "loops", "alpha", "blender", "width", "height", "base-image",
+    "base-chroma", "blend-image", "blend-chroma", NULL
 };
 
 /*****************************************************************************
@@ -111,6 +127,7 @@ struct filter_sys_t
 {
     bool b_done;
     int i_loops, i_alpha;
+    char *psz_blender;
 
     picture_t *p_base_image;
     picture_t *p_blend_image;
@@ -128,10 +145,21 @@ static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
     memset( &fmt_in, 0, sizeof(video_format_t) );
     memset( &fmt_out, 0, sizeof(video_format_t) );
 
-    fmt_out.i_chroma = i_chroma;
-    p_image = image_HandlerCreate( p_this );
-    *pp_pic = image_ReadUrl( p_image, psz_file, &fmt_in, &fmt_out );
-    image_HandlerDelete( p_image );
+    if( psz_file == NULL || *psz_file == '\0' )
+    {
+        unsigned i_width = var_InheritInteger( p_this, CFG_PREFIX "width" );
+        unsigned i_height = var_InheritInteger( p_this, CFG_PREFIX "height" );
+
+        /* Fixed seed, so that every run blends the same pixels */
+        *pp_pic = bench_NewPicture( i_chroma, i_width, i_height, 0x12345678 );
+    }
+    else
+    {
+        fmt_out.i_chroma = i_chroma;
+        p_image = image_HandlerCreate( p_this );
+        *pp_pic = image_ReadUrl( p_image, psz_file, &fmt_in, &fmt_out );
+        image_HandlerDelete( p_image );
+    }
 
     if( *pp_pic == NULL )
     {
@@ -175,6 +203,7 @@ static int Create( vlc_object_t *p_this )
                                                   CFG_PREFIX "loops" );
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
+    p_sys->psz_blender = var_InheritString( p_filter, CFG_PREFIX "blender" );
 
     psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
     p_sys->i_base_chroma = !psz_temp || strlen( psz_temp ) != 4 ? 0 :
@@ -186,6 +215,7 @@ static int Create( vlc_object_t *p_this )
     free( psz_cmd );
     if( i_ret != VLC_SUCCESS )
     {
+        free( p_sys->psz_blender );
         free( p_sys );
         return i_ret;
     }
@@ -204,6 +234,7 @@ static int Create( vlc_object_t *p_this )
     if( i_ret != VLC_SUCCESS )
     {
         picture_Release( p_sys->p_base_image );
+        free( p_sys->psz_blender );
         free( p_sys );
 
         return VLC_EGENERIC;
@@ -222,6 +253,78 @@ static void Destroy( vlc_object_t *p_this )
 
     picture_Release( p_sys->p_base_image );
     picture_Release( p_sys->p_blend_image );
+    free( p_sys->psz_blender );
+    free( p_sys );
+}
+
+static filter_t *blendbench_CreateBlender( filter_t *p_filter,
+                                           const char *psz_name )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    filter_t *p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
+    if( !p_blend )
+        return NULL;
+
+    p_blend->fmt_out.video = p_sys->p_base_image->format;
+    p_blend->fmt_in.video = p_sys->p_blend_image->format;
+    p_blend->p_module = module_need( p_blend, "video blending", psz_name,
+                                     psz_name != NULL );
+    if( !p_blend->p_module )
+    {
+        vlc_object_release( p_blend );
+        return NULL;
+    }
+    return p_blend;
+}
+
+static void blendbench_DeleteBlender( filter_t *p_blend )
+{
+    module_unneed( p_blend, p_blend->p_module );
+    vlc_object_release( p_blend );
+}
+
+/*****************************************************************************
+ * Check: compares blends against the generic blending module
+ *****************************************************************************/
+static void blendbench_Check( filter_t *p_filter, filter_t *p_blend )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *p_base = p_sys->p_base_image;
+
+    filter_t *p_ref = blendbench_CreateBlender( p_filter, "blend_c" );
+    picture_t *p_expected = picture_NewFromFormat( &p_base->format );
+    picture_t *p_result = picture_NewFromFormat( &p_base->format );
+    if( !p_ref || !p_expected || !p_result )
+        goto out;
+
+    /* Odd offsets exercise the chroma subsampling edges */
+    for( int i_offset = 0; i_offset < 2; i_offset++ )
+    {
+        int i_plane, i_line;
+
+        picture_Copy( p_expected, p_base );
+        picture_Copy( p_result, p_base );
+        p_ref->pf_video_blend( p_ref, p_expected, p_sys->p_blend_image,
+                               i_offset, i_offset, p_sys->i_alpha );
+        p_blend->pf_video_blend( p_blend, p_result, p_sys->p_blend_image,
+                                 i_offset, i_offset, p_sys->i_alpha );
+
+        if( !bench_ComparePictures( p_expected, p_result, &i_plane, &i_line ) )
+        {
+            msg_Err( p_filter, "blending at offset %d differs from the "
+                     "generic module (plane %d, line %d)", i_offset,
+                     i_plane, i_line );
+            goto out;
+        }
+    }
+    msg_Info( p_filter, "blending matches the generic module" );
+out:
+    if( p_result )
+        picture_Release( p_result );
+    if( p_expected )
+        picture_Release( p_expected );
+    if( p_ref )
+        blendbench_DeleteBlender( p_ref );
 }
 
 /*****************************************************************************
@@ -235,21 +338,15 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     if( p_sys->b_done )
         return p_pic;
 
-    p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
+    p_blend = blendbench_CreateBlender( p_filter, p_sys->psz_blender );
     if( !p_blend )
     {
+        msg_Err( p_filter, "no blending module for %4.4s -> %4.4s",
+                 (const char *)&p_sys->i_blend_chroma,
+                 (const char *)&p_sys->i_base_chroma );
         picture_Release( p_pic );
         return NULL;
     }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
-    p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
-    if( !p_blend->p_module )
-    {
-        picture_Release( p_pic );
-        vlc_object_release( p_blend );
-        return NULL;
-    }
 
     mtime_t time = mdate();
     for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
@@ -260,17 +357,22 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     }
     time = mdate() - time;
 
+    const video_format_t *p_fmt = &p_sys->p_blend_image->format;
+    msg_Info( p_filter, "%s: %4.4s -> %4.4s, %ux%u, alpha %d",
+              module_GetLongName( p_blend->p_module ),
+              (const char *)&p_sys->i_blend_chroma,
+              (const char *)&p_sys->i_base_chroma,
+              p_fmt->i_visible_width, p_fmt->i_visible_height,
+              p_sys->i_alpha );
     msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
               time / 1000000.0f );
     msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
               (float) p_sys->i_loops / time * 1000000,
               (float) p_sys->i_loops / time * 1000000 *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
+                  p_fmt->i_visible_width * p_fmt->i_visible_height );
 
-    module_unneed( p_blend, p_blend->p_module );
-
-    vlc_object_release( p_blend );
+    blendbench_Check( p_filter, p_blend );
+    blendbench_DeleteBlender( p_blend );
 
     p_sys->b_done = true;
     return p_pic;
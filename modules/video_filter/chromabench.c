@@ -0,0 +1,359 @@
+/*****************************************************************************
+ * chromabench.c : chroma conversion benchmark plugin for vlc
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_modules.h>
+
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#include "bench_picture.h"
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int Create( vlc_object_t * );
+static void Destroy( vlc_object_t * );
+
+static picture_t *Filter( filter_t *, picture_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+
+#define LOOPS_TEXT N_("Number of conversions")
+#define LOOPS_LONGTEXT N_("The number of time each conversion will be " \
+                          "performed")
+
+#define CONVERSIONS_TEXT N_("Conversions")
+#define CONVERSIONS_LONGTEXT N_("Comma separated list of source and " \
+                                "destination chromas to convert, " \
+                                "as SRC:DST")
+
+#define SIZES_TEXT N_("Picture sizes")
+#define SIZES_LONGTEXT N_("Comma separated list of picture sizes, as WxH. " \
+                          "Pictures are generated with pseudo-random " \
+                          "pixels, so that results can be reproduced")
+
+#define CONVERTER_TEXT N_("Conversion module")
+#define CONVERTER_LONGTEXT N_("The video converter which will be benchmarked")
+
+#define REFERENCE_TEXT N_("Reference modules")
+#define REFERENCE_LONGTEXT N_("The generic video converters which the " \
+                              "results are checked against, and " \
+                              "benchmarked too")
+
+#define CFG_PREFIX "chromabench-"
+
+#define DEFAULT_CONVERSIONS "YUY2:I420,YVYU:I420,UYVY:I420," \
+                            "YUY2:I422,YVYU:I422,UYVY:I422," \
+                            "I422:I420,GREY:I420,GREY:YUY2," \
+                            "RV24:RV32,I0AL:P010"
+#define DEFAULT_REFERENCE "yuy2_i420_c,yuy2_i422_c,i422_i420,grey_yuv_c," \
+                          "rv32_c,i420_10_p010_c"
+
+vlc_module_begin ()
+    set_description( N_("Chroma conversion benchmark filter") )
+    set_shortname( N_("Chromabench" ))
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    set_capability( "video filter", 0 )
+
+    set_section( N_("Benchmarking"), NULL )
+    add_integer( CFG_PREFIX "loops", 100, LOOPS_TEXT,
+              LOOPS_LONGTEXT, false )
+    add_string( CFG_PREFIX "conversions", DEFAULT_CONVERSIONS,
+                CONVERSIONS_TEXT, CONVERSIONS_LONGTEXT, false )
+    add_string( CFG_PREFIX "sizes", "1920x1080,3840x2160",
+                SIZES_TEXT, SIZES_LONGTEXT, false )
+    add_module( CFG_PREFIX "converter", "video converter", NULL,
+                CONVERTER_TEXT, CONVERTER_LONGTEXT, false )
+    add_string( CFG_PREFIX "reference", DEFAULT_REFERENCE,
+                REFERENCE_TEXT, REFERENCE_LONGTEXT, false )
+
+    set_callbacks( Create, Destroy )
+vlc_module_end ()
+
+static const char *const ppsz_filter_options[] = {
+    "loops", "conversions", "sizes", "converter", "reference", NULL
+};
+
+/*****************************************************************************
+ * filter_sys_t: filter method descriptor
+ *****************************************************************************/
+struct filter_sys_t
+{
+    bool b_done;
+    int i_loops;
+    char *psz_conversions;
+    char *psz_sizes;
+    char *psz_converter;
+    char *psz_reference;
+};
+
+/*****************************************************************************
+ * Create: allocates video thread output method
+ *****************************************************************************/
+static int Create( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys;
+
+    p_filter->p_sys = p_sys = malloc( sizeof( filter_sys_t ) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+
+    config_ChainParse( p_filter, CFG_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+
+    p_sys->b_done = false;
+    p_sys->i_loops = var_InheritInteger( p_filter, CFG_PREFIX "loops" );
+    p_sys->psz_conversions = var_InheritString( p_filter,
+                                                CFG_PREFIX "conversions" );
+    p_sys->psz_sizes = var_InheritString( p_filter, CFG_PREFIX "sizes" );
+    p_sys->psz_converter = var_InheritString( p_filter,
+                                              CFG_PREFIX "converter" );
+    p_sys->psz_reference = var_InheritString( p_filter,
+                                              CFG_PREFIX "reference" );
+
+    p_filter->pf_video_filter = Filter;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Destroy: destroy video thread output method
+ *****************************************************************************/
+static void Destroy( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    free( p_sys->psz_conversions );
+    free( p_sys->psz_sizes );
+    free( p_sys->psz_converter );
+    free( p_sys->psz_reference );
+    free( p_sys );
+}
+
+/* The converters output to a single picture, so that allocations are not
+ * measured */
+static picture_t *chromabench_BufferNew( filter_t *p_conv )
+{
+    return picture_Hold( p_conv->owner.sys );
+}
+
+static filter_t *chromabench_CreateConverter( filter_t *p_filter,
+                                              const char *psz_name,
+                                              picture_t *p_src,
+                                              picture_t *p_dst )
+{
+    filter_t *p_conv = vlc_object_create( p_filter, sizeof(filter_t) );
+    if( !p_conv )
+        return NULL;
+
+    es_format_Init( &p_conv->fmt_in, VIDEO_ES, p_src->format.i_chroma );
+    p_conv->fmt_in.video = p_src->format;
+    es_format_Init( &p_conv->fmt_out, VIDEO_ES, p_dst->format.i_chroma );
+    p_conv->fmt_out.video = p_dst->format;
+    p_conv->owner.sys = p_dst;
+    p_conv->owner.video.buffer_new = chromabench_BufferNew;
+
+    p_conv->p_module = module_need( p_conv, "video converter", psz_name,
+                                    psz_name != NULL );
+    if( !p_conv->p_module )
+    {
+        vlc_object_release( p_conv );
+        return NULL;
+    }
+    return p_conv;
+}
+
+static void chromabench_DeleteConverter( filter_t *p_conv )
+{
+    module_unneed( p_conv, p_conv->p_module );
+    vlc_object_release( p_conv );
+}
+
+/*****************************************************************************
+ * Run: converts a picture i_loops times, returns the speed in GB/s
+ *****************************************************************************/
+static double chromabench_Run( filter_t *p_conv, picture_t *p_src,
+                               int i_loops )
+{
+    const picture_t *p_dst = p_conv->owner.sys;
+    uint64_t i_bytes = 0;
+
+    for( int i = 0; i < p_src->i_planes; i++ )
+        i_bytes += p_src->p[i].i_visible_pitch * p_src->p[i].i_visible_lines;
+    for( int i = 0; i < p_dst->i_planes; i++ )
+        i_bytes += p_dst->p[i].i_visible_pitch * p_dst->p[i].i_visible_lines;
+
+    mtime_t time = mdate();
+    for( int i_iter = 0; i_iter < i_loops; ++i_iter )
+    {
+        picture_t *p_out = p_conv->pf_video_filter( p_conv,
+                                                    picture_Hold( p_src ) );
+        if( p_out )
+            picture_Release( p_out );
+    }
+    time = mdate() - time;
+
+    /* bytes per microsecond, divided by 1000 */
+    return time > 0 ? (double)i_bytes * i_loops / time / 1000. : 0.;
+}
+
+/*****************************************************************************
+ * Bench: measures one conversion, and checks it against the reference
+ *****************************************************************************/
+static void chromabench_Bench( filter_t *p_filter, vlc_fourcc_t i_src_chroma,
+                               vlc_fourcc_t i_dst_chroma,
+                               unsigned i_width, unsigned i_height )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    filter_t *p_conv = NULL, *p_ref = NULL;
+
+    picture_t *p_src = bench_NewPicture( i_src_chroma, i_width, i_height,
+                                         0x12345678 );
+    /* Both outputs start with the same pixels */
+    picture_t *p_result = bench_NewPicture( i_dst_chroma, i_width, i_height,
+                                            0x87654321 );
+    picture_t *p_expected = bench_NewPicture( i_dst_chroma, i_width, i_height,
+                                              0x87654321 );
+    if( !p_src || !p_result || !p_expected )
+        goto out;
+
+    p_conv = chromabench_CreateConverter( p_filter, p_sys->psz_converter,
+                                          p_src, p_result );
+    if( !p_conv )
+    {
+        msg_Err( p_filter, "no converter for %4.4s -> %4.4s",
+                 (const char *)&i_src_chroma, (const char *)&i_dst_chroma );
+        goto out;
+    }
+    p_ref = chromabench_CreateConverter( p_filter, p_sys->psz_reference,
+                                         p_src, p_expected );
+
+    double f_speed = chromabench_Run( p_conv, p_src, p_sys->i_loops );
+    msg_Info( p_filter, "%4.4s -> %4.4s, %ux%u: %.2f GB/s with %s",
+              (const char *)&i_src_chroma, (const char *)&i_dst_chroma,
+              i_width, i_height, f_speed,
+              module_GetLongName( p_conv->p_module ) );
+
+    if( !p_ref )
+    {
+        msg_Warn( p_filter, "no reference converter for %4.4s -> %4.4s",
+                  (const char *)&i_src_chroma, (const char *)&i_dst_chroma );
+        goto out;
+    }
+
+    f_speed = chromabench_Run( p_ref, p_src, p_sys->i_loops );
+
+    int i_plane, i_line;
+    if( bench_ComparePictures( p_expected, p_result, &i_plane, &i_line ) )
+        msg_Info( p_filter, "%4.4s -> %4.4s, %ux%u: %.2f GB/s with %s, "
+                  "same output",
+                  (const char *)&i_src_chroma, (const char *)&i_dst_chroma,
+                  i_width, i_height, f_speed,
+                  module_GetLongName( p_ref->p_module ) );
+    else
+        msg_Err( p_filter, "%4.4s -> %4.4s, %ux%u: %.2f GB/s with %s, "
+                 "output differs (plane %d, line %d)",
+                 (const char *)&i_src_chroma, (const char *)&i_dst_chroma,
+                 i_width, i_height, f_speed,
+                 module_GetLongName( p_ref->p_module ), i_plane, i_line );
+out:
+    if( p_ref )
+        chromabench_DeleteConverter( p_ref );
+    if( p_conv )
+        chromabench_DeleteConverter( p_conv );
+    if( p_expected )
+        picture_Release( p_expected );
+    if( p_result )
+        picture_Release( p_result );
+    if( p_src )
+        picture_Release( p_src );
+}
+
+/*****************************************************************************
+ * Render: runs the benchmark once, then passes pictures through
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->b_done )
+        return p_pic;
+    p_sys->b_done = true;
+
+    if( p_sys->psz_sizes == NULL || p_sys->psz_conversions == NULL )
+        return p_pic;
+
+    char *psz_sizes = p_sys->psz_sizes, *psz_size, *psz_save_size;
+
+    while( (psz_size = strtok_r( psz_sizes, ",", &psz_save_size )) != NULL )
+    {
+        unsigned i_width, i_height;
+
+        psz_sizes = NULL;
+        if( sscanf( psz_size, "%ux%u", &i_width, &i_height ) != 2 )
+        {
+            msg_Warn( p_filter, "invalid picture size %s", psz_size );
+            continue;
+        }
+
+        char *psz_list = strdup( p_sys->psz_conversions );
+        if( unlikely(psz_list == NULL) )
+            break;
+
+        char *psz_conv, *psz_save_conv, *psz_convs = psz_list;
+        while( (psz_conv = strtok_r( psz_convs, ",",
+                                     &psz_save_conv )) != NULL )
+        {
+            char *psz_dst = strchr( psz_conv, ':' );
+
+            psz_convs = NULL;
+            if( psz_dst != NULL )
+                *(psz_dst++) = '\0';
+
+            vlc_fourcc_t i_src = vlc_fourcc_GetCodecFromString( VIDEO_ES,
+                                                                psz_conv );
+            vlc_fourcc_t i_dst = psz_dst == NULL ? 0 :
+                vlc_fourcc_GetCodecFromString( VIDEO_ES, psz_dst );
+            if( i_src == 0 || i_dst == 0 )
+            {
+                msg_Warn( p_filter, "invalid conversion %s", psz_conv );
+                continue;
+            }
+            chromabench_Bench( p_filter, i_src, i_dst, i_width, i_height );
+        }
+        free( psz_list );
+    }
+
+    return p_pic;
+}
@@ -317,6 +317,8 @@ notsupp:
         return VLC_ENOMEM;
 
     p_sys->chroma = chroma;
+    p_sys->p_slices = filter_slices_New( p_filter,
+                                         p_filter->fmt_in.video.i_height, 0 );
 
     InitDeinterlacingContext( &p_sys->context );
 
@@ -448,5 +450,7 @@ void Close( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t*)p_this;
 
     Flush( p_filter );
+    if( p_filter->p_sys->p_slices )
+        filter_slices_Delete( p_filter->p_sys->p_slices );
     free( p_filter->p_sys );
 }
@@ -35,6 +35,7 @@ struct vlc_object_t;
 
 #include <vlc_common.h>
 #include <vlc_mouse.h>
+#include <vlc_filter.h>
 
 /* Local algorithm headers */
 #include "algo_basic.h"
@@ -78,6 +79,9 @@ struct filter_sys_t
 
     struct deinterlace_ctx   context;
 
+    /** Slice threading context, NULL if unavailable */
+    filter_slices_t *p_slices;
+
     /* Algorithm-specific substructures */
     union {
         phosphor_sys_t phosphor; /**< Phosphor algorithm state. */
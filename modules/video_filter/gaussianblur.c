@@ -101,6 +101,9 @@ struct filter_sys_t
     type_t *pt_distribution;
     type_t *pt_buffer;
     type_t *pt_scale;
+
+    filter_slices_t *p_slices;
+    int i_buffer_size;      /* per slice */
 };
 
 static void gaussianblur_InitDistribution( filter_sys_t *p_sys )
@@ -171,6 +174,8 @@ static int Create( vlc_object_t *p_this )
 
     p_filter->p_sys->pt_buffer = NULL;
     p_filter->p_sys->pt_scale = NULL;
+    p_filter->p_sys->p_slices =
+        filter_slices_New( p_filter, p_filter->fmt_in.video.i_height, 0 );
 
     return VLC_SUCCESS;
 }
@@ -182,16 +187,89 @@ static void Destroy( vlc_object_t *p_this )
     free( p_filter->p_sys->pt_distribution );
     free( p_filter->p_sys->pt_buffer );
     free( p_filter->p_sys->pt_scale );
+    if( p_filter->p_sys->p_slices )
+        filter_slices_Delete( p_filter->p_sys->p_slices );
 
     free( p_filter->p_sys );
 }
 
+struct slice_ctx
+{
+    filter_sys_t *p_sys;
+    picture_t *p_pic;
+    picture_t *p_outpic;
+};
+
+static void FilterSlice( void *opaque, unsigned i_slice, unsigned i_slices )
+{
+    const struct slice_ctx *ctx = opaque;
+    filter_sys_t *p_sys = ctx->p_sys;
+    picture_t *p_pic = ctx->p_pic;
+    picture_t *p_outpic = ctx->p_outpic;
+    const int i_dim = p_sys->i_dim;
+    type_t *pt_buffer = p_sys->pt_buffer + i_slice * p_sys->i_buffer_size;
+    const type_t *pt_scale = p_sys->pt_scale;
+    const type_t *pt_distribution = p_sys->pt_distribution;
+
+    for( int i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    {
+
+        uint8_t *p_in = p_pic->p[i_plane].p_pixels;
+        uint8_t *p_out = p_outpic->p[i_plane].p_pixels;
+
+        const int i_visible_lines = p_pic->p[i_plane].i_visible_lines;
+        const int i_visible_pitch = p_pic->p[i_plane].i_visible_pitch;
+        const int i_in_pitch = p_pic->p[i_plane].i_pitch;
+
+        const int x_factor = p_pic->p[Y_PLANE].i_visible_pitch/i_visible_pitch-1;
+        const int y_factor = p_pic->p[Y_PLANE].i_visible_lines/i_visible_lines-1;
+
+        filter_band_t band;
+        filter_slices_GetBand( &band, i_visible_lines, i_slice, i_slices, 1,
+                               i_dim );
+
+        for( int i_line = band.i_above; i_line < band.i_below; i_line++ )
+        {
+            for( int i_col = 0; i_col < i_visible_pitch; i_col++ )
+            {
+                type_t t_value = 0;
+                const int c = i_line*i_in_pitch+i_col;
+                for( int x = __MAX( -i_dim, -i_col*(x_factor+1) );
+                     x <= __MIN( i_dim, (i_visible_pitch - i_col)*(x_factor+1) + 1 );
+                     x++ )
+                {
+                    t_value += pt_distribution[x+i_dim] *
+                               p_in[c+(x>>x_factor)];
+                }
+                pt_buffer[c-band.i_above*i_in_pitch] = t_value;
+            }
+        }
+        for( int i_line = band.i_first; i_line < band.i_end; i_line++ )
+        {
+            for( int i_col = 0; i_col < i_visible_pitch; i_col++ )
+            {
+                type_t t_value = 0;
+                const int c = (i_line-band.i_above)*i_in_pitch+i_col;
+                for( int y = __MAX( -i_dim, (-i_line)*(y_factor+1) );
+                     y <= __MIN( i_dim, (i_visible_lines - i_line)*(y_factor+1) - 1 );
+                     y++ )
+                {
+                    t_value += pt_distribution[y+i_dim] *
+                               pt_buffer[c+(y>>y_factor)*i_in_pitch];
+                }
+
+                const type_t t_scale = pt_scale[(i_line<<y_factor)*(i_in_pitch<<x_factor)+(i_col<<x_factor)];
+                p_out[i_line * p_outpic->p[i_plane].i_pitch + i_col] = (uint8_t)(t_value / t_scale); // FIXME wouldn't it be better to round instead of trunc ?
+            }
+        }
+    }
+}
+
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
     picture_t *p_outpic;
     filter_sys_t *p_sys = p_filter->p_sys;
     const int i_dim = p_sys->i_dim;
-    type_t *pt_buffer;
     type_t *pt_scale;
     const type_t *pt_distribution = p_sys->pt_distribution;
 
@@ -205,12 +283,23 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     }
     if( !p_sys->pt_buffer )
     {
+        /* Each slice blurs its band and i_dim lines around it horizontally */
+        const unsigned i_slices = p_sys->p_slices ?
+                                  filter_slices_Count( p_sys->p_slices ) : 1;
+        const int i_lines = p_pic->p[Y_PLANE].i_visible_lines;
+        const int i_band = __MIN( (i_lines + (int)i_slices - 1) / (int)i_slices + 2 * i_dim,
+                                  i_lines );
+
+        p_sys->i_buffer_size = i_band * p_pic->p[Y_PLANE].i_pitch;
         p_sys->pt_buffer = realloc_or_free( p_sys->pt_buffer,
-                               p_pic->p[Y_PLANE].i_visible_lines *
-                               p_pic->p[Y_PLANE].i_pitch * sizeof( type_t ) );
+                               i_slices * p_sys->i_buffer_size * sizeof( type_t ) );
+        if( !p_sys->pt_buffer )
+        {
+            picture_Release( p_pic );
+            picture_Release( p_outpic );
+            return NULL;
+        }
     }
-
-    pt_buffer = p_sys->pt_buffer;
     if( !p_sys->pt_scale )
     {
         const int i_visible_lines = p_pic->p[Y_PLANE].i_visible_lines;
@@ -243,55 +332,12 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         }
     }
 
-    pt_scale = p_sys->pt_scale;
-    for( int i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-
-        uint8_t *p_in = p_pic->p[i_plane].p_pixels;
-        uint8_t *p_out = p_outpic->p[i_plane].p_pixels;
-
-        const int i_visible_lines = p_pic->p[i_plane].i_visible_lines;
-        const int i_visible_pitch = p_pic->p[i_plane].i_visible_pitch;
-        const int i_in_pitch = p_pic->p[i_plane].i_pitch;
-
-        const int x_factor = p_pic->p[Y_PLANE].i_visible_pitch/i_visible_pitch-1;
-        const int y_factor = p_pic->p[Y_PLANE].i_visible_lines/i_visible_lines-1;
-
-        for( int i_line = 0; i_line < i_visible_lines; i_line++ )
-        {
-            for( int i_col = 0; i_col < i_visible_pitch; i_col++ )
-            {
-                type_t t_value = 0;
-                const int c = i_line*i_in_pitch+i_col;
-                for( int x = __MAX( -i_dim, -i_col*(x_factor+1) );
-                     x <= __MIN( i_dim, (i_visible_pitch - i_col)*(x_factor+1) + 1 );
-                     x++ )
-                {
-                    t_value += pt_distribution[x+i_dim] *
-                               p_in[c+(x>>x_factor)];
-                }
-                pt_buffer[c] = t_value;
-            }
-        }
-        for( int i_line = 0; i_line < i_visible_lines; i_line++ )
-        {
-            for( int i_col = 0; i_col < i_visible_pitch; i_col++ )
-            {
-                type_t t_value = 0;
-                const int c = i_line*i_in_pitch+i_col;
-                for( int y = __MAX( -i_dim, (-i_line)*(y_factor+1) );
-                     y <= __MIN( i_dim, (i_visible_lines - i_line)*(y_factor+1) - 1 );
-                     y++ )
-                {
-                    t_value += pt_distribution[y+i_dim] *
-                               pt_buffer[c+(y>>y_factor)*i_in_pitch];
-                }
-
-                const type_t t_scale = pt_scale[(i_line<<y_factor)*(i_in_pitch<<x_factor)+(i_col<<x_factor)];
-                p_out[i_line * p_outpic->p[i_plane].i_pitch + i_col] = (uint8_t)(t_value / t_scale); // FIXME wouldn't it be better to round instead of trunc ?
-            }
-        }
-    }
+    struct slice_ctx ctx = { .p_sys = p_sys, .p_pic = p_pic,
+                             .p_outpic = p_outpic };
+    if( p_sys->p_slices )
+        filter_slices_Run( p_sys->p_slices, FilterSlice, &ctx );
+    else
+        FilterSlice( &ctx, 0, 1 );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
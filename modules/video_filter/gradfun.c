@@ -108,6 +108,8 @@ struct filter_sys_t {
     int              radius;
     const vlc_chroma_description_t *chroma;
     struct vf_priv_s cfg;
+    filter_slices_t *slices;
+    size_t           buf_size;   /* per slice, in elements */
 };
 
 static int Open(vlc_object_t *object)
@@ -156,6 +158,9 @@ static int Open(vlc_object_t *object)
 #endif
         cfg->filter_line = filter_line_c;
 
+    sys->slices = filter_slices_New(filter, filter->fmt_in.video.i_height, 0);
+    sys->buf_size = 0;
+
     filter->p_sys           = sys;
     filter->pf_video_filter = Filter;
     return VLC_SUCCESS;
@@ -169,10 +174,55 @@ static void Close(vlc_object_t *object)
     var_DelCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     var_DelCallback(filter, CFG_PREFIX "strength", Callback, NULL);
     aligned_free(sys->cfg.buf);
+    if (sys->slices)
+        filter_slices_Delete(sys->slices);
     vlc_mutex_destroy(&sys->lock);
     free(sys);
 }
 
+struct slice_ctx {
+    filter_t  *filter;
+    picture_t *src;
+    picture_t *dst;
+};
+
+static void FilterSlice(void *opaque, unsigned slice, unsigned slices)
+{
+    const struct slice_ctx *ctx = opaque;
+    filter_sys_t *sys = ctx->filter->p_sys;
+    const video_format_t *fmt = &ctx->filter->fmt_in.video;
+    struct vf_priv_s *cfg = &sys->cfg;
+
+    for (int i = 0; i < ctx->dst->i_planes; i++) {
+        const plane_t *srcp = &ctx->src->p[i];
+        plane_t       *dstp = &ctx->dst->p[i];
+
+        const vlc_chroma_description_t *chroma = sys->chroma;
+        int w = fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
+        int h = fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
+        int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
+                 cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
+        r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
+
+        filter_band_t band;
+        if (__MIN(w, h) > 2 * r && cfg->buf) {
+            filter_slices_GetBand(&band, h, slice, slices, 2, 0);
+            filter_plane(cfg, cfg->buf + slice * sys->buf_size,
+                         dstp->p_pixels, srcp->p_pixels,
+                         w, h, dstp->i_pitch, srcp->i_pitch, r,
+                         band.i_first, band.i_end);
+        } else {
+            filter_slices_GetBand(&band, __MIN(dstp->i_visible_lines,
+                                               srcp->i_visible_lines),
+                                  slice, slices, 1, 0);
+            for (int y = band.i_first; y < band.i_end; y++)
+                memcpy(&dstp->p_pixels[y * dstp->i_pitch],
+                       &srcp->p_pixels[y * srcp->i_pitch],
+                       __MIN(dstp->i_visible_pitch, srcp->i_visible_pitch));
+        }
+    }
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -193,29 +243,20 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
 
     cfg->thresh = (1 << 15) / strength;
     if (cfg->radius != radius) {
-        cfg->radius = radius;
-        cfg->buf    = aligned_alloc(16,
-                                   (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf));
-    }
+        unsigned slices = sys->slices ? filter_slices_Count(sys->slices) : 1;
 
-    for (int i = 0; i < dst->i_planes; i++) {
-        const plane_t *srcp = &src->p[i];
-        plane_t       *dstp = &dst->p[i];
-
-        const vlc_chroma_description_t *chroma = sys->chroma;
-        int w = fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
-        int h = fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
-        int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
-                 cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
-        r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
-        if (__MIN(w, h) > 2 * r && cfg->buf) {
-            filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
-                         w, h, dstp->i_pitch, srcp->i_pitch, r);
-        } else {
-            plane_CopyPixels(dstp, srcp);
-        }
+        cfg->radius   = radius;
+        sys->buf_size = (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32 + 7) & ~7;
+        aligned_free(cfg->buf);
+        cfg->buf      = aligned_alloc(16, slices * sys->buf_size * sizeof(*cfg->buf));
     }
 
+    struct slice_ctx ctx = { .filter = filter, .src = src, .dst = dst };
+    if (sys->slices)
+        filter_slices_Run(sys->slices, FilterSlice, &ctx);
+    else
+        FilterSlice(&ctx, 0, 1);
+
     picture_CopyProperties(dst, src);
     picture_Release(src);
     return dst;
@@ -222,19 +222,31 @@ static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
 }
 #endif // HAVE_6REGS && HAVE_SSE2
 
-static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
-                         int width, int height, int dstride, int sstride, int r)
+/* Filters the lines first to end-1 of a plane, using buf as scratch memory.
+ * The blurred value of a line only depends on the lines up to r away from it,
+ * so bands of the same plane can be filtered at the same time. */
+static void filter_plane(struct vf_priv_s *ctx, uint16_t *scratch,
+                         uint8_t *dst, uint8_t *src,
+                         int width, int height, int dstride, int sstride, int r,
+                         int first, int end)
 {
     int bstride = ((width+15)&~15)/2;
     int y;
     uint32_t dc_factor = (1<<21)/(r*r);
-    uint16_t *dc = ctx->buf+16;
-    uint16_t *buf = ctx->buf+bstride+32;
+    uint16_t *dc = scratch+16;
+    uint16_t *buf = scratch+bstride+32;
     int thresh = ctx->thresh;
 
+    /* Start from the last line with its own blurred line, at or above the
+     * first one, priming the ring of blurred lines with the r lines below */
+    y = __MIN(__MAX(first, r), (height-r-1)&~1);
+    int k0 = (y+r)/2 - r;
+
     memset(dc, 0, (bstride+16)*sizeof(*buf));
-    for (y=0; y<r; y++)
-        ctx->blur_line(dc, buf+y*bstride, buf+(y-1)*bstride, src+2*y*sstride, sstride, width/2);
+    for (int k = k0; k < k0+r; k++)
+        ctx->blur_line(dc, buf+(k%r)*bstride,
+                       k > k0 ? buf+((k-1)%r)*bstride : buf-bstride,
+                       src+2*k*sstride, sstride, width/2);
     for (;;) {
         if (y < height-r) {
             int mod = ((y+r)/2)%r;
@@ -254,13 +266,14 @@ static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
                 dc[x] = dc[0];
         }
         if (y == r) {
-            for (y=0; y<r; y++)
-                ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
+            for (int i = first; i < __MIN(r, end); i++)
+                ctx->filter_line(dst+i*dstride, src+i*sstride, dc-r/2, width, thresh, dither[i&7]);
         }
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
+        if (y >= first && y < end)
+            ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
+        if (++y >= end) break;
+        if (y >= first)
+            ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
+        if (++y >= end) break;
     }
 }
-
@@ -91,6 +91,8 @@ struct filter_sys_t
 {
     const vlc_chroma_description_t *chroma;
     int w[3], h[3];
+    int wmax;
+    filter_slices_t *slices;
 
     struct vf_priv_s cfg;
     bool   b_recalc_coefs;
@@ -138,8 +140,18 @@ static int Open(vlc_object_t *this)
         if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
     }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
+    sys->wmax = wmax;
+
+    /* The filter is recursive over the lines: splitting the planes in
+     * bands would make the output depend on the number of threads, so
+     * only the planes are filtered in parallel */
+    sys->slices = filter_slices_New(filter, fmt_out->i_height, 3);
+    unsigned slice_count = sys->slices ? filter_slices_Count(sys->slices) : 1;
+
+    cfg->Line = malloc(slice_count * wmax * sizeof(unsigned int));
     if (!cfg->Line) {
+        if (sys->slices)
+            filter_slices_Delete(sys->slices);
         free(sys);
         return VLC_ENOMEM;
     }
@@ -186,12 +198,39 @@ static void Close(vlc_object_t *this)
         free(cfg->Frame[i]);
     }
     free(cfg->Line);
+    if (sys->slices)
+        filter_slices_Delete(sys->slices);
     free(sys);
 }
 
 /*****************************************************************************
  * Filter
  *****************************************************************************/
+struct slice_ctx
+{
+    filter_sys_t *sys;
+    picture_t *src;
+    picture_t *dst;
+};
+
+static void FilterSlice(void *opaque, unsigned slice, unsigned slices)
+{
+    const struct slice_ctx *ctx = opaque;
+    filter_sys_t *sys = ctx->sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+    unsigned int *line = cfg->Line + slice * sys->wmax;
+
+    for (unsigned i = slice; i < 3; i += slices) {
+        int *spat = cfg->Coefs[i ? 2 : 0];
+        int *temp = cfg->Coefs[i ? 3 : 1];
+
+        deNoise(ctx->src->p[i].p_pixels, ctx->dst->p[i].p_pixels,
+                line, &cfg->Frame[i], sys->w[i], sys->h[i],
+                ctx->src->p[i].i_pitch, ctx->dst->p[i].i_pitch,
+                spat, spat, temp);
+    }
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     picture_t *dst;
@@ -221,24 +260,11 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
+    struct slice_ctx ctx = { .sys = sys, .src = src, .dst = dst };
+    if (sys->slices)
+        filter_slices_Run(sys->slices, FilterSlice, &ctx);
+    else
+        FilterSlice(&ctx, 0, 1);
 
     if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
     {
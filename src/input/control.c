@@ -89,7 +89,7 @@ int input_vaControl( input_thread_t *p_input, int i_query, va_list args )
 
         case INPUT_GET_LENGTH:
             pi_64 = va_arg( args, int64_t * );
-            *pi_64 = var_GetInteger( p_input, "length" );
+            *pi_64 = var_HandleGetInteger( input_priv(p_input)->length );
             return VLC_SUCCESS;
 
         case INPUT_GET_TIME:
@@ -167,6 +167,7 @@ struct ts_storage_t
     ts_storage_t *p_next;
 
     /* */
+    bool    b_memory;   /* Blocks are kept as is instead of written to a file */
 #ifdef _WIN32
     char    *psz_file;  /* Filename */
 #endif
@@ -188,12 +189,26 @@ typedef struct
     input_thread_t *p_input;
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
+    int64_t        i_memory_max;
     const char     *psz_tmp_path;
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
     vlc_cond_t     wait;
 
+    /* Size of the blocks held by memory storages */
+    int64_t        i_memory_size;
+
+    struct
+    {
+        mtime_t  i_next;        /* date of the next report */
+        int64_t  i_memory_peak; /* highest i_memory_size */
+        uint64_t i_spilled;     /* bytes written to temporary files */
+        unsigned i_reads;       /* blocks read back */
+        mtime_t  i_read_time;
+        mtime_t  i_read_max;
+    } stats;
+
     /* */
     bool           b_paused;
     mtime_t        i_pause_date;
@@ -227,6 +242,7 @@ struct es_out_sys_t
 
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
+    int64_t        i_memory_max;      /* Memory to use before temporary files */
     char           *psz_tmp_path;     /* Path for temporary files */
 
     /* Lock for all following fields */
@@ -266,7 +282,7 @@ static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
 
 static void         *TsRun( void * );
 
-static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
+static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max, bool b_memory );
 static void         TsStorageDelete( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
@@ -344,6 +360,12 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     msg_Dbg( p_input, "using timeshift granularity of %d MiB",
              (int)p_sys->i_tmp_size_max/(1024*1024) );
 
+    const int i_memory_max = var_InheritInteger( p_input, "input-timeshift-memory" );
+    p_sys->i_memory_max = (int64_t)__MAX( i_memory_max, 0 ) * 1024 * 1024;
+    if( p_sys->i_memory_max > 0 )
+        msg_Dbg( p_input, "using up to %d MiB of memory for timeshift",
+                 i_memory_max );
+
     p_sys->psz_tmp_path = var_InheritString( p_input, "input-timeshift-path" );
 #if defined (_WIN32) && !VLC_WINSTORE_APP
     if( p_sys->psz_tmp_path == NULL )
@@ -786,6 +808,7 @@ static int TsStart( es_out_t *p_out )
         return VLC_EGENERIC;
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
+    p_ts->i_memory_max = p_sys->i_memory_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
@@ -801,6 +824,8 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_cmd_delay = 0;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
+    p_ts->i_memory_size = 0;
+    p_ts->stats.i_next = mdate() + 10 * CLOCK_FREQ;
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
@@ -847,15 +872,40 @@ static void TsStop( ts_thread_t *p_ts )
         TsStorageDelete( p_ts->p_storage_r );
     vlc_mutex_unlock( &p_ts->lock );
 
+    if( p_ts->stats.i_memory_peak > 0 || p_ts->stats.i_spilled > 0 )
+        msg_Dbg( p_ts->p_input, "timeshift: peak memory %"PRId64" KiB, "
+                 "%"PRIu64" KiB written to temporary files",
+                 p_ts->stats.i_memory_peak / 1024, p_ts->stats.i_spilled / 1024 );
+
     TsDestroy( p_ts );
 }
+static int64_t TsCmdSize( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type != C_SEND )
+        return 0;
+    return sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
+}
+static bool TsMemoryAvailable( ts_thread_t *p_ts, const ts_cmd_t *p_cmd )
+{
+    return p_ts->i_memory_max > 0 &&
+           p_ts->i_memory_size + TsCmdSize( p_cmd ) <= p_ts->i_memory_max;
+}
 static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
     vlc_mutex_lock( &p_ts->lock );
 
-    if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
+    ts_storage_t *p_storage_w = p_ts->p_storage_w;
+    bool b_memory = TsMemoryAvailable( p_ts, p_cmd );
+
+    /* Spill to a file once the memory is exhausted, and come back to memory
+     * as soon as the reader has drained it */
+    if( !p_storage_w || TsStorageIsFull( p_storage_w, p_cmd ) ||
+        ( p_storage_w->b_memory && !b_memory ) ||
+        ( !p_storage_w->b_memory && b_memory && p_ts->i_memory_size == 0 &&
+          p_storage_w->i_cmd_w > 0 ) )
     {
-        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
+        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path,
+                                                p_ts->i_tmp_size_max, b_memory );
 
         if( !p_storage )
         {
@@ -877,9 +927,20 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
         }
     }
 
+    const int64_t i_size = TsCmdSize( p_cmd );
+
     /* TODO return error and warn the user (but only once) */
     TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
 
+    if( p_ts->p_storage_w->b_memory )
+    {
+        p_ts->i_memory_size += i_size;
+        if( p_ts->i_memory_size > p_ts->stats.i_memory_peak )
+            p_ts->stats.i_memory_peak = p_ts->i_memory_size;
+    }
+    else
+        p_ts->stats.i_spilled += i_size;
+
     vlc_cond_signal( &p_ts->wait );
 
     vlc_mutex_unlock( &p_ts->lock );
@@ -891,8 +952,37 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
     if( TsStorageIsEmpty( p_ts->p_storage_r ) )
         return VLC_EGENERIC;
 
+    const mtime_t i_start = mdate();
+
     TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
 
+    if( p_cmd->i_type == C_SEND && p_ts->p_storage_r->b_memory )
+        p_ts->i_memory_size -= TsCmdSize( p_cmd );
+
+    if( p_cmd->i_type == C_SEND && !b_flush && p_cmd->u.send.p_block != NULL )
+    {
+        const mtime_t i_now = mdate();
+        const mtime_t i_read = i_now - i_start;
+
+        p_ts->stats.i_reads++;
+        p_ts->stats.i_read_time += i_read;
+        if( i_read > p_ts->stats.i_read_max )
+            p_ts->stats.i_read_max = i_read;
+
+        if( i_now >= p_ts->stats.i_next )
+        {
+            msg_Dbg( p_ts->p_input, "timeshift: %"PRId64" KiB in memory, "
+                     "read back %u blocks in %"PRId64" us on average "
+                     "(max %"PRId64" us)", p_ts->i_memory_size / 1024,
+                     p_ts->stats.i_reads,
+                     p_ts->stats.i_read_time / p_ts->stats.i_reads,
+                     p_ts->stats.i_read_max );
+            p_ts->stats.i_reads = 0;
+            p_ts->stats.i_read_time = p_ts->stats.i_read_max = 0;
+            p_ts->stats.i_next = i_now + 10 * CLOCK_FREQ;
+        }
+    }
+
     while( p_ts->p_storage_r && TsStorageIsEmpty( p_ts->p_storage_r ) )
     {
         ts_storage_t *p_next = p_ts->p_storage_r->p_next;
@@ -1099,19 +1189,12 @@ static void *TsRun( void *p_data )
 /*****************************************************************************
  *
  *****************************************************************************/
-static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max )
+static int TsStorageOpenFile( ts_storage_t *p_storage, const char *psz_tmp_path )
 {
-    ts_storage_t *p_storage = malloc( sizeof (*p_storage) );
-    if( unlikely(p_storage == NULL) )
-        return NULL;
-
     char *psz_file;
     int fd = GetTmpFile( &psz_file, psz_tmp_path );
     if( fd == -1 )
-    {
-        free( p_storage );
-        return NULL;
-    }
+        return VLC_EGENERIC;
 
     p_storage->p_filew = fdopen( fd, "w+b" );
     if( p_storage->p_filew == NULL )
@@ -1135,6 +1218,25 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
 #else
     p_storage->psz_file = psz_file;
 #endif
+    return VLC_SUCCESS;
+error:
+    free( psz_file );
+    return VLC_EGENERIC;
+}
+
+static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max,
+                                   bool b_memory )
+{
+    ts_storage_t *p_storage = malloc( sizeof (*p_storage) );
+    if( unlikely(p_storage == NULL) )
+        return NULL;
+
+    p_storage->b_memory = b_memory;
+    if( !b_memory && TsStorageOpenFile( p_storage, psz_tmp_path ) )
+    {
+        free( p_storage );
+        return NULL;
+    }
     p_storage->p_next = NULL;
 
     /* */
@@ -1154,10 +1256,6 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
         return NULL;
     }
     return p_storage;
-error:
-    free( psz_file );
-    free( p_storage );
-    return NULL;
 }
 
 static void TsStorageDelete( ts_storage_t *p_storage )
@@ -1172,12 +1270,15 @@ static void TsStorageDelete( ts_storage_t *p_storage )
     }
     free( p_storage->p_cmd );
 
-    fclose( p_storage->p_filer );
-    fclose( p_storage->p_filew );
+    if( !p_storage->b_memory )
+    {
+        fclose( p_storage->p_filer );
+        fclose( p_storage->p_filew );
 #ifdef _WIN32
-    vlc_unlink( p_storage->psz_file );
-    free( p_storage->psz_file );
+        vlc_unlink( p_storage->psz_file );
+        free( p_storage->psz_file );
 #endif
+    }
     free( p_storage );
 }
 
@@ -1214,7 +1315,12 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
 
     assert( !TsStorageIsFull( p_storage, p_cmd ) );
 
-    if( cmd.i_type == C_SEND )
+    if( cmd.i_type == C_SEND && p_storage->b_memory )
+    {
+        /* Keep the block itself: nothing to serialize */
+        p_storage->i_file_size += TsCmdSize( &cmd );
+    }
+    else if( cmd.i_type == C_SEND )
     {
         block_t *p_block = cmd.u.send.p_block;
 
@@ -1248,7 +1354,7 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     assert( !TsStorageIsEmpty( p_storage ) );
 
     *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
-    if( p_cmd->i_type == C_SEND )
+    if( p_cmd->i_type == C_SEND && !p_storage->b_memory )
     {
         block_t block;
 
@@ -73,7 +73,7 @@ void input_SendEventLength( input_thread_t *p_input, mtime_t i_length )
     vlc_value_t val;
 
     /* FIXME ugly + what about meta change event ? */
-    if( var_GetInteger( p_input, "length" ) == i_length )
+    if( var_HandleGetInteger( input_priv(p_input)->length ) == i_length )
         return;
 
     input_item_SetDuration( input_priv(p_input)->p_item, i_length );
@@ -240,6 +240,8 @@ static void input_Destructor( vlc_object_t *obj )
     if( priv->p_es_out_display )
         es_out_Delete( priv->p_es_out_display );
 
+    var_Release( p_input, priv->length );
+
     if( priv->p_resource )
         input_resource_Release( priv->p_resource );
     if( priv->p_resource_private )
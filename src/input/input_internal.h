@@ -103,6 +103,7 @@ typedef struct input_thread_private_t
     int64_t     i_start;    /* :start-time,0 by default */
     int64_t     i_stop;     /* :stop-time, 0 if none */
     int64_t     i_time;     /* Current time */
+    vlc_var_handle_t *length; /* "length" variable, compared on updates */
     bool        b_fast_seek;/* :input-fast-seek */
 
     /* Output */
@@ -214,6 +214,7 @@ void input_ControlVarInit ( input_thread_t *p_input )
     var_Create( p_input, "bookmarks", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
 
     var_Create( p_input, "length", VLC_VAR_INTEGER );
+    input_priv(p_input)->length = var_Hold( p_input, "length" );
 
     var_Create( p_input, "bit-rate", VLC_VAR_INTEGER );
     var_Create( p_input, "sample-rate", VLC_VAR_INTEGER );
@@ -117,6 +117,8 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
     char        *psz_val;
     int          i_ret = VLC_EGENERIC;
 
+    priv->start_date = mdate();
+
     /* System specific initialization code */
     system_Init();
 
@@ -422,6 +424,18 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
 
+    block_pool_stats_t blockstats;
+    block_PoolStats( &blockstats );
+    msg_Dbg( p_libvlc, "block pool: %llu allocations, %llu recycled, "
+             "%llu released remotely, %llu thread caches",
+             blockstats.allocs, blockstats.hits, blockstats.remote,
+             blockstats.caches );
+
+    unsigned long long lookups = var_CountLookups();
+    mtime_t uptime = mdate() - priv->start_date;
+    msg_Dbg( p_libvlc, "variables: %llu lookups by name (%.0f/s)", lookups,
+             lookups * (double)CLOCK_FREQ / __MAX(uptime, 1) );
+
     /* Free module bank. It is refcounted, so we call this each time  */
     vlc_LogDeinit (p_libvlc);
     module_EndBank (true);
@@ -192,6 +192,8 @@ typedef struct libvlc_priv_t
 
     /* Exit callback */
     vlc_exit_t       exit;
+
+    mtime_t          start_date; ///< Initialization date, for statistics
 } libvlc_priv_t;
 
 static inline libvlc_priv_t *libvlc_priv (libvlc_int_t *libvlc)
@@ -205,11 +207,30 @@ void intf_DestroyAll( libvlc_int_t * );
 
 #define libvlc_stats( o ) (libvlc_priv((VLC_OBJECT(o))->obj.libvlc)->b_stats)
 
+/*
+ * Data blocks
+ */
+typedef struct
+{
+    unsigned long long allocs; /**< pooled allocations */
+    unsigned long long hits; /**< pooled allocations recycled from a cache */
+    unsigned long long remote; /**< pooled blocks recycled from another thread */
+    unsigned long long caches; /**< per-thread caches created */
+} block_pool_stats_t;
+
+void block_PoolStats(block_pool_stats_t *);
+
 /*
  * Variables stuff
  */
 void var_OptionParse (vlc_object_t *, const char *, bool trusted);
 
+/**
+ * Returns the number of variable lookups by name so far (approximately, as
+ * other threads count theirs in batches).
+ */
+unsigned long long var_CountLookups(void);
+
 /*
  * Stats stuff
  */
@@ -23,6 +23,7 @@
 #include <vlc_common.h>
 #include <vlc_threads.h>
 #include <vlc_arrays.h>
+#include <vlc_cpu.h>
 
 #include "libvlc.h"
 #include "background_worker.h"
@@ -31,78 +32,88 @@ struct bg_queued_item {
     void* id; /**< id associated with entity */
     void* entity; /**< the entity to process */
     int timeout; /**< timeout duration in microseconds */
+    struct bg_queued_item* next; /**< next item in the same lane */
+};
+
+struct bg_running_task {
+    void* id; /**< id of the task */
+    mtime_t deadline; /**< deadline of the task */
+    bool probe_request; /**< true if a probe is requested */
 };
 
 struct background_worker {
     void* owner;
     struct background_worker_config conf;
 
-    struct {
-        bool probe_request; /**< true if a probe is requested */
-        vlc_mutex_t lock; /**< acquire to inspect members that follow */
-        vlc_cond_t wait; /**< wait for update in terms of head */
-        mtime_t deadline; /**< deadline of the current task */
-        void* id; /**< id of the current task */
-        bool active; /**< true if there is an active thread */
-    } head;
+    vlc_mutex_t lock; /**< acquire to inspect members that follow */
+    vlc_cond_t wait; /**< wait for update in terms of running tasks */
 
     struct {
-        vlc_mutex_t lock; /**< acquire to inspect members that follow */
-        vlc_array_t data; /**< queue of pending entities to process */
-    } tail;
+        struct bg_queued_item* first;
+        struct bg_queued_item** last;
+    } lanes[2]; /**< queues of pending entities, urgent lane first */
+    unsigned pending; /**< number of queued entities */
+
+    vlc_array_t running; /**< tasks being processed, one per thread */
+    unsigned threads; /**< number of threads */
+    unsigned max_threads; /**< maximum number of threads */
 };
 
-static void* Thread( void* data )
+static struct bg_queued_item* QueuePop( struct background_worker* worker )
 {
-    struct background_worker* worker = data;
-
-    for( ;; )
+    for( size_t i = 0; i < ARRAY_SIZE( worker->lanes ); i++ )
     {
-        struct bg_queued_item* item = NULL;
-        void* handle;
+        struct bg_queued_item* item = worker->lanes[i].first;
 
-        vlc_mutex_lock( &worker->tail.lock );
-        {
-            if( vlc_array_count( &worker->tail.data ) )
-            {
-                item = vlc_array_item_at_index( &worker->tail.data, 0 );
-                handle = NULL;
+        if( item == NULL )
+            continue;
 
-                vlc_array_remove( &worker->tail.data, 0 );
-            }
+        worker->lanes[i].first = item->next;
+        if( item->next == NULL )
+            worker->lanes[i].last = &worker->lanes[i].first;
+        worker->pending--;
+        return item;
+    }
+    return NULL;
+}
 
-            vlc_mutex_lock( &worker->head.lock );
-            {
-                worker->head.deadline = INT64_MAX;
-                worker->head.active = item != NULL;
-                worker->head.id = item ? item->id : NULL;
+static void* Thread( void* data )
+{
+    struct background_worker* worker = data;
+    struct bg_running_task task;
 
-                if( item && item->timeout > 0 )
-                    worker->head.deadline = mdate() + item->timeout * 1000;
-            }
-            vlc_cond_broadcast( &worker->head.wait );
-            vlc_mutex_unlock( &worker->head.lock );
-        }
-        vlc_mutex_unlock( &worker->tail.lock );
+    vlc_mutex_lock( &worker->lock );
+    for( ;; )
+    {
+        struct bg_queued_item* item = QueuePop( worker );
+        void* handle = NULL;
 
         if( item == NULL )
             break;
 
+        task.id = item->id;
+        task.probe_request = false;
+        task.deadline = INT64_MAX;
+        if( item->timeout > 0 )
+            task.deadline = mdate() + item->timeout * 1000;
+        vlc_array_append( &worker->running, &task );
+        vlc_mutex_unlock( &worker->lock );
+
         if( worker->conf.pf_start( worker->owner, item->entity, &handle ) )
         {
             worker->conf.pf_release( item->entity );
             free( item );
-            continue;
+            goto next;
         }
 
         for( ;; )
         {
-            vlc_mutex_lock( &worker->head.lock );
+            vlc_mutex_lock( &worker->lock );
 
-            bool const b_timeout = worker->head.deadline <= mdate();
-            worker->head.probe_request = false;
+            bool const b_timeout = task.deadline <= mdate();
+            task.probe_request = false;
 
-            vlc_mutex_unlock( &worker->head.lock );
+            vlc_mutex_unlock( &worker->lock );
 
             if( b_timeout ||
                 worker->conf.pf_probe( worker->owner, handle ) )
@@ -113,49 +124,76 @@ static void* Thread( void* data )
                 break;
             }
 
-            vlc_mutex_lock( &worker->head.lock );
-            if( worker->head.probe_request == false &&
-                worker->head.deadline > mdate() )
-            {
-                vlc_cond_timedwait( &worker->head.wait, &worker->head.lock,
-                                     worker->head.deadline );
-            }
-            vlc_mutex_unlock( &worker->head.lock );
+            vlc_mutex_lock( &worker->lock );
+            if( task.probe_request == false && task.deadline > mdate() )
+                vlc_cond_timedwait( &worker->wait, &worker->lock,
+                                    task.deadline );
+            vlc_mutex_unlock( &worker->lock );
         }
+next:
+        vlc_mutex_lock( &worker->lock );
+        vlc_array_remove( &worker->running,
+                          vlc_array_index_of_item( &worker->running, &task ) );
+        vlc_cond_broadcast( &worker->wait );
     }
 
+    worker->threads--;
+    vlc_cond_broadcast( &worker->wait );
+    vlc_mutex_unlock( &worker->lock );
     return NULL;
 }
 
+static bool TaskMatches( struct background_worker* worker, void* id )
+{
+    for( size_t i = 0; i < vlc_array_count( &worker->running ); i++ )
+    {
+        struct bg_running_task* task =
+            vlc_array_item_at_index( &worker->running, i );
+
+        if( id == NULL || task->id == id )
+            return true;
+    }
+    return false;
+}
+
 static void BackgroundWorkerCancel( struct background_worker* worker, void* id)
 {
-    vlc_mutex_lock( &worker->tail.lock );
-    for( size_t i = 0; i < vlc_array_count( &worker->tail.data ); )
+    vlc_mutex_lock( &worker->lock );
+    for( size_t i = 0; i < ARRAY_SIZE( worker->lanes ); i++ )
     {
-        struct bg_queued_item* item =
-            vlc_array_item_at_index( &worker->tail.data, i );
+        struct bg_queued_item** pp = &worker->lanes[i].first;
 
-        if( id == NULL || item->id == id )
+        while( *pp != NULL )
         {
-            vlc_array_remove( &worker->tail.data, i );
-            worker->conf.pf_release( item->entity );
-            free( item );
-            continue;
-        }
+            struct bg_queued_item* item = *pp;
 
-        ++i;
+            if( id == NULL || item->id == id )
+            {
+                *pp = item->next;
+                worker->pending--;
+                worker->conf.pf_release( item->entity );
+                free( item );
+                continue;
+            }
+            pp = &item->next;
+        }
+        worker->lanes[i].last = pp;
     }
-    vlc_mutex_unlock( &worker->tail.lock );
 
-    vlc_mutex_lock( &worker->head.lock );
-    while( ( id == NULL && worker->head.active )
-        || ( id != NULL && worker->head.id == id ) )
+    while( TaskMatches( worker, id ) )
     {
-        worker->head.deadline = VLC_TS_0;
-        vlc_cond_broadcast( &worker->head.wait );
-        vlc_cond_wait( &worker->head.wait, &worker->head.lock );
+        for( size_t i = 0; i < vlc_array_count( &worker->running ); i++ )
+        {
+            struct bg_running_task* task =
+                vlc_array_item_at_index( &worker->running, i );
+
+            if( id == NULL || task->id == id )
+                task->deadline = VLC_TS_0;
+        }
+        vlc_cond_broadcast( &worker->wait );
+        vlc_cond_wait( &worker->wait, &worker->lock );
     }
-    vlc_mutex_unlock( &worker->head.lock );
+    vlc_mutex_unlock( &worker->lock );
 }
 
 struct background_worker* background_worker_New( void* owner,
@@ -168,21 +206,26 @@ struct background_worker* background_worker_New( void* owner,
 
     worker->conf = *conf;
     worker->owner = owner;
-    worker->head.id = NULL;
-    worker->head.active = false;
-    worker->head.deadline = VLC_TS_INVALID;
 
-    vlc_mutex_init( &worker->head.lock );
-    vlc_cond_init( &worker->head.wait );
+    vlc_mutex_init( &worker->lock );
+    vlc_cond_init( &worker->wait );
 
-    vlc_array_init( &worker->tail.data );
-    vlc_mutex_init( &worker->tail.lock );
+    for( size_t i = 0; i < ARRAY_SIZE( worker->lanes ); i++ )
+    {
+        worker->lanes[i].first = NULL;
+        worker->lanes[i].last = &worker->lanes[i].first;
+    }
+    worker->pending = 0;
+    vlc_array_init( &worker->running );
+    worker->threads = 0;
+    worker->max_threads = conf->max_threads > 0 ? (unsigned)conf->max_threads
+                                                : vlc_GetCPUCount();
 
     return worker;
 }
 
 int background_worker_Push( struct background_worker* worker, void* entity,
-                        void* id, int timeout )
+                        void* id, int timeout, bool urgent )
 {
     struct bg_queued_item* item = malloc( sizeof( *item ) );
 
@@ -192,26 +235,43 @@ int background_worker_Push( struct background_worker* worker, void* entity,
     item->id = id;
     item->entity = entity;
     item->timeout = timeout < 0 ? worker->conf.default_timeout : timeout;
-
-    vlc_mutex_lock( &worker->tail.lock );
-    vlc_array_append( &worker->tail.data, item );
-    vlc_mutex_unlock( &worker->tail.lock );
-
-    vlc_mutex_lock( &worker->head.lock );
-    if( worker->head.active == false )
+    item->next = NULL;
+
+    worker->conf.pf_hold( item->entity );
+
+    vlc_mutex_lock( &worker->lock );
+    struct bg_queued_item** plast = worker->lanes[urgent ? 0 : 1].last;
+    *plast = item;
+    worker->lanes[urgent ? 0 : 1].last = &item->next;
+    worker->pending++;
+
+    /* Threads only quit once the queue is empty. The idle ones, including
+     * those just started, will each dequeue one entity: spawn more as long
+     * as there are more entities than that. */
+    while( worker->threads < worker->max_threads
+        && worker->pending > worker->threads
+                             - vlc_array_count( &worker->running ) )
     {
-        worker->head.probe_request = false;
-        worker->head.active =
-            !vlc_clone_detach( NULL, Thread, worker, VLC_THREAD_PRIORITY_LOW );
+        if( vlc_clone_detach( NULL, Thread, worker,
+                              VLC_THREAD_PRIORITY_LOW ) )
+            break;
+        worker->threads++;
     }
 
-    if( worker->head.active )
-        worker->conf.pf_hold( item->entity );
+    if( unlikely( worker->threads == 0 ) )
+    {   /* nobody will ever process it */
+        *plast = NULL;
+        worker->lanes[urgent ? 0 : 1].last = plast;
+        worker->pending--;
+        vlc_mutex_unlock( &worker->lock );
 
-    int ret = worker->head.active ? VLC_SUCCESS : VLC_EGENERIC;
-    vlc_mutex_unlock( &worker->head.lock );
+        worker->conf.pf_release( item->entity );
+        free( item );
+        return VLC_EGENERIC;
+    }
+    vlc_mutex_unlock( &worker->lock );
 
-    return ret;
+    return VLC_SUCCESS;
 }
 
 void background_worker_Cancel( struct background_worker* worker, void* id )
@@ -221,15 +281,30 @@ void background_worker_Cancel( struct background_worker* worker, void* id )
 
 void background_worker_RequestProbe( struct background_worker* worker )
 {
-    vlc_mutex_lock( &worker->head.lock );
-    worker->head.probe_request = true;
-    vlc_cond_broadcast( &worker->head.wait );
-    vlc_mutex_unlock( &worker->head.lock );
+    vlc_mutex_lock( &worker->lock );
+    for( size_t i = 0; i < vlc_array_count( &worker->running ); i++ )
+    {
+        struct bg_running_task* task =
+            vlc_array_item_at_index( &worker->running, i );
+
+        task->probe_request = true;
+    }
+    vlc_cond_broadcast( &worker->wait );
+    vlc_mutex_unlock( &worker->lock );
 }
 
 void background_worker_Delete( struct background_worker* worker )
 {
     BackgroundWorkerCancel( worker, NULL );
-    vlc_array_clear( &worker->tail.data );
+
+    /* wait for the idle threads to notice the empty queue */
+    vlc_mutex_lock( &worker->lock );
+    while( worker->threads > 0 )
+        vlc_cond_wait( &worker->wait, &worker->lock );
+    vlc_mutex_unlock( &worker->lock );
+
+    vlc_array_clear( &worker->running );
+    vlc_cond_destroy( &worker->wait );
+    vlc_mutex_destroy( &worker->lock );
     free( worker );
 }
@@ -29,6 +29,15 @@ struct background_worker_config {
      **/
     mtime_t default_timeout;
 
+    /**
+     * Maximum number of tasks processed concurrently
+     *
+     * Each task is processed by its own thread. Threads are created on demand
+     * and exit when there is no more pending work. A value less-than or equal
+     * to 0 denotes the number of CPU cores.
+     **/
+    int max_threads;
+
     /**
      * Release an entity
      *
@@ -119,10 +128,10 @@ struct background_worker* background_worker_New( void* owner,
     struct background_worker_config* config );
 
 /**
- * Request the background-worker to probe the current task
+ * Request the background-worker to probe the running tasks
  *
  * This function is used to signal the background-worker that it should do
- * another probe to see whether the current task is still alive.
+ * another probe to see whether the running tasks are still alive.
  *
  * \warning Note that the function will not wait for the probing to finish, it
  *          will simply ask the background worker to recheck it as soon as
@@ -136,8 +145,9 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * Push an entity into the background-worker
  *
  * This function is used to push an entity into the queue of pending work. The
- * entities will be processed in the order in which they are received (in terms
- * of the order of invocations in a single-threaded environment).
+ * entities will be started in the order in which they are received (in terms
+ * of the order of invocations in a single-threaded environment), urgent ones
+ * before all others.
  *
  * \param worker the background-worker
  * \param entity the entity which is to be queued
@@ -145,11 +155,13 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * \param timeout the timeout of the entity in milliseconds, `0` denotes no
  *                timeout, a negative value will use the default timeout
  *                associated with the background-worker.
+ * \param urgent true to queue the entity ahead of the non-urgent ones, e.g.
+ *               because it is visible to the user
  * \return VLC_SUCCESS if the entity was successfully queued, an error-code on
  *         failure.
  **/
 int background_worker_Push( struct background_worker* worker, void* entity,
-    void* id, int timeout );
+    void* id, int timeout, bool urgent );
 
 /**
  * Remove entities from the background-worker
@@ -163,7 +175,7 @@ int background_worker_Push( struct background_worker* worker, void* entity,
  *
  * \param worker the background-worker
  * \param id NULL if every entity shall be removed, and the currently running
- *        task (if any) shall be cancelled.
+ *        tasks (if any) shall be cancelled.
  **/
 void background_worker_Cancel( struct background_worker* worker, void* id );
 
@@ -171,11 +183,11 @@ void background_worker_Cancel( struct background_worker* worker, void* id );
  * Delete a background-worker
  *
  * This function will destroy a background-worker created through \ref
- * background_worker_New. It will effectively stop the currently running task,
+ * background_worker_New. It will effectively stop the currently running tasks,
  * if any, and empty the queue of pending entities.
  *
- * \warning If there is a currently running task, the function will block until
- *          it has been stopped.
+ * \warning If there are currently running tasks, the function will block until
+ *          they have been stopped.
  *
  * \param worker the background-worker
  **/
@@ -34,6 +34,8 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
+#include "libvlc.h"
 
 #ifndef NDEBUG
 static void BlockNoRelease( block_t *b )
@@ -117,6 +119,270 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+/*
+ * Block recycling pool
+ *
+ * Small and medium blocks are recycled through per-thread caches, split into
+ * power-of-two size classes. A block released by its allocating thread goes
+ * back to that thread's cache directly, without any atomic operation. A block
+ * released by any other thread is pushed onto a lock-free return stack of the
+ * owner cache, which the owner drains when its own lists run out.
+ *
+ * When the owner thread exits, its return stack is closed. Blocks still in
+ * use are then freed directly on release, and the last one frees the cache.
+ */
+
+/** Smallest pooled allocation (header included), as a power of two */
+#define BLOCK_POOL_MIN_SHIFT 9 /* 512 bytes */
+/** Number of size classes: 512 bytes to 64 KiB */
+#define BLOCK_POOL_CLASSES   8
+/** Maximum cached bytes per thread and size class */
+#define BLOCK_POOL_CACHE     (64 * 1024)
+/** Return stack value of a cache whose owner thread has exited */
+#define BLOCK_POOL_CLOSED    ((uintptr_t)1)
+
+typedef struct block_cache block_cache_t;
+
+typedef struct
+{
+    block_t        self;
+    block_cache_t *cache; /**< owner cache */
+    unsigned       class;
+} block_pooled_t;
+
+struct block_cache
+{
+    block_t         *free[BLOCK_POOL_CLASSES];
+    unsigned         count[BLOCK_POOL_CLASSES];
+    size_t           inuse; /**< blocks handed out and not returned yet */
+    block_pool_stats_t stats; /**< not yet accounted globally */
+    atomic_uintptr_t returned; /**< blocks released by other threads */
+    atomic_intptr_t  orphans; /**< blocks in use after the owner exited */
+};
+
+static struct
+{
+    atomic_ullong allocs;
+    atomic_ullong hits;
+    atomic_ullong remote;
+    atomic_ullong caches;
+} block_pool_stats;
+
+static thread_local block_cache_t *block_cache;
+static vlc_threadvar_t block_cache_key;
+static bool block_cache_key_ok = false;
+static vlc_mutex_t block_cache_lock = VLC_STATIC_MUTEX;
+
+static size_t block_pool_Size (unsigned class)
+{
+    return ((size_t)1) << (class + BLOCK_POOL_MIN_SHIFT);
+}
+
+static unsigned block_pool_Limit (unsigned class)
+{
+    size_t limit = BLOCK_POOL_CACHE >> (class + BLOCK_POOL_MIN_SHIFT);
+    return (limit > 2) ? limit : 2;
+}
+
+static void block_cache_Push (block_cache_t *cache, block_t *b)
+{
+    unsigned class = ((block_pooled_t *)b)->class;
+
+    if (cache->count[class] < block_pool_Limit (class))
+    {
+        b->p_next = cache->free[class];
+        cache->free[class] = b;
+        cache->count[class]++;
+    }
+    else
+        free (b);
+}
+
+/** Takes the blocks released by other threads over */
+static void block_cache_Drain (block_cache_t *cache, uintptr_t head)
+{
+    head = atomic_exchange_explicit (&cache->returned, head,
+                                     memory_order_acquire);
+    assert (head != BLOCK_POOL_CLOSED);
+
+    while (head != 0)
+    {
+        block_t *b = (block_t *)head;
+
+        head = (uintptr_t)b->p_next;
+        block_cache_Push (cache, b);
+        cache->inuse--;
+        cache->stats.remote++;
+    }
+}
+
+static void block_cache_Flush (block_cache_t *cache)
+{
+    atomic_fetch_add_explicit (&block_pool_stats.allocs, cache->stats.allocs,
+                               memory_order_relaxed);
+    atomic_fetch_add_explicit (&block_pool_stats.hits, cache->stats.hits,
+                               memory_order_relaxed);
+    atomic_fetch_add_explicit (&block_pool_stats.remote, cache->stats.remote,
+                               memory_order_relaxed);
+    cache->stats.allocs = cache->stats.hits = cache->stats.remote = 0;
+}
+
+/** Thread exit handler */
+static void block_cache_Release (void *data)
+{
+    block_cache_t *cache = data;
+
+    block_cache_Drain (cache, BLOCK_POOL_CLOSED);
+    block_cache_Flush (cache);
+
+    for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+    {
+        block_t *b;
+
+        while ((b = cache->free[i]) != NULL)
+        {
+            cache->free[i] = b->p_next;
+            free (b);
+        }
+    }
+
+    if (block_cache == cache)
+        block_cache = NULL;
+
+    /* Remaining blocks are released by other threads, maybe already. */
+    if (atomic_fetch_add_explicit (&cache->orphans, cache->inuse,
+                                   memory_order_acq_rel)
+         + (intptr_t)cache->inuse == 0)
+        free (cache);
+}
+
+static block_cache_t *block_cache_Get (void)
+{
+    block_cache_t *cache = block_cache;
+    if (likely(cache != NULL))
+        return cache;
+
+    cache = malloc (sizeof (*cache));
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+    {
+        cache->free[i] = NULL;
+        cache->count[i] = 0;
+    }
+    cache->inuse = 0;
+    cache->stats.allocs = cache->stats.hits = cache->stats.remote = 0;
+    atomic_init (&cache->returned, 0);
+    atomic_init (&cache->orphans, 0);
+
+    /* Register the cache for release on thread exit. */
+    vlc_mutex_lock (&block_cache_lock);
+    if (!block_cache_key_ok)
+        block_cache_key_ok =
+            vlc_threadvar_create (&block_cache_key, block_cache_Release) == 0;
+    if (!block_cache_key_ok
+     || vlc_threadvar_set (block_cache_key, cache) != 0)
+    {
+        vlc_mutex_unlock (&block_cache_lock);
+        free (cache);
+        return NULL;
+    }
+    vlc_mutex_unlock (&block_cache_lock);
+
+    atomic_fetch_add_explicit (&block_pool_stats.caches, 1,
+                               memory_order_relaxed);
+    block_cache = cache;
+    return cache;
+}
+
+static void block_pool_Release (block_t *block)
+{
+    block_pooled_t *b = (block_pooled_t *)block;
+    block_cache_t *cache = b->cache;
+
+    assert (block->p_start == (unsigned char *)(b + 1));
+    block_Invalidate (block);
+
+    if (cache == block_cache)
+    {
+        block_cache_Push (cache, block);
+        cache->inuse--;
+        return;
+    }
+
+    uintptr_t head = atomic_load_explicit (&cache->returned,
+                                           memory_order_relaxed);
+    do
+    {
+        if (head == BLOCK_POOL_CLOSED)
+        {   /* The owner thread has exited. */
+            free (b);
+            if (atomic_fetch_sub_explicit (&cache->orphans, 1,
+                                           memory_order_acq_rel) == 1)
+                free (cache);
+            return;
+        }
+        block->p_next = (block_t *)head;
+    }
+    while (!atomic_compare_exchange_weak_explicit (&cache->returned, &head,
+                       (uintptr_t)block, memory_order_release,
+                       memory_order_relaxed));
+}
+
+static block_t *block_pool_Alloc (size_t alloc)
+{
+    unsigned class = 0;
+
+    while (block_pool_Size (class) < alloc)
+        if (++class >= BLOCK_POOL_CLASSES)
+            return NULL;
+
+    block_cache_t *cache = block_cache_Get ();
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    if (cache->free[class] == NULL
+     && atomic_load_explicit (&cache->returned, memory_order_relaxed) != 0)
+        block_cache_Drain (cache, 0);
+
+    block_pooled_t *b = (block_pooled_t *)cache->free[class];
+    if (b != NULL)
+    {
+        cache->free[class] = b->self.p_next;
+        cache->count[class]--;
+        cache->stats.hits++;
+    }
+    else
+    {
+        b = malloc (block_pool_Size (class));
+        if (unlikely(b == NULL))
+            return NULL;
+    }
+
+    cache->inuse++;
+    if (unlikely(++cache->stats.allocs >= 4096))
+        block_cache_Flush (cache);
+
+    b->cache = cache;
+    b->class = class;
+    block_Init (&b->self, b + 1, block_pool_Size (class) - sizeof (*b));
+    b->self.pf_release = block_pool_Release;
+    return &b->self;
+}
+
+void block_PoolStats (block_pool_stats_t *st)
+{
+    st->allocs = atomic_load_explicit (&block_pool_stats.allocs,
+                                       memory_order_relaxed);
+    st->hits = atomic_load_explicit (&block_pool_stats.hits,
+                                     memory_order_relaxed);
+    st->remote = atomic_load_explicit (&block_pool_stats.remote,
+                                       memory_order_relaxed);
+    st->caches = atomic_load_explicit (&block_pool_stats.caches,
+                                       memory_order_relaxed);
+}
+
 block_t *block_Alloc (size_t size)
 {
     /* 2 * BLOCK_PADDING: pre + post padding */
@@ -125,20 +391,144 @@ block_t *block_Alloc (size_t size)
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
-    if (unlikely(b == NULL))
-        return NULL;
+    block_t *b = block_pool_Alloc (alloc - sizeof (block_t)
+                                   + sizeof (block_pooled_t));
+    if (b == NULL)
+    {
+        b = malloc (alloc);
+        if (unlikely(b == NULL))
+            return NULL;
+
+        block_Init (b, b + 1, alloc - sizeof (*b));
+        b->pf_release = block_generic_Release;
+    }
 
-    block_Init (b, b + 1, alloc - sizeof (*b));
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
                    "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
     b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
     b->i_buffer = size;
-    b->pf_release = block_generic_Release;
     return b;
 }
 
+/*
+ * Shared blocks
+ *
+ * Shared blocks are references to the payload of an origin block, which is
+ * released with the last of them. Each reference only covers the payload as
+ * it was when the reference was made, so that reallocations which grow it
+ * copy it, rather than writing over the other references' data.
+ */
+typedef struct
+{
+    atomic_uint refs;
+    block_t    *origin;
+} block_payload_t;
+
+typedef struct
+{
+    block_t          self;
+    block_payload_t *payload;
+} block_shared_t;
+
+static void block_shared_Release (block_t *block)
+{
+    block_shared_t *shared = container_of (block, block_shared_t, self);
+    block_payload_t *payload = shared->payload;
+
+    block_Invalidate (block);
+    free (shared);
+
+    if (atomic_fetch_sub_explicit (&payload->refs, 1,
+                                   memory_order_acq_rel) == 1)
+    {
+        block_Release (payload->origin);
+        free (payload);
+    }
+}
+
+static block_t *block_shared_New (block_payload_t *payload,
+                                  const block_t *from)
+{
+    block_shared_t *shared = malloc (sizeof (*shared));
+    if (unlikely(shared == NULL))
+        return NULL;
+
+    block_Init (&shared->self, from->p_buffer, from->i_buffer);
+    BlockMetaCopy (&shared->self, from);
+    shared->self.p_next = NULL;
+    shared->self.pf_release = block_shared_Release;
+    shared->payload = payload;
+    return &shared->self;
+}
+
+/** Whether the payload of a block is referenced by other blocks */
+static bool block_IsShared (const block_t *block)
+{
+    if (block->pf_release != block_shared_Release)
+        return false;
+
+    const block_shared_t *shared = container_of (block, block_shared_t, self);
+    return atomic_load_explicit (&shared->payload->refs,
+                                 memory_order_acquire) > 1;
+}
+
+block_t *block_Share (block_t *block)
+{
+    if (block->pf_release == block_shared_Release)
+        return block;
+
+    block_payload_t *payload = malloc (sizeof (*payload));
+    if (unlikely(payload == NULL))
+    {
+        block_Release (block);
+        return NULL;
+    }
+    atomic_init (&payload->refs, 1);
+    payload->origin = block;
+
+    block_t *shared = block_shared_New (payload, block);
+    if (unlikely(shared == NULL))
+    {
+        free (payload);
+        block_Release (block);
+    }
+    else
+        block->p_next = NULL;
+    return shared;
+}
+
+block_t *block_Hold (block_t *block)
+{
+    if (block->pf_release != block_shared_Release)
+        return block_Duplicate (block);
+
+    block_shared_t *shared = container_of (block, block_shared_t, self);
+    block_t *ref = block_shared_New (shared->payload, block);
+    if (likely(ref != NULL))
+        atomic_fetch_add_explicit (&shared->payload->refs, 1,
+                                   memory_order_relaxed);
+    return ref;
+}
+
+block_t *block_Writable (block_t *block)
+{
+    if (!block_IsShared (block))
+        return block;
+
+    block_t *copy = block_Alloc (block->i_buffer);
+    if (unlikely(copy == NULL))
+    {
+        block_Release (block);
+        return NULL;
+    }
+
+    memcpy (copy->p_buffer, block->p_buffer, block->i_buffer);
+    BlockMetaCopy (copy, block);
+    block_Release (block);
+    return copy;
+}
+
 block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 {
     block_Check( p_block );
@@ -172,10 +562,12 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
         p_block->i_buffer = i_body;
 
     size_t requested = i_prebody + i_body;
+    /* Never expand over the payload of other references */
+    const bool b_shared = block_IsShared( p_block );
 
     if( p_block->i_buffer == 0 )
     {   /* Corner case: nothing to preserve */
-        if( requested <= p_block->i_size )
+        if( requested <= p_block->i_size && (!b_shared || requested == 0) )
         {   /* Enough room: recycle buffer */
             size_t extra = p_block->i_size - requested;
 
@@ -200,7 +592,8 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
     /* Second, reallocate the buffer if we lack space. */
     assert( i_prebody >= 0 );
     if( (size_t)(p_block->p_buffer - p_start) < (size_t)i_prebody
-     || (size_t)(p_end - p_block->p_buffer) < i_body )
+     || (size_t)(p_end - p_block->p_buffer) < i_body
+     || (b_shared && (i_prebody > 0 || i_body > p_block->i_buffer)) )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea == NULL )
@@ -30,8 +30,12 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "libvlc.h"
 
+/** Number of slots of the lock-free ring of single producer FIFOs */
+#define FIFO_SPSC_SLOTS 256
+
 /**
  * Internal state for block queues
  */
@@ -44,8 +48,80 @@ struct block_fifo_t
     block_t             **pp_last;
     size_t              i_depth;
     size_t              i_size;
+
+    /* Single producer, single consumer mode (ring == NULL otherwise).
+     * Blocks are queued to the lock-free ring first. Once the ring is full,
+     * the producer falls back to the locked list until the consumer has
+     * emptied it, so that the ring always holds the oldest blocks. */
+    struct
+    {
+        block_t       **ring;
+        atomic_uint     head; /**< next slot to read, owned by the consumer */
+        atomic_uint     tail; /**< next slot to write, owned by the producer */
+        atomic_size_t   bytes; /**< bytes in the ring */
+        atomic_bool     overflow; /**< the locked list is in use */
+        atomic_bool     waiting; /**< the consumer may be sleeping */
+    } spsc;
 };
 
+static bool vlc_fifo_IsSPSC(const vlc_fifo_t *fifo)
+{
+    return fifo->spsc.ring != NULL;
+}
+
+/** Queues one block to the ring (producer side) */
+static bool vlc_fifo_PushSPSC(vlc_fifo_t *fifo, block_t *block)
+{
+    unsigned tail = atomic_load_explicit(&fifo->spsc.tail,
+                                         memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&fifo->spsc.head,
+                                         memory_order_acquire);
+
+    if (tail - head >= FIFO_SPSC_SLOTS)
+        return false; /* full */
+
+    fifo->spsc.ring[tail % FIFO_SPSC_SLOTS] = block;
+    atomic_fetch_add_explicit(&fifo->spsc.bytes, block->i_buffer,
+                              memory_order_relaxed);
+    atomic_store(&fifo->spsc.tail, tail + 1);
+    return true;
+}
+
+/** Dequeues one block from the ring (consumer side) */
+static block_t *vlc_fifo_PopSPSC(vlc_fifo_t *fifo)
+{
+    unsigned head = atomic_load_explicit(&fifo->spsc.head,
+                                         memory_order_relaxed);
+    unsigned tail = atomic_load(&fifo->spsc.tail);
+
+    if (head == tail)
+        return NULL; /* empty */
+
+    block_t *block = fifo->spsc.ring[head % FIFO_SPSC_SLOTS];
+    atomic_store_explicit(&fifo->spsc.head, head + 1, memory_order_release);
+    atomic_fetch_sub_explicit(&fifo->spsc.bytes, block->i_buffer,
+                              memory_order_relaxed);
+    return block;
+}
+
+static size_t vlc_fifo_CountSPSC(const vlc_fifo_t *fifo)
+{
+    vlc_fifo_t *f = (vlc_fifo_t *)fifo;
+
+    return atomic_load_explicit(&f->spsc.tail, memory_order_acquire)
+         - atomic_load_explicit(&f->spsc.head, memory_order_acquire);
+}
+
+/** Flags the consumer as sleeping, then checks the ring again */
+static bool vlc_fifo_PrepareWaitSPSC(vlc_fifo_t *fifo)
+{
+    /* Pairs with the producer storing the tail, then checking the flag:
+     * either the consumer sees the new block or the producer sees the flag. */
+    atomic_store(&fifo->spsc.waiting, true);
+    return atomic_load(&fifo->spsc.tail)
+        == atomic_load_explicit(&fifo->spsc.head, memory_order_relaxed);
+}
+
 void vlc_fifo_Lock(vlc_fifo_t *fifo)
 {
     vlc_mutex_lock(&fifo->lock);
@@ -63,6 +139,15 @@ void vlc_fifo_Signal(vlc_fifo_t *fifo)
 
 void vlc_fifo_Wait(vlc_fifo_t *fifo)
 {
+    if (vlc_fifo_IsSPSC(fifo))
+    {
+        if (!vlc_fifo_PrepareWaitSPSC(fifo))
+            return; /* spurious wakeup */
+        vlc_fifo_WaitCond(fifo, &fifo->wait);
+        atomic_store_explicit(&fifo->spsc.waiting, false,
+                              memory_order_relaxed);
+        return;
+    }
     vlc_fifo_WaitCond(fifo, &fifo->wait);
 }
 
@@ -78,11 +163,16 @@ int vlc_fifo_TimedWaitCond(vlc_fifo_t *fifo, vlc_cond_t *condvar, mtime_t deadli
 
 size_t vlc_fifo_GetCount(const vlc_fifo_t *fifo)
 {
+    if (vlc_fifo_IsSPSC(fifo))
+        return fifo->i_depth + vlc_fifo_CountSPSC(fifo);
     return fifo->i_depth;
 }
 
 size_t vlc_fifo_GetBytes(const vlc_fifo_t *fifo)
 {
+    if (vlc_fifo_IsSPSC(fifo))
+        return fifo->i_size + atomic_load_explicit(
+                          &((vlc_fifo_t *)fifo)->spsc.bytes, memory_order_relaxed);
     return fifo->i_size;
 }
 
@@ -91,6 +181,10 @@ void vlc_fifo_QueueUnlocked(block_fifo_t *fifo, block_t *block)
     vlc_assert_locked(&fifo->lock);
     assert(*(fifo->pp_last) == NULL);
 
+    if (vlc_fifo_IsSPSC(fifo) && block != NULL)
+        atomic_store_explicit(&fifo->spsc.overflow, true,
+                              memory_order_relaxed);
+
     *(fifo->pp_last) = block;
 
     while (block != NULL)
@@ -109,6 +203,13 @@ block_t *vlc_fifo_DequeueUnlocked(block_fifo_t *fifo)
 {
     vlc_assert_locked(&fifo->lock);
 
+    if (vlc_fifo_IsSPSC(fifo))
+    {
+        block_t *block = vlc_fifo_PopSPSC(fifo);
+        if (block != NULL)
+            return block;
+    }
+
     block_t *block = fifo->p_first;
 
     if (block == NULL)
@@ -116,7 +217,12 @@ block_t *vlc_fifo_DequeueUnlocked(block_fifo_t *fifo)
 
     fifo->p_first = block->p_next;
     if (block->p_next == NULL)
+    {
         fifo->pp_last = &fifo->p_first;
+        if (vlc_fifo_IsSPSC(fifo))
+            atomic_store_explicit(&fifo->spsc.overflow, false,
+                                  memory_order_relaxed);
+    }
     block->p_next = NULL;
 
     assert(fifo->i_depth > 0);
@@ -131,22 +237,53 @@ block_t *vlc_fifo_DequeueAllUnlocked(block_fifo_t *fifo)
 {
     vlc_assert_locked(&fifo->lock);
 
-    block_t *block = fifo->p_first;
+    block_t *head = NULL, **pp_last = &head;
+
+    if (vlc_fifo_IsSPSC(fifo))
+    {
+        block_t *block;
+
+        while ((block = vlc_fifo_PopSPSC(fifo)) != NULL)
+        {
+            *pp_last = block;
+            pp_last = &block->p_next;
+        }
+        atomic_store_explicit(&fifo->spsc.overflow, false,
+                              memory_order_relaxed);
+    }
+
+    *pp_last = fifo->p_first;
 
     fifo->p_first = NULL;
     fifo->pp_last = &fifo->p_first;
     fifo->i_depth = 0;
     fifo->i_size = 0;
 
-    return block;
+    return head;
 }
 
-block_fifo_t *block_FifoNew( void )
+static block_fifo_t *block_FifoCreate(bool spsc)
 {
     block_fifo_t *p_fifo = malloc( sizeof( block_fifo_t ) );
     if( !p_fifo )
         return NULL;
 
+    p_fifo->spsc.ring = NULL;
+    if( spsc )
+    {
+        p_fifo->spsc.ring = malloc( FIFO_SPSC_SLOTS * sizeof( block_t * ) );
+        if( unlikely(p_fifo->spsc.ring == NULL) )
+        {
+            free( p_fifo );
+            return NULL;
+        }
+    }
+    atomic_init( &p_fifo->spsc.head, 0 );
+    atomic_init( &p_fifo->spsc.tail, 0 );
+    atomic_init( &p_fifo->spsc.bytes, 0 );
+    atomic_init( &p_fifo->spsc.overflow, false );
+    atomic_init( &p_fifo->spsc.waiting, false );
+
     vlc_mutex_init( &p_fifo->lock );
     vlc_cond_init( &p_fifo->wait );
     p_fifo->p_first = NULL;
@@ -156,8 +293,26 @@ block_fifo_t *block_FifoNew( void )
     return p_fifo;
 }
 
+block_fifo_t *block_FifoNew( void )
+{
+    return block_FifoCreate( false );
+}
+
+block_fifo_t *block_FifoNewSPSC( void )
+{
+    return block_FifoCreate( true );
+}
+
 void block_FifoRelease( block_fifo_t *p_fifo )
 {
+    if( vlc_fifo_IsSPSC( p_fifo ) )
+    {
+        block_t *block;
+
+        while( (block = vlc_fifo_PopSPSC( p_fifo )) != NULL )
+            block_Release( block );
+        free( p_fifo->spsc.ring );
+    }
     block_ChainRelease( p_fifo->p_first );
     vlc_cond_destroy( &p_fifo->wait );
     vlc_mutex_destroy( &p_fifo->lock );
@@ -174,8 +329,44 @@ void block_FifoEmpty(block_fifo_t *fifo)
     block_ChainRelease(block);
 }
 
+static void block_FifoPutSPSC(block_fifo_t *fifo, block_t *block)
+{
+    while (block != NULL
+        && !atomic_load_explicit(&fifo->spsc.overflow, memory_order_relaxed))
+    {
+        block_t *next = block->p_next;
+
+        block->p_next = NULL;
+        if (!vlc_fifo_PushSPSC(fifo, block))
+        {
+            block->p_next = next;
+            break;
+        }
+        block = next;
+    }
+
+    if (block != NULL)
+    {   /* Ring full: queue the rest behind the lock */
+        vlc_fifo_Lock(fifo);
+        vlc_fifo_QueueUnlocked(fifo, block);
+        vlc_fifo_Unlock(fifo);
+    }
+    else if (atomic_load(&fifo->spsc.waiting))
+    {
+        vlc_fifo_Lock(fifo);
+        vlc_fifo_Signal(fifo);
+        vlc_fifo_Unlock(fifo);
+    }
+}
+
 void block_FifoPut(block_fifo_t *fifo, block_t *block)
 {
+    if (vlc_fifo_IsSPSC(fifo))
+    {
+        block_FifoPutSPSC(fifo, block);
+        return;
+    }
+
     vlc_fifo_Lock(fifo);
     vlc_fifo_QueueUnlocked(fifo, block);
     vlc_fifo_Unlock(fifo);
@@ -187,6 +378,9 @@ block_t *block_FifoGet(block_fifo_t *fifo)
 
     vlc_testcancel();
 
+    if (vlc_fifo_IsSPSC(fifo) && (block = vlc_fifo_PopSPSC(fifo)) != NULL)
+        return block;
+
     vlc_fifo_Lock(fifo);
     while (vlc_fifo_IsEmpty(fifo))
     {
@@ -205,6 +399,14 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
     block_t *b;
 
     vlc_mutex_lock( &p_fifo->lock );
+    if( vlc_fifo_IsSPSC( p_fifo ) && vlc_fifo_CountSPSC( p_fifo ) > 0 )
+    {
+        unsigned head = atomic_load_explicit( &p_fifo->spsc.head,
+                                              memory_order_relaxed );
+        b = p_fifo->spsc.ring[head % FIFO_SPSC_SLOTS];
+        vlc_mutex_unlock( &p_fifo->lock );
+        return b;
+    }
     assert(p_fifo->p_first != NULL);
     b = p_fifo->p_first;
     vlc_mutex_unlock( &p_fifo->lock );
@@ -218,7 +420,7 @@ size_t block_FifoSize (block_fifo_t *fifo)
     size_t size;
 
     vlc_mutex_lock (&fifo->lock);
-    size = fifo->i_size;
+    size = vlc_fifo_GetBytes(fifo);
     vlc_mutex_unlock (&fifo->lock);
     return size;
 }
@@ -229,7 +431,7 @@ size_t block_FifoCount (block_fifo_t *fifo)
     size_t depth;
 
     vlc_mutex_lock (&fifo->lock);
-    depth = fifo->i_depth;
+    depth = vlc_fifo_GetCount(fifo);
     vlc_mutex_unlock (&fifo->lock);
     return depth;
 }
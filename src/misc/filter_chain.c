@@ -40,6 +40,15 @@ typedef struct chained_filter_t
     struct chained_filter_t *prev, *next;
     vlc_mouse_t *mouse;
     picture_t *pending;
+
+    /* Pipeline stage, see filter_chain_SetPipeline() */
+    vlc_thread_t thread;
+    picture_t *queue; /**< Input pictures */
+    picture_t **queue_last;
+    unsigned queue_count;
+    bool busy; /**< Filtering or queuing the output */
+    uint64_t pictures;
+    mtime_t time;
 } chained_filter_t;
 
 /* Only use this with filter objects from _this_ C module */
@@ -61,12 +70,27 @@ struct filter_chain_t
     bool b_allow_fmt_out_change; /**< Can the output format be changed? */
     const char *filter_cap; /**< Filter modules capability */
     const char *conv_cap; /**< Converter modules capability */
+
+    struct
+    {
+        vlc_mutex_t lock;
+        vlc_cond_t wait_stage; /**< Input picture or room for the filters */
+        vlc_cond_t wait_owner; /**< Output picture, room or idle filter */
+        picture_t *out; /**< Output pictures */
+        picture_t **out_last;
+        unsigned depth; /**< Pictures queued before each filter, 0 if off */
+        unsigned in_flight; /**< Pictures queued or being filtered */
+        bool running;
+        bool flushing;
+        bool stopping;
+    } pipe;
 };
 
 /**
  * Local prototypes
  */
 static void FilterDeletePictures( picture_t * );
+static void PipelineStop( filter_chain_t * );
 
 static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     const char *cap, const char *conv_cap, bool fmt_out_change,
@@ -89,6 +113,17 @@ static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     chain->b_allow_fmt_out_change = fmt_out_change;
     chain->filter_cap = cap;
     chain->conv_cap = conv_cap;
+
+    vlc_mutex_init( &chain->pipe.lock );
+    vlc_cond_init( &chain->pipe.wait_stage );
+    vlc_cond_init( &chain->pipe.wait_owner );
+    chain->pipe.out = NULL;
+    chain->pipe.out_last = &chain->pipe.out;
+    chain->pipe.depth = 0;
+    chain->pipe.in_flight = 0;
+    chain->pipe.running = false;
+    chain->pipe.flushing = false;
+    chain->pipe.stopping = false;
     return chain;
 }
 
@@ -154,6 +189,9 @@ void filter_chain_Delete( filter_chain_t *p_chain )
     es_format_Clean( &p_chain->fmt_in );
     es_format_Clean( &p_chain->fmt_out );
 
+    vlc_cond_destroy( &p_chain->pipe.wait_owner );
+    vlc_cond_destroy( &p_chain->pipe.wait_stage );
+    vlc_mutex_destroy( &p_chain->pipe.lock );
     free( p_chain );
 }
 /**
@@ -182,6 +220,9 @@ static filter_t *filter_chain_AppendInner( filter_chain_t *chain,
     const es_format_t *fmt_in, const es_format_t *fmt_out )
 {
     vlc_object_t *parent = chain->callbacks.sys;
+
+    PipelineStop( chain );
+
     chained_filter_t *chained =
         vlc_custom_create( parent, sizeof(*chained), "filter" );
     if( unlikely(chained == NULL) )
@@ -247,6 +288,10 @@ static filter_t *filter_chain_AppendInner( filter_chain_t *chain,
         vlc_mouse_Init( mouse );
     chained->mouse = mouse;
     chained->pending = NULL;
+    chained->queue = NULL;
+    chained->queue_last = &chained->queue;
+    chained->queue_count = 0;
+    chained->busy = false;
 
     msg_Dbg( parent, "Filter '%s' (%p) appended to chain",
              (name != NULL) ? name : module_get_name(filter->p_module, false),
@@ -284,6 +329,8 @@ void filter_chain_DeleteFilter( filter_chain_t *chain, filter_t *filter )
     vlc_object_t *obj = chain->callbacks.sys;
     chained_filter_t *chained = (chained_filter_t *)filter;
 
+    PipelineStop( chain );
+
     /* Remove it from the chain */
     if( chained->prev != NULL )
         chained->prev->next = chained->next;
@@ -410,8 +457,236 @@ static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic
     return p_pic;
 }
 
+/* Pipelined chain */
+static void QueuePush( picture_t ***ppp_last, picture_t *pic )
+{
+    pic->p_next = NULL;
+    **ppp_last = pic;
+    *ppp_last = &pic->p_next;
+}
+
+static picture_t *QueuePop( picture_t **pp_first, picture_t ***ppp_last )
+{
+    picture_t *pic = *pp_first;
+    if( pic != NULL )
+    {
+        *pp_first = pic->p_next;
+        if( *pp_first == NULL )
+            *ppp_last = pp_first;
+        pic->p_next = NULL;
+    }
+    return pic;
+}
+
+static void *PipelineThread( void *data )
+{
+    chained_filter_t *f = data;
+    filter_t *p_filter = &f->filter;
+    filter_chain_t *chain = p_filter->owner.sys;
+
+    vlc_mutex_lock( &chain->pipe.lock );
+    for( ;; )
+    {
+        while( !chain->pipe.stopping
+            && (f->queue == NULL || chain->pipe.flushing) )
+            vlc_cond_wait( &chain->pipe.wait_stage, &chain->pipe.lock );
+        if( chain->pipe.stopping )
+            break;
+
+        picture_t *p_pic = QueuePop( &f->queue, &f->queue_last );
+        f->queue_count--;
+        f->busy = true;
+        /* There is room for the previous filter or the owner */
+        if( f->prev != NULL )
+            vlc_cond_broadcast( &chain->pipe.wait_stage );
+        else
+            vlc_cond_broadcast( &chain->pipe.wait_owner );
+        vlc_mutex_unlock( &chain->pipe.lock );
+
+        mtime_t i_start = mdate();
+        p_pic = p_filter->pf_video_filter( p_filter, p_pic );
+        mtime_t i_time = mdate() - i_start;
+
+        vlc_mutex_lock( &chain->pipe.lock );
+        f->pictures++;
+        f->time += i_time;
+        chain->pipe.in_flight--;
+
+        while( p_pic != NULL )
+        {
+            picture_t *p_next = p_pic->p_next;
+            chained_filter_t *next = f->next;
+
+            if( next != NULL )
+            {
+                /* While flushing or stopping, the queues are discarded
+                 * once all the filters are idle */
+                while( next->queue_count >= chain->pipe.depth
+                    && !chain->pipe.flushing && !chain->pipe.stopping )
+                    vlc_cond_wait( &chain->pipe.wait_stage, &chain->pipe.lock );
+                QueuePush( &next->queue_last, p_pic );
+                next->queue_count++;
+                chain->pipe.in_flight++;
+                vlc_cond_broadcast( &chain->pipe.wait_stage );
+            }
+            else
+                QueuePush( &chain->pipe.out_last, p_pic );
+            p_pic = p_next;
+        }
+        f->busy = false;
+        vlc_cond_broadcast( &chain->pipe.wait_owner );
+    }
+    vlc_mutex_unlock( &chain->pipe.lock );
+    return NULL;
+}
+
+/* Discards the queued pictures, the filters must be idle */
+static unsigned PipelineDiscard( filter_chain_t *chain )
+{
+    unsigned i_count = 0;
+
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+    {
+        i_count += f->queue_count;
+        FilterDeletePictures( f->queue );
+        f->queue = NULL;
+        f->queue_last = &f->queue;
+        f->queue_count = 0;
+    }
+    for( picture_t *p_pic = chain->pipe.out; p_pic; p_pic = p_pic->p_next )
+        i_count++;
+    FilterDeletePictures( chain->pipe.out );
+    chain->pipe.out = NULL;
+    chain->pipe.out_last = &chain->pipe.out;
+    chain->pipe.in_flight = 0;
+    return i_count;
+}
+
+static bool PipelineStart( filter_chain_t *chain )
+{
+    vlc_object_t *obj = chain->callbacks.sys;
+
+    if( chain->pipe.running )
+        return true;
+    /* A single filter has nothing to run concurrently with */
+    if( chain->pipe.depth == 0
+     || chain->first == NULL || chain->first->next == NULL )
+        return false;
+
+    /* Pictures left by the synchronous mode move to the next queue */
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+    {
+        picture_t *p_pic = f->pending;
+
+        f->pending = NULL;
+        while( p_pic != NULL )
+        {
+            picture_t *p_next = p_pic->p_next;
+
+            if( f->next != NULL )
+            {
+                QueuePush( &f->next->queue_last, p_pic );
+                f->next->queue_count++;
+                chain->pipe.in_flight++;
+            }
+            else
+                QueuePush( &chain->pipe.out_last, p_pic );
+            p_pic = p_next;
+        }
+    }
+
+    unsigned i_count = 0;
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+    {
+        f->pictures = 0;
+        f->time = 0;
+        if( vlc_clone( &f->thread, PipelineThread, f,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            msg_Err( obj, "cannot start filter thread" );
+            /* Stop the threads already started and fall back to the
+             * synchronous mode */
+            vlc_mutex_lock( &chain->pipe.lock );
+            chain->pipe.stopping = true;
+            vlc_cond_broadcast( &chain->pipe.wait_stage );
+            vlc_mutex_unlock( &chain->pipe.lock );
+            for( chained_filter_t *g = chain->first; g != f; g = g->next )
+                vlc_join( g->thread, NULL );
+            PipelineDiscard( chain );
+            chain->pipe.stopping = false;
+            chain->pipe.depth = 0;
+            return false;
+        }
+        i_count++;
+    }
+    msg_Dbg( obj, "pipelining %u filters, %u pictures queued "
+             "per filter", i_count, chain->pipe.depth );
+    chain->pipe.running = true;
+    return true;
+}
+
+static void PipelineStop( filter_chain_t *chain )
+{
+    vlc_object_t *obj = chain->callbacks.sys;
+
+    if( !chain->pipe.running )
+        return;
+
+    vlc_mutex_lock( &chain->pipe.lock );
+    chain->pipe.stopping = true;
+    vlc_cond_broadcast( &chain->pipe.wait_stage );
+    vlc_mutex_unlock( &chain->pipe.lock );
+
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+    {
+        vlc_join( f->thread, NULL );
+        if( f->pictures > 0 )
+            msg_Dbg( &f->filter, "%"PRIu64" pictures in %"PRId64" ms, "
+                     "%"PRId64" us per picture", f->pictures, f->time / 1000,
+                     f->time / (mtime_t)f->pictures );
+    }
+
+    unsigned i_lost = PipelineDiscard( chain );
+    if( i_lost > 0 )
+        msg_Warn( obj, "dropping %u pictures", i_lost );
+    chain->pipe.stopping = false;
+    chain->pipe.running = false;
+}
+
+static picture_t *PipelineVideoFilter( filter_chain_t *chain, picture_t *p_pic,
+                                       bool b_drain )
+{
+    vlc_mutex_lock( &chain->pipe.lock );
+    if( p_pic != NULL )
+    {
+        chained_filter_t *first = chain->first;
+
+        while( first->queue_count >= chain->pipe.depth )
+            vlc_cond_wait( &chain->pipe.wait_owner, &chain->pipe.lock );
+        QueuePush( &first->queue_last, p_pic );
+        first->queue_count++;
+        chain->pipe.in_flight++;
+        vlc_cond_broadcast( &chain->pipe.wait_stage );
+    }
+    if( b_drain )
+        while( chain->pipe.out == NULL && chain->pipe.in_flight > 0 )
+            vlc_cond_wait( &chain->pipe.wait_owner, &chain->pipe.lock );
+    p_pic = QueuePop( &chain->pipe.out, &chain->pipe.out_last );
+    vlc_mutex_unlock( &chain->pipe.lock );
+    return p_pic;
+}
+
+void filter_chain_SetPipeline( filter_chain_t *chain, unsigned depth )
+{
+    PipelineStop( chain );
+    chain->pipe.depth = depth;
+}
+
 picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
 {
+    if( PipelineStart( p_chain ) )
+        return PipelineVideoFilter( p_chain, p_pic, false );
+
     if( p_pic )
     {
         p_pic = FilterChainVideoFilter( p_chain->first, p_pic );
@@ -433,8 +708,29 @@ picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
     return NULL;
 }
 
+picture_t *filter_chain_VideoDrain( filter_chain_t *p_chain )
+{
+    if( p_chain->pipe.running )
+        return PipelineVideoFilter( p_chain, NULL, true );
+    return filter_chain_VideoFilter( p_chain, NULL );
+}
+
 void filter_chain_VideoFlush( filter_chain_t *p_chain )
 {
+    if( p_chain->pipe.running )
+    {
+        vlc_mutex_lock( &p_chain->pipe.lock );
+        p_chain->pipe.flushing = true;
+        vlc_cond_broadcast( &p_chain->pipe.wait_stage );
+        for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
+            while( f->busy )
+                vlc_cond_wait( &p_chain->pipe.wait_owner, &p_chain->pipe.lock );
+        PipelineDiscard( p_chain );
+        p_chain->pipe.flushing = false;
+        vlc_mutex_unlock( &p_chain->pipe.lock );
+        /* The filters are idle until the next picture */
+    }
+
     for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
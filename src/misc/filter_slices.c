@@ -0,0 +1,266 @@
+/*****************************************************************************
+ * filter_slices.c : slice threading for video filters
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+
+/* A call to filter_slices_Run(), living on the stack of its caller */
+typedef struct slice_job_t slice_job_t;
+struct slice_job_t
+{
+    slice_job_t    *p_next;
+    filter_slice_cb pf_slice;
+    void           *opaque;
+    unsigned        i_next;     /* next band to process */
+    unsigned        i_done;     /* processed bands */
+    unsigned        i_slices;
+};
+
+/* Threads shared by all the filters */
+typedef struct
+{
+    vlc_cond_t      wait_job;
+    vlc_cond_t      wait_done;
+    slice_job_t    *p_first;
+    slice_job_t   **pp_last;
+    bool            b_exit;
+
+    unsigned        i_refs;
+    unsigned        i_threads;
+    vlc_thread_t    threads[];
+} slice_pool_t;
+
+static vlc_mutex_t pool_lock = VLC_STATIC_MUTEX;
+static slice_pool_t *pool = NULL;
+
+struct filter_slices_t
+{
+    filter_t       *p_filter;
+    slice_pool_t   *p_pool;
+    unsigned        i_slices;
+
+    /* statistics */
+    uint64_t        i_runs;
+    mtime_t         i_time;
+};
+
+/* Takes the next band of a queued job, pool_lock must be held */
+static unsigned NextSlice( slice_pool_t *p_pool, slice_job_t *p_job )
+{
+    unsigned i_slice = p_job->i_next++;
+
+    if( p_job->i_next == p_job->i_slices )
+    {
+        /* All the bands have started, no other thread needs the job */
+        slice_job_t **pp = &p_pool->p_first;
+        while( *pp != p_job )
+            pp = &(*pp)->p_next;
+        *pp = p_job->p_next;
+        if( *pp == NULL )
+            p_pool->pp_last = pp;
+    }
+    return i_slice;
+}
+
+static void RunSlice( slice_pool_t *p_pool, slice_job_t *p_job,
+                      unsigned i_slice )
+{
+    vlc_mutex_unlock( &pool_lock );
+    p_job->pf_slice( p_job->opaque, i_slice, p_job->i_slices );
+    vlc_mutex_lock( &pool_lock );
+
+    if( ++p_job->i_done == p_job->i_slices )
+        vlc_cond_broadcast( &p_pool->wait_done );
+}
+
+static void *Thread( void *data )
+{
+    slice_pool_t *p_pool = data;
+
+    vlc_mutex_lock( &pool_lock );
+    for( ;; )
+    {
+        while( p_pool->p_first == NULL && !p_pool->b_exit )
+            vlc_cond_wait( &p_pool->wait_job, &pool_lock );
+        if( p_pool->p_first == NULL )
+            break;
+
+        slice_job_t *p_job = p_pool->p_first;
+        RunSlice( p_pool, p_job, NextSlice( p_pool, p_job ) );
+    }
+    vlc_mutex_unlock( &pool_lock );
+    return NULL;
+}
+
+static slice_pool_t *PoolHold( filter_t *p_filter )
+{
+    vlc_mutex_lock( &pool_lock );
+    if( pool != NULL )
+    {
+        pool->i_refs++;
+        vlc_mutex_unlock( &pool_lock );
+        return pool;
+    }
+
+    unsigned i_threads = var_InheritInteger( p_filter, "filter-threads" );
+    if( i_threads == 0 )
+        i_threads = vlc_GetCPUCount();
+    /* The thread calling filter_slices_Run() processes bands too */
+    i_threads = i_threads > 1 ? i_threads - 1 : 0;
+
+    slice_pool_t *p_pool = malloc( sizeof(*p_pool)
+                                   + i_threads * sizeof(vlc_thread_t) );
+    if( unlikely(p_pool == NULL) )
+    {
+        vlc_mutex_unlock( &pool_lock );
+        return NULL;
+    }
+
+    vlc_cond_init( &p_pool->wait_job );
+    vlc_cond_init( &p_pool->wait_done );
+    p_pool->p_first = NULL;
+    p_pool->pp_last = &p_pool->p_first;
+    p_pool->b_exit = false;
+    p_pool->i_refs = 1;
+    p_pool->i_threads = 0;
+
+    for( unsigned i = 0; i < i_threads; i++ )
+    {
+        if( vlc_clone( &p_pool->threads[i], Thread, p_pool,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+            break;
+        p_pool->i_threads++;
+    }
+    msg_Dbg( p_filter, "using %u filter threads", p_pool->i_threads + 1 );
+
+    pool = p_pool;
+    vlc_mutex_unlock( &pool_lock );
+    return p_pool;
+}
+
+static void PoolRelease( slice_pool_t *p_pool )
+{
+    vlc_mutex_lock( &pool_lock );
+    assert( p_pool == pool );
+    if( --p_pool->i_refs > 0 )
+    {
+        vlc_mutex_unlock( &pool_lock );
+        return;
+    }
+    pool = NULL;
+    p_pool->b_exit = true;
+    vlc_cond_broadcast( &p_pool->wait_job );
+    vlc_mutex_unlock( &pool_lock );
+
+    for( unsigned i = 0; i < p_pool->i_threads; i++ )
+        vlc_join( p_pool->threads[i], NULL );
+
+    assert( p_pool->p_first == NULL );
+    vlc_cond_destroy( &p_pool->wait_done );
+    vlc_cond_destroy( &p_pool->wait_job );
+    free( p_pool );
+}
+
+filter_slices_t *filter_slices_New( filter_t *p_filter, unsigned i_lines,
+                                    unsigned i_max_slices )
+{
+    filter_slices_t *p_slices = malloc( sizeof(*p_slices) );
+    if( unlikely(p_slices == NULL) )
+        return NULL;
+
+    slice_pool_t *p_pool = PoolHold( p_filter );
+    if( unlikely(p_pool == NULL) )
+    {
+        free( p_slices );
+        return NULL;
+    }
+
+    p_slices->p_filter = p_filter;
+    p_slices->p_pool = p_pool;
+    unsigned i_slices = __MIN( p_pool->i_threads + 1,
+                               i_lines / FILTER_SLICES_MIN_LINES );
+    if( i_max_slices > 0 )
+        i_slices = __MIN( i_slices, i_max_slices );
+    p_slices->i_slices = __MAX( i_slices, 1 );
+    p_slices->i_runs = 0;
+    p_slices->i_time = 0;
+    return p_slices;
+}
+
+void filter_slices_Delete( filter_slices_t *p_slices )
+{
+    if( p_slices->i_runs > 0 && p_slices->i_time > 0 )
+        msg_Dbg( p_slices->p_filter, "%u slices: %"PRIu64" pictures in "
+                 "%"PRId64" ms, %"PRId64" us per picture (%"PRIu64" fps)",
+                 p_slices->i_slices, p_slices->i_runs,
+                 p_slices->i_time / 1000, p_slices->i_time / p_slices->i_runs,
+                 p_slices->i_runs * CLOCK_FREQ / p_slices->i_time );
+
+    PoolRelease( p_slices->p_pool );
+    free( p_slices );
+}
+
+unsigned filter_slices_Count( const filter_slices_t *p_slices )
+{
+    return p_slices->i_slices;
+}
+
+void filter_slices_Run( filter_slices_t *p_slices, filter_slice_cb pf_slice,
+                        void *opaque )
+{
+    const mtime_t i_start = mdate();
+
+    if( p_slices->i_slices == 1 )
+        pf_slice( opaque, 0, 1 );
+    else
+    {
+        slice_job_t job = {
+            .p_next = NULL,
+            .pf_slice = pf_slice,
+            .opaque = opaque,
+            .i_next = 0,
+            .i_done = 0,
+            .i_slices = p_slices->i_slices,
+        };
+
+        slice_pool_t *p_pool = p_slices->p_pool;
+
+        vlc_mutex_lock( &pool_lock );
+        *p_pool->pp_last = &job;
+        p_pool->pp_last = &job.p_next;
+        vlc_cond_broadcast( &p_pool->wait_job );
+
+        /* Help with our own bands, then wait for the others */
+        while( job.i_next < job.i_slices )
+            RunSlice( p_pool, &job, NextSlice( p_pool, &job ) );
+        while( job.i_done < job.i_slices )
+            vlc_cond_wait( &p_pool->wait_done, &pool_lock );
+        vlc_mutex_unlock( &pool_lock );
+    }
+
+    p_slices->i_runs++;
+    p_slices->i_time += mdate() - i_start;
+}
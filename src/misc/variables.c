@@ -77,6 +77,8 @@ struct variable_t
 
     /** The variable's exported value */
     vlc_value_t  val;
+    /** Copy of a scalar value for lock-less reads through handles */
+    atomic_uint_least64_t scalar;
 
     /** The variable display name, mainly for use by the interfaces */
     char *       psz_text;
@@ -150,11 +152,29 @@ static int varcmp( const void *a, const void *b )
     return strcmp( va->psz_name, vb->psz_name );
 }
 
+/* Lookups by name, counted per thread and flushed in batches */
+#define VAR_LOOKUP_BATCH 256
+static atomic_ullong var_lookups = ATOMIC_VAR_INIT(0);
+static thread_local unsigned var_lookups_pending;
+
+unsigned long long var_CountLookups(void)
+{
+    return atomic_load_explicit(&var_lookups, memory_order_relaxed)
+           + var_lookups_pending;
+}
+
 static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
     variable_t **pp_var;
 
+    if( ++var_lookups_pending >= VAR_LOOKUP_BATCH )
+    {
+        atomic_fetch_add_explicit( &var_lookups, var_lookups_pending,
+                                   memory_order_relaxed );
+        var_lookups_pending = 0;
+    }
+
     vlc_mutex_lock(&priv->var_lock);
     pp_var = tfind( &psz_name, &priv->var_root, varcmp );
     return (pp_var != NULL) ? *pp_var : NULL;
@@ -180,6 +200,38 @@ static void Destroy( variable_t *p_var )
     free( p_var );
 }
 
+/**
+ * Publishes the value of a scalar variable to handle readers.
+ * The variable lock must be held, unless the variable is not shared yet.
+ */
+static void Publish(variable_t *var)
+{
+    uint_least64_t scalar;
+
+    switch (var->i_type & VLC_VAR_CLASS)
+    {
+        case VLC_VAR_BOOL:
+            scalar = var->val.b_bool;
+            break;
+        case VLC_VAR_INTEGER:
+            scalar = var->val.i_int;
+            break;
+        case VLC_VAR_FLOAT:
+        {
+            uint32_t bits;
+
+            static_assert(sizeof (bits) == sizeof (var->val.f_float),
+                          "Unexpected float size");
+            memcpy(&bits, &var->val.f_float, sizeof (bits));
+            scalar = bits;
+            break;
+        }
+        default:
+            return;
+    }
+    atomic_store_explicit(&var->scalar, scalar, memory_order_relaxed);
+}
+
 /**
  * Adjusts a value to fit the constraints for a certain variable:
  * - If the value is lower than the minimum, use the minimum.
@@ -360,6 +412,7 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
 
     if (i_type & VLC_VAR_DOINHERIT)
         var_Inherit(p_this, psz_name, i_type, &p_var->val);
+    Publish(p_var);
 
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
     variable_t **pp_var, *p_oldvar;
@@ -482,6 +535,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
             assert(p_var->ops->pf_free == FreeDummy);
             p_var->step = *p_val;
             CheckValue( p_var, &p_var->val );
+            Publish( p_var );
             break;
         case VLC_VAR_GETSTEP:
             switch (p_var->i_type & VLC_VAR_TYPE)
@@ -569,6 +623,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
             CheckValue( p_var, &newval );
             /* Set the variable */
             p_var->val = newval;
+            Publish( p_var );
             /* Free data if needed */
             p_var->ops->pf_free( &oldval );
             break;
@@ -680,6 +735,7 @@ int var_GetAndSet( vlc_object_t *p_this, const char *psz_name, int i_action,
 
     /*  Check boundaries */
     CheckValue( p_var, &p_var->val );
+    Publish( p_var );
     *p_val = p_var->val;
 
     /* Deal with callbacks.*/
@@ -753,6 +809,7 @@ int var_SetChecked( vlc_object_t *p_this, const char *psz_name,
 
     /* Set the variable */
     p_var->val = val;
+    Publish( p_var );
 
     /* Deal with callbacks */
     TriggerCallback( p_this, p_var, psz_name, oldval );
@@ -821,6 +878,62 @@ int var_Get( vlc_object_t *p_this, const char *psz_name, vlc_value_t *p_val )
     return var_GetChecked( p_this, psz_name, 0, p_val );
 }
 
+#undef var_Hold
+/**
+ * Gets a handle to a variable, for lock-less reads of its value
+ *
+ * The variable is kept alive until the handle is released, as if
+ * var_Create() had been called.
+ *
+ * \param p_this The object that holds the variable
+ * \param psz_name The name of the variable
+ * \return a variable handle, or NULL if the variable does not exist
+ */
+vlc_var_handle_t *var_Hold( vlc_object_t *p_this, const char *psz_name )
+{
+    assert( p_this );
+
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+    variable_t *p_var = Lookup( p_this, psz_name );
+
+    if( p_var != NULL )
+        p_var->i_usage++;
+    vlc_mutex_unlock( &p_priv->var_lock );
+    return p_var;
+}
+
+#undef var_Release
+/**
+ * Releases a variable handle obtained from var_Hold()
+ */
+void var_Release( vlc_object_t *p_this, vlc_var_handle_t *p_var )
+{
+    var_Destroy( p_this, p_var->psz_name );
+}
+
+bool var_HandleGetBool( const vlc_var_handle_t *p_var )
+{
+    assert( (p_var->i_type & VLC_VAR_CLASS) == VLC_VAR_BOOL );
+    return atomic_load_explicit( &p_var->scalar, memory_order_relaxed );
+}
+
+int64_t var_HandleGetInteger( const vlc_var_handle_t *p_var )
+{
+    assert( (p_var->i_type & VLC_VAR_CLASS) == VLC_VAR_INTEGER );
+    return atomic_load_explicit( &p_var->scalar, memory_order_relaxed );
+}
+
+float var_HandleGetFloat( const vlc_var_handle_t *p_var )
+{
+    assert( (p_var->i_type & VLC_VAR_CLASS) == VLC_VAR_FLOAT );
+
+    uint32_t bits = atomic_load_explicit( &p_var->scalar,
+                                          memory_order_relaxed );
+    float f;
+    memcpy( &f, &bits, sizeof (f) );
+    return f;
+}
+
 typedef enum
 {
     vlc_value_callback,
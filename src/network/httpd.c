@@ -52,6 +52,11 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_EVENTFD_H)
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+# define HTTPD_EPOLL 1
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -66,6 +71,14 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* Largest chunk written from a stream buffer to a client at once */
+#define HTTPD_STREAM_WRITE_MAX (256 * 1024)
+
+#ifdef HTTPD_EPOLL
+/* Events handled per epoll_wait() call */
+# define HTTPD_MAX_EVENTS 64
+#endif
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
 static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
 
@@ -95,6 +108,12 @@ struct httpd_host_t
 
     int            i_client;
     httpd_client_t **client;
+    unsigned       i_dropped; /* clients destroyed outside the host thread */
+
+#ifdef HTTPD_EPOLL
+    int         epfd;   /* persistent set of watched sockets */
+    int         wakefd; /* eventfd to interrupt epoll_wait() */
+#endif
 
     /* TLS data */
     vlc_tls_creds_t *p_tls;
@@ -132,7 +151,9 @@ enum
     HTTPD_CLIENT_DEAD,
 
     HTTPD_CLIENT_TLS_HS_IN,
-    HTTPD_CLIENT_TLS_HS_OUT
+    HTTPD_CLIENT_TLS_HS_OUT,
+
+    HTTPD_CLIENT_STREAMING, /* sending straight from a stream buffer */
 };
 
 /* mode */
@@ -167,6 +188,12 @@ struct httpd_client_t
      */
     int64_t i_keyframe_wait_to_pass;
 
+    /* Stream whose circular buffer is written to the socket directly */
+    httpd_stream_t *stream;
+#ifdef HTTPD_EPOLL
+    uint32_t i_events; /* events currently registered with epoll */
+#endif
+
     /* */
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
@@ -616,12 +643,101 @@ struct httpd_stream_t
     uint8_t     *p_buffer;          /* buffer */
     int64_t     i_buffer_pos;       /* absolute position from beginning */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
+    bool        b_wanted;           /* a client is waiting for more data */
 
     /* custom headers */
     size_t        i_http_headers;
     httpd_header * p_http_headers;
 };
 
+static void httpd_HostWake(httpd_host_t *host)
+{
+#ifdef HTTPD_EPOLL
+    uint64_t one = 1;
+    if (write(host->wakefd, &one, sizeof (one)) < 0 && errno != EAGAIN)
+        msg_Err(host, "cannot wake up host: %s", vlc_strerror_c(errno));
+#else
+    VLC_UNUSED(host); /* waiting clients are polled every 20ms */
+#endif
+}
+
+/**
+ * Returns how many bytes a streaming client can be sent, after moving it to
+ * the next keyframe or to the live position if it fell too far behind.
+ * The stream lock must be held.
+ */
+static int64_t httpd_StreamPending(httpd_stream_t *stream, httpd_client_t *cl)
+{
+    httpd_message_t *answer = &cl->answer;
+
+    if (answer->i_body_offset >= stream->i_buffer_pos)
+        return 0;
+
+    if (cl->i_keyframe_wait_to_pass >= 0) {
+        if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            /* still waiting for the next keyframe */
+            return 0;
+
+        /* seek to the new keyframe */
+        answer->i_body_offset = stream->i_last_keyframe_seen_pos;
+        cl->i_keyframe_wait_to_pass = -1;
+    }
+
+    if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
+        answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
+
+    return stream->i_buffer_pos - answer->i_body_offset;
+}
+
+/**
+ * Writes pending stream data to a client straight from the circular buffer,
+ * so that serving many clients costs one system call each and no copy.
+ */
+static void httpd_StreamWrite(httpd_client_t *cl)
+{
+    httpd_stream_t *stream = cl->stream;
+    vlc_tls_t *sock = cl->sock;
+    struct iovec iov[2];
+    ssize_t val = 0;
+
+    /* Only snapshot the buffer location under the lock, so that neither the
+     * muxer nor the other clients wait for the socket. */
+    vlc_mutex_lock(&stream->lock);
+    int64_t i_write = httpd_StreamPending(stream, cl);
+    int64_t i_offset = cl->answer.i_body_offset;
+    if (i_write > 0) {
+        int i_pos = i_offset % stream->i_buffer_size;
+
+        i_write = __MIN(i_write, HTTPD_STREAM_WRITE_MAX);
+        iov[0].iov_base = &stream->p_buffer[i_pos];
+        iov[0].iov_len = __MIN(i_write, stream->i_buffer_size - i_pos);
+        iov[1].iov_base = stream->p_buffer;
+        iov[1].iov_len = i_write - iov[0].iov_len;
+    }
+    vlc_mutex_unlock(&stream->lock);
+
+    if (i_write > 0) {
+        val = sock->writev(sock, iov, (iov[1].iov_len > 0) ? 2 : 1);
+        if (val > 0) {
+            vlc_mutex_lock(&stream->lock);
+            if (i_offset + stream->i_buffer_size < stream->i_buffer_pos)
+                /* The data was overwritten while being sent: this client
+                 * isn't fast enough, resume from a clean position. */
+                cl->answer.i_body_offset = stream->i_buffer_last_pos;
+            else
+                cl->answer.i_body_offset = i_offset + val;
+            vlc_mutex_unlock(&stream->lock);
+        }
+    }
+
+#if defined(_WIN32)
+    if (val == 0 ? i_write > 0 : (val < 0 && WSAGetLastError() != WSAEWOULDBLOCK))
+#else
+    if (val == 0 ? i_write > 0 : (val < 0 && errno != EAGAIN))
+#endif
+        cl->i_state = HTTPD_CLIENT_DEAD;
+}
+
 static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query)
@@ -632,31 +748,17 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
-
-        if (answer->i_body_offset >= stream->i_buffer_pos)
+        vlc_mutex_lock(&stream->lock);
+        int64_t i_write = httpd_StreamPending(stream, cl);
+        if (i_write <= 0) {
+            vlc_mutex_unlock(&stream->lock);
             return VLC_EGENERIC;    /* wait, no data available */
-
-        if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
-                /* still waiting for the next keyframe */
-                return VLC_EGENERIC;
-
-            /* seek to the new keyframe */
-            answer->i_body_offset = stream->i_last_keyframe_seen_pos;
-            cl->i_keyframe_wait_to_pass = -1;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
-
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
+        int i_pos = answer->i_body_offset % stream->i_buffer_size;
 
         if (i_write > HTTPD_CL_BUFSIZE)
             i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
 
         /* Don't go past the end of the circular buffer */
         i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
@@ -669,6 +771,7 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         answer->i_body = i_write;
         answer->p_body = xmalloc(i_write);
         memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
+        vlc_mutex_unlock(&stream->lock);
 
         answer->i_body_offset += i_write;
 
@@ -698,6 +801,7 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
 
         if (query->i_type != HTTPD_MSG_HEAD) {
             cl->b_stream_mode = true;
+            cl->stream = stream;
             vlc_mutex_lock(&stream->lock);
             /* Send the header */
             if (stream->i_header > 0) {
@@ -771,6 +875,7 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
     stream->i_buffer_last_pos = 1;
+    stream->b_wanted = false;
     stream->b_has_keyframes = false;
     stream->i_last_keyframe_seen_pos = 0;
     stream->i_http_headers = 0;
@@ -837,6 +942,11 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
 
     httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
 
+    if (stream->b_wanted) {
+        stream->b_wanted = false;
+        httpd_HostWake(stream->url->host);
+    }
+
     vlc_mutex_unlock(&stream->lock);
     return VLC_SUCCESS;
 }
@@ -959,6 +1069,10 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     vlc_mutex_init(&host->lock);
     vlc_cond_init(&host->wait);
     host->i_ref = 1;
+#ifdef HTTPD_EPOLL
+    host->epfd = -1;
+    host->wakefd = -1;
+#endif
 
     host->fds = net_ListenTCP(p_this, url.psz_host, port);
     if (!host->fds) {
@@ -967,11 +1081,29 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     }
     for (host->nfd = 0; host->fds[host->nfd] != -1; host->nfd++);
 
+#ifdef HTTPD_EPOLL
+    host->epfd = epoll_create1(EPOLL_CLOEXEC);
+    host->wakefd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (host->epfd == -1 || host->wakefd == -1) {
+        msg_Err(p_this, "cannot create HTTP host event set: %s",
+                vlc_strerror_c(errno));
+        goto error;
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &host->wakefd };
+    epoll_ctl(host->epfd, EPOLL_CTL_ADD, host->wakefd, &ev);
+    for (unsigned i = 0; i < host->nfd; i++) {
+        ev.data.ptr = &host->fds[i];
+        epoll_ctl(host->epfd, EPOLL_CTL_ADD, host->fds[i], &ev);
+    }
+#endif
+
     host->port     = port;
     host->i_url    = 0;
     host->url      = NULL;
     host->i_client = 0;
     host->client   = NULL;
+    host->i_dropped = 0;
     host->p_tls    = p_tls;
 
     /* create the thread */
@@ -993,6 +1125,12 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+#ifdef HTTPD_EPOLL
+        if (host->wakefd != -1)
+            vlc_close(host->wakefd);
+        if (host->epfd != -1)
+            vlc_close(host->epfd);
+#endif
         net_ListenClose(host->fds);
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
@@ -1039,6 +1177,10 @@ void httpd_HostDelete(httpd_host_t *host)
     TAB_CLEAN(host->i_client, host->client);
 
     vlc_tls_Delete(host->p_tls);
+#ifdef HTTPD_EPOLL
+    vlc_close(host->wakefd);
+    vlc_close(host->epfd);
+#endif
     net_ListenClose(host->fds);
     vlc_cond_destroy(&host->wait);
     vlc_mutex_destroy(&host->lock);
@@ -1116,6 +1258,8 @@ void httpd_UrlDelete(httpd_url_t *url)
         msg_Warn(host, "force closing connections");
         TAB_REMOVE(host->i_client, host->client, client);
         httpd_ClientDestroy(client);
+        /* the host thread may have pending events for this client */
+        host->i_dropped++;
         i--;
     }
     free(url);
@@ -1201,6 +1345,7 @@ static void httpd_ClientInit(httpd_client_t *cl, mtime_t now)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->stream = NULL;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1602,6 +1747,12 @@ static void httpd_ClientSend(httpd_client_t *cl)
 
         if (cl->i_buffer >= cl->i_buffer_size) {
             if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
+                if (cl->stream != NULL) {
+                    /* write the stream buffer as is from now on */
+                    cl->i_state = HTTPD_CLIENT_STREAMING;
+                    return;
+                }
+
                 /* catch more body data */
                 int     i_msg = cl->query.i_type;
                 int64_t i_offset = cl->answer.i_body_offset;
@@ -1689,8 +1840,86 @@ auth_failed:
     return false;
 }
 
+static void httpd_ClientEvent(httpd_host_t *host, httpd_client_t *cl)
+{
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
+        case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
+        case HTTPD_CLIENT_STREAMING: httpd_StreamWrite(cl); break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            httpd_ClientTlsHandshake(host, cl);
+            break;
+    }
+}
+
+static void httpd_HostAccept(httpd_host_t *host, int fd, mtime_t now)
+{
+    httpd_client_t *cl;
+
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
+    if (unlikely(sk == NULL))
+    {
+        vlc_close(fd);
+        return;
+    }
+
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+        vlc_tls_t *tls;
+
+        tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
+        if (tls == NULL)
+        {
+            vlc_tls_SessionDelete(sk);
+            return;
+        }
+        sk = tls;
+    }
+
+    cl = httpd_ClientNew(sk, now);
+
+    if (host->p_tls != NULL)
+        cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+
+    TAB_APPEND(host->i_client, host->client, cl);
+#ifdef HTTPD_EPOLL
+    /* the socket is removed from the set when it is closed */
+    struct epoll_event ev = { .events = 0, .data.ptr = cl };
+
+    cl->i_events = 0;
+    epoll_ctl(host->epfd, EPOLL_CTL_ADD, fd, &ev);
+#endif
+}
+
+#ifdef HTTPD_EPOLL
+static void httpd_ClientWatch(httpd_host_t *host, httpd_client_t *cl,
+                              short events)
+{
+    uint32_t i_events = ((events & POLLIN) ? EPOLLIN : 0)
+                      | ((events & POLLOUT) ? EPOLLOUT : 0);
+
+    if (cl->i_events == i_events)
+        return;
+
+    struct epoll_event ev = { .events = i_events, .data.ptr = cl };
+
+    if (epoll_ctl(host->epfd, EPOLL_CTL_MOD, vlc_tls_GetFD(cl->sock), &ev))
+        cl->i_state = HTTPD_CLIENT_DEAD;
+    cl->i_events = i_events;
+}
+#endif
+
 static void httpdLoop(httpd_host_t *host)
 {
+#ifndef HTTPD_EPOLL
     struct pollfd ufd[host->nfd + host->i_client];
     unsigned nfd;
     for (nfd = 0; nfd < host->nfd; nfd++) {
@@ -1698,6 +1927,7 @@ static void httpdLoop(httpd_host_t *host)
         ufd[nfd].events = POLLIN;
         ufd[nfd].revents = 0;
     }
+#endif
 
     /* add all socket that should be read/write and close dead connection */
     while (host->i_url <= 0) {
@@ -1723,21 +1953,17 @@ static void httpdLoop(httpd_host_t *host)
             continue;
         }
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
-
-        pufd->fd = vlc_tls_GetFD(cl->sock);
-        pufd->events = pufd->revents = 0;
+        short events = 0;
 
         switch (cl->i_state) {
             case HTTPD_CLIENT_RECEIVING:
             case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
+                events = POLLIN;
                 break;
 
             case HTTPD_CLIENT_SENDING:
             case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
+                events = POLLOUT;
                 break;
 
             case HTTPD_CLIENT_RECEIVE_DONE: {
@@ -1888,6 +2114,7 @@ static void httpdLoop(httpd_host_t *host)
                     bool b_query = false;
 
                     cl->url = NULL;
+                    cl->stream = NULL;
                     if (psz_connection) {
                         b_connection = (strcasecmp(psz_connection, "Close") == 0);
                         b_keepalive = (strcasecmp(psz_connection, "Keep-Alive") == 0);
@@ -1944,16 +2171,98 @@ static void httpdLoop(httpd_host_t *host)
                     cl->answer.i_body = 0;
                     cl->i_state = HTTPD_CLIENT_SENDING;
                 }
+                break;
+
+            case HTTPD_CLIENT_STREAMING:
+                vlc_mutex_lock(&cl->stream->lock);
+                if (httpd_StreamPending(cl->stream, cl) > 0)
+                    events = POLLOUT;
+                else
+                    cl->stream->b_wanted = true;
+                vlc_mutex_unlock(&cl->stream->lock);
+                break;
         }
 
-        if (pufd->events != 0)
-            nfd++;
-        else
+#ifdef HTTPD_EPOLL
+        httpd_ClientWatch(host, cl, events);
+        /* idle stream clients are woken up by httpd_StreamSend() */
+        if (events == 0 && cl->i_state != HTTPD_CLIENT_STREAMING)
+            b_low_delay = true;
+#else
+        if (events != 0) {
+            struct pollfd *pufd = ufd + nfd++;
+            assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+
+            pufd->fd = vlc_tls_GetFD(cl->sock);
+            pufd->events = events;
+            pufd->revents = 0;
+        } else
             b_low_delay = true;
+#endif
     }
+
+#ifdef HTTPD_EPOLL
+    struct epoll_event ev[HTTPD_MAX_EVENTS];
+    unsigned dropped = host->i_dropped;
+    int n;
+#endif
     vlc_mutex_unlock(&host->lock);
     vlc_restorecancel(canc);
 
+#ifdef HTTPD_EPOLL
+    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
+    while ((n = epoll_wait(host->epfd, ev, HTTPD_MAX_EVENTS,
+                           b_low_delay ? 20 : -1)) < 0)
+    {
+        if (errno != EINTR)
+            msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+    }
+
+    canc = vlc_savecancel();
+    vlc_mutex_lock(&host->lock);
+
+    now = mdate();
+    for (int i = 0; i < n; i++) {
+        void *data = ev[i].data.ptr;
+
+        if (data == &host->wakefd) {
+            uint64_t val;
+            while (read(host->wakefd, &val, sizeof (val)) > 0);
+            continue;
+        }
+
+        if ((int *)data >= host->fds && (int *)data < host->fds + host->nfd)
+            continue; /* accepted below */
+
+        httpd_client_t *cl = data;
+
+        /* the client may have been destroyed while we were waiting */
+        if (host->i_dropped != dropped) {
+            int j = 0;
+            while (j < host->i_client && host->client[j] != cl)
+                j++;
+            if (j == host->i_client)
+                continue;
+        }
+
+        if (cl->i_events == 0) {
+            /* hang up or error on a client that is not waiting for I/O */
+            cl->i_state = HTTPD_CLIENT_DEAD;
+            continue;
+        }
+
+        cl->i_activity_date = now;
+        httpd_ClientEvent(host, cl);
+    }
+
+    /* Handle server sockets (accept new connections) */
+    for (int i = 0; i < n; i++) {
+        int *fd = ev[i].data.ptr;
+
+        if (fd >= host->fds && fd < host->fds + host->nfd)
+            httpd_HostAccept(host, *fd, now);
+    }
+#else
     /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
     while (poll(ufd, nfd, b_low_delay ? 20 : -1) < 0)
     {
@@ -1981,62 +2290,17 @@ static void httpdLoop(httpd_host_t *host)
             continue; // no event received
 
         cl->i_activity_date = now;
-
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
-            case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                httpd_ClientTlsHandshake(host, cl);
-                break;
-        }
+        httpd_ClientEvent(host, cl);
     }
 
     /* Handle server sockets (accept new connections) */
     for (nfd = 0; nfd < host->nfd; nfd++) {
-        httpd_client_t *cl;
-        int fd = ufd[nfd].fd;
-
-        assert (fd == host->fds[nfd]);
-
-        if (ufd[nfd].revents == 0)
-            continue;
-
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
-            continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
-
-        vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
-        if (unlikely(sk == NULL))
-        {
-            vlc_close(fd);
-            continue;
-        }
-
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
-            vlc_tls_t *tls;
-
-            tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
-            if (tls == NULL)
-            {
-                vlc_tls_SessionDelete(sk);
-                continue;
-            }
-            sk = tls;
-        }
-
-        cl = httpd_ClientNew(sk, now);
+        assert (ufd[nfd].fd == host->fds[nfd]);
 
-        if (host->p_tls != NULL)
-            cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
-
-        TAB_APPEND(host->i_client, host->client, cl);
+        if (ufd[nfd].revents != 0)
+            httpd_HostAccept(host, ufd[nfd].fd, now);
     }
+#endif
 
     vlc_restorecancel(canc);
 }
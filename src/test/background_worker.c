@@ -0,0 +1,159 @@
+/*****************************************************************************
+ * background_worker.c: Test for the background worker
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include <vlc_common.h>
+#include "../libvlc.h"
+#include "../misc/background_worker.h"
+
+#define THREADS 4
+#define TASKS   (2 * THREADS)
+
+static vlc_mutex_t lock;
+static vlc_cond_t wait;
+static unsigned held, running, max_running;
+static bool done;
+
+/* The worker is built into the test, but this helper is private to
+ * libvlccore. */
+int vlc_clone_detach(vlc_thread_t *th, void *(*entry)(void *), void *data,
+                     int priority)
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+    int val;
+
+    (void) th; (void) priority;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    val = pthread_create(&thread, &attr, entry, data);
+    pthread_attr_destroy(&attr);
+    return val;
+}
+
+static void Hold(void *entity)
+{
+    (void) entity;
+    vlc_mutex_lock(&lock);
+    held++;
+    vlc_mutex_unlock(&lock);
+}
+
+static void Release(void *entity)
+{
+    (void) entity;
+    vlc_mutex_lock(&lock);
+    assert(held > 0);
+    held--;
+    vlc_mutex_unlock(&lock);
+}
+
+static int Start(void *owner, void *entity, void **out)
+{
+    (void) owner;
+    *out = entity;
+
+    /* Wait for the other tasks, so that they all run at the same time */
+    vlc_mutex_lock(&lock);
+    if (++running > max_running)
+        max_running = running;
+    vlc_cond_broadcast(&wait);
+
+    mtime_t deadline = mdate() + CLOCK_FREQ;
+    while (!done && running < THREADS)
+        if (vlc_cond_timedwait(&wait, &lock, deadline))
+            break;
+    vlc_mutex_unlock(&lock);
+    return VLC_SUCCESS;
+}
+
+static int Probe(void *owner, void *handle)
+{
+    (void) owner; (void) handle;
+    vlc_mutex_lock(&lock);
+    bool finished = done;
+    vlc_mutex_unlock(&lock);
+    return finished;
+}
+
+static void Stop(void *owner, void *handle)
+{
+    (void) owner; (void) handle;
+    vlc_mutex_lock(&lock);
+    assert(running > 0);
+    running--;
+    vlc_mutex_unlock(&lock);
+}
+
+int main(void)
+{
+    struct background_worker_config conf = {
+        .default_timeout = -1,
+        .max_threads = THREADS,
+        .pf_release = Release,
+        .pf_hold = Hold,
+        .pf_start = Start,
+        .pf_probe = Probe,
+        .pf_stop = Stop,
+    };
+    int entities[TASKS];
+
+    vlc_mutex_init(&lock);
+    vlc_cond_init(&wait);
+
+    struct background_worker *worker = background_worker_New(NULL, &conf);
+    assert(worker != NULL);
+
+    /* A burst of requests runs on as many threads as allowed */
+    for (unsigned i = 0; i < TASKS; i++)
+        assert(background_worker_Push(worker, &entities[i], NULL, -1,
+                                      false) == VLC_SUCCESS);
+
+    mtime_t deadline = mdate() + 5 * CLOCK_FREQ;
+    vlc_mutex_lock(&lock);
+    while (max_running < THREADS)
+        if (vlc_cond_timedwait(&wait, &lock, deadline))
+            break;
+    printf("%u tasks out of %u ran concurrently\n", max_running, THREADS);
+    assert(max_running == THREADS);
+
+    done = true;
+    vlc_cond_broadcast(&wait);
+    vlc_mutex_unlock(&lock);
+
+    background_worker_RequestProbe(worker);
+    background_worker_Delete(worker);
+
+    assert(running == 0);
+    assert(held == 0);
+    assert(max_running <= THREADS);
+
+    vlc_cond_destroy(&wait);
+    vlc_mutex_destroy(&lock);
+    return 0;
+}
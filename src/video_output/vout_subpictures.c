@@ -69,6 +69,7 @@ struct spu_private_t {
 
     int channel;             /**< number of subpicture channels registered */
     filter_t *text;                              /**< text renderer module */
+    vlc_var_handle_t *text_rerender;     /**< "text-rerender" of the above */
     filter_t *scale_yuvp;                     /**< scaling module for YUVP */
     filter_t *scale;                    /**< scaling module (all but YUVP) */
     bool force_crop;                     /**< force cropping of subpicture */
@@ -211,9 +212,22 @@ static filter_t *SpuRenderCreateAndLoadText(spu_t *spu)
     var_Create(text, "spu-elapsed",   VLC_VAR_INTEGER);
     var_Create(text, "text-rerender", VLC_VAR_BOOL);
 
+    /* The latter is read back after every text rendering */
+    spu->p->text_rerender = var_Hold(text, "text-rerender");
+    if (unlikely(spu->p->text_rerender == NULL)) {
+        FilterRelease(text);
+        return NULL;
+    }
+
     return text;
 }
 
+static void SpuRenderReleaseText(spu_t *spu)
+{
+    var_Release(spu->p->text, spu->p->text_rerender);
+    FilterRelease(spu->p->text);
+}
+
 static filter_t *SpuRenderCreateAndLoadScale(vlc_object_t *object,
                                              vlc_fourcc_t src_chroma,
                                              vlc_fourcc_t dst_chroma,
@@ -280,7 +294,7 @@ static void SpuRenderText(spu_t *spu, bool *rerender_text,
 
     if ( region->p_text )
         text->pf_render(text, region, region, chroma_list);
-    *rerender_text = var_GetBool(text, "text-rerender");
+    *rerender_text = var_HandleGetBool(spu->p->text_rerender);
 }
 
 /**
@@ -1344,7 +1358,7 @@ void spu_Destroy(spu_t *spu)
     spu_private_t *sys = spu->p;
 
     if (sys->text)
-        FilterRelease(sys->text);
+        SpuRenderReleaseText(spu);
 
     if (sys->scale_yuvp)
         FilterRelease(sys->scale_yuvp);
@@ -1393,7 +1407,7 @@ void spu_Attach(spu_t *spu, vlc_object_t *input, bool attach)
         spu->p->input = input;
 
         if (spu->p->text)
-            FilterRelease(spu->p->text);
+            SpuRenderReleaseText(spu);
         spu->p->text = SpuRenderCreateAndLoadText(spu);
 
         vlc_mutex_unlock(&spu->p->lock);
@@ -0,0 +1,175 @@
+/*****************************************************************************
+ * udp.c: UDP access loopback test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_access.h>
+#include <vlc_block.h>
+#include <vlc_network.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#define PACKETS      100000
+#define PACKET_SIZE  (7 * 188)
+
+struct bench
+{
+    int fd;
+    unsigned burst; /* packets sent before waiting for the receiver */
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    uint32_t last; /* last received sequence number */
+};
+
+static void *sender(void *data)
+{
+    struct bench *b = data;
+    uint8_t buf[PACKET_SIZE];
+
+    memset(buf, 0x47, sizeof (buf));
+    for (uint32_t i = 0; i < PACKETS; i++)
+    {
+        SetDWBE(buf, i);
+        if (send(b->fd, buf, sizeof (buf), 0) < 0)
+            assert(errno == ENOBUFS || errno == EAGAIN);
+
+        if (b->burst == 0 || (i + 1) % b->burst)
+            continue;
+
+        /* Let the receiver catch up, unless the tail of the burst is lost */
+        mtime_t deadline = mdate() + CLOCK_FREQ / 10;
+
+        vlc_mutex_lock(&b->lock);
+        while (b->last != i
+            && vlc_cond_timedwait(&b->wait, &b->lock, deadline) == 0);
+        vlc_mutex_unlock(&b->lock);
+    }
+    return NULL;
+}
+
+static int loopback_port(void)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t len = sizeof (addr);
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    assert(fd != -1);
+    assert(bind(fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    assert(getsockname(fd, (struct sockaddr *)&addr, &len) == 0);
+    net_Close(fd);
+    return ntohs(addr.sin_port);
+}
+
+static const char *const argv[] = {
+    "-v", "--ignore-config", "--udp-timeout=1",
+};
+
+static void bench(vlc_object_t *obj, unsigned burst)
+{
+    int port = loopback_port();
+    char mrl[64];
+
+    snprintf(mrl, sizeof (mrl), "udp://@127.0.0.1:%d", port);
+    stream_t *access = vlc_access_NewMRL(obj, mrl);
+    assert(access != NULL);
+
+    struct bench b = { .burst = burst, .last = -1 };
+
+    b.fd = net_ConnectUDP(obj, "127.0.0.1", port, -1);
+    assert(b.fd != -1);
+    vlc_mutex_init(&b.lock);
+    vlc_cond_init(&b.wait);
+
+    vlc_thread_t th;
+    unsigned received = 0, reordered = 0;
+    uint32_t last = 0;
+    block_t *block;
+
+    mtime_t start = mdate();
+    assert(vlc_clone(&th, sender, &b, VLC_THREAD_PRIORITY_LOW) == 0);
+
+    while ((block = vlc_stream_ReadBlock(access)) != NULL
+        || !vlc_stream_Eof(access))
+    {
+        if (block == NULL)
+            continue;
+
+        assert(block->i_buffer == PACKET_SIZE);
+        assert(!(block->i_flags & BLOCK_FLAG_CORRUPTED));
+        assert(block->p_buffer[4] == 0x47);
+
+        uint32_t seq = GetDWBE(block->p_buffer);
+        if (received > 0 && seq <= last)
+            reordered++;
+        last = seq;
+        received++;
+        block_Release(block);
+
+        if (burst != 0 && (seq + 1) % burst == 0)
+        {
+            vlc_mutex_lock(&b.lock);
+            b.last = seq;
+            vlc_cond_signal(&b.wait);
+            vlc_mutex_unlock(&b.lock);
+        }
+    }
+    /* minus the time-out */
+    mtime_t elapsed = mdate() - start - CLOCK_FREQ;
+
+    vlc_join(th, NULL);
+    vlc_cond_destroy(&b.wait);
+    vlc_mutex_destroy(&b.lock);
+    net_Close(b.fd);
+    vlc_stream_Delete(access);
+
+    printf("udp (%s): %u of %u packets received (%.2f%% dropped), "
+           "%.0f packets/s\n", burst ? "paced" : "flood", received, PACKETS,
+           100. * (PACKETS - received) / PACKETS,
+           received * (double)CLOCK_FREQ / __MAX(elapsed, 1));
+    assert(received > 0);
+    assert(reordered == 0);
+}
+
+int main(void)
+{
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    bench(VLC_OBJECT(vlc->p_libvlc_int), 0);
+    bench(VLC_OBJECT(vlc->p_libvlc_int), 64);
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,416 @@
+/*****************************************************************************
+ * mp4.c: MP4 demuxer sample tables test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_block.h>
+#include <vlc_stream.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+/*
+ * Synthetic four hours long video track at 25 fps, with one sample per chunk
+ * for the first half and three for the second half. The stts runs (1000
+ * samples) and ctts runs (2 samples) are not aligned on chunks.
+ */
+#define TIMESCALE    90000
+#define SAMPLES      (4 * 3600 * 25)
+#define SPLIT        (SAMPLES / 2)
+#define STTS_RUN     1000
+#define SAMPLE_SIZE  8
+
+static int64_t sample_dts(unsigned i)
+{
+    unsigned run = i / STTS_RUN;
+    unsigned delta = (run % 2) ? 3602 : 3600;
+
+    return (int64_t)(run / 2) * STTS_RUN * (3600 + 3602)
+         + (run % 2) * STTS_RUN * 3600 + (i % STTS_RUN) * delta;
+}
+
+static int64_t sample_offset(unsigned i)
+{
+    return ((i / 2) % 2) ? 7200 : 0;
+}
+
+struct buf
+{
+    uint8_t *data;
+    size_t len, size;
+};
+
+static void put(struct buf *b, const void *p, size_t len)
+{
+    if (b->len + len > b->size)
+    {
+        b->size = (b->len + len) * 2;
+        b->data = realloc(b->data, b->size);
+        assert(b->data != NULL);
+    }
+    memcpy(b->data + b->len, p, len);
+    b->len += len;
+}
+
+static void put32(struct buf *b, uint32_t v)
+{
+    uint8_t p[4];
+    SetDWBE(p, v);
+    put(b, p, 4);
+}
+
+static void put16(struct buf *b, uint16_t v)
+{
+    uint8_t p[2];
+    SetWBE(p, v);
+    put(b, p, 2);
+}
+
+static void zero(struct buf *b, size_t len)
+{
+    while (len-- > 0)
+        put(b, "", 1);
+}
+
+static size_t box_start(struct buf *b, const char *type)
+{
+    size_t pos = b->len;
+    put32(b, 0);
+    put(b, type, 4);
+    return pos;
+}
+
+static void box_end(struct buf *b, size_t pos)
+{
+    SetDWBE(b->data + pos, b->len - pos);
+}
+
+static void put_matrix(struct buf *b)
+{
+    static const uint32_t matrix[9] = {
+        0x10000, 0, 0, 0, 0x10000, 0, 0, 0, 0x40000000
+    };
+    for (unsigned i = 0; i < 9; i++)
+        put32(b, matrix[i]);
+}
+
+static void write_stbl(struct buf *b, uint32_t mdat_offset)
+{
+    size_t stbl = box_start(b, "stbl"), box;
+
+    box = box_start(b, "stsd");
+    put32(b, 0);
+    put32(b, 1);
+    size_t entry = box_start(b, "jpeg");
+    zero(b, 6);
+    put16(b, 1); /* data reference */
+    zero(b, 16);
+    put16(b, 320);
+    put16(b, 240);
+    put32(b, 0x00480000);
+    put32(b, 0x00480000);
+    put32(b, 0);
+    put16(b, 1);
+    zero(b, 32);
+    put16(b, 24);
+    put16(b, 0xffff);
+    box_end(b, entry);
+    box_end(b, box);
+
+    box = box_start(b, "stts");
+    put32(b, 0);
+    put32(b, SAMPLES / STTS_RUN);
+    for (unsigned i = 0; i < SAMPLES / STTS_RUN; i++)
+    {
+        put32(b, STTS_RUN);
+        put32(b, (i % 2) ? 3602 : 3600);
+    }
+    box_end(b, box);
+
+    box = box_start(b, "ctts");
+    put32(b, 0);
+    put32(b, SAMPLES / 2);
+    for (unsigned i = 0; i < SAMPLES / 2; i++)
+    {
+        put32(b, 2);
+        put32(b, sample_offset(2 * i));
+    }
+    box_end(b, box);
+
+    box = box_start(b, "stsc");
+    put32(b, 0);
+    put32(b, 2);
+    put32(b, 1);
+    put32(b, 1);
+    put32(b, 1);
+    put32(b, SPLIT + 1);
+    put32(b, 3);
+    put32(b, 1);
+    box_end(b, box);
+
+    box = box_start(b, "stsz");
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, SAMPLES);
+    for (unsigned i = 0; i < SAMPLES; i++)
+        put32(b, SAMPLE_SIZE);
+    box_end(b, box);
+
+    box = box_start(b, "stco");
+    put32(b, 0);
+    put32(b, SPLIT + (SAMPLES - SPLIT) / 3);
+    for (unsigned i = 0; i < SPLIT; i++)
+        put32(b, mdat_offset + i * SAMPLE_SIZE);
+    for (unsigned i = SPLIT; i < SAMPLES; i += 3)
+        put32(b, mdat_offset + i * SAMPLE_SIZE);
+    box_end(b, box);
+
+    box_end(b, stbl);
+}
+
+static void write_moov(struct buf *b, uint32_t mdat_offset)
+{
+    uint32_t duration = sample_dts(SAMPLES) / (TIMESCALE / 1000);
+    size_t moov = box_start(b, "moov"), box;
+
+    box = box_start(b, "mvhd");
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, 1000);
+    put32(b, duration);
+    put32(b, 0x10000);
+    put16(b, 0x100);
+    zero(b, 10);
+    put_matrix(b);
+    zero(b, 24);
+    put32(b, 2);
+    box_end(b, box);
+
+    size_t trak = box_start(b, "trak");
+    box = box_start(b, "tkhd");
+    put32(b, 3);
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, 1);
+    put32(b, 0);
+    put32(b, duration);
+    zero(b, 8);
+    put16(b, 0);
+    put16(b, 0);
+    put16(b, 0);
+    put16(b, 0);
+    put_matrix(b);
+    put32(b, 320 << 16);
+    put32(b, 240 << 16);
+    box_end(b, box);
+
+    size_t mdia = box_start(b, "mdia");
+    box = box_start(b, "mdhd");
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, TIMESCALE);
+    put32(b, sample_dts(SAMPLES));
+    put16(b, 0x55c4);
+    put16(b, 0);
+    box_end(b, box);
+
+    box = box_start(b, "hdlr");
+    put32(b, 0);
+    put32(b, 0);
+    put(b, "vide", 4);
+    zero(b, 12);
+    put(b, "", 1);
+    box_end(b, box);
+
+    size_t minf = box_start(b, "minf");
+    box = box_start(b, "vmhd");
+    put32(b, 1);
+    zero(b, 8);
+    box_end(b, box);
+
+    size_t dinf = box_start(b, "dinf");
+    box = box_start(b, "dref");
+    put32(b, 0);
+    put32(b, 1);
+    size_t url = box_start(b, "url ");
+    put32(b, 1);
+    box_end(b, url);
+    box_end(b, box);
+    box_end(b, dinf);
+
+    write_stbl(b, mdat_offset);
+    box_end(b, minf);
+    box_end(b, mdia);
+    box_end(b, trak);
+    box_end(b, moov);
+}
+
+static struct buf make_file(void)
+{
+    struct buf b = { NULL, 0, 0 };
+    size_t box = box_start(&b, "ftyp");
+
+    put(&b, "isom", 4);
+    put32(&b, 0x200);
+    put(&b, "isommp41", 8);
+    box_end(&b, box);
+
+    /* write the moov once to know its size, then with the right offsets */
+    size_t moov = b.len;
+    write_moov(&b, 0);
+    uint32_t mdat_offset = b.len + 8;
+    b.len = moov;
+    write_moov(&b, mdat_offset);
+
+    box = box_start(&b, "mdat");
+    assert(b.len == mdat_offset);
+    for (unsigned i = 0; i < SAMPLES; i++)
+    {
+        put32(&b, i);
+        put32(&b, ~i);
+    }
+    box_end(&b, box);
+    return b;
+}
+
+struct es_out_sys_t
+{
+    unsigned count;
+    unsigned first; /* first sample received since the last reset */
+    unsigned last;
+};
+
+static es_out_id_t *EsOutAdd(es_out_t *out, const es_format_t *fmt)
+{
+    (void) out;
+    assert(fmt->i_cat == VIDEO_ES);
+    return malloc(1);
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    struct es_out_sys_t *sys = out->p_sys;
+    unsigned i = GetDWBE(block->p_buffer);
+
+    (void) id;
+    assert(block->i_buffer == SAMPLE_SIZE);
+    assert(GetDWBE(block->p_buffer + 4) == ~i);
+    assert(block->i_dts == VLC_TS_0 + sample_dts(i) * CLOCK_FREQ / TIMESCALE);
+    assert(block->i_pts == block->i_dts
+                           + sample_offset(i) * CLOCK_FREQ / TIMESCALE);
+    if (sys->count++ == 0)
+        sys->first = i;
+    else
+        assert(i == sys->last + 1);
+    sys->last = i;
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel(es_out_t *out, es_out_id_t *id)
+{
+    (void) out;
+    free(id);
+}
+
+static int EsOutControl(es_out_t *out, int query, va_list args)
+{
+    (void) out;
+    if (query == ES_OUT_GET_ES_STATE)
+    {
+        (void) va_arg(args, es_out_id_t *);
+        *va_arg(args, bool *) = true;
+    }
+    return VLC_SUCCESS;
+}
+
+static const char *const argv[] = {
+    "-v", "--ignore-config",
+};
+
+int main(void)
+{
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    struct buf file = make_file();
+    struct es_out_sys_t sys = { 0, 0, 0 };
+    es_out_t out = {
+        EsOutAdd, EsOutSend, EsOutDel, EsOutControl, NULL, &sys,
+    };
+
+    stream_t *s = vlc_stream_MemoryNew(obj, file.data, file.len, true);
+    assert(s != NULL);
+
+    mtime_t start = mdate();
+    demux_t *demux = demux_New(obj, "mp4", "", s, &out);
+    mtime_t open_time = mdate() - start;
+    assert(demux != NULL);
+
+    while (sys.count < 1000)
+        assert(demux_Demux(demux) == VLC_DEMUXER_SUCCESS);
+    assert(sys.first == 0);
+
+    /* seek around both chunk layouts */
+    static const unsigned targets[] = {
+        SAMPLES - 100, 1, SPLIT - 1, SPLIT, SPLIT + 1, SPLIT + 2,
+        STTS_RUN * 37 + 5, SAMPLES / 3, SAMPLES / 3 * 2 + 1, 4242,
+    };
+    mtime_t seek_time = 0;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(targets); i++)
+    {
+        int64_t time = sample_dts(targets[i]) * CLOCK_FREQ / TIMESCALE + 1;
+
+        start = mdate();
+        assert(demux_Control(demux, DEMUX_SET_TIME, time, true) == VLC_SUCCESS);
+        seek_time += mdate() - start;
+
+        sys.count = 0;
+        while (sys.count < 2)
+            assert(demux_Demux(demux) == VLC_DEMUXER_SUCCESS);
+        assert(sys.first == targets[i]);
+    }
+
+    printf("mp4: %u samples, opened in %"PRId64" us, "
+           "%"PRId64" us per seek\n", SAMPLES, open_time,
+           seek_time / (mtime_t)ARRAY_SIZE(targets));
+
+    demux_Delete(demux); /* deletes the stream too */
+    free(file.data);
+    libvlc_release(vlc);
+    return 0;
+}
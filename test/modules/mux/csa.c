@@ -0,0 +1,158 @@
+/*****************************************************************************
+ * csa.c: CSA batch (de)scrambling tests
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <vlc_common.h>
+#include "../modules/mux/mpeg/csa.h"
+#include "../modules/mux/mpeg/csa.c"
+
+#define TEST_PACKETS 200 /* not a multiple of the batch size */
+
+static void set_keys( csa_t *c )
+{
+    static uint8_t odd[8]  = { 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0 };
+    static uint8_t even[8] = { 0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10 };
+
+    memcpy( c->o_ck, odd, 8 );
+    csa_ComputeKey( c->o_kk, odd );
+    memcpy( c->e_ck, even, 8 );
+    csa_ComputeKey( c->e_kk, even );
+}
+
+static void fill_packets( uint8_t pkts[][188], int i_count, bool b_scrambled )
+{
+    for( int i = 0; i < i_count; i++ )
+    {
+        for( int j = 0; j < 188; j++ )
+            pkts[i][j] = rand();
+        pkts[i][0] = 0x47;
+        pkts[i][3] &= 0x3f;
+        if( b_scrambled && (i % 7) )
+            pkts[i][3] |= (i & 1) ? 0xc0 : 0x80;
+        if( i % 3 == 0 )
+        {
+            /* adaptation field of varying length, up to a full packet */
+            pkts[i][3] |= 0x20;
+            pkts[i][4] = (i * 13) % 184;
+        }
+        else
+            pkts[i][3] &= ~0x20;
+    }
+}
+
+static void test_decrypt( csa_t *c, int i_pkt_size )
+{
+    static uint8_t ref[TEST_PACKETS][188], pkts[TEST_PACKETS][188];
+    uint8_t *pp[TEST_PACKETS];
+
+    fill_packets( ref, TEST_PACKETS, true );
+    memcpy( pkts, ref, sizeof(ref) );
+
+    for( int i = 0; i < TEST_PACKETS; i++ )
+    {
+        csa_Decrypt( c, ref[i], i_pkt_size );
+        pp[i] = pkts[i];
+    }
+    csa_DecryptBatch( c, pp, TEST_PACKETS, i_pkt_size );
+
+    assert( !memcmp( ref, pkts, sizeof(ref) ) );
+}
+
+static void test_encrypt( csa_t *c, int i_pkt_size, bool use_odd )
+{
+    static uint8_t ref[TEST_PACKETS][188], pkts[TEST_PACKETS][188];
+    static uint8_t clear[TEST_PACKETS][188];
+    uint8_t *pp[TEST_PACKETS];
+
+    c->use_odd = use_odd;
+    fill_packets( clear, TEST_PACKETS, false );
+    memcpy( ref, clear, sizeof(ref) );
+    memcpy( pkts, clear, sizeof(ref) );
+
+    for( int i = 0; i < TEST_PACKETS; i++ )
+    {
+        csa_Encrypt( c, ref[i], i_pkt_size );
+        pp[i] = pkts[i];
+    }
+    csa_EncryptBatch( c, pp, TEST_PACKETS, i_pkt_size );
+
+    assert( !memcmp( ref, pkts, sizeof(ref) ) );
+
+    /* and back */
+    csa_DecryptBatch( c, pp, TEST_PACKETS, i_pkt_size );
+    assert( !memcmp( clear, pkts, sizeof(clear) ) );
+}
+
+static void bench( csa_t *c )
+{
+    static uint8_t pkts[CSA_BATCH_MAX][188];
+    uint8_t *pp[CSA_BATCH_MAX];
+    const int i_loops = 200;
+
+    for( int i = 0; i < CSA_BATCH_MAX; i++ )
+        pp[i] = pkts[i];
+
+    fill_packets( pkts, CSA_BATCH_MAX, false );
+    mtime_t i_start = mdate();
+    for( int i = 0; i < i_loops; i++ )
+        for( int j = 0; j < CSA_BATCH_MAX; j++ )
+        {
+            pkts[j][3] |= 0x80;
+            csa_Decrypt( c, pkts[j], 188 );
+        }
+    mtime_t i_scalar = mdate() - i_start;
+
+    i_start = mdate();
+    for( int i = 0; i < i_loops; i++ )
+    {
+        for( int j = 0; j < CSA_BATCH_MAX; j++ )
+            pkts[j][3] |= 0x80;
+        csa_DecryptBatch( c, pp, CSA_BATCH_MAX, 188 );
+    }
+    mtime_t i_batch = mdate() - i_start;
+
+    const double i_bytes = (double)i_loops * CSA_BATCH_MAX * 188;
+    printf( "decrypt: scalar %.1f MB/s, batch %.1f MB/s\n",
+            i_bytes / __MAX(i_scalar, 1), i_bytes / __MAX(i_batch, 1) );
+}
+
+int main( void )
+{
+    csa_t *c = csa_New();
+    assert( c );
+    set_keys( c );
+    srand( 42 );
+
+    const int sizes[] = { 188, 184, 100, 12 };
+    for( size_t i = 0; i < ARRAY_SIZE(sizes); i++ )
+    {
+        test_decrypt( c, sizes[i] );
+        test_encrypt( c, sizes[i], true );
+        test_encrypt( c, sizes[i], false );
+    }
+
+    bench( c );
+
+    csa_Delete( c );
+    return 0;
+}
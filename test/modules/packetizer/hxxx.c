@@ -112,6 +112,23 @@ static void testannexbin( const uint8_t *p_data, size_t i_data,
             printf("** No output **\n");
             assert(0);
         }
+
+        /* other references to a shared payload must be left untouched */
+        p_block = block_Alloc( i_data );
+        memcpy( p_block->p_buffer, p_data, i_data );
+        p_block = block_Share( p_block );
+        assert( p_block );
+        block_t *p_ref = block_Hold( p_block );
+        assert( p_ref );
+
+        p_block = hxxx_AnnexB_to_xVC( p_block, 1 << i );
+        assert( p_block );
+        assert( p_block->i_buffer == pi_res[i] );
+        assert( memcmp( p_block->p_buffer, pp_res[i], pi_res[i] ) == 0 );
+        assert( p_ref->i_buffer == i_data );
+        assert( memcmp( p_ref->p_buffer, p_data, i_data ) == 0 );
+        block_Release( p_block );
+        block_Release( p_ref );
     }
 }
 #define runtest(number, name, testfunction) \
@@ -0,0 +1,266 @@
+/*****************************************************************************
+ * seekindex.c: test the demuxers seek index cache
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+#include <vlc_fs.h>
+#include <vlc_url.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../../modules/demux/seekindex.h"
+#include "../../libvlc/test.h"
+
+#include <vlc/vlc.h>
+
+#define FORMAT "test 1"
+#define ENTRIES 1000
+
+static vlc_object_t *parent;
+static char *path, *url;
+static char cachedir[] = "/tmp/vlc-test-seekindex.XXXXXX";
+
+static seekindex_t *OpenIndex(const char *format)
+{
+    stream_t *s = vlc_stream_NewURL(parent, url);
+    assert(s != NULL);
+
+    seekindex_t *idx = seekindex_Open(parent, s, format);
+    vlc_stream_Delete(s);
+    assert(idx != NULL);
+    return idx;
+}
+
+static void AppendFile(const char *str)
+{
+    FILE *file = vlc_fopen(path, "ab");
+    assert(file != NULL);
+    fputs(str, file);
+    fclose(file);
+}
+
+static size_t CountCacheFiles(void)
+{
+    char *dirpath;
+    size_t count = 0;
+
+    assert(asprintf(&dirpath, "%s/vlc/seekindex", cachedir) != -1);
+    DIR *dir = vlc_opendir(dirpath);
+    assert(dir != NULL);
+    for (const char *name; (name = vlc_readdir(dir)) != NULL;)
+        if (name[0] != '.')
+            count++;
+    closedir(dir);
+    free(dirpath);
+    return count;
+}
+
+static void FillIndex(seekindex_t *idx)
+{
+    /* Appended in reverse order, to exercise the insertion */
+    for (unsigned i = ENTRIES; i-- > 0;)
+    {
+        seekindex_entry_t entry = {
+            .i_time = i * 1000,
+            .i_offset = i * 188,
+            .i_size = 188,
+            .i_flags = i & 1,
+            .i_track = i % 2,
+        };
+        assert(seekindex_Add(idx, &entry) == VLC_SUCCESS);
+    }
+    assert(seekindex_Count(idx) == ENTRIES);
+    seekindex_SetComplete(idx);
+}
+
+static void CheckIndex(const seekindex_t *idx)
+{
+    const seekindex_entry_t *before, *after;
+
+    assert(seekindex_Count(idx) == ENTRIES);
+    assert(seekindex_IsComplete(idx));
+
+    for (size_t i = 1; i < ENTRIES; i++)
+    {
+        const seekindex_entry_t *prev = seekindex_Get(idx, i - 1);
+        const seekindex_entry_t *cur = seekindex_Get(idx, i);
+
+        assert(prev->i_track < cur->i_track
+            || (prev->i_track == cur->i_track && prev->i_time < cur->i_time));
+    }
+    assert(seekindex_Get(idx, ENTRIES) == NULL);
+
+    assert(seekindex_Lookup(idx, 1, 3500, &before, &after) == VLC_SUCCESS);
+    assert(before != NULL && before->i_time == 3000);
+    assert(before->i_offset == 3 * 188 && before->i_flags == 1);
+    assert(after != NULL && after->i_time == 5000);
+
+    assert(seekindex_Lookup(idx, 0, -1, &before, &after) == VLC_SUCCESS);
+    assert(before == NULL && after != NULL && after->i_time == 0);
+
+    assert(seekindex_Lookup(idx, 2, 0, &before, &after) != VLC_SUCCESS);
+}
+
+static void test_save_load(void)
+{
+    seekindex_t *idx = OpenIndex(FORMAT);
+    assert(seekindex_Count(idx) == 0);
+    FillIndex(idx);
+    seekindex_Close(idx);
+    assert(CountCacheFiles() == 1);
+
+    idx = OpenIndex(FORMAT);
+    CheckIndex(idx);
+    seekindex_Close(idx);
+
+    /* another demuxer does not see the index */
+    idx = OpenIndex("other 1");
+    assert(seekindex_Count(idx) == 0);
+    seekindex_Close(idx);
+}
+
+static void test_invalidation(void)
+{
+    AppendFile("modified");
+
+    seekindex_t *idx = OpenIndex(FORMAT);
+    assert(seekindex_Count(idx) == 0);
+    assert(!seekindex_IsComplete(idx));
+    FillIndex(idx);
+    seekindex_Close(idx);
+
+    idx = OpenIndex(FORMAT);
+    CheckIndex(idx);
+    seekindex_Close(idx);
+
+    /* same size, different modification time */
+    struct utimbuf times = { .actime = 0, .modtime = 0 };
+    assert(utime(path, &times) == 0);
+
+    idx = OpenIndex(FORMAT);
+    assert(seekindex_Count(idx) == 0);
+    seekindex_Close(idx);
+}
+
+static void test_trim(void)
+{
+    char *name;
+
+    /* fill the cache directory with old files */
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        assert(asprintf(&name, "%s/vlc/seekindex/old%u", cachedir, i) != -1);
+        FILE *file = vlc_fopen(name, "wb");
+        assert(file != NULL);
+        fclose(file);
+
+        struct utimbuf times = { .actime = 0, .modtime = i };
+        assert(utime(name, &times) == 0);
+        free(name);
+    }
+    assert(CountCacheFiles() == 1001);
+
+    seekindex_t *idx = OpenIndex(FORMAT);
+    FillIndex(idx);
+    seekindex_Close(idx);
+
+    /* the oldest files were removed, not the new index */
+    assert(CountCacheFiles() == 1000);
+    assert(asprintf(&name, "%s/vlc/seekindex/old0", cachedir) != -1);
+    assert(vlc_stat(name, &(struct stat){ 0 }) != 0);
+    free(name);
+    assert(asprintf(&name, "%s/vlc/seekindex/old1", cachedir) != -1);
+    assert(vlc_stat(name, &(struct stat){ 0 }) == 0);
+    free(name);
+
+    idx = OpenIndex(FORMAT);
+    CheckIndex(idx);
+    seekindex_Close(idx);
+}
+
+static void Cleanup(void)
+{
+    char *dirpath;
+
+    assert(asprintf(&dirpath, "%s/vlc/seekindex", cachedir) != -1);
+    DIR *dir = vlc_opendir(dirpath);
+    if (dir != NULL)
+    {
+        for (const char *name; (name = vlc_readdir(dir)) != NULL;)
+        {
+            char *file;
+
+            if (name[0] == '.')
+                continue;
+            assert(asprintf(&file, "%s/%s", dirpath, name) != -1);
+            vlc_unlink(file);
+            free(file);
+        }
+        closedir(dir);
+    }
+    rmdir(dirpath);
+    free(dirpath);
+    assert(asprintf(&dirpath, "%s/vlc", cachedir) != -1);
+    rmdir(dirpath);
+    free(dirpath);
+    rmdir(cachedir);
+}
+
+int main(void)
+{
+    test_init();
+
+    /* keep the user cache out of the way */
+    assert(mkdtemp(cachedir) != NULL);
+    setenv("XDG_CACHE_HOME", cachedir, 1);
+
+    char tmpl[] = "/tmp/vlc-test-seekindex-file.XXXXXX";
+    int fd = vlc_mkstemp(tmpl);
+    assert(fd != -1);
+    vlc_close(fd);
+    path = tmpl;
+    url = vlc_path2uri(path, NULL);
+    assert(url != NULL);
+    AppendFile("media");
+
+    const char *argv[] = { "-v", "--ignore-config" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+    parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    test_save_load();
+    test_invalidation();
+    test_trim();
+
+    libvlc_release(vlc);
+    Cleanup();
+    vlc_unlink(path);
+    free(url);
+    return 0;
+}
@@ -182,7 +182,7 @@ stream_close( struct reader *p_reader )
 }
 
 static struct reader *
-stream_open( const char *psz_url )
+stream_open( const char *psz_url, bool b_mmap )
 {
     libvlc_instance_t *p_vlc;
     struct reader *p_reader;
@@ -194,6 +194,7 @@ stream_open( const char *psz_url )
         "--no-media-library",
         "--vout=dummy",
         "--aout=dummy",
+        b_mmap ? "--file-mmap" : "--no-file-mmap",
     };
 
     p_reader = calloc( 1, sizeof(struct reader) );
@@ -216,7 +217,7 @@ stream_open( const char *psz_url )
     p_reader->pf_tell = stream_tell;
     p_reader->pf_seek = stream_seek;
     p_reader->p_data = p_vlc;
-    p_reader->psz_name = "stream";
+    p_reader->psz_name = b_mmap ? "stream (mmap)" : "stream";
     return p_reader;
 }
 
@@ -381,10 +382,11 @@ main( void )
     assert( asprintf( &psz_url, "file://%s", psz_tmp_path ) != -1 );
 
     assert( ( pp_readers[0] = libc_open( psz_tmp_path ) ) );
-    assert( ( pp_readers[1] = stream_open( psz_url ) ) );
+    assert( ( pp_readers[1] = stream_open( psz_url, false ) ) );
+    assert( ( pp_readers[2] = stream_open( psz_url, true ) ) );
 
-    test( pp_readers, 2, NULL );
-    for( unsigned int i = 0; i < 2; ++i )
+    test( pp_readers, 3, NULL );
+    for( unsigned int i = 0; i < 3; ++i )
         pp_readers[i]->pf_close( pp_readers[i] );
     free( psz_url );
 
@@ -393,7 +395,7 @@ main( void )
 
     log( "Test http url with stream\n" );
     alarm( 0 );
-    if( !( pp_readers[0] = stream_open( HTTP_URL ) ) )
+    if( !( pp_readers[0] = stream_open( HTTP_URL, false ) ) )
     {
         log( "WARNING: can't test http url" );
         return 0;
@@ -0,0 +1,325 @@
+/*****************************************************************************
+ * block.c: data blocks allocation, sharing and FIFO test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#define TS_PACKETS    200000
+#define TS_PER_DGRAM  7
+
+static void test_sizes(void)
+{
+    static const size_t sizes[] = {
+        0, 1, 188, 400, 1316, 4000, 65000, 66000, 1 << 20,
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+        for (int j = 0; j < 4; j++)
+        {
+            block_t *b = block_Alloc(sizes[i]);
+            assert(b != NULL);
+            assert(b->i_buffer == sizes[i]);
+            assert(((uintptr_t)b->p_buffer % 32) == 0);
+            memset(b->p_buffer, j, b->i_buffer);
+
+            b = block_Realloc(b, 16, sizes[i] + 100);
+            assert(b != NULL);
+            assert(b->i_buffer == sizes[i] + 116);
+            for (size_t k = 0; k < sizes[i]; k++)
+                assert(b->p_buffer[16 + k] == j);
+            block_Release(b);
+        }
+}
+
+/*
+ * TS to UDP remux pattern: the input thread allocates one block per TS
+ * packet, gathers them into datagrams and hands those over to the output
+ * thread, which releases them.
+ */
+static void *output_thread(void *data)
+{
+    block_fifo_t *fifo = data;
+    block_t *dgram;
+
+    while ((dgram = block_FifoGet(fifo))->i_buffer > 0)
+    {
+        assert(dgram->i_buffer == 188 * TS_PER_DGRAM);
+        assert(dgram->p_buffer[0] == 0x47);
+        block_Release(dgram);
+    }
+    block_Release(dgram);
+    return NULL;
+}
+
+static void *input_thread(void *data)
+{
+    block_fifo_t *fifo = data;
+    block_t *chain = NULL, **pp_last = &chain;
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < TS_PACKETS; i++)
+    {
+        block_t *pkt = block_Alloc(188);
+        assert(pkt != NULL);
+        memset(pkt->p_buffer, 0x47, pkt->i_buffer);
+        block_ChainLastAppend(&pp_last, pkt);
+
+        if (++count == TS_PER_DGRAM)
+        {
+            block_t *dgram = block_ChainGather(chain);
+            assert(dgram != NULL);
+            block_FifoPut(fifo, dgram);
+            chain = NULL;
+            pp_last = &chain;
+            count = 0;
+        }
+    }
+    block_ChainRelease(chain);
+    return NULL;
+}
+
+static void bench_remux(bool spsc)
+{
+    block_fifo_t *fifo = spsc ? block_FifoNewSPSC() : block_FifoNew();
+    vlc_thread_t in, out;
+
+    assert(fifo != NULL);
+
+    mtime_t start = mdate();
+    int ret = vlc_clone(&out, output_thread, fifo, VLC_THREAD_PRIORITY_LOW);
+    assert(ret == 0);
+    ret = vlc_clone(&in, input_thread, fifo, VLC_THREAD_PRIORITY_LOW);
+    assert(ret == 0);
+    vlc_join(in, NULL);
+    /* end of stream */
+    block_FifoPut(fifo, block_Alloc(0));
+    vlc_join(out, NULL);
+    mtime_t elapsed = mdate() - start;
+
+    unsigned allocs = TS_PACKETS + TS_PACKETS / TS_PER_DGRAM;
+    printf("remux (%s FIFO): %u allocations in %"PRId64" us "
+           "(%.0f allocations/s)\n", spsc ? "SPSC" : "locked", allocs,
+           elapsed, allocs * (double)CLOCK_FREQ / __MAX(elapsed, 1));
+    block_FifoRelease(fifo);
+}
+
+static void test_shared(void)
+{
+    block_t *b = block_Alloc(188);
+    assert(b != NULL);
+    memset(b->p_buffer, 0x47, b->i_buffer);
+    b->i_dts = 42;
+
+    b = block_Share(b);
+    assert(b != NULL);
+    assert(block_Share(b) == b);
+
+    block_t *ref = block_Hold(b);
+    assert(ref != NULL && ref != b);
+    assert(ref->p_buffer == b->p_buffer);
+    assert(ref->i_buffer == 188 && ref->i_dts == 42);
+
+    /* Growing a reference must not write over the other one */
+    ref = block_Realloc(ref, 4, 200);
+    assert(ref != NULL);
+    memset(ref->p_buffer, 0, ref->i_buffer);
+    for (size_t i = 0; i < b->i_buffer; i++)
+        assert(b->p_buffer[i] == 0x47);
+
+    /* Shrinking in place is fine */
+    block_t *ref2 = block_Hold(b);
+    assert(ref2 != NULL);
+    ref2 = block_Realloc(ref2, -4, 104);
+    assert(ref2 != NULL && ref2->p_buffer == b->p_buffer + 4);
+
+    ref2 = block_Writable(ref2);
+    assert(ref2 != NULL && ref2->p_buffer != b->p_buffer + 4);
+    assert(ref2->i_buffer == 100 && ref2->i_dts == 42);
+    memset(ref2->p_buffer, 0, ref2->i_buffer);
+    for (size_t i = 0; i < b->i_buffer; i++)
+        assert(b->p_buffer[i] == 0x47);
+
+    block_Release(ref);
+    block_Release(ref2);
+
+    /* The last reference is writable as is */
+    uint8_t *p = b->p_buffer;
+    b = block_Writable(b);
+    assert(b != NULL && b->p_buffer == p);
+    block_Release(b);
+}
+
+/*
+ * Duplicate stream output pattern: each datagram is sent to a number of
+ * branches, either as copies or as references to the same payload.
+ */
+static void bench_fanout(size_t size, unsigned branches, bool share)
+{
+    const unsigned count = (64 << 20) / size;
+    block_t *out[4];
+
+    assert(branches <= ARRAY_SIZE(out));
+
+    mtime_t start = mdate();
+    for (unsigned i = 0; i < count; i++)
+    {
+        block_t *dgram = block_Alloc(size);
+        assert(dgram != NULL);
+        memset(dgram->p_buffer, 0x47, size);
+
+        if (share && branches > 1)
+            dgram = block_Share(dgram);
+        for (unsigned j = 0; j < branches - 1; j++)
+        {
+            out[j] = share ? block_Hold(dgram) : block_Duplicate(dgram);
+            assert(out[j] != NULL);
+        }
+        out[branches - 1] = dgram;
+
+        for (unsigned j = 0; j < branches; j++)
+        {
+            assert(out[j]->p_buffer[size - 1] == 0x47);
+            block_Release(out[j]);
+        }
+    }
+    mtime_t elapsed = mdate() - start;
+
+    uint64_t copied = share ? 0 : (uint64_t)count * size * (branches - 1);
+    printf("fan-out of %zu bytes blocks to %u (%s): %.0f MB/s delivered, "
+           "%"PRIu64" bytes copied (%.0f per extra branch)\n", size, branches,
+           share ? "shared" : "copies",
+           (double)count * size * branches / __MAX(elapsed, 1),
+           copied, branches > 1 ? (double)copied / (branches - 1) : 0.);
+}
+
+static void test_fifo(block_fifo_t *fifo)
+{
+    const unsigned count = 1000; /* more than the lock-free ring holds */
+    size_t bytes = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        block_t *b = block_Alloc(i % 7);
+        assert(b != NULL);
+        b->i_dts = i;
+        bytes += b->i_buffer;
+        block_FifoPut(fifo, b);
+    }
+
+    vlc_fifo_Lock(fifo);
+    assert(vlc_fifo_GetCount(fifo) == count);
+    assert(vlc_fifo_GetBytes(fifo) == bytes);
+    vlc_fifo_Unlock(fifo);
+    assert(block_FifoShow(fifo)->i_dts == 0);
+
+    for (unsigned i = 0; i < count / 2; i++)
+    {
+        block_t *b = block_FifoGet(fifo);
+        assert(b->i_dts == i);
+        assert(b->p_next == NULL);
+        block_Release(b);
+    }
+
+    /* Queue more while the older blocks are still pending */
+    block_t *chain = NULL, **pp_last = &chain;
+    for (unsigned i = count; i < count + 10; i++)
+    {
+        block_t *b = block_Alloc(188);
+        assert(b != NULL);
+        b->i_dts = i;
+        block_ChainLastAppend(&pp_last, b);
+    }
+    block_FifoPut(fifo, chain);
+
+    for (unsigned i = count / 2; i < count / 2 + 10; i++)
+    {
+        vlc_fifo_Lock(fifo);
+        block_t *b = vlc_fifo_DequeueUnlocked(fifo);
+        vlc_fifo_Unlock(fifo);
+        assert(b->i_dts == i);
+        block_Release(b);
+    }
+
+    vlc_fifo_Lock(fifo);
+    assert(vlc_fifo_GetCount(fifo) == count / 2);
+    block_t *all = vlc_fifo_DequeueAllUnlocked(fifo);
+    assert(vlc_fifo_IsEmpty(fifo));
+    assert(vlc_fifo_GetBytes(fifo) == 0);
+    vlc_fifo_Unlock(fifo);
+
+    unsigned i = count / 2 + 10;
+    for (block_t *b = all; b != NULL; b = b->p_next)
+        assert(b->i_dts == i++);
+    assert(i == count + 10);
+    block_ChainRelease(all);
+
+    /* The ring is usable again */
+    block_FifoPut(fifo, block_Alloc(1));
+    block_Release(block_FifoGet(fifo));
+    block_FifoPut(fifo, block_Alloc(1));
+    block_FifoRelease(fifo);
+}
+
+static void *test_thread(void *data)
+{
+    (void) data;
+    test_sizes();
+    test_fifo(block_FifoNew());
+    test_fifo(block_FifoNewSPSC());
+    test_shared();
+
+    /* TS datagrams and video frames */
+    static const size_t fanout_sizes[] = { 188 * TS_PER_DGRAM, 1 << 20 };
+    for (size_t i = 0; i < ARRAY_SIZE(fanout_sizes); i++)
+        for (unsigned branches = 1; branches <= 4; branches++)
+        {
+            bench_fanout(fanout_sizes[i], branches, false);
+            bench_fanout(fanout_sizes[i], branches, true);
+        }
+
+    /* Threads exiting with blocks still in flight */
+    for (int i = 0; i < 4; i++)
+    {
+        bench_remux(false);
+        bench_remux(true);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    vlc_thread_t th;
+
+    /* The tests run on their own thread, so that its block cache is
+     * released on exit, like those of the other threads */
+    int ret = vlc_clone(&th, test_thread, NULL, VLC_THREAD_PRIORITY_LOW);
+    assert(ret == 0);
+    vlc_join(th, NULL);
+    return 0;
+}
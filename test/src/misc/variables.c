@@ -443,6 +443,71 @@ static void test_creation_and_type( libvlc_int_t *p_libvlc )
     assert( var_Get( p_libvlc, "bla", &val ) == VLC_ENOVAR );
 }
 
+static void test_handles( libvlc_int_t *p_libvlc )
+{
+    vlc_value_t val, val2;
+
+    assert( var_Hold( p_libvlc, "bla" ) == NULL );
+
+    var_Create( p_libvlc, "bla", VLC_VAR_INTEGER );
+    var_SetInteger( p_libvlc, "bla", -42 );
+    vlc_var_handle_t *h = var_Hold( p_libvlc, "bla" );
+    assert( h != NULL );
+    assert( var_HandleGetInteger( h ) == -42 );
+
+    var_IncInteger( p_libvlc, "bla" );
+    assert( var_HandleGetInteger( h ) == -41 );
+    val.i_int = INT64_MAX;
+    var_Change( p_libvlc, "bla", VLC_VAR_SETVALUE, &val, NULL );
+    assert( var_HandleGetInteger( h ) == INT64_MAX );
+    val.i_int = 0;
+    val2.i_int = 10;
+    var_Change( p_libvlc, "bla", VLC_VAR_SETMINMAX, &val, &val2 );
+    var_SetInteger( p_libvlc, "bla", 100 );
+    assert( var_HandleGetInteger( h ) == 10 );
+
+    /* The handle keeps the variable alive */
+    var_Destroy( p_libvlc, "bla" );
+    assert( var_GetInteger( p_libvlc, "bla" ) == 10 );
+    var_Release( p_libvlc, h );
+    assert( var_Get( p_libvlc, "bla", &val ) == VLC_ENOVAR );
+
+    var_Create( p_libvlc, "bla", VLC_VAR_BOOL );
+    h = var_Hold( p_libvlc, "bla" );
+    assert( !var_HandleGetBool( h ) );
+    var_ToggleBool( p_libvlc, "bla" );
+    assert( var_HandleGetBool( h ) );
+    var_Release( p_libvlc, h );
+    var_Destroy( p_libvlc, "bla" );
+
+    var_Create( p_libvlc, "bla", VLC_VAR_FLOAT );
+    h = var_Hold( p_libvlc, "bla" );
+    assert( var_HandleGetFloat( h ) == 0.f );
+    var_SetFloat( p_libvlc, "bla", -1.5f );
+    assert( var_HandleGetFloat( h ) == -1.5f );
+
+    /* Per-frame reads: by name versus through a handle */
+    const unsigned count = 1000000;
+    float sum = 0.f;
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < count; i++ )
+        sum += var_GetFloat( p_libvlc, "bla" );
+    mtime_t by_name = mdate() - start;
+
+    start = mdate();
+    for( unsigned i = 0; i < count; i++ )
+        sum += var_HandleGetFloat( h );
+    mtime_t by_handle = mdate() - start;
+    assert( sum == -3.f * count );
+
+    log( "%u reads: %.0f/s by name, %.0f/s through a handle\n", count,
+         count * (double)CLOCK_FREQ / __MAX(by_name, 1),
+         count * (double)CLOCK_FREQ / __MAX(by_handle, 1) );
+
+    var_Release( p_libvlc, h );
+    var_Destroy( p_libvlc, "bla" );
+}
+
 static void test_variables( libvlc_instance_t *p_vlc )
 {
     libvlc_int_t *p_libvlc = p_vlc->p_libvlc_int;
@@ -480,6 +545,9 @@ static void test_variables( libvlc_instance_t *p_vlc )
 
     log( "Testing type at creation\n" );
     test_creation_and_type( p_libvlc );
+
+    log( "Testing handles\n" );
+    test_handles( p_libvlc );
 }
 
 
@@ -0,0 +1,193 @@
+/*****************************************************************************
+ * httpd.c: HTTP server stream fan-out test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_httpd.h>
+#include <vlc_network.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#define CLIENTS     64
+#define BLOCK_SIZE  (7 * 188)
+#define BLOCKS      3000 /* less than the stream buffer, no client can lag */
+#define STREAM_SIZE (BLOCK_SIZE * BLOCKS)
+
+static const char header[] = "HEADER";
+
+struct client
+{
+    int fd;
+    vlc_thread_t thread;
+    size_t received;
+};
+
+static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+static vlc_cond_t wait = VLC_STATIC_COND;
+static unsigned ready;
+
+static void *reader(void *data)
+{
+    struct client *cl = data;
+    char buf[65536];
+    size_t len = 0;
+    ssize_t val;
+
+    /* HTTP response head and stream header */
+    while (len < 4 || memcmp(buf + len - 4, "\r\n\r\n", 4))
+    {
+        val = recv(cl->fd, buf + len, 1, 0);
+        assert(val == 1);
+        len++;
+        assert(len < sizeof (buf));
+    }
+    assert(!strncmp(buf, "HTTP/1.0 200 ", 13));
+
+    len = 0;
+    while (len < strlen(header))
+    {
+        val = recv(cl->fd, buf + len, strlen(header) - len, 0);
+        assert(val > 0);
+        len += val;
+    }
+    assert(!memcmp(buf, header, strlen(header)));
+
+    vlc_mutex_lock(&lock);
+    ready++;
+    vlc_cond_signal(&wait);
+    vlc_mutex_unlock(&lock);
+
+    /* Stream data: a wrapping sequence, which must arrive contiguous */
+    while (cl->received < STREAM_SIZE)
+    {
+        val = recv(cl->fd, buf, sizeof (buf), 0);
+        assert(val > 0);
+        for (ssize_t i = 0; i < val; i++)
+            assert((uint8_t)buf[i] == (cl->received + i) % 251);
+        cl->received += val;
+    }
+    assert(cl->received == STREAM_SIZE);
+    return NULL;
+}
+
+static int loopback_port(void)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t len = sizeof (addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    assert(fd != -1);
+    assert(bind(fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    assert(getsockname(fd, (struct sockaddr *)&addr, &len) == 0);
+    net_Close(fd);
+    return ntohs(addr.sin_port);
+}
+
+int main(void)
+{
+    static struct client clients[CLIENTS];
+    char port_opt[32];
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    int port = loopback_port();
+    snprintf(port_opt, sizeof (port_opt), "--http-port=%d", port);
+
+    const char *argv[] = {
+        "-v", "--ignore-config", "--http-host=127.0.0.1", port_opt,
+    };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    httpd_host_t *host = vlc_http_HostNew(obj);
+    assert(host != NULL);
+
+    httpd_stream_t *stream = httpd_StreamNew(host, "/stream",
+                                             "application/octet-stream",
+                                             NULL, NULL);
+    assert(stream != NULL);
+    httpd_StreamHeader(stream, (uint8_t *)header, strlen(header));
+
+    for (unsigned i = 0; i < CLIENTS; i++)
+    {
+        static const char req[] = "GET /stream HTTP/1.0\r\n\r\n";
+        struct client *cl = &clients[i];
+
+        struct sockaddr_in addr = {
+            .sin_family = AF_INET,
+            .sin_port = htons(port),
+            .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        };
+
+        cl->fd = socket(AF_INET, SOCK_STREAM, 0);
+        assert(cl->fd != -1);
+        assert(connect(cl->fd, (struct sockaddr *)&addr,
+                       sizeof (addr)) == 0);
+        assert(send(cl->fd, req, strlen(req), 0) == (ssize_t)strlen(req));
+        assert(vlc_clone(&cl->thread, reader, cl,
+                         VLC_THREAD_PRIORITY_LOW) == 0);
+    }
+
+    vlc_mutex_lock(&lock);
+    while (ready < CLIENTS)
+        vlc_cond_wait(&wait, &lock);
+    vlc_mutex_unlock(&lock);
+
+    mtime_t start = mdate();
+    block_t *block = block_Alloc(BLOCK_SIZE);
+    assert(block != NULL);
+
+    for (size_t pos = 0; pos < STREAM_SIZE; pos += BLOCK_SIZE)
+    {
+        for (size_t i = 0; i < BLOCK_SIZE; i++)
+            block->p_buffer[i] = (pos + i) % 251;
+        httpd_StreamSend(stream, block);
+    }
+    block_Release(block);
+
+    for (unsigned i = 0; i < CLIENTS; i++)
+        vlc_join(clients[i].thread, NULL);
+    mtime_t elapsed = mdate() - start;
+
+    printf("httpd: %u clients, %.1f MB/s fan-out\n", CLIENTS,
+           (double)STREAM_SIZE * CLIENTS / __MAX(elapsed, 1));
+
+    for (unsigned i = 0; i < CLIENTS; i++)
+        net_Close(clients[i].fd);
+    httpd_StreamDelete(stream);
+    httpd_HostDelete(host);
+    libvlc_release(vlc);
+    return 0;
+}